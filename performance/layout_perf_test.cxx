@@ -0,0 +1,77 @@
+#include <iostream>
+
+#include "fast_random.h"
+#include "time_measurer.h"
+#include "perf_profiler.h"
+#include "data_table.h"
+#include "index_all.h"
+
+
+template<typename KeyT, typename ValueT>
+void layout_performance(const IndexType index_type, const int index_param_1, const int index_param_2, const LayoutType layout) {
+
+  size_t n = 10000000;
+  size_t lookup_count = 10000000;
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
+
+  FastRandom rand_gen(0);
+
+  KeyT *keys = new KeyT[n];
+
+  // insert
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>();
+    ValueT value = i + 2048;
+    
+    data_table->insert_tuple(key, value);
+    keys[i] = key;
+  }
+
+  data_index->reorganize();
+
+  ResultSink values;
+  size_t found_count = 0;
+
+  PerfProfiler perf_profiler;
+  TimeMeasurer timer;
+
+  perf_profiler.start();
+  timer.tic();
+
+  for (size_t i = 0; i < lookup_count; ++i) {
+    values.clear();
+    data_index->find(keys[rand_gen.next<uint32_t>() % n], values);
+    found_count += values.size();
+  }
+
+  timer.toc();
+  perf_profiler.stop();
+
+  std::cout << get_index_name(index_type) << ", " 
+            << (layout == LayoutType::AoSLayout ? "AoS" : "SoA") << ": " 
+            << lookup_count * 1.0 / timer.time_us() << " M ops";
+  if (perf_profiler.is_available()) {
+    std::cout << ", " << perf_profiler.llc_misses() * 1.0 / lookup_count << " llc misses/op"
+              << ", " << perf_profiler.l1d_misses() * 1.0 / lookup_count << " l1d misses/op"
+              << ", " << perf_profiler.dtlb_misses() * 1.0 / lookup_count << " dtlb misses/op";
+  }
+  std::cout << " (" << found_count << " found)" << std::endl;
+
+  delete[] keys;
+  keys = nullptr;
+}
+
+int main() {
+
+  for (auto layout : { LayoutType::AoSLayout, LayoutType::SoALayout }) {
+    layout_performance<uint32_t, uint64_t>(IndexType::S_Interpolation, 1, INVALID_INDEX_PARAM, layout);
+    layout_performance<uint32_t, uint64_t>(IndexType::S_Binary, 10, INVALID_INDEX_PARAM, layout);
+    layout_performance<uint32_t, uint64_t>(IndexType::S_KAry, 5, 4, layout);
+    layout_performance<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM, layout);
+  }
+}
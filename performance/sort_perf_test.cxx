@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "fast_random.h"
+#include "time_measurer.h"
+#include "radix_sort.h"
+
+
+template<typename KeyT>
+struct SortEntry {
+  KeyT key_;
+  Uint64 value_;
+};
+
+template<typename KeyT>
+void sort_performance() {
+
+  size_t n = 10000000;
+
+  std::vector<SortEntry<KeyT>> entries(n);
+
+  FastRandom rand_gen(0);
+
+  for (size_t i = 0; i < n; ++i) {
+    entries[i].key_ = rand_gen.next<KeyT>();
+    entries[i].value_ = i;
+  }
+
+  std::vector<SortEntry<KeyT>> std_entries(entries);
+
+  TimeMeasurer timer;
+
+  timer.tic();
+  std::sort(std_entries.begin(), std_entries.end(), 
+    [](const SortEntry<KeyT> &lhs, const SortEntry<KeyT> &rhs) { return lhs.key_ < rhs.key_; });
+  timer.toc();
+
+  std::cout << sizeof(KeyT) * 8 << "-bit keys, std::sort:  " << n * 1.0 / timer.time_us() << " M keys/s" << std::endl;
+
+  timer.tic();
+  radix_sort(entries.data(), n);
+  timer.toc();
+
+  std::cout << sizeof(KeyT) * 8 << "-bit keys, radix_sort: " << n * 1.0 / timer.time_us() << " M keys/s" << std::endl;
+
+  for (size_t i = 0; i < n; ++i) {
+    if (entries[i].key_ != std_entries[i].key_) {
+      std::cout << "incorrect result!" << std::endl;
+      return;
+    }
+  }
+}
+
+int main() {
+  sort_performance<uint32_t>();
+  sort_performance<uint64_t>();
+}
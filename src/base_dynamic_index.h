@@ -11,17 +11,17 @@ public:
 
   virtual ~BaseDynamicIndex() {}
 
-  virtual void scan(const KeyT &key, std::vector<Uint64> &values) override {}
+  virtual void scan(const KeyT &key, ResultSink &values) override {}
 
-  virtual void scan_reverse(const KeyT &key, std::vector<Uint64> &values) override {}
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) override {}
 
-  virtual void scan_full(std::vector<Uint64> &values, const size_t count) override {}
+  virtual void scan_full(ResultSink &values, const size_t count) override {}
 
   virtual void prepare_threads(const size_t thread_count) override {}
 
   virtual void register_thread(const size_t thread_id) override {}
 
-  virtual void reorganize() final {}
+  virtual void reorganize(const size_t thread_count) final {}
 
   virtual void print() const override {}
 
@@ -8,6 +8,7 @@
 #include "generic_key.h"
 #include "generic_data_table.h"
 #include "offset.h"
+#include "result_sink.h"
 
 class BaseGenericIndex {
 
@@ -19,15 +20,43 @@ public:
 
   virtual void insert(const GenericKey &key, const Uint64 &value) = 0;
 
-  virtual void find(const GenericKey &key, std::vector<Uint64> &values) = 0;
+  // read operations write their results into a sink.
+  // see result_sink.h for the supported modes.
+  virtual void find(const GenericKey &key, ResultSink &values) = 0;
 
-  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, std::vector<Uint64> &values) = 0;
+  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, ResultSink &values) = 0;
 
-  virtual void scan(const GenericKey &key, std::vector<Uint64> &values) = 0;
+  virtual void scan(const GenericKey &key, ResultSink &values) = 0;
 
-  virtual void scan_reverse(const GenericKey &key, std::vector<Uint64> &values) = 0;
+  virtual void scan_reverse(const GenericKey &key, ResultSink &values) = 0;
 
-  virtual void scan_full(std::vector<Uint64> &values, const size_t count = std::numeric_limits<std::size_t>::max()) = 0;
+  virtual void scan_full(ResultSink &values, const size_t count = std::numeric_limits<std::size_t>::max()) = 0;
+
+  // convenience wrappers that append results to a vector.
+  void find(const GenericKey &key, std::vector<Uint64> &values) {
+    ResultSink sink(values);
+    find(key, sink);
+  }
+
+  void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, std::vector<Uint64> &values) {
+    ResultSink sink(values);
+    find_range(lhs_key, rhs_key, sink);
+  }
+
+  void scan(const GenericKey &key, std::vector<Uint64> &values) {
+    ResultSink sink(values);
+    scan(key, sink);
+  }
+
+  void scan_reverse(const GenericKey &key, std::vector<Uint64> &values) {
+    ResultSink sink(values);
+    scan_reverse(key, sink);
+  }
+
+  void scan_full(std::vector<Uint64> &values, const size_t count = std::numeric_limits<std::size_t>::max()) {
+    ResultSink sink(values);
+    scan_full(sink, count);
+  }
 
   virtual void erase(const GenericKey &key) = 0;
 
@@ -7,6 +7,10 @@
 
 #include "data_table.h"
 #include "offset.h"
+#include "result_sink.h"
+
+// number of lookups that are interleaved by batched find operations.
+static const size_t PREFETCH_GROUP_SIZE = 16;
 
 template<typename KeyT, typename ValueT>
 class BaseIndex {
@@ -19,21 +23,58 @@ public:
 
   virtual void insert(const KeyT &key, const Uint64 &value) = 0;
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) = 0;
+  // read operations write their results into a sink.
+  // see result_sink.h for the supported modes.
+  virtual void find(const KeyT &key, ResultSink &values) = 0;
+
+  // find values for a batch of keys. values of keys[i] are written to values[i].
+  // indexes that can overlap cache misses across lookups override this method.
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) {
+    for (size_t i = 0; i < count; ++i) {
+      find(keys[i], values[i]);
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) = 0;
+
+  virtual void scan(const KeyT &key, ResultSink &values) = 0;
+
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) = 0;
+
+  virtual void scan_full(ResultSink &values, const size_t count = std::numeric_limits<std::size_t>::max()) = 0;
+
+  // convenience wrappers that append results to a vector.
+  void find(const KeyT &key, std::vector<Uint64> &values) {
+    ResultSink sink(values);
+    find(key, sink);
+  }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) = 0;
+  void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) {
+    ResultSink sink(values);
+    find_range(lhs_key, rhs_key, sink);
+  }
 
-  virtual void scan(const KeyT &key, std::vector<Uint64> &values) = 0;
+  void scan(const KeyT &key, std::vector<Uint64> &values) {
+    ResultSink sink(values);
+    scan(key, sink);
+  }
 
-  virtual void scan_reverse(const KeyT &key, std::vector<Uint64> &values) = 0;
+  void scan_reverse(const KeyT &key, std::vector<Uint64> &values) {
+    ResultSink sink(values);
+    scan_reverse(key, sink);
+  }
 
-  virtual void scan_full(std::vector<Uint64> &values, const size_t count = std::numeric_limits<std::size_t>::max()) = 0;
+  void scan_full(std::vector<Uint64> &values, const size_t count = std::numeric_limits<std::size_t>::max()) {
+    ResultSink sink(values);
+    scan_full(sink, count);
+  }
 
   virtual void erase(const KeyT &key) = 0;
 
   virtual size_t size() const = 0;
 
-  virtual void reorganize() = 0;
+  // build the index from the data table. static indexes use thread_count threads.
+  virtual void reorganize(const size_t thread_count = 1) = 0;
   
   virtual void prepare_threads(const size_t thread_count) = 0;
 
@@ -1,11 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <typeinfo>
+
 #include "base_index.h"
+#include "index_image.h"
+#include "parallel_sort.h"
+#include "simd_search.h"
+
+// memory layout of the sorted entries of a static index.
+enum class LayoutType {
+  AoSLayout = 0, // array of structs: each key is stored next to its value
+  SoALayout,     // struct of arrays: keys and values are stored in separate arrays
+};
 
 template<typename KeyT, typename ValueT>
 class BaseStaticIndex : public BaseIndex<KeyT, ValueT> {
 
-protected:
+public:
   struct KeyValuePair {
     KeyValuePair() : key_(0), value_(0) {}
     KeyValuePair(const KeyT key, const Uint64 value) : key_(key), value_(value) {}
@@ -14,49 +29,72 @@ protected:
     Uint64 value_;
   };
 
-  static bool compare_func(KeyValuePair &lhs, KeyValuePair &rhs) {
-    return lhs.key_ < rhs.key_;
-  }
-
 public:
-  BaseStaticIndex(DataTable<KeyT, ValueT> *table_ptr) : 
-    BaseIndex<KeyT, ValueT>(table_ptr), container_(nullptr), size_(0) {}
+  BaseStaticIndex(DataTable<KeyT, ValueT> *table_ptr, const LayoutType layout = LayoutType::AoSLayout) : 
+    BaseIndex<KeyT, ValueT>(table_ptr), 
+    layout_(layout), container_(nullptr), keys_(nullptr), values_(nullptr), size_(0), 
+    run_values_(nullptr), entry_count_(0), use_value_runs_(true), source_entries_(nullptr), source_count_(0), source_snapshot_(nullptr), leaf_scan_threshold_(0), image_(nullptr), image_size_(0), key_base_(nullptr), value_base_(nullptr), key_shift_(0), value_shift_(0) {}
   
   virtual ~BaseStaticIndex() {
-    delete[] container_;
+    if (image_ != nullptr) {
+      IndexImageReader::unmap_image(image_, image_size_);
+      image_ = nullptr;
+      return;
+    }
+
+    huge_page_delete_array(container_);
     container_ = nullptr;
+
+    huge_page_delete_array(keys_);
+    keys_ = nullptr;
+
+    huge_page_delete_array(values_);
+    values_ = nullptr;
+
+    huge_page_delete_array(run_values_);
+    run_values_ = nullptr;
   }
 
   virtual void insert(const KeyT &key, const Uint64 &value) final {}
   
   virtual void erase(const KeyT &key) final {}
 
-  virtual void scan(const KeyT &key, std::vector<Uint64> &values) final {
+  virtual void scan(const KeyT &key, ResultSink &values) {
     for (size_t i = 0; i < this->size_; ++i) {
-      if (this->container_[i].key_ == key) {
-        values.push_back(this->container_[i].value_);
+      if (this->key_at(i) == key) {
+        if (!this->push_values(i, values)) { return; }
       }
-      if (this->container_[i].key_ > key) {
+      if (this->key_at(i) > key) {
         return;
       }
     }
   }
 
-  virtual void scan_reverse(const KeyT &key, std::vector<Uint64> &values) final {
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) {
     for (int i = this->size_ - 1; i >= 0; --i) {
-      if (this->container_[i].key_ == key) {
-        values.push_back(this->container_[i].value_);
+      if (this->key_at(i) == key) {
+        if (run_values_ == nullptr) {
+          if (!values.push_back(this->value_at(i))) { return; }
+          continue;
+        }
+        for (size_t j = run_end(i); j > this->value_at(i); --j) {
+          if (!values.push_back(run_values_[j - 1])) { return; }
+        }
       }
-      if (this->container_[i].key_ < key) {
+      if (this->key_at(i) < key) {
         return;
       }
     }
   }
 
-  virtual void scan_full(std::vector<Uint64> &values, const size_t count) final {
+  virtual void scan_full(ResultSink &values, const size_t count) {
+    if (run_values_ != nullptr) {
+      values.append(run_values_, std::min(count, entry_count_));
+      return;
+    }
     size_t bound = std::min(count, this->size_);
     for (size_t i = 0; i < bound; ++i) {
-      values.push_back(this->container_[i].value_);
+      if (!values.push_back(this->value_at(i))) { return; }
     }
   }
   
@@ -64,33 +102,617 @@ public:
 
   virtual void register_thread(const size_t thread_id) final {}
 
-  virtual size_t size() const final { return size_; }
+  virtual size_t size() const final { return entry_count_; }
+
+  LayoutType layout() const { return layout_; }
+
+  // write the sorted entries and the inner structure of a reorganized index to an image at path.
+  // returns false if the image could not be written.
+  bool serialize(const std::string &path) const {
+
+    IndexImageWriter writer(path);
+
+    IndexImageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic_ = INDEX_IMAGE_MAGIC;
+    header.version_ = INDEX_IMAGE_VERSION;
+    strncpy(header.index_name_, typeid(*this).name(), INDEX_IMAGE_NAME_SIZE - 1);
+    header.table_size_ = this->table_ptr_->size();
+    header.table_block_capacity_ = this->table_ptr_->get_max_block_capacity();
+    header.table_block_placement_ = uint64_t(this->table_ptr_->get_block_placement());
+
+    writer.write_value(header);
+    writer.write_value(uint64_t(layout_));
+    writer.write_value(uint64_t(size_));
+    writer.write_value(uint64_t(entry_count_));
+
+    // indexes that released the entries keep their own copy.
+    size_t entry_count = (container_ != nullptr || keys_ != nullptr) ? size_ : 0;
+
+    if (layout_ == LayoutType::AoSLayout) {
+      writer.write_array(container_, entry_count);
+    } else {
+      writer.write_array(keys_, entry_count);
+      writer.write_array(values_, entry_count);
+    }
+
+    writer.write_array(run_values_, run_values_ != nullptr ? entry_count_ : 0);
+
+    serialize_inner(writer);
+
+    return writer.close();
+  }
+
+  // build the index from an image written by serialize(), in place of reorganize().
+  // the image is mapped read-only and used without copying, so the index stays read-only.
+  // the index must be created with the same type, parameters and layout as the one that was serialized,
+  // and its data table must hold the same tuples, as values are offsets into it.
+  // only the size, block capacity and block placement of the table are checked.
+  // returns false if the image cannot be read or does not match, and the index must then be discarded.
+  bool load(const std::string &path, const bool populate = false, const bool huge_pages = false) {
+
+    ASSERT(container_ == nullptr && keys_ == nullptr && size_ == 0 && image_ == nullptr, "index is already built");
+
+    IndexImageReader reader(path, populate, huge_pages);
+
+    IndexImageHeader header = reader.read_value<IndexImageHeader>();
+    if (!reader.is_valid() || header.magic_ != INDEX_IMAGE_MAGIC || header.version_ != INDEX_IMAGE_VERSION) {
+      return false;
+    }
+    if (strncmp(header.index_name_, typeid(*this).name(), INDEX_IMAGE_NAME_SIZE - 1) != 0) {
+      return false;
+    }
+    if (header.table_size_ != this->table_ptr_->size() ||
+        header.table_block_capacity_ != this->table_ptr_->get_max_block_capacity() ||
+        header.table_block_placement_ != uint64_t(this->table_ptr_->get_block_placement())) {
+      return false;
+    }
+    if (reader.read_value<uint64_t>() != uint64_t(layout_)) {
+      return false;
+    }
+
+    size_t size = reader.read_value<uint64_t>();
+    size_t entry_count = reader.read_value<uint64_t>();
+    size_t count = 0;
+
+    if (layout_ == LayoutType::AoSLayout) {
+      container_ = reader.read_array<KeyValuePair>(count);
+    } else {
+      size_t value_count = 0;
+      keys_ = reader.read_array<KeyT>(count);
+      values_ = reader.read_array<Uint64>(value_count);
+      count = (value_count == count) ? count : size + 1;
+    }
+
+    size_t run_value_count = 0;
+    run_values_ = reader.read_array<Uint64>(run_value_count);
+
+    // arrays in the image are never released by the index
+    reader.release(image_, image_size_);
+
+    if (!reader.is_valid() || (count != size && count != 0) || (run_value_count != entry_count && run_value_count != 0)) {
+      return false;
+    }
+
+    size_ = size;
+    entry_count_ = entry_count;
+
+    if (run_value_count == 0) {
+      run_values_ = nullptr;
+    }
+
+    if (count == 0) {
+      container_ = nullptr;
+      keys_ = nullptr;
+      values_ = nullptr;
+    } else {
+      construct_bases();
+    }
+
+    return load_inner(reader) && reader.is_valid();
+  }
+
+  // build the index from a snapshot of the data table, which other threads may keep inserting into.
+  void reorganize_snapshot(const DataTableSnapshot<KeyT, ValueT> &snapshot, const size_t thread_count = 1) {
+    source_snapshot_ = &snapshot;
+    this->reorganize(thread_count);
+    source_snapshot_ = nullptr;
+  }
+
+  // build the index from count entries sorted by key, in place of the tuples of the data table.
+  // the data table is not read, so it may grow while the index is built.
+  void reorganize_from(const KeyValuePair *entries, const size_t count, const size_t thread_count = 1) {
+    source_entries_ = entries;
+    source_count_ = count;
+    this->reorganize(thread_count);
+    source_entries_ = nullptr;
+    source_count_ = 0;
+  }
+
+  // write the size() entries of a reorganized index to entries, sorted by key.
+  // equal keys keep the order of their values.
+  virtual void export_entries(KeyValuePair *entries) const {
+    size_t position = 0;
+    for (size_t i = 0; i < size_; ++i) {
+      if (run_values_ == nullptr) {
+        entries[position++] = KeyValuePair(key_at(i), value_at(i));
+        continue;
+      }
+      for (size_t j = value_at(i); j < run_end(i); ++j) {
+        entries[position++] = KeyValuePair(key_at(i), run_values_[j]);
+      }
+    }
+  }
+
+  // let reorganize collapse equal keys into value runs, if they are repeated often enough. enabled by default.
+  void set_value_runs(const bool use_value_runs) {
+    use_value_runs_ = use_value_runs;
+  }
+
+  // whether reorganize collapsed equal keys into value runs.
+  bool has_value_runs() const { return run_values_ != nullptr; }
+
+  // let leaf searches switch from binary search to a linear scan 
+  // once the remaining range fits in this many cachelines. 0 disables the scan.
+  void set_leaf_scan_cachelines(const size_t cachelines) {
+    size_t entry_size = (layout_ == LayoutType::SoALayout) ? sizeof(KeyT) : sizeof(KeyValuePair);
+    leaf_scan_threshold_ = cachelines * 64 / entry_size; // 64-byte cachelines
+  }
 
 protected:
-  void base_reorganize() {
+  // write the inner structure, after the sorted entries.
+  virtual void serialize_inner(IndexImageWriter &writer) const = 0;
+
+  // set up the inner structure from an image, after the sorted entries have been loaded.
+  // arrays may be used in place. returns false if the image does not match the index.
+  virtual bool load_inner(IndexImageReader &reader) = 0;
+
+  // whether the index was loaded from an image, whose arrays must not be released.
+  bool is_image() const { return image_ != nullptr; }
+
+  // the i-th smallest key. in the SoA layout, reading keys never touches values.
+  KeyT key_at(const size_t offset) const {
+    return *reinterpret_cast<const KeyT*>(key_base_ + (offset << key_shift_));
+  }
+
+  Uint64 value_at(const size_t offset) const {
+    return *reinterpret_cast<const Uint64*>(value_base_ + (offset << value_shift_));
+  }
+
+  void prefetch_key(const size_t offset) const {
+    __builtin_prefetch(key_base_ + (offset << key_shift_));
+  }
+
+  // with value runs, entries hold distinct keys, and the value of an entry is the start 
+  // of the run of values of its key in run_values_. the run ends where the next one starts.
+  size_t run_end(const size_t offset) const {
+    return (offset + 1 < size_) ? value_at(offset + 1) : entry_count_;
+  }
+
+  // push all values of the entry at offset: its value, or the run of values of its key.
+  // return false if the sink does not accept any more values.
+  bool push_values(const size_t offset, ResultSink &values) const {
+    if (run_values_ == nullptr) {
+      return values.push_back(value_at(offset));
+    }
+    size_t begin = value_at(offset);
+    return values.append(run_values_ + begin, run_end(offset) - begin);
+  }
+
+  // interleaved binary search in leaf nodes.
+  // for each key, search entries in [offset_begins[i], offset_ends[i]] (both inclusive), 
+  // and store the offset of a matching entry into offsets[i], or size_ if there is no match.
+  // the probes of all keys proceed in lockstep, and the next probe of each key is prefetched, 
+  // so that the cache misses of different lookups overlap.
+  void find_internal_batch(const KeyT *keys, const size_t count, const int *offset_begins, const int *offset_ends, size_t *offsets) const {
+
+    ASSERT(count <= PREFETCH_GROUP_SIZE, "exceed prefetch group size: " << count);
+
+    size_t bases[PREFETCH_GROUP_SIZE];
+    size_t lengths[PREFETCH_GROUP_SIZE];
+
+    for (size_t i = 0; i < count; ++i) {
+      if (offset_begins[i] > offset_ends[i]) {
+        lengths[i] = 0;
+        continue;
+      }
+      bases[i] = offset_begins[i];
+      lengths[i] = offset_ends[i] - offset_begins[i] + 1;
+      prefetch_key(bases[i] + lengths[i] / 2);
+    }
+
+    bool has_active = true;
+    while (has_active) {
+      has_active = false;
+      for (size_t i = 0; i < count; ++i) {
+        if (lengths[i] <= 1) { continue; }
+
+        size_t half = lengths[i] / 2;
+        bases[i] = (key_at(bases[i] + half) < keys[i]) ? bases[i] + half : bases[i];
+        lengths[i] -= half;
+
+        prefetch_key(bases[i] + lengths[i] / 2);
+        has_active = true;
+      }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      offsets[i] = size_;
+      if (lengths[i] == 0) { continue; }
+
+      size_t offset = bases[i] + (key_at(bases[i]) < keys[i]);
+      if (offset <= (size_t)offset_ends[i] && key_at(offset) == keys[i]) {
+        offsets[i] = offset;
+      }
+    }
+  }
+
+  // search entries [offset_begin, offset_end] (both inclusive) for key,
+  // and return the offset of a matching entry, or size_ if there is no match.
+  // the binary search is branch-free: each step picks the next half with a conditional move,
+  // and prefetches the midpoints of both halves it may continue with.
+  // ranges of at most leaf_scan_threshold_ entries are finished by a linear scan.
+  size_t find_leaf(const KeyT &key, const int64_t offset_begin, const int64_t offset_end) const {
+
+    int64_t last_offset = std::min(offset_end, int64_t(size_) - 1);
+    if (offset_begin > last_offset) {
+      return size_;
+    }
+
+    size_t base = offset_begin;
+    size_t length = last_offset - offset_begin + 1;
+
+    while (length > 1 && length > leaf_scan_threshold_) {
+      size_t half = length / 2;
+      size_t next_half = (length - half) / 2;
+
+      prefetch_key(base + next_half);
+      prefetch_key(base + half + next_half);
+
+      base = (key_at(base + half) < key) ? base + half : base;
+      length -= half;
+    }
 
-    ASSERT(container_ == nullptr && size_ == 0, "invalid container");
+    size_t offset = base + count_less(key, base, length);
 
-    size_t capacity = 0;
-    capacity = this->table_ptr_->size();
+    if (offset <= size_t(last_offset) && key_at(offset) == key) {
+      return offset;
+    }
+    return size_;
+  }
+
+  // number of keys smaller than key in entries [offset, offset + length).
+  size_t count_less(const KeyT &key, const size_t offset, const size_t length) const {
+    if (keys_ != nullptr) {
+      return simd_count_less(keys_ + offset, key, length);
+    }
+    size_t count = 0;
+    for (size_t i = offset; i < offset + length; ++i) {
+      count += (key_at(i) < key);
+    }
+    return count;
+  }
+
+  // offset of the first entry whose key is not smaller than key, or size_ if there is none.
+  size_t lower_bound_offset(const KeyT &key) const {
+    size_t base = 0;
+    size_t length = size_;
+    while (length > 0) {
+      size_t half = length / 2;
+      if (key_at(base + half) < key) {
+        base += half + 1;
+        length -= half + 1;
+      } else {
+        length = half;
+      }
+    }
+    return base;
+  }
+
+  // collect the values of all entries whose keys are in [lhs_key, rhs_key],
+  // given that the first such entry lies in [offset_begin, offset_end + 1].
+  // the lower bound is searched within the given range, and values are then streamed out 
+  // of the contiguous entries that follow it.
+  void collect_range(const KeyT &lhs_key, const KeyT &rhs_key, const int64_t offset_begin, const int64_t offset_end, ResultSink &values) const {
+
+    size_t lhs_offset = std::min(size_t(std::max(offset_begin, int64_t(0))), size_);
+    size_t rhs_offset = std::min(size_t(std::max(offset_end + 1, int64_t(0))), size_);
+
+    // the lower bound is one of the (length) candidates starting at base
+    size_t base = lhs_offset;
+    size_t length = std::max(rhs_offset, lhs_offset) - lhs_offset + 1;
+
+    while (length > 1) {
+      size_t half = length / 2;
+      base = (key_at(base + half - 1) < lhs_key) ? base + half : base;
+      length -= half;
+    }
+
+    // with duplicate keys, an inner layer may hit a copy of lhs_key that is not the first one.
+    while (base > 0 && !(key_at(base - 1) < lhs_key)) {
+      --base;
+    }
+
+    if (run_values_ == nullptr) {
+      for (size_t offset = base; offset < size_ && !(rhs_key < key_at(offset)); ++offset) {
+        if (!values.push_back(value_at(offset))) { return; }
+      }
+      return;
+    }
+
+    // the runs of all keys in the range are contiguous
+    size_t end = base;
+    while (end < size_ && !(rhs_key < key_at(end))) {
+      ++end;
+    }
+    if (end > base) {
+      size_t begin = value_at(base);
+      values.append(run_values_ + begin, run_end(end - 1) - begin);
+    }
+  }
+
+  // collect the values of all entries that are equal to key, 
+  // given the offset of one matching entry.
+  void collect_values(const KeyT &key, const size_t offset_find, ResultSink &values) const {
+
+    // keys are distinct, and the run holds all values of key.
+    if (run_values_ != nullptr) {
+      push_values(offset_find, values);
+      return;
+    }
+
+    if (!values.push_back(value_at(offset_find))) { return; }
+
+    // move left
+    int64_t offset_find_lhs = offset_find - 1;
+    while (offset_find_lhs >= 0 && key_at(offset_find_lhs) == key) {
+      if (!values.push_back(value_at(offset_find_lhs))) { return; }
+      offset_find_lhs -= 1;
+    }
+    // move right
+    size_t offset_find_rhs = offset_find + 1;
+    while (offset_find_rhs < size_ && key_at(offset_find_rhs) == key) {
+      if (!values.push_back(value_at(offset_find_rhs))) { return; }
+      offset_find_rhs += 1;
+    }
+  }
+
+  // copy all tuples from a snapshot of the data table, sort them by key, and lay them out as layout_.
+  // inner layers that need more than min_size entries keep equal keys from being collapsed below that.
+  void base_reorganize(const size_t thread_count = 1, const size_t min_size = 0) {
+
+    ASSERT(container_ == nullptr && keys_ == nullptr && size_ == 0, "invalid container");
+
+    // entries given to reorganize_from() are already sorted.
+    if (source_entries_ != nullptr) {
+      container_ = huge_page_new_array<KeyValuePair>(source_count_);
+      run_parallel(thread_count, [&](const size_t thread_id) {
+        size_t begin = source_count_ * thread_id / thread_count;
+        size_t end = source_count_ * (thread_id + 1) / thread_count;
+        std::copy(source_entries_ + begin, source_entries_ + end, container_ + begin);
+      });
+      size_ = source_count_;
+
+      construct_layout(thread_count, min_size);
+      return;
+    }
+
+    // a snapshot of the data table, unless one was given to reorganize_snapshot()
+    DataTableSnapshot<KeyT, ValueT> table_snapshot;
+    const DataTableSnapshot<KeyT, ValueT> *snapshot = source_snapshot_;
+    if (snapshot == nullptr) {
+      this->table_ptr_->take_snapshot(table_snapshot);
+      snapshot = &table_snapshot;
+    }
+
+    size_t capacity = snapshot->size();
     
-    container_ = new KeyValuePair[capacity];
+    container_ = huge_page_new_array<KeyValuePair>(capacity);
+
+    // each thread copies a range of data blocks into the positions that a serial scan of the table would have used.
+    size_t block_count = snapshot->block_count();
+
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      for (size_t block_id = thread_id; block_id < block_count; block_id += thread_count) {
+        size_t block_size = snapshot->block_size(block_id);
+        KeyValuePair *dst = container_ + snapshot->block_offset(block_id);
+        for (size_t rel_offset = 0; rel_offset < block_size; ++rel_offset) {
+          dst[rel_offset].key_ = *(snapshot->get_tuple_key(block_id, rel_offset));
+          dst[rel_offset].value_ = OffsetT::construct_raw_data(block_id, rel_offset);
+        }
+      }
+    });
+
+    size_ = capacity;
+
+    if (thread_count <= 1) {
+      sort_by_key(container_, size_);
+    } else {
+      parallel_sort(container_, size_, thread_count);
+    }
+
+    construct_layout(thread_count, min_size);
+  }
+
+  // drop the sorted entries once the index serves lookups from a copy of its own. size_ is kept.
+  void release_entries() {
+    huge_page_delete_array(run_values_);
+    run_values_ = nullptr;
 
-    DataTableIterator<KeyT, ValueT> iterator(this->table_ptr_);
-    while (iterator.has_next()) {
-      auto entry = iterator.next();
-      container_[size_].key_ = *(entry.key_);
-      container_[size_].value_ = entry.offset_;
-      ++size_;
+    huge_page_delete_array(container_);
+    container_ = nullptr;
+
+    huge_page_delete_array(keys_);
+    keys_ = nullptr;
+
+    huge_page_delete_array(values_);
+    values_ = nullptr;
+
+    key_base_ = nullptr;
+    value_base_ = nullptr;
+  }
+
+  // set up key_at() and value_at() on the sorted container_.
+  // in the SoA layout, container_ is split into keys_ and values_ and then released.
+  void construct_layout(const size_t thread_count, const size_t min_size = 0) {
+
+    static_assert((sizeof(KeyValuePair) & (sizeof(KeyValuePair) - 1)) == 0, "entry size must be a power of 2");
+
+    entry_count_ = size_;
+
+    if (use_value_runs_) {
+      construct_value_runs(thread_count, min_size);
+    }
+
+    if (layout_ == LayoutType::AoSLayout) {
+      construct_bases();
+      return;
     }
 
-    std::sort(container_, container_ + size_, compare_func);
+    keys_ = huge_page_new_array<KeyT>(size_);
+    values_ = huge_page_new_array<Uint64>(size_);
+
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      for (size_t i = size_ * thread_id / thread_count; i < size_ * (thread_id + 1) / thread_count; ++i) {
+        keys_[i] = container_[i].key_;
+        values_[i] = container_[i].value_;
+      }
+    });
 
+    huge_page_delete_array(container_);
+    container_ = nullptr;
+
+    construct_bases();
+  }
+
+  // collapse the equal keys of the sorted container_ into one entry each, whose value is
+  // the start of the run of their values in run_values_. lookups then locate a key once, 
+  // and return its values as a contiguous span.
+  // keys are only collapsed if they are repeated twice on average, so that the run values
+  // take no more memory than the entries they replace, and if more than min_size keys are distinct.
+  void construct_value_runs(const size_t thread_count, const size_t min_size) {
+
+    // entries that start a run, per thread
+    std::vector<size_t> run_counts(thread_count + 1, 0);
+
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      size_t run_count = 0;
+      for (size_t i = size_ * thread_id / thread_count; i < size_ * (thread_id + 1) / thread_count; ++i) {
+        run_count += (i == 0 || container_[i].key_ != container_[i - 1].key_);
+      }
+      run_counts[thread_id + 1] = run_count;
+    });
+
+    for (size_t thread_id = 0; thread_id < thread_count; ++thread_id) {
+      run_counts[thread_id + 1] += run_counts[thread_id];
+    }
+
+    size_t run_count = run_counts[thread_count];
+    if (size_ == 0 || run_count * 2 > size_ || run_count <= min_size) {
+      return;
+    }
+
+    KeyValuePair *runs = huge_page_new_array<KeyValuePair>(run_count);
+    run_values_ = huge_page_new_array<Uint64>(size_);
+
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      size_t run_id = run_counts[thread_id];
+      for (size_t i = size_ * thread_id / thread_count; i < size_ * (thread_id + 1) / thread_count; ++i) {
+        run_values_[i] = container_[i].value_;
+        if (i == 0 || container_[i].key_ != container_[i - 1].key_) {
+          runs[run_id++] = KeyValuePair(container_[i].key_, i);
+        }
+      }
+    });
+
+    huge_page_delete_array(container_);
+    container_ = runs;
+    size_ = run_count;
+  }
+
+  // point key_at() and value_at() to container_, or to keys_ and values_.
+  void construct_bases() {
+    if (layout_ == LayoutType::AoSLayout) {
+      key_base_ = reinterpret_cast<const char*>(&(container_[0].key_));
+      value_base_ = reinterpret_cast<const char*>(&(container_[0].value_));
+      key_shift_ = __builtin_ctzll(sizeof(KeyValuePair));
+      value_shift_ = __builtin_ctzll(sizeof(KeyValuePair));
+    } else {
+      key_base_ = reinterpret_cast<const char*>(keys_);
+      value_base_ = reinterpret_cast<const char*>(values_);
+      key_shift_ = __builtin_ctzll(sizeof(KeyT));
+      value_shift_ = __builtin_ctzll(sizeof(Uint64));
+    }
+  }
+
+  // an inner layer construction task: build the subtree whose root is 
+  // inner node (base_pos + dst_pos) in layer and covers entries [begin_offset, end_offset].
+  struct InnerLayerTask {
+    InnerLayerTask(const int begin_offset, const int end_offset, const size_t base_pos, const size_t dst_pos, const size_t layer) :
+      begin_offset_(begin_offset), end_offset_(end_offset), base_pos_(base_pos), dst_pos_(dst_pos), layer_(layer) {}
+
+    int begin_offset_;
+    int end_offset_;
+    size_t base_pos_;
+    size_t dst_pos_;
+    size_t layer_;
+  };
+
+  // run inner layer construction tasks on thread_count threads.
+  template<typename FuncT>
+  static void run_inner_layer_tasks(const std::vector<InnerLayerTask> &tasks, const size_t thread_count, FuncT func) {
+    size_t task_thread_count = std::min(thread_count, tasks.size());
+    run_parallel(task_thread_count, [&](const size_t thread_id) {
+      for (size_t i = thread_id; i < tasks.size(); i += task_thread_count) {
+        func(tasks[i]);
+      }
+    });
   }
 
 protected:
 
+  LayoutType layout_;
+
+  // AoS layout
   KeyValuePair *container_;
+
+  // SoA layout
+  KeyT *keys_;
+  Uint64 *values_;
+
+  // number of entries, or of distinct keys with value runs
   size_t size_;
 
+  // values of all entries in key order, with value runs
+  Uint64 *run_values_;
+  size_t entry_count_;
+
+  // whether reorganize may collapse equal keys into value runs
+  bool use_value_runs_;
+
+  // sorted entries that reorganize_from() builds the index from, instead of the data table
+  const KeyValuePair *source_entries_;
+  size_t source_count_;
+
+  // snapshot that reorganize_snapshot() builds the index from
+  const DataTableSnapshot<KeyT, ValueT> *source_snapshot_;
+
+  // unit: entries
+  size_t leaf_scan_threshold_;
+
+  // the mapped image that the index was loaded from, if any
+  char *image_;
+  size_t image_size_;
+
+private:
+  // the i-th key is at key_base_ + (i << key_shift_), in either layout.
+  const char *key_base_;
+  const char *value_base_;
+  size_t key_shift_;
+  size_t value_shift_;
+
 };
+
+// creates an empty static index of a fixed type, for indexes that build new versions of it over time.
+template<typename KeyT, typename ValueT>
+using StaticIndexFactory = std::function<BaseStaticIndex<KeyT, ValueT>*()>;
@@ -10,20 +10,33 @@ const uint64_t MaxBlockCapacity = 1000;
 class DataBlock {
 
   public:
-    DataBlock(const BlockIDT block_id, const size_t tuple_size, const uint64_t max_block_capacity) : 
+    // tuples, if given, is storage for max_block_capacity tuples that the caller keeps owning.
+    // otherwise the block allocates its own with huge_page_new_array().
+    DataBlock(const BlockIDT block_id, const size_t tuple_size, const uint64_t max_block_capacity, char *tuples = nullptr) : 
       block_id_(block_id),
       tuple_size_(tuple_size), 
-      max_rel_offset_(max_block_capacity) {
+      max_rel_offset_(max_block_capacity),
+      owns_tuples_(tuples == nullptr) {
       
       next_rel_offset_ = 0;
 
-      tuples_ = new char[tuple_size_ * max_rel_offset_];
+      tuples_ = owns_tuples_ ? huge_page_new_array<char>(tuple_size_ * max_rel_offset_) : tuples;
       memset(tuples_, 0, tuple_size_ * max_rel_offset_);
+
+      written_bitmap_ = new std::atomic<uint64_t>[(max_rel_offset_ + 63) / 64];
+      for (size_t i = 0; i < (max_rel_offset_ + 63) / 64; ++i) {
+        written_bitmap_[i].store(0, std::memory_order_relaxed);
+      }
     }
 
     ~DataBlock() {
-      delete[] tuples_;
+      if (owns_tuples_) {
+        huge_page_delete_array(tuples_);
+      }
       tuples_ = nullptr;
+
+      delete[] written_bitmap_;
+      written_bitmap_ = nullptr;
     }
 
     RelOffsetT get_next_rel_offset() {
@@ -35,6 +48,17 @@ class DataBlock {
       }
     }
 
+    // called once the tuple at rel_offset, handed out by get_next_rel_offset(), has been written.
+    // publishes the tuple to threads that see is_written(rel_offset).
+    void finish_tuple(const RelOffsetT rel_offset) {
+      written_bitmap_[rel_offset / 64].fetch_or(uint64_t(1) << (rel_offset % 64), std::memory_order_release);
+    }
+
+    // tuples are written in any order, so a later tuple may be written before an earlier one.
+    bool is_written(const RelOffsetT rel_offset) const {
+      return (written_bitmap_[rel_offset / 64].load(std::memory_order_acquire) >> (rel_offset % 64)) & 1;
+    }
+
     char* get_tuple(const RelOffsetT rel_offset) const {
       ASSERT(rel_offset < max_rel_offset_, "wrong offset: " << rel_offset << " " << max_rel_offset_);
       return tuples_ + rel_offset * tuple_size_;
@@ -62,7 +86,10 @@ class DataBlock {
     BlockIDT block_id_;
 
     std::atomic<RelOffsetT> next_rel_offset_;
+    // one bit per tuple, set once the tuple has been written.
+    std::atomic<uint64_t> *written_bitmap_;
 
     size_t tuple_size_;
     char *tuples_;
+    bool owns_tuples_;
 };
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <thread>
 #include <vector>
 
 #include "data_block.h"
@@ -8,31 +11,129 @@
 template<typename KeyT, typename ValueT>
 class DataTableIterator;
 
+// where insert_tuple() puts new tuples.
+enum class BlockPlacement {
+  SharedBlock = 0, // all threads fill a single active block
+  NumaLocalBlock,  // threads fill the active block of their numa node, whose tuples are allocated on that node
+  CoreLocalBlock,  // threads fill the active block of their core, so that pinned threads never share one
+};
+
+inline const char* get_block_placement_name(const BlockPlacement block_placement) {
+  switch (block_placement) {
+    case BlockPlacement::SharedBlock: return "shared";
+    case BlockPlacement::NumaLocalBlock: return "numa-local";
+    case BlockPlacement::CoreLocalBlock: return "core-local";
+  }
+  return "unknown";
+}
+
+// the blocks of a data table and the tuples in them when the snapshot was taken.
+// all tuples in a snapshot have been written, and later inserts do not change it.
+// with several active blocks, any block may be partly filled.
+template<typename KeyT, typename ValueT>
+struct DataTableSnapshot {
+  DataTableSnapshot() : block_offsets_(1, 0) {}
+
+  size_t size() const {
+    return block_offsets_.back();
+  }
+
+  size_t block_count() const {
+    return blocks_.size();
+  }
+
+  size_t block_size(const BlockIDT block_id) const {
+    return block_offsets_[block_id + 1] - block_offsets_[block_id];
+  }
+
+  // number of tuples in the blocks before block_id.
+  size_t block_offset(const BlockIDT block_id) const {
+    return block_offsets_[block_id];
+  }
+
+  const KeyT* get_tuple_key(const BlockIDT block_id, const RelOffsetT rel_offset) const {
+    return reinterpret_cast<const KeyT*>(blocks_[block_id]->get_tuple(rel_offset));
+  }
+
+  std::vector<DataBlock*> blocks_;
+  // block_count() + 1 entries
+  std::vector<size_t> block_offsets_;
+};
+
 template<typename KeyT, typename ValueT>
 class DataTable {
 
   friend DataTableIterator<KeyT, ValueT>;
 
+  // one cacheline per active block, so that threads filling different blocks do not share lines.
+  // only the thread that takes the last tuple of block_ adds the next block, 
+  // so the chunk that blocks are carved from needs no lock.
+  struct alignas(64) ActiveBlock {
+    std::atomic<DataBlock*> block_;
+    // the numa node that chunks are bound to
+    size_t node_;
+    char *chunk_;
+    size_t chunk_offset_;
+    std::vector<char*> chunks_;
+  };
+
+  // blocks are published in a two-level directory. segments are allocated as the table grows,
+  // and never move, so readers need no lock.
+  static const size_t DIRECTORY_SEGMENT_BITS = 14; // blocks per segment: 16K
+  static const size_t DIRECTORY_SEGMENT_COUNT = 1 << 12; // blocks per table: 64M
+
 public:
-  DataTable(const uint64_t max_block_capacity = MaxBlockCapacity) {
+  DataTable(const uint64_t max_block_capacity = MaxBlockCapacity, const BlockPlacement block_placement = BlockPlacement::SharedBlock) : 
+    block_count_(0), block_placement_(block_placement) {
 
     max_block_capacity_ = max_block_capacity;
 
-    data_blocks_.emplace_back(new DataBlock(0, sizeof(KeyT) + sizeof(ValueT), max_block_capacity_));
-    active_data_block_ = data_blocks_.at(0);
+    for (size_t segment_id = 0; segment_id < DIRECTORY_SEGMENT_COUNT; ++segment_id) {
+      segments_[segment_id].store(nullptr);
+    }
+
+    const NumaTopology &topology = numa_topology();
+    if (block_placement_ == BlockPlacement::NumaLocalBlock) {
+      active_block_count_ = topology.node_count();
+    } else if (block_placement_ == BlockPlacement::CoreLocalBlock) {
+      active_block_count_ = topology.core_nodes_.size();
+    } else {
+      active_block_count_ = 1;
+    }
+
+    active_blocks_ = aligned_new_array<ActiveBlock>(active_block_count_);
+    for (size_t active_id = 0; active_id < active_block_count_; ++active_id) {
+      ActiveBlock *active_block = new (&active_blocks_[active_id]) ActiveBlock();
+      active_block->node_ = (block_placement_ == BlockPlacement::NumaLocalBlock) ? active_id : topology.node_of_core(active_id);
+      active_block->chunk_ = nullptr;
+      active_block->chunk_offset_ = 0;
+      active_block->block_.store(add_block(*active_block));
+    }
   }
   
   ~DataTable() {
-    for (auto entry : data_blocks_) {
-      delete entry;
-      entry = nullptr;
+    for (size_t block_id = 0; block_id < block_count_.load(); ++block_id) {
+      delete get_block(block_id);
+    }
+    for (size_t segment_id = 0; segment_id < DIRECTORY_SEGMENT_COUNT; ++segment_id) {
+      delete[] segments_[segment_id].load();
+    }
+    for (size_t active_id = 0; active_id < active_block_count_; ++active_id) {
+      for (auto chunk : active_blocks_[active_id].chunks_) {
+        huge_page_delete_array(chunk);
+      }
+      active_blocks_[active_id].~ActiveBlock();
     }
+    aligned_delete_array(active_blocks_);
+    active_blocks_ = nullptr;
   }
 
   OffsetT insert_tuple(const KeyT &key, const ValueT &value) {
 
+    ActiveBlock &active_block = active_blocks_[active_block_id()];
+
     while (true) {
-      DataBlock* tmp_block = active_data_block_;
+      DataBlock* tmp_block = active_block.block_.load();
 
       RelOffsetT rel_offset = tmp_block->get_next_rel_offset();
 
@@ -45,63 +146,192 @@ public:
         memcpy(data, &key, sizeof(key));
         memcpy(data + sizeof(key), &value, sizeof(ValueT));
 
-        if (rel_offset == tmp_block->get_max_rel_offset() - 1) {
-          auto new_block = new DataBlock(tmp_block->get_block_id() + 1, sizeof(KeyT) + sizeof(ValueT), max_block_capacity_);
-          data_blocks_.emplace_back(new_block);
-
-          COMPILER_MEMORY_FENCE;
+        tmp_block->finish_tuple(rel_offset);
 
-          active_data_block_ = new_block;
+        if (rel_offset == tmp_block->get_max_rel_offset() - 1) {
+          active_block.block_.store(add_block(active_block));
         }
 
         return tuple_offset;
       }
+
+      // the block is full, and the thread that took its last tuple is adding the next one.
+      std::this_thread::yield();
     }
   }
 
   KeyT* get_tuple_key(const BlockIDT block_id, const RelOffsetT rel_offset) const {
 
-    char *data = data_blocks_.at(block_id)->get_tuple(rel_offset);
+    char *data = get_block(block_id)->get_tuple(rel_offset);
     return (KeyT*)(data);
   }
 
   ValueT* get_tuple_value(const BlockIDT block_id, const RelOffsetT rel_offset) const {
 
-    char *data = data_blocks_.at(block_id)->get_tuple(rel_offset);
+    char *data = get_block(block_id)->get_tuple(rel_offset);
     return (ValueT*)(data + sizeof(KeyT));
   }
 
   KeyT* get_tuple_key(const OffsetT offset) const {
 
-    char *data = data_blocks_.at(offset.block_id())->get_tuple(offset.rel_offset());
+    char *data = get_block(offset.block_id())->get_tuple(offset.rel_offset());
     return (KeyT*)(data);
   }
 
   ValueT* get_tuple_value(const OffsetT offset) const {
 
-    char *data = data_blocks_.at(offset.block_id())->get_tuple(offset.rel_offset());
+    char *data = get_block(offset.block_id())->get_tuple(offset.rel_offset());
     return (ValueT*)(data + sizeof(KeyT));
   }
 
   size_t size() const {
-    ASSERT(data_blocks_.size() != 0, "must have at least one data block");
-    if (data_blocks_.size() == 1) {
-      return data_blocks_.at(0)->size();
-    } else {
-      return (data_blocks_.size() - 1) * max_block_capacity_ + data_blocks_.at(data_blocks_.size() - 1)->size();
+    size_t size = 0;
+    for (size_t block_id = 0; block_id < block_count(); ++block_id) {
+      size += block_size(block_id);
     }
+    return size;
+  }
+
+  // blocks whose ids have been handed out. the newest ones may not be published yet.
+  size_t block_count() const {
+    return block_count_.load();
+  }
+
+  // take a snapshot of the tuples inserted so far, while other threads may keep inserting.
+  // waits for the tuples that are being written, which takes as long as a single insert.
+  void take_snapshot(DataTableSnapshot<KeyT, ValueT> &snapshot) const {
+    size_t block_count = block_count_.load();
+
+    snapshot.blocks_.clear();
+    for (size_t block_id = 0; block_id < block_count; ++block_id) {
+      DataBlock *block = nullptr;
+      while ((block = get_block(block_id)) == nullptr) {
+        std::this_thread::yield();
+      }
+      snapshot.blocks_.push_back(block);
+    }
+
+    snapshot.block_offsets_.assign(1, 0);
+    for (auto block : snapshot.blocks_) {
+      snapshot.block_offsets_.push_back(snapshot.block_offsets_.back() + std::min(block->size(), max_block_capacity_));
+    }
+
+    for (size_t block_id = 0; block_id < snapshot.blocks_.size(); ++block_id) {
+      DataBlock *block = snapshot.blocks_[block_id];
+      for (size_t rel_offset = 0; rel_offset < snapshot.block_size(block_id); ++rel_offset) {
+        while (!block->is_written(rel_offset)) {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+
+  // number of tuples in a block. blocks that are no longer active are full.
+  size_t block_size(const BlockIDT block_id) const {
+    DataBlock *block = get_block(block_id);
+    return block == nullptr ? 0 : std::min(block->size(), max_block_capacity_);
+  }
+
+  uint64_t get_max_block_capacity() const {
+    return max_block_capacity_;
+  }
+
+  BlockPlacement get_block_placement() const {
+    return block_placement_;
   }
 
   // approximate data table size
   size_t size_approx() const {
-    assert(data_blocks_.size() != 0);
-    return data_blocks_.size() * max_block_capacity_;
+    return block_count_.load() * max_block_capacity_;
+  }
+
+private:
+  size_t active_block_id() const {
+    if (block_placement_ == BlockPlacement::NumaLocalBlock) {
+      return current_numa_node() % active_block_count_;
+    }
+    if (block_placement_ == BlockPlacement::CoreLocalBlock) {
+      int core = sched_getcpu();
+      return core < 0 ? 0 : core % active_block_count_;
+    }
+    return 0;
+  }
+
+  // the published block of block_id, or nullptr.
+  DataBlock* get_block(const BlockIDT block_id) const {
+    std::atomic<DataBlock*> *segment = segments_[block_id >> DIRECTORY_SEGMENT_BITS].load(std::memory_order_acquire);
+    if (segment == nullptr) {
+      return nullptr;
+    }
+    return segment[block_id & ((1 << DIRECTORY_SEGMENT_BITS) - 1)].load(std::memory_order_acquire);
+  }
+
+  // a new block for active_block. block ids follow the order in which blocks are added.
+  DataBlock* add_block(ActiveBlock &active_block) {
+    BlockIDT block_id = block_count_.fetch_add(1);
+    size_t segment_id = block_id >> DIRECTORY_SEGMENT_BITS;
+    ASSERT(segment_id < DIRECTORY_SEGMENT_COUNT, "too many data blocks: " << block_id);
+
+    std::atomic<DataBlock*> *segment = segments_[segment_id].load(std::memory_order_acquire);
+    if (segment == nullptr) {
+      std::atomic<DataBlock*> *new_segment = new std::atomic<DataBlock*>[1 << DIRECTORY_SEGMENT_BITS];
+      for (size_t i = 0; i < (1 << DIRECTORY_SEGMENT_BITS); ++i) {
+        new_segment[i].store(nullptr, std::memory_order_relaxed);
+      }
+      if (segments_[segment_id].compare_exchange_strong(segment, new_segment)) {
+        segment = new_segment;
+      } else {
+        delete[] new_segment;
+      }
+    }
+
+    auto new_block = new DataBlock(block_id, sizeof(KeyT) + sizeof(ValueT), max_block_capacity_, allocate_block_tuples(active_block));
+    segment[block_id & ((1 << DIRECTORY_SEGMENT_BITS) - 1)].store(new_block, std::memory_order_release);
+    return new_block;
+  }
+
+  // blocks too small for huge pages of their own are packed into huge page chunks, 
+  // so that the table as a whole is backed by huge pages.
+  // blocks of numa-local and core-local active blocks are always packed into chunks, 
+  // which are bound to the node of their active block.
+  char* allocate_block_tuples(ActiveBlock &active_block) {
+    size_t block_size = (sizeof(KeyT) + sizeof(ValueT)) * max_block_capacity_;
+    size_t chunk_size = HUGE_PAGE_SIZE;
+    size_t alignment = 64;
+
+    if (block_placement_ == BlockPlacement::SharedBlock) {
+      if (get_huge_page_mode() == HugePageNone || block_size >= HUGE_PAGE_SIZE / 2) {
+        return nullptr;
+      }
+    } else {
+      alignment = sysconf(_SC_PAGESIZE);
+      chunk_size = std::max(chunk_size, (block_size + alignment - 1) / alignment * alignment);
+    }
+
+    if (active_block.chunk_ == nullptr || active_block.chunk_offset_ + block_size > chunk_size) {
+      active_block.chunk_ = huge_page_new_array<char>(chunk_size, alignment);
+      active_block.chunk_offset_ = 0;
+      active_block.chunks_.push_back(active_block.chunk_);
+      if (block_placement_ != BlockPlacement::SharedBlock) {
+        bind_to_numa_node(active_block.chunk_, chunk_size, active_block.node_);
+      }
+    }
+    char *tuples = active_block.chunk_ + active_block.chunk_offset_;
+    active_block.chunk_offset_ += block_size;
+    return tuples;
   }
 
 private:
   uint64_t max_block_capacity_;
-  std::vector<DataBlock*> data_blocks_;
-  DataBlock* active_data_block_;
+
+  std::atomic<std::atomic<DataBlock*>*> segments_[DIRECTORY_SEGMENT_COUNT];
+  std::atomic<size_t> block_count_;
+
+  const BlockPlacement block_placement_;
+  // one per numa node with BlockPlacement::NumaLocalBlock, one per core with BlockPlacement::CoreLocalBlock,
+  // a single one otherwise
+  ActiveBlock *active_blocks_;
+  size_t active_block_count_;
 
 };
 
@@ -121,51 +351,42 @@ public:
   DataTableIterator(DataTable<KeyT, ValueT> *table_ptr) : 
     table_ptr_(table_ptr), curr_block_id_(0), curr_rel_offset_(0) {
     
-    ASSERT(table_ptr_->data_blocks_.size() != 0, "table must contain at least one data block!");
-    ASSERT(!(table_ptr_->data_blocks_.size() == 1 && table_ptr_->data_blocks_.at(0)->size() == 0), "table must contain at least one tuple!");
-
-    max_rel_offset_ = table_ptr_->max_block_capacity_ - 1; 
+    ASSERT(table_ptr_->block_count() != 0, "table must contain at least one data block!");
+    ASSERT(table_ptr_->size() != 0, "table must contain at least one tuple!");
 
-    last_block_id_ = table_ptr_->data_blocks_.size() - 1;
+    block_count_ = table_ptr_->block_count();
 
-    size_t last_block_size = table_ptr_->data_blocks_.at(last_block_id_)->size();
-    if (last_block_size == 0) {
-      last_rel_offset_ = max_rel_offset_;
-      last_block_id_ = last_block_id_ - 1;
-    } else {
-      last_rel_offset_ = last_block_size - 1;
-    }
+    skip_finished_blocks();
   }
 
   bool has_next() const {
-    if (curr_block_id_ > last_block_id_ || (curr_block_id_ == last_block_id_ && curr_rel_offset_ > last_rel_offset_)) {
-      return false;
-    } else {
-      return true;
-    }
+    return curr_block_id_ < block_count_;
   }
 
   IteratorEntry next() {
     BlockIDT ret_block_id = curr_block_id_;
     RelOffsetT ret_rel_offset = curr_rel_offset_;
 
-    if (curr_rel_offset_ != max_rel_offset_) {
-      curr_rel_offset_++;
-    } else {
+    curr_rel_offset_++;
+    skip_finished_blocks();
+
+    return IteratorEntry(ret_block_id, ret_rel_offset, table_ptr_->get_tuple_key(ret_block_id, ret_rel_offset));
+  }
+
+private:
+  // move on to the next tuple if the current block has no more. blocks may be partly filled, or empty.
+  void skip_finished_blocks() {
+    while (curr_block_id_ < block_count_ && curr_rel_offset_ >= table_ptr_->block_size(curr_block_id_)) {
       curr_block_id_++;
       curr_rel_offset_ = 0;
     }
-    return IteratorEntry(ret_block_id, ret_rel_offset, table_ptr_->get_tuple_key(ret_block_id, ret_rel_offset));
   }
 
-
 private:
   DataTable<KeyT, ValueT> *table_ptr_;
 
   BlockIDT curr_block_id_;
   RelOffsetT curr_rel_offset_;
 
-  BlockIDT last_block_id_;
-  RelOffsetT last_rel_offset_;
-  RelOffsetT max_rel_offset_;
+  size_t block_count_;
 };
@@ -104,6 +104,118 @@ restart:
   }
 }
 
+void Tree::lookupBatch(const Key *keys, std::vector<TID> *results,
+                       uint32_t count, ThreadInfo &threadEpochInfo) const {
+  EpochGuardReadonly epochGuard(threadEpochInfo);
+
+  static constexpr uint32_t groupSize = 16;
+
+  // The state of one interleaved lookup. Once a child has been found, it is
+  // only prefetched; it is read locked when the lookup is advanced next time.
+  struct LookupState {
+    Node *node;
+    Node *parentNode;
+    uint64_t v;
+    uint32_t level;
+    bool optimisticPrefixMatch;
+    bool done;
+  };
+  LookupState states[groupSize];
+
+  for (uint32_t begin = 0; begin < count; begin += groupSize) {
+    uint32_t n = std::min(groupSize, count - begin);
+    uint32_t active = n;
+
+    for (uint32_t i = 0; i < n; ++i) {
+      states[i].node = root;
+      states[i].parentNode = nullptr;
+      states[i].v = 0;
+      states[i].level = 0;
+      states[i].optimisticPrefixMatch = false;
+      states[i].done = false;
+    }
+
+    while (active > 0) {
+      for (uint32_t i = 0; i < n; ++i) {
+        LookupState &s = states[i];
+        if (s.done) continue;
+
+        const Key &k = keys[begin + i];
+        std::vector<TID> &result = results[begin + i];
+        bool needRestart = false;
+
+        // Lock coupling: lock the current node, then release the parent
+        uint64_t nv = s.node->readLockOrRestart(needRestart);
+        if (!needRestart && s.parentNode != nullptr) {
+          s.parentNode->readUnlockOrRestart(s.v, needRestart);
+        }
+        s.v = nv;
+
+        Node *child = nullptr;
+        if (!needRestart) {
+          switch (checkPrefix(s.node, k, s.level)) {  // Increases level
+            case CheckPrefixResult::NoMatch:
+              // Prefix mismatch
+              s.node->readUnlockOrRestart(s.v, needRestart);
+              s.done = true;
+              break;
+            case CheckPrefixResult::OptimisticMatch:
+              s.optimisticPrefixMatch = true;
+            // Fallthrough
+            case CheckPrefixResult::Match:
+              if (k.getKeyLen() <= s.level) {
+                s.done = true;
+                break;
+              }
+              child = Node::getChild(k[s.level], s.node);
+              s.node->checkOrRestart(s.v, needRestart);
+              if (needRestart) break;
+
+              if (child == nullptr) {
+                // Not found
+                s.done = true;
+                break;
+              }
+              if (Node::isLeaf(child)) {
+                s.node->readUnlockOrRestart(s.v, needRestart);
+                if (needRestart) break;
+
+                size_t sz = result.size();
+                LeafNode::readLeaf(child, result, needRestart);
+                if (needRestart) break;
+
+                if (s.level < k.getKeyLen() - 1 || s.optimisticPrefixMatch) {
+                  if (checkKey(result[sz], k) == -1) {
+                    // Optimistic prefix match failed
+                    result.resize(sz);
+                  }
+                }
+                s.done = true;
+                break;
+              }
+              s.level++;
+          }
+        }
+
+        if (needRestart) {
+          // Fall back to a regular lookup, which retries until it succeeds
+          lookup(k, result, threadEpochInfo);
+          s.done = true;
+        }
+
+        if (s.done) {
+          --active;
+          continue;
+        }
+
+        __builtin_prefetch(child);
+        s.parentNode = s.node;
+        s.node = child;
+      }
+    }
+  }
+}
+
 bool Tree::lookupRange(const Key &start, const Key &end, Key &continueKey,
                        std::vector<TID> &results, uint32_t softMaxResults,
                        ThreadInfo &threadEpochInfo) const {
@@ -30,6 +30,12 @@ class Tree {
   bool lookup(const Key &k, std::vector<TID> &results,
               ThreadInfo &threadEpochInfo) const;
 
+  /// Lookup TIDs mapping to a batch of full keys. The TIDs of keys[i] are
+  /// appended to results[i]. Lookups are interleaved and the next node of
+  /// each lookup is prefetched before the other lookups are advanced.
+  void lookupBatch(const Key *keys, std::vector<TID> *results, uint32_t count,
+                   ThreadInfo &threadEpochInfo) const;
+
   /// Looks up all key-value pairs between the provided start and end keys.
   /// Results are placed in the provided result vector (of the provided size).
   /// The actual number of results that were inserted is in the output parameter
@@ -49,22 +49,29 @@ public:
     bool rt = container_.insert(tree_key, value, ti_);
   }
 
-  virtual void find(const GenericKey &key, std::vector<Uint64> &values) final {
+  virtual void find(const GenericKey &key, ResultSink &values) final {
 
     art::Key tree_key;
     load_key(key, tree_key);
 
-    bool rt = container_.lookup(tree_key, values, ti_);
+    // the tree may roll back values it has collected when an optimistic read fails,
+    // so they are collected into a vector that is reused by each thread.
+    static thread_local std::vector<Uint64> tmp_result;
+    tmp_result.clear();
+
+    bool rt = container_.lookup(tree_key, tmp_result, ti_);
+
+    values.append(tmp_result);
   }
 
-  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, ResultSink &values) final {
     art::Key start_key, end_key;
     load_key(lhs_key, start_key);
     load_key(rhs_key, end_key);
 
     // Perform scan
     const uint32_t batch_size = 1000;
-    std::vector<Uint64> tmp_result;
+    static thread_local std::vector<Uint64> tmp_result;
 
     art::Key curr_key;
     curr_key.setFrom(start_key);
@@ -75,10 +82,8 @@ public:
       has_more = container_.lookupRange(curr_key, end_key, next_key,
                                         tmp_result, batch_size, ti_);
 
-      // Copy the results to the vector
-      for (const auto &tid : tmp_result) {
-        values.push_back(tid);
-      }
+      // Copy the results to the sink
+      if (!values.append(tmp_result)) { return; }
 
       // Set the next key
       curr_key.setFrom(next_key);
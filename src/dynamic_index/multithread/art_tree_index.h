@@ -45,22 +45,49 @@ public:
     bool rt = container_.insert(tree_key, value, ti_);
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {
+  virtual void find(const KeyT &key, ResultSink &values) final {
 
     art::Key tree_key;
     load_key(key, tree_key);
 
-    bool rt = container_.lookup(tree_key, values, ti_);
+    // the tree may roll back values it has collected when an optimistic read fails,
+    // so they are collected into a vector that is reused by each thread.
+    static thread_local std::vector<Uint64> tmp_result;
+    tmp_result.clear();
+
+    bool rt = container_.lookup(tree_key, tmp_result, ti_);
+
+    values.append(tmp_result);
+  }
+
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
+
+    art::Key tree_keys[PREFETCH_GROUP_SIZE];
+    static thread_local std::vector<Uint64> tmp_results[PREFETCH_GROUP_SIZE];
+
+    for (size_t group_begin = 0; group_begin < count; group_begin += PREFETCH_GROUP_SIZE) {
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, count - group_begin);
+
+      for (size_t i = 0; i < group_size; ++i) {
+        load_key(keys[group_begin + i], tree_keys[i]);
+        tmp_results[i].clear();
+      }
+      container_.lookupBatch(tree_keys, tmp_results, group_size, ti_);
+
+      for (size_t i = 0; i < group_size; ++i) {
+        values[group_begin + i].append(tmp_results[i]);
+      }
+    }
   }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
     art::Key start_key, end_key;
     load_key(lhs_key, start_key);
     load_key(rhs_key, end_key);
 
     // Perform scan
     const uint32_t batch_size = 1000;
-    std::vector<Uint64> tmp_result;
+    static thread_local std::vector<Uint64> tmp_result;
 
     art::Key curr_key;
     curr_key.setFrom(start_key);
@@ -71,10 +98,8 @@ public:
       has_more = container_.lookupRange(curr_key, end_key, next_key,
                                         tmp_result, batch_size, ti_);
 
-      // Copy the results to the vector
-      for (const auto &tid : tmp_result) {
-        values.push_back(tid);
-      }
+      // Copy the results to the sink
+      if (!values.append(tmp_result)) { return; }
 
       // Set the next key
       curr_key.setFrom(next_key);
@@ -0,0 +1,500 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <new>
+#include <vector>
+
+#include "art_tree/Node.h"
+
+#include "base_dynamic_index.h"
+#include "utils.h"
+
+namespace dynamic_index {
+namespace multithread {
+
+// a B+-tree with optimistic lock coupling (V. Leis, et al., 2016), on the version locks of the art-tree.
+// readers never write shared memory: they read a node, and check afterwards that its version did not change.
+// writers lock only the nodes they change. full nodes are split on the way down, so that a split
+// never has to go back up the tree.
+// nodes span a few cache lines. every key in child i is not greater than keys_[i], and not less than keys_[i - 1],
+// so duplicate keys may span several leaves, which are linked for range scans. duplicates keep insertion order.
+// nodes are never merged or freed before the tree is destroyed, so that readers need no reclamation scheme.
+// erase removes entries from their leaves.
+template<typename KeyT, typename ValueT>
+class BTreeOLCIndex : public BaseDynamicIndex<KeyT, ValueT> {
+
+  static const size_t CACHELINE_SIZE = 64;
+  static const size_t NODE_SIZE = 4 * CACHELINE_SIZE;
+
+  struct NodeBase {
+    NodeBase(const bool is_leaf) : lock_(0), is_leaf_(is_leaf), count_(0) {}
+
+    art::OptimisticRWLock lock_;
+    bool is_leaf_;
+    uint16_t count_;
+  };
+
+  // the node header takes 16 bytes. arrays may need 8 more for alignment.
+  static const size_t INNER_KEYS = (NODE_SIZE - 16 - 2 * sizeof(void*)) / (sizeof(KeyT) + sizeof(void*));
+  static const size_t LEAF_KEYS = (NODE_SIZE - 16 - 2 * sizeof(void*)) / (sizeof(KeyT) + sizeof(Uint64));
+
+  struct alignas(CACHELINE_SIZE) InnerNode : public NodeBase {
+    InnerNode() : NodeBase(false) {}
+
+    KeyT keys_[INNER_KEYS];
+    NodeBase *children_[INNER_KEYS + 1];
+  };
+
+  struct alignas(CACHELINE_SIZE) LeafNode : public NodeBase {
+    LeafNode() : NodeBase(true), next_(nullptr) {}
+
+    LeafNode *next_;
+    KeyT keys_[LEAF_KEYS];
+    Uint64 values_[LEAF_KEYS];
+  };
+
+  static_assert(sizeof(InnerNode) == NODE_SIZE, "inner node must fill NODE_SIZE bytes");
+  static_assert(sizeof(LeafNode) == NODE_SIZE, "leaf node must fill NODE_SIZE bytes");
+
+  // restarts of each thread, on its own cache line.
+  struct alignas(CACHELINE_SIZE) RestartCounter {
+    RestartCounter() : count_(0) {}
+
+    std::atomic<uint64_t> count_;
+  };
+
+public:
+  BTreeOLCIndex(DataTable<KeyT, ValueT> *table_ptr) : BaseDynamicIndex<KeyT, ValueT>(table_ptr),
+    root_(new_node<LeafNode>()), size_(0), inner_count_(0), leaf_count_(1), restart_counters_(nullptr), thread_count_(0) {
+    prepare_threads(1);
+  }
+
+  virtual ~BTreeOLCIndex() {
+    delete_subtree(root_.load());
+    root_ = nullptr;
+
+    aligned_delete_array(restart_counters_);
+    restart_counters_ = nullptr;
+  }
+
+  virtual void prepare_threads(const size_t thread_count) final {
+    aligned_delete_array(restart_counters_);
+    restart_counters_ = aligned_new_array<RestartCounter>(thread_count);
+    for (size_t thread_id = 0; thread_id < thread_count; ++thread_id) {
+      new (&restart_counters_[thread_id]) RestartCounter();
+    }
+    thread_count_ = thread_count;
+  }
+
+  virtual void register_thread(const size_t thread_id) final {
+    ASSERT(thread_id < thread_count_, "unprepared thread: " << thread_id << " " << thread_count_);
+    thread_id_ = thread_id;
+  }
+
+  virtual void insert(const KeyT &key, const Uint64 &value) final {
+    int restart_count = 0;
+  restart:
+    if (restart_count++) { count_restart(); }
+    bool need_restart = false;
+
+    NodeBase *node = root_.load();
+    uint64_t node_version = node->lock_.readLockOrRestart(need_restart);
+    if (need_restart || node != root_.load()) goto restart;
+
+    InnerNode *parent = nullptr;
+    uint64_t parent_version = 0;
+
+    while (!node->is_leaf_) {
+      InnerNode *inner = static_cast<InnerNode*>(node);
+
+      if (inner->count_ == INNER_KEYS) {
+        if (!lock_for_split(parent, parent_version, node, node_version)) goto restart;
+
+        KeyT split_key;
+        InnerNode *right = split_inner(inner, split_key);
+        add_child(parent, inner, split_key, right);
+
+        node->lock_.writeUnlock();
+        if (parent != nullptr) { parent->lock_.writeUnlock(); }
+        goto restart;
+      }
+
+      if (parent != nullptr) {
+        parent->lock_.readUnlockOrRestart(parent_version, need_restart);
+        if (need_restart) goto restart;
+      }
+
+      parent = inner;
+      parent_version = node_version;
+
+      node = inner->children_[upper_child(inner, key)];
+      inner->lock_.checkOrRestart(node_version, need_restart);
+      if (need_restart) goto restart;
+
+      node_version = node->lock_.readLockOrRestart(need_restart);
+      if (need_restart) goto restart;
+    }
+
+    LeafNode *leaf = static_cast<LeafNode*>(node);
+
+    if (leaf->count_ == LEAF_KEYS) {
+      if (!lock_for_split(parent, parent_version, node, node_version)) goto restart;
+
+      KeyT split_key;
+      LeafNode *right = split_leaf(leaf, split_key);
+      add_child(parent, leaf, split_key, right);
+
+      node->lock_.writeUnlock();
+      if (parent != nullptr) { parent->lock_.writeUnlock(); }
+      goto restart;
+    }
+
+    node->lock_.upgradeToWriteLockOrRestart(node_version, need_restart);
+    if (need_restart) goto restart;
+
+    if (parent != nullptr) {
+      parent->lock_.readUnlockOrRestart(parent_version, need_restart);
+      if (need_restart) {
+        node->lock_.writeUnlock();
+        goto restart;
+      }
+    }
+
+    size_t pos = std::upper_bound(leaf->keys_, leaf->keys_ + leaf->count_, key) - leaf->keys_;
+    for (size_t i = leaf->count_; i > pos; --i) {
+      leaf->keys_[i] = leaf->keys_[i - 1];
+      leaf->values_[i] = leaf->values_[i - 1];
+    }
+    leaf->keys_[pos] = key;
+    leaf->values_[pos] = value;
+    ++leaf->count_;
+
+    node->lock_.writeUnlock();
+
+    size_.fetch_add(1);
+  }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+    scan_leaves(key, key, values);
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
+
+    scan_leaves(lhs_key, rhs_key, values);
+  }
+
+  // walk the leaves from the first one, and compare every key on the way.
+  virtual void scan(const KeyT &key, ResultSink &values) final {
+
+    LeafNode *leaf = find_leaf(std::numeric_limits<KeyT>::min());
+
+    Uint64 leaf_values[LEAF_KEYS];
+
+    while (leaf != nullptr) {
+      bool need_restart = false;
+      uint64_t version = leaf->lock_.readLockOrRestart(need_restart);
+      if (need_restart) {
+        count_restart();
+        continue;
+      }
+
+      size_t leaf_count = bounded_count(leaf->count_, LEAF_KEYS);
+      size_t value_count = 0;
+      size_t pos = 0;
+      for (; pos < leaf_count && !(key < leaf->keys_[pos]); ++pos) {
+        if (leaf->keys_[pos] == key) {
+          leaf_values[value_count++] = leaf->values_[pos];
+        }
+      }
+      LeafNode *next = (pos == leaf_count) ? leaf->next_ : nullptr;
+
+      leaf->lock_.readUnlockOrRestart(version, need_restart);
+      if (need_restart) {
+        count_restart();
+        continue;
+      }
+
+      if (!values.append(leaf_values, value_count)) { return; }
+
+      leaf = next;
+    }
+  }
+
+  // leaves are only linked forward, so the values of key are collected first, and handed out in reverse.
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) final {
+    static thread_local std::vector<Uint64> tmp_result;
+    tmp_result.clear();
+
+    ResultSink sink(tmp_result);
+    scan_leaves(key, key, sink);
+
+    for (auto it = tmp_result.rbegin(); it != tmp_result.rend(); ++it) {
+      if (!values.push_back(*it)) { return; }
+    }
+  }
+
+  virtual void scan_full(ResultSink &values, const size_t count) final {
+    scan_leaves(std::numeric_limits<KeyT>::min(), std::numeric_limits<KeyT>::max(), values, count);
+  }
+
+  // remove all values of key.
+  virtual void erase(const KeyT &key) final {
+    LeafNode *leaf = find_leaf(key);
+
+    while (leaf != nullptr) {
+      bool need_restart = false;
+      leaf->lock_.writeLockOrRestart(need_restart);
+      if (need_restart) {
+        count_restart();
+        continue;
+      }
+
+      size_t begin = std::lower_bound(leaf->keys_, leaf->keys_ + leaf->count_, key) - leaf->keys_;
+      size_t end = std::upper_bound(leaf->keys_, leaf->keys_ + leaf->count_, key) - leaf->keys_;
+
+      // more values of key may follow in the next leaf
+      LeafNode *next = (end == leaf->count_) ? leaf->next_ : nullptr;
+
+      for (size_t i = end; i < leaf->count_; ++i) {
+        leaf->keys_[begin + i - end] = leaf->keys_[i];
+        leaf->values_[begin + i - end] = leaf->values_[i];
+      }
+      leaf->count_ -= end - begin;
+      size_.fetch_sub(end - begin);
+      leaf->lock_.writeUnlock();
+      leaf = next;
+    }
+  }
+
+  virtual size_t size() const final {
+    return size_.load();
+  }
+
+  virtual void print() const final {
+    uint64_t restart_count = 0;
+    for (size_t thread_id = 0; thread_id < thread_count_; ++thread_id) {
+      restart_count += restart_counters_[thread_id].count_.load();
+    }
+    std::cout << "size = " << size_.load() << ", inner nodes = " << inner_count_.load()
+              << ", leaves = " << leaf_count_.load() << ", restarts = " << restart_count << std::endl;
+  }
+
+private:
+  // a count read without a lock may be torn. it must not lead a reader out of the node.
+  static size_t bounded_count(const size_t count, const size_t capacity) {
+    return (count < capacity) ? count : capacity;
+  }
+
+  // the first child that may hold key.
+  static size_t lower_child(const InnerNode *node, const KeyT &key) {
+    size_t count = bounded_count(node->count_, INNER_KEYS);
+    return std::lower_bound(node->keys_, node->keys_ + count, key) - node->keys_;
+  }
+
+  // the last child that may hold key.
+  static size_t upper_child(const InnerNode *node, const KeyT &key) {
+    size_t count = bounded_count(node->count_, INNER_KEYS);
+    return std::upper_bound(node->keys_, node->keys_ + count, key) - node->keys_;
+  }
+
+  // the leftmost leaf that may hold key.
+  LeafNode* find_leaf(const KeyT &key) {
+    int restart_count = 0;
+  restart:
+    if (restart_count++) { count_restart(); }
+    bool need_restart = false;
+
+    NodeBase *node = root_.load();
+    uint64_t node_version = node->lock_.readLockOrRestart(need_restart);
+    if (need_restart || node != root_.load()) goto restart;
+
+    while (!node->is_leaf_) {
+      InnerNode *inner = static_cast<InnerNode*>(node);
+
+      NodeBase *child = inner->children_[lower_child(inner, key)];
+      inner->lock_.checkOrRestart(node_version, need_restart);
+      if (need_restart) goto restart;
+
+      uint64_t child_version = child->lock_.readLockOrRestart(need_restart);
+      if (need_restart) goto restart;
+
+      inner->lock_.readUnlockOrRestart(node_version, need_restart);
+      if (need_restart) goto restart;
+
+      node = child;
+      node_version = child_version;
+    }
+
+    return static_cast<LeafNode*>(node);
+  }
+
+  // push the values of the keys in [lhs_key, rhs_key], up to count of them.
+  // each leaf is copied, and its copy is used once its version is confirmed.
+  // a leaf that splits meanwhile only loses entries to the leaf that follows it, so reading it again is enough.
+  void scan_leaves(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values, const size_t count = ResultSink::UNLIMITED) {
+
+    LeafNode *leaf = find_leaf(lhs_key);
+    size_t pushed_count = 0;
+
+    Uint64 leaf_values[LEAF_KEYS];
+
+    while (leaf != nullptr) {
+      bool need_restart = false;
+      uint64_t version = leaf->lock_.readLockOrRestart(need_restart);
+      if (need_restart) {
+        count_restart();
+        continue;
+      }
+
+      size_t leaf_count = bounded_count(leaf->count_, LEAF_KEYS);
+      size_t begin = std::lower_bound(leaf->keys_, leaf->keys_ + leaf_count, lhs_key) - leaf->keys_;
+      size_t end = std::upper_bound(leaf->keys_ + begin, leaf->keys_ + leaf_count, rhs_key) - leaf->keys_;
+      for (size_t i = begin; i < end; ++i) {
+        leaf_values[i - begin] = leaf->values_[i];
+      }
+      LeafNode *next = (end == leaf_count) ? leaf->next_ : nullptr;
+
+      leaf->lock_.readUnlockOrRestart(version, need_restart);
+      if (need_restart) {
+        count_restart();
+        continue;
+      }
+
+      size_t accepted = std::min(end - begin, count - pushed_count);
+      if (!values.append(leaf_values, accepted)) { return; }
+      pushed_count += accepted;
+      if (pushed_count >= count) { return; }
+
+      leaf = next;
+    }
+  }
+
+  // lock parent and node for a split. return false if either has changed, or node is no longer the root.
+  bool lock_for_split(InnerNode *parent, uint64_t &parent_version, NodeBase *node, uint64_t &node_version) {
+    bool need_restart = false;
+    if (parent != nullptr) {
+      parent->lock_.upgradeToWriteLockOrRestart(parent_version, need_restart);
+      if (need_restart) { return false; }
+    }
+    node->lock_.upgradeToWriteLockOrRestart(node_version, need_restart);
+    if (need_restart) {
+      if (parent != nullptr) { parent->lock_.writeUnlock(); }
+      return false;
+    }
+    // a root that split meanwhile has a parent now
+    if (parent == nullptr && node != root_.load()) {
+      node->lock_.writeUnlock();
+      return false;
+    }
+    return true;
+  }
+
+  // move the upper half of node to a new node. split_key is the largest key of the lower half.
+  LeafNode* split_leaf(LeafNode *leaf, KeyT &split_key) {
+    LeafNode *right = new_node<LeafNode>();
+    size_t left_count = leaf->count_ / 2;
+    right->count_ = leaf->count_ - left_count;
+    std::copy(leaf->keys_ + left_count, leaf->keys_ + leaf->count_, right->keys_);
+    std::copy(leaf->values_ + left_count, leaf->values_ + leaf->count_, right->values_);
+    right->next_ = leaf->next_;
+
+    leaf->count_ = left_count;
+    leaf->next_ = right;
+    split_key = leaf->keys_[left_count - 1];
+
+    leaf_count_.fetch_add(1);
+    return right;
+  }
+
+  // the middle key moves up to the parent.
+  InnerNode* split_inner(InnerNode *inner, KeyT &split_key) {
+    InnerNode *right = new_node<InnerNode>();
+    size_t left_count = inner->count_ / 2;
+    right->count_ = inner->count_ - left_count - 1;
+    std::copy(inner->keys_ + left_count + 1, inner->keys_ + inner->count_, right->keys_);
+    std::copy(inner->children_ + left_count + 1, inner->children_ + inner->count_ + 1, right->children_);
+
+    inner->count_ = left_count;
+    split_key = inner->keys_[left_count];
+
+    inner_count_.fetch_add(1);
+    return right;
+  }
+
+  // place right after left in parent, which is not full. without a parent, both go below a new root.
+  void add_child(InnerNode *parent, NodeBase *left, const KeyT &split_key, NodeBase *right) {
+    if (parent == nullptr) {
+      InnerNode *root = new_node<InnerNode>();
+      root->count_ = 1;
+      root->keys_[0] = split_key;
+      root->children_[0] = left;
+      root->children_[1] = right;
+      inner_count_.fetch_add(1);
+      root_.store(root);
+      return;
+    }
+
+    size_t pos = 0;
+    while (parent->children_[pos] != left) {
+      ++pos;
+    }
+    for (size_t i = parent->count_; i > pos; --i) {
+      parent->keys_[i] = parent->keys_[i - 1];
+      parent->children_[i + 1] = parent->children_[i];
+    }
+    parent->keys_[pos] = split_key;
+    parent->children_[pos + 1] = right;
+    ++parent->count_;
+  }
+
+  void count_restart() {
+    restart_counters_[thread_id_].count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  template<typename NodeT>
+  static NodeT* new_node() {
+    NodeT *node = aligned_new_array<NodeT>(1, CACHELINE_SIZE);
+    new (node) NodeT();
+    return node;
+  }
+
+  static void delete_subtree(NodeBase *node) {
+    if (node->is_leaf_) {
+      LeafNode *leaf = static_cast<LeafNode*>(node);
+      leaf->~LeafNode();
+      aligned_delete_array(leaf);
+      return;
+    }
+    InnerNode *inner = static_cast<InnerNode*>(node);
+    for (size_t i = 0; i <= inner->count_; ++i) {
+      delete_subtree(inner->children_[i]);
+    }
+    inner->~InnerNode();
+    aligned_delete_array(inner);
+  }
+
+private:
+  BTreeOLCIndex(const BTreeOLCIndex &);
+  BTreeOLCIndex& operator=(const BTreeOLCIndex &);
+
+private:
+  std::atomic<NodeBase*> root_;
+  std::atomic<size_t> size_;
+
+  std::atomic<size_t> inner_count_;
+  std::atomic<size_t> leaf_count_;
+
+  RestartCounter *restart_counters_;
+  size_t thread_count_;
+  static thread_local size_t thread_id_;
+};
+
+template<typename KeyT, typename ValueT>
+thread_local size_t BTreeOLCIndex<KeyT, ValueT>::thread_id_ = 0;
+
+}
+}
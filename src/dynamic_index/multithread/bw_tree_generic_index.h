@@ -36,11 +36,17 @@ public:
     container_->Insert(key, value);
   }
 
-  virtual void find(const GenericKey &key, std::vector<Uint64> &values) final {
-    container_->GetValue(key, values);
+  virtual void find(const GenericKey &key, ResultSink &values) final {
+    // the bw-tree collects values into a vector, which is reused by each thread.
+    static thread_local std::vector<Uint64> tmp_result;
+    tmp_result.clear();
+
+    container_->GetValue(key, tmp_result);
+
+    values.append(tmp_result);
   }
 
-  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, ResultSink &values) final {
 
     if (lhs_key > rhs_key) { return; }
 
@@ -50,7 +56,7 @@ public:
     }
     for (auto scan_itr = container_->Begin(lhs_key); (scan_itr.IsEnd() == false) && (container_->KeyCmpLessEqual(scan_itr->first, rhs_key)); scan_itr++) {
 
-      values.push_back(scan_itr->second);
+      if (!values.push_back(scan_itr->second)) { return; }
     }
   }
 
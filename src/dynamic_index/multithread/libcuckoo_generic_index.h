@@ -18,11 +18,16 @@ public:
     container_.upsert(key, [&value](std::vector<Uint64>& vec) { vec.push_back(value); }, 1, value);
   }
 
-  virtual void find(const GenericKey &key, std::vector<Uint64> &values) final {
-    container_.find(key, values);
+  virtual void find(const GenericKey &key, ResultSink &values) final {
+    // read the values in place instead of copying the vector out of the table.
+    container_.find_fn(key, [&values](const std::vector<Uint64> &vec) {
+      for (auto value : vec) {
+        if (!values.push_back(value)) { return; }
+      }
+    });
   }
 
-  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, ResultSink &values) final {
     assert(false);
   }
 
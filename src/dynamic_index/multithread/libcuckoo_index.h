@@ -20,11 +20,16 @@ public:
     container_.upsert(key, [&value](std::vector<Uint64>& vec) { vec.push_back(value); }, 1, value);
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {
-    container_.find(key, values);
+  virtual void find(const KeyT &key, ResultSink &values) final {
+    // read the values in place instead of copying the vector out of the table.
+    container_.find_fn(key, [&values](const std::vector<Uint64> &vec) {
+      for (auto value : vec) {
+        if (!values.push_back(value)) { return; }
+      }
+    });
   }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
     assert(false);
   }
 
@@ -70,7 +70,7 @@ public:
 
   }
 
-  virtual void find(const GenericKey &key, std::vector<Uint64> &values) final {
+  virtual void find(const GenericKey &key, ResultSink &values) final {
 
     Str value;
     typename Masstree::default_table::unlocked_cursor_type lp(container_->table(), key.raw(), key.size());
@@ -81,7 +81,7 @@ public:
     }
   }
 
-  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, ResultSink &values) final {
     // assert(false);
   }
 
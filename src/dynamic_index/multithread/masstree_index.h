@@ -70,7 +70,7 @@ public:
 
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {
+  virtual void find(const KeyT &key, ResultSink &values) final {
 
     Str value;
     typename Masstree::default_table::unlocked_cursor_type lp(container_->table(), (char*)(&key), sizeof(key));
@@ -81,7 +81,7 @@ public:
     }
   }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
     // assert(false);
   }
 
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include "epoch_manager.h"
+#include "fast_random.h"
+
+#include "base_dynamic_index.h"
+
+namespace dynamic_index {
+namespace multithread {
+
+// a lock-free skiplist, after Herlihy and Shavit.
+// entries are ordered by key, then by value, so that duplicate keys get distinct positions.
+// inserting a key-value pair that is already present has no effect.
+// a node is erased by marking its next pointers, top level first. searches that run into a marked node
+// unlink it with a compare-and-swap. erased nodes are retired to an epoch manager, so threads must be
+// prepared and registered before they use the index.
+// as in the single-thread skiplist, a node keeps its key, value and tower in one allocation.
+template<typename KeyT, typename ValueT>
+class SkiplistIndex : public BaseDynamicIndex<KeyT, ValueT> {
+
+  // enough levels for 4^16 entries.
+  static const size_t MAX_HEIGHT = 16;
+
+  struct Node {
+    KeyT key_;
+    Uint64 value_;
+    size_t height_;
+    // set by the inserter once it stops linking the node into upper levels
+    std::atomic<bool> is_linked_;
+    // height_ pointers follow in the same allocation. the lowest bit marks the node as erased.
+    std::atomic<Node*> next_[1];
+  };
+
+public:
+  SkiplistIndex(DataTable<KeyT, ValueT> *table_ptr) : BaseDynamicIndex<KeyT, ValueT>(table_ptr),
+    head_(new_node(KeyT(), 0, MAX_HEIGHT)), size_(0) {
+    epoch_manager_.prepare_threads(1);
+  }
+
+  virtual ~SkiplistIndex() {
+    Node *node = head_;
+    while (node != nullptr) {
+      Node *next = unmarked(node->next_[0].load());
+      free_node(node);
+      node = next;
+    }
+    head_ = nullptr;
+  }
+
+  virtual void prepare_threads(const size_t thread_count) final {
+    epoch_manager_.prepare_threads(thread_count);
+  }
+
+  virtual void register_thread(const size_t thread_id) final {
+    thread_id_ = thread_id;
+  }
+
+  virtual void insert(const KeyT &key, const Uint64 &value) final {
+
+    EpochGuard guard(epoch_manager_, thread_id_);
+
+    Node *preds[MAX_HEIGHT];
+    Node *succs[MAX_HEIGHT];
+
+    size_t height = random_height();
+    Node *node = nullptr;
+
+    // link the bottom level, which makes the node visible.
+    while (true) {
+      if (find_position(key, value, preds, succs)) {
+        free_node(node);
+        return;
+      }
+      if (node == nullptr) {
+        node = new_node(key, value, height);
+      }
+      for (size_t level = 0; level < height; ++level) {
+        node->next_[level].store(succs[level], std::memory_order_relaxed);
+      }
+      Node *expected = succs[0];
+      if (preds[0]->next_[0].compare_exchange_strong(expected, node)) {
+        break;
+      }
+    }
+
+    size_.fetch_add(1);
+
+    // upper levels only speed up searches. stop once the node is being erased.
+    for (size_t level = 1; level < height; ++level) {
+      if (!link_level(node, level, preds, succs)) {
+        break;
+      }
+    }
+
+    node->is_linked_.store(true);
+  }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+    EpochGuard guard(epoch_manager_, thread_id_);
+
+    for (Node *node = lower_bound(key); node != nullptr && node->key_ == key; ) {
+      Node *next = node->next_[0].load();
+      if (!is_marked(next)) {
+        if (!values.push_back(node->value_)) { return; }
+      }
+      node = unmarked(next);
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
+
+    EpochGuard guard(epoch_manager_, thread_id_);
+
+    for (Node *node = lower_bound(lhs_key); node != nullptr && !(rhs_key < node->key_); ) {
+      Node *next = node->next_[0].load();
+      if (!is_marked(next)) {
+        if (!values.push_back(node->value_)) { return; }
+      }
+      node = unmarked(next);
+    }
+  }
+
+  virtual void scan(const KeyT &key, ResultSink &values) final {
+    EpochGuard guard(epoch_manager_, thread_id_);
+
+    for (Node *node = unmarked(head_->next_[0].load()); node != nullptr; ) {
+      Node *next = node->next_[0].load();
+      if (node->key_ == key && !is_marked(next)) {
+        if (!values.push_back(node->value_)) { return; }
+      }
+      if (node->key_ > key) {
+        return;
+      }
+      node = unmarked(next);
+    }
+  }
+
+  // the list has no backward links, so the values of key are collected front to back,
+  // and handed out in reverse.
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) final {
+    static thread_local std::vector<Uint64> tmp_result;
+    tmp_result.clear();
+
+    ResultSink sink(tmp_result);
+    scan(key, sink);
+
+    for (auto it = tmp_result.rbegin(); it != tmp_result.rend(); ++it) {
+      if (!values.push_back(*it)) { return; }
+    }
+  }
+
+  virtual void scan_full(ResultSink &values, const size_t count) final {
+    EpochGuard guard(epoch_manager_, thread_id_);
+
+    size_t i = 0;
+    for (Node *node = unmarked(head_->next_[0].load()); node != nullptr && i < count; ) {
+      Node *next = node->next_[0].load();
+      if (!is_marked(next)) {
+        if (!values.push_back(node->value_)) { return; }
+        ++i;
+      }
+      node = unmarked(next);
+    }
+  }
+
+  // remove all values of key.
+  virtual void erase(const KeyT &key) final {
+    {
+      EpochGuard guard(epoch_manager_, thread_id_);
+
+      while (true) {
+        Node *node = lower_bound(key);
+        if (node == nullptr || node->key_ != key) {
+          break;
+        }
+        erase_node(node);
+      }
+    }
+
+    epoch_manager_.reclaim();
+  }
+
+  virtual size_t size() const final {
+    return size_.load();
+  }
+
+  virtual void print() const final {
+    std::cout << "size = " << size_.load() << std::endl;
+  }
+
+private:
+  static bool is_marked(Node *ptr) {
+    return (reinterpret_cast<uintptr_t>(ptr) & 1) != 0;
+  }
+
+  static Node* marked(Node *ptr) {
+    return reinterpret_cast<Node*>(reinterpret_cast<uintptr_t>(ptr) | 1);
+  }
+
+  static Node* unmarked(Node *ptr) {
+    return reinterpret_cast<Node*>(reinterpret_cast<uintptr_t>(ptr) & ~uintptr_t(1));
+  }
+
+  // whether the entry of node comes before key and value.
+  static bool is_before(const Node *node, const KeyT &key, const Uint64 value) {
+    return node->key_ < key || (!(key < node->key_) && node->value_ < value);
+  }
+
+  // the first node that is not erased, and whose key is not less than key. searches do not unlink anything.
+  Node* lower_bound(const KeyT &key) const {
+    Node *pred = head_;
+    Node *curr = nullptr;
+    for (size_t level = MAX_HEIGHT; level-- > 0; ) {
+      curr = unmarked(pred->next_[level].load());
+      while (curr != nullptr) {
+        Node *succ = curr->next_[level].load();
+        if (is_marked(succ)) {
+          curr = unmarked(succ);
+          continue;
+        }
+        if (!(curr->key_ < key)) {
+          break;
+        }
+        pred = curr;
+        curr = succ;
+      }
+    }
+    return curr;
+  }
+
+  // fill preds and succs with the nodes around key and value at every level, and unlink erased nodes on the way.
+  // return true if the pair is present.
+  bool find_position(const KeyT &key, const Uint64 value, Node **preds, Node **succs) {
+    while (!try_find_position(key, value, preds, succs)) {}
+    return succs[0] != nullptr && succs[0]->key_ == key && succs[0]->value_ == value;
+  }
+
+  // return false if an erased node could not be unlinked, and the search has to start over.
+  bool try_find_position(const KeyT &key, const Uint64 value, Node **preds, Node **succs) {
+    Node *pred = head_;
+    for (size_t level = MAX_HEIGHT; level-- > 0; ) {
+      Node *curr = unmarked(pred->next_[level].load());
+      while (curr != nullptr) {
+        Node *succ = curr->next_[level].load();
+        if (is_marked(succ)) {
+          // fails if pred is erased too, or a node was linked after it
+          Node *expected = curr;
+          if (!pred->next_[level].compare_exchange_strong(expected, unmarked(succ))) {
+            return false;
+          }
+          curr = unmarked(succ);
+          continue;
+        }
+        if (!is_before(curr, key, value)) {
+          break;
+        }
+        pred = curr;
+        curr = succ;
+      }
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+    return true;
+  }
+
+  // link node into level. return false if the node is being erased.
+  bool link_level(Node *node, const size_t level, Node **preds, Node **succs) {
+    while (true) {
+      Node *next = node->next_[level].load();
+      if (is_marked(next)) {
+        return false;
+      }
+      if (next != succs[level] && !node->next_[level].compare_exchange_strong(next, succs[level])) {
+        return false;
+      }
+      Node *expected = succs[level];
+      if (preds[level]->next_[level].compare_exchange_strong(expected, node)) {
+        return true;
+      }
+      find_position(node->key_, node->value_, preds, succs);
+    }
+  }
+
+  // mark node as erased, unlink it, and retire it. return false if another thread erased it first.
+  bool erase_node(Node *node) {
+    for (size_t level = node->height_; level-- > 1; ) {
+      Node *next = node->next_[level].load();
+      while (!is_marked(next)) {
+        node->next_[level].compare_exchange_weak(next, marked(next));
+      }
+    }
+
+    // marking the bottom level erases the node.
+    Node *next = node->next_[0].load();
+    while (true) {
+      if (is_marked(next)) {
+        return false;
+      }
+      if (node->next_[0].compare_exchange_weak(next, marked(next))) {
+        break;
+      }
+    }
+
+    // once the inserter is done, a search unlinks the node from every level it reached.
+    while (!node->is_linked_.load()) {
+      std::this_thread::yield();
+    }
+    Node *preds[MAX_HEIGHT];
+    Node *succs[MAX_HEIGHT];
+    find_position(node->key_, node->value_, preds, succs);
+
+    size_.fetch_sub(1);
+    epoch_manager_.retire([node]() { free_node(node); });
+    return true;
+  }
+
+  size_t random_height() {
+    static thread_local FastRandom rand_gen(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    uint64_t bits = rand_gen.next<uint64_t>();
+    size_t height = 1;
+    while ((bits & 3) == 0 && height < MAX_HEIGHT) {
+      bits >>= 2;
+      ++height;
+    }
+    return height;
+  }
+
+  static Node* new_node(const KeyT &key, const Uint64 value, const size_t height) {
+    Node *node = static_cast<Node*>(malloc(sizeof(Node) + (height - 1) * sizeof(std::atomic<Node*>)));
+    if (node == nullptr) {
+      throw std::bad_alloc();
+    }
+    node->key_ = key;
+    node->value_ = value;
+    node->height_ = height;
+    new (&node->is_linked_) std::atomic<bool>(false);
+    for (size_t level = 0; level < height; ++level) {
+      new (&node->next_[level]) std::atomic<Node*>(nullptr);
+    }
+    return node;
+  }
+
+  static void free_node(Node *node) {
+    free(node);
+  }
+
+private:
+  SkiplistIndex(const SkiplistIndex &);
+  SkiplistIndex& operator=(const SkiplistIndex &);
+
+private:
+  Node *head_;
+  std::atomic<size_t> size_;
+
+  EpochManager epoch_manager_;
+  static thread_local size_t thread_id_;
+};
+
+template<typename KeyT, typename ValueT>
+thread_local size_t SkiplistIndex<KeyT, ValueT>::thread_id_ = 0;
+
+}
+}
@@ -256,9 +256,9 @@ static int leaf_matches(const art_leaf *n, const unsigned char *key, int key_len
  * @arg t The tree
  * @arg key The key
  * @arg key_len The length of the key
- * @arg rets The vector of matched results
+ * @arg rets The sink of matched results
  */
-void art_search(const art_tree *t, const unsigned char *key, int key_len, std::vector<ValueT> &rets) {
+void art_search(const art_tree *t, const unsigned char *key, int key_len, ResultSink &rets) {
     art_node **child;
     art_node *n = t->root;
     int prefix_len, depth = 0;
@@ -272,7 +272,7 @@ void art_search(const art_tree *t, const unsigned char *key, int key_len, std::v
 
                 for (size_t i = 0; i < l->val_count; ++i) {
                     ValueT ret = *(ValueT*)(l->kvs+key_len+(i*sizeof(ValueT)));
-                    rets.push_back(ret);
+                    if (!rets.push_back(ret)) break;
                 }
             }
             return;
@@ -296,6 +296,81 @@ void art_search(const art_tree *t, const unsigned char *key, int key_len, std::v
 }
 
 
+/**
+ * Number of lookups that are interleaved by art_search_batch()
+ */
+#define SEARCH_GROUP_SIZE 16
+
+/**
+ * Searches for a batch of values in the ART tree
+ * @arg t The tree
+ * @arg keys The keys, stored back to back
+ * @arg key_len The length of each key
+ * @arg count The number of keys
+ * @arg rets The sinks of matched results, one per key
+ */
+void art_search_batch(const art_tree *t, const unsigned char *keys, int key_len, int count, ResultSink *rets) {
+    art_node *nodes[SEARCH_GROUP_SIZE];
+    int depths[SEARCH_GROUP_SIZE];
+
+    for (int begin = 0; begin < count; begin += SEARCH_GROUP_SIZE) {
+        int group_size = min(SEARCH_GROUP_SIZE, count - begin);
+        int active = 0;
+
+        for (int i = 0; i < group_size; i++) {
+            nodes[i] = t->root;
+            depths[i] = 0;
+            if (nodes[i]) active++;
+        }
+
+        // Advance every lookup by one node per round
+        while (active) {
+            for (int i = 0; i < group_size; i++) {
+                art_node *n = nodes[i];
+                if (!n) continue;
+
+                const unsigned char *key = keys + (begin + i) * key_len;
+
+                // Might be a leaf
+                if (IS_LEAF(n)) {
+                    art_leaf *l = LEAF_RAW(n);
+                    // Check if the expanded path matches
+                    if (!leaf_matches(l, key, key_len)) {
+                        for (size_t j = 0; j < l->val_count; ++j) {
+                            ValueT ret = *(ValueT*)(l->kvs+key_len+(j*sizeof(ValueT)));
+                            if (!rets[begin + i].push_back(ret)) break;
+                        }
+                    }
+                    nodes[i] = NULL;
+                    active--;
+                    continue;
+                }
+
+                // Bail if the prefix does not match
+                if (n->partial_len) {
+                    int prefix_len = node_prefix_matches(n, key, key_len, depths[i]);
+                    if (prefix_len != min(MAX_PREFIX_LEN, n->partial_len)) {
+                        nodes[i] = NULL;
+                        active--;
+                        continue;
+                    }
+                    depths[i] = depths[i] + n->partial_len;
+                }
+
+                art_node **child = find_child(n, key[depths[i]]);
+                nodes[i] = (child) ? *child : NULL;
+                depths[i]++;
+
+                if (nodes[i]) {
+                    __builtin_prefetch(LEAF_RAW(nodes[i]));
+                } else {
+                    active--;
+                }
+            }
+        }
+    }
+}
+
 // Find the minimum leaf under a node
 static art_leaf* minimum(const art_node *n) {
     // Handle base cases
@@ -841,15 +916,15 @@ void art_delete(art_tree *t, const unsigned char *key, int key_len) {
 }
 
 // Retrieve all the leaves given a node
-static void recursive_scan(art_node *n, std::vector<ValueT> &rets) {
+static void recursive_scan(art_node *n, ResultSink &rets) {
     // Handle base cases
-    if (!n) return;
+    if (!n || rets.full()) return;
     if (IS_LEAF(n)) {
         art_leaf *l = LEAF_RAW(n);
 
         for (size_t i = 0; i < l->val_count; ++i) {
             ValueT ret = *(ValueT*)(l->kvs+l->key_len+(i*sizeof(ValueT)));
-            rets.push_back(ret);
+            if (!rets.push_back(ret)) break;
         }
         return;
     }
@@ -894,14 +969,14 @@ static void recursive_scan(art_node *n, std::vector<ValueT> &rets) {
 /**
  * Scan the entire tree.
  * @arg t The tree to iterate over
- * @arg rets The vector that holds all the results
+ * @arg rets The sink that receives all the results
  */
-void art_scan(art_tree *t, std::vector<ValueT> &rets) {
+void art_scan(art_tree *t, ResultSink &rets) {
     recursive_scan(t->root, rets);
 }
 
 // Retrieve all the leaves given a node
-static void recursive_scan_limit(art_node *n, std::vector<ValueT> &rets, const size_t count) {
+static void recursive_scan_limit(art_node *n, ResultSink &rets, const size_t count) {
     // Handle base cases
     if (!n) return;
     if (IS_LEAF(n)) {
@@ -909,9 +984,7 @@ static void recursive_scan_limit(art_node *n, std::vector<ValueT> &rets, const s
 
         for (size_t i = 0; i < l->val_count; ++i) {
             ValueT ret = *(ValueT*)(l->kvs+l->key_len+(i*sizeof(ValueT)));
-            if (rets.size() < count) {
-                rets.push_back(ret);
-            } else {
+            if (rets.size() >= count || !rets.push_back(ret)) {
                 return;
             }
         }
@@ -923,14 +996,14 @@ static void recursive_scan_limit(art_node *n, std::vector<ValueT> &rets, const s
         case NODE4:
             for (int i=0; i < n->num_children; i++) {
                 recursive_scan_limit(((art_node4*)n)->children[i], rets, count);
-                if (rets.size() >= count) { return; }
+                if (rets.size() >= count || rets.full()) { return; }
             }
             break;
 
         case NODE16:
             for (int i=0; i < n->num_children; i++) {
                 recursive_scan_limit(((art_node16*)n)->children[i], rets, count);
-                if (rets.size() >= count) { return; }
+                if (rets.size() >= count || rets.full()) { return; }
             }
             break;
 
@@ -940,7 +1013,7 @@ static void recursive_scan_limit(art_node *n, std::vector<ValueT> &rets, const s
                 if (!idx) continue;
 
                 recursive_scan_limit(((art_node48*)n)->children[idx-1], rets, count);
-                if (rets.size() >= count) { return; }
+                if (rets.size() >= count || rets.full()) { return; }
             }
             break;
 
@@ -949,7 +1022,7 @@ static void recursive_scan_limit(art_node *n, std::vector<ValueT> &rets, const s
                 if (!((art_node256*)n)->children[i]) continue;
 
                 recursive_scan_limit(((art_node256*)n)->children[i], rets, count);
-                if (rets.size() >= count) { return; }
+                if (rets.size() >= count || rets.full()) { return; }
             }
             break;
 
@@ -962,9 +1035,9 @@ static void recursive_scan_limit(art_node *n, std::vector<ValueT> &rets, const s
 /**
  * Scan the entire tree.
  * @arg t The tree to iterate over
- * @arg rets The vector that holds all the results
+ * @arg rets The sink that receives all the results
  */
-void art_scan_limit(art_tree *t, std::vector<ValueT> &rets, const size_t count) {
+void art_scan_limit(art_tree *t, ResultSink &rets, const size_t count) {
     recursive_scan_limit(t->root, rets, count);
 }
 
@@ -975,9 +1048,9 @@ void art_scan_limit(art_tree *t, std::vector<ValueT> &rets, const size_t count)
  * @arg lhs_key_len The length of the left-hand-side key
  * @arg rhs_key The right-hand-side key
  * @arg rhs_key_len The length of the right-hand-side key
- * @arg rets The vector of matched results
+ * @arg rets The sink of matched results
  */
-void art_range_scan(const art_tree *t, const unsigned char *lhs_key, int lhs_key_len, const unsigned char *rhs_key, int rhs_key_len, std::vector<ValueT> &rets) {
+void art_range_scan(const art_tree *t, const unsigned char *lhs_key, int lhs_key_len, const unsigned char *rhs_key, int rhs_key_len, ResultSink &rets) {
 
     // compute common prefix between lhs_key and rhs_key
     int prefix_key_len = 0;
@@ -1004,7 +1077,7 @@ void art_range_scan(const art_tree *t, const unsigned char *lhs_key, int lhs_key
 
                     for (size_t i = 0; i < l->val_count; ++i) {
                         ValueT ret = *(ValueT*)(l->kvs+l->key_len+(i*sizeof(ValueT)));
-                        rets.push_back(ret);
+                        if (!rets.push_back(ret)) break;
                     }
                 }
                 return;
@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 #include <stdint.h>
+
+#include "result_sink.h"
 // #ifndef ART_H
 // #define ART_H
 
@@ -161,9 +163,21 @@ void art_delete(art_tree *t, const unsigned char *key, int key_len);
  * @arg t The tree
  * @arg key The key
  * @arg key_len The length of the key
- * @arg rets The vector of matched results
+ * @arg rets The sink of matched results
+ */
+void art_search(const art_tree *t, const unsigned char *key, int key_len, ResultSink &rets);
+
+/**
+ * Searches for a batch of values in the ART tree.
+ * The lookups are interleaved, and the next node of each lookup
+ * is prefetched before the other lookups are advanced.
+ * @arg t The tree
+ * @arg keys The keys, stored back to back
+ * @arg key_len The length of each key
+ * @arg count The number of keys
+ * @arg rets The sinks of matched results, one per key
  */
-void art_search(const art_tree *t, const unsigned char *key, int key_len, std::vector<ValueT> &rets);
+void art_search_batch(const art_tree *t, const unsigned char *keys, int key_len, int count, ResultSink *rets);
 
 /**
  * Searches for a value in the ART tree
@@ -172,9 +186,9 @@ void art_search(const art_tree *t, const unsigned char *key, int key_len, std::v
  * @arg lhs_key_len The length of the left-hand-side key
  * @arg rhs_key The right-hand-side key
  * @arg rhs_key_len The length of the right-hand-side key
- * @arg rets The vector of matched results
+ * @arg rets The sink of matched results
  */
-void art_range_scan(const art_tree *t, const unsigned char *lhs_key, int lhs_key_len, const unsigned char *rhs_key, int rhs_key_len, std::vector<ValueT> &rets);
+void art_range_scan(const art_tree *t, const unsigned char *lhs_key, int lhs_key_len, const unsigned char *rhs_key, int rhs_key_len, ResultSink &rets);
 
 /**
  * Returns the minimum valued leaf
@@ -191,11 +205,11 @@ art_leaf* art_maximum(art_tree *t);
 /**
  * Iterates through the entire tree.
  * @arg t The tree to iterate over
- * @arg rets The vector that holds all the results
+ * @arg rets The sink that receives all the results
  */
-void art_scan(art_tree *t, std::vector<ValueT> &rets);
+void art_scan(art_tree *t, ResultSink &rets);
 
-void art_scan_limit(art_tree *t, std::vector<ValueT> &rets, const size_t count);
+void art_scan_limit(art_tree *t, ResultSink &rets, const size_t count);
 
 /**
  * Iterates through the entries pairs in the map,
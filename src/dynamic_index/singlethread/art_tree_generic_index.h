@@ -22,15 +22,15 @@ public:
     art_insert(&container_, (unsigned char*)(key.raw()), key.size(), value);
   }
 
-  virtual void find(const GenericKey &key, std::vector<Uint64> &values) final {
+  virtual void find(const GenericKey &key, ResultSink &values) final {
     art_search(&container_, (unsigned char*)(key.raw()), key.size(), values);
   }
 
-  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, ResultSink &values) final {
     art_range_scan(&container_, (unsigned char*)(lhs_key.raw()), lhs_key.size(), (unsigned char*)(rhs_key.raw()), rhs_key.size(), values);
   }
 
-  virtual void scan_full(std::vector<Uint64> &values, const size_t count) final {
+  virtual void scan_full(ResultSink &values, const size_t count) final {
     art_scan_limit(&container_, values, count);
   }
 
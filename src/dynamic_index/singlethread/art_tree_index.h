@@ -24,18 +24,31 @@ public:
     art_insert(&container_, (unsigned char*)(&bs_key), sizeof(KeyT), value);
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {
+  virtual void find(const KeyT &key, ResultSink &values) final {
     KeyT bs_key = byte_swap<KeyT>(key);
     art_search(&container_, (unsigned char*)(&bs_key), sizeof(KeyT), values);
   }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
+    KeyT bs_keys[PREFETCH_GROUP_SIZE];
+
+    for (size_t group_begin = 0; group_begin < count; group_begin += PREFETCH_GROUP_SIZE) {
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, count - group_begin);
+
+      for (size_t i = 0; i < group_size; ++i) {
+        bs_keys[i] = byte_swap<KeyT>(keys[group_begin + i]);
+      }
+      art_search_batch(&container_, (unsigned char*)(bs_keys), sizeof(KeyT), group_size, values + group_begin);
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
     KeyT bs_lhs_key = byte_swap<KeyT>(lhs_key);
     KeyT bs_rhs_key = byte_swap<KeyT>(rhs_key);
     art_range_scan(&container_, (unsigned char*)(&bs_lhs_key), sizeof(KeyT), (unsigned char*)(&bs_rhs_key), sizeof(KeyT), values);
   }
 
-  virtual void scan_full(std::vector<Uint64> &values, const size_t count) final {
+  virtual void scan_full(ResultSink &values, const size_t count) final {
     art_scan_limit(&container_, values, count);
   }
 
@@ -5,32 +5,443 @@
 namespace dynamic_index {
 namespace singlethread {
 
+// a cache-sensitive B+-tree (J. Rao and K. A. Ross, 2000).
+// an inner node fills one cache line. instead of a pointer per child, it keeps a single pointer to
+// a node group that stores all its children contiguously, which leaves room for about twice as many keys.
+// leaves span a few cache lines, with the keys ahead of the values, and are linked both ways for scans.
+// adding a child reallocates the group of its parent. a full parent splits its group in two.
+// duplicate keys are kept in insertion order, and may span several leaves.
+// erase removes entries from their leaves, but does not merge nodes.
 template<typename KeyT, typename ValueT>
 class CSBTreeIndex : public BaseDynamicIndex<KeyT, ValueT> {
 
+  static const size_t CACHELINE_SIZE = 64;
+  static const size_t LEAF_SIZE = 4 * CACHELINE_SIZE;
+
+  // the count and the group pointer take 16 bytes.
+  static const size_t INNER_KEYS = (CACHELINE_SIZE - 16) / sizeof(KeyT);
+  // the count and the links take 24 bytes, and values may need 8 more for alignment.
+  static const size_t LEAF_KEYS = (LEAF_SIZE - 32) / (sizeof(KeyT) + sizeof(Uint64));
+
+  struct alignas(CACHELINE_SIZE) InnerNode {
+    uint32_t count_;
+    // count_ + 1 children: inner nodes, or leaves right above the bottom.
+    // every key in child i is not greater than keys_[i], and not less than keys_[i - 1].
+    void *children_;
+    KeyT keys_[INNER_KEYS];
+  };
+
+  struct alignas(CACHELINE_SIZE) LeafNode {
+    uint32_t count_;
+    LeafNode *prev_;
+    LeafNode *next_;
+    KeyT keys_[LEAF_KEYS];
+    Uint64 values_[LEAF_KEYS];
+  };
+
+  static_assert(sizeof(InnerNode) == CACHELINE_SIZE, "inner node must fill a single cache line");
+  static_assert(sizeof(LeafNode) == LEAF_SIZE, "leaf node must fill LEAF_SIZE bytes");
+
 public:
-  CSBTreeIndex(DataTable<KeyT, ValueT> *table_ptr) : BaseDynamicIndex<KeyT, ValueT>(table_ptr) {
+  CSBTreeIndex(DataTable<KeyT, ValueT> *table_ptr) : BaseDynamicIndex<KeyT, ValueT>(table_ptr),
+    root_(new_group<LeafNode>(1)), height_(0), size_(0), inner_count_(0), leaf_count_(1) {
+    LeafNode *root = static_cast<LeafNode*>(root_);
+    root->count_ = 0;
+    root->prev_ = nullptr;
+    root->next_ = nullptr;
+    first_leaf_ = root;
+    last_leaf_ = root;
   }
-  
+
   virtual ~CSBTreeIndex() {
+    delete_group(root_, height_, 1);
+    root_ = nullptr;
   }
 
   virtual void insert(const KeyT &key, const Uint64 &value) final {
+
+    KeyT split_key;
+
+    if (height_ == 0) {
+      LeafNode right;
+      if (insert_leaf(static_cast<LeafNode*>(root_), key, value, split_key, right)) {
+        grow_root(static_cast<LeafNode*>(root_), split_key, right);
+      }
+    } else {
+      InnerNode right;
+      if (insert_inner(static_cast<InnerNode*>(root_), height_, key, value, split_key, right)) {
+        grow_root(static_cast<InnerNode*>(root_), split_key, right);
+      }
+    }
+
+    ++size_;
+  }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+    LeafNode *leaf = find_leaf(key);
+    size_t pos = lower_bound(leaf, key);
+
+    for (; leaf != nullptr; leaf = leaf->next_, pos = 0) {
+      for (; pos < leaf->count_; ++pos) {
+        if (leaf->keys_[pos] != key) { return; }
+        if (!values.push_back(leaf->values_[pos])) { return; }
+      }
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
+
+    LeafNode *leaf = find_leaf(lhs_key);
+    size_t pos = lower_bound(leaf, lhs_key);
+
+    for (; leaf != nullptr; leaf = leaf->next_, pos = 0) {
+      for (; pos < leaf->count_; ++pos) {
+        if (rhs_key < leaf->keys_[pos]) { return; }
+        if (!values.push_back(leaf->values_[pos])) { return; }
+      }
+    }
+  }
+
+  virtual void scan(const KeyT &key, ResultSink &values) final {
+    for (LeafNode *leaf = first_leaf_; leaf != nullptr; leaf = leaf->next_) {
+      for (size_t pos = 0; pos < leaf->count_; ++pos) {
+        if (leaf->keys_[pos] == key) {
+          if (!values.push_back(leaf->values_[pos])) { return; }
+        }
+        if (leaf->keys_[pos] > key) {
+          return;
+        }
+      }
+    }
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {    
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) final {
+    for (LeafNode *leaf = last_leaf_; leaf != nullptr; leaf = leaf->prev_) {
+      for (size_t pos = leaf->count_; pos > 0; --pos) {
+        if (leaf->keys_[pos - 1] == key) {
+          if (!values.push_back(leaf->values_[pos - 1])) { return; }
+        }
+        if (leaf->keys_[pos - 1] < key) {
+          return;
+        }
+      }
+    }
   }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
+  virtual void scan_full(ResultSink &values, const size_t count) final {
+    size_t i = 0;
+    for (LeafNode *leaf = first_leaf_; leaf != nullptr; leaf = leaf->next_) {
+      for (size_t pos = 0; pos < leaf->count_; ++pos, ++i) {
+        if (i >= count) { return; }
+        if (!values.push_back(leaf->values_[pos])) { return; }
+      }
+    }
   }
 
+  // remove all values of key. separators stay valid, so no node needs to change but the leaves.
   virtual void erase(const KeyT &key) final {
+    LeafNode *leaf = find_leaf(key);
+    size_t pos = lower_bound(leaf, key);
+
+    for (; leaf != nullptr; leaf = leaf->next_, pos = 0) {
+      size_t end = pos;
+      while (end < leaf->count_ && leaf->keys_[end] == key) {
+        ++end;
+      }
+      if (end == pos) {
+        // either a larger key or an empty leaf
+        if (pos < leaf->count_) { return; }
+        continue;
+      }
+      for (size_t i = end; i < leaf->count_; ++i) {
+        leaf->keys_[pos + i - end] = leaf->keys_[i];
+        leaf->values_[pos + i - end] = leaf->values_[i];
+      }
+      leaf->count_ -= end - pos;
+      size_ -= end - pos;
+      if (pos < leaf->count_) { return; }
+    }
   }
 
   virtual size_t size() const final {
-    return 0;
+    return size_;
+  }
+
+  virtual void print() const final {
+    std::cout << "size = " << size_ << ", height = " << height_
+              << ", inner nodes = " << inner_count_ << ", leaves = " << leaf_count_
+              << ", node bytes = " << inner_count_ * sizeof(InnerNode) + leaf_count_ * sizeof(LeafNode) << std::endl;
+  }
+
+private:
+  // the first child that may hold key.
+  static size_t lower_child(const InnerNode *node, const KeyT &key) {
+    size_t i = 0;
+    while (i < node->count_ && node->keys_[i] < key) {
+      ++i;
+    }
+    return i;
+  }
+
+  // the last child that may hold key.
+  static size_t upper_child(const InnerNode *node, const KeyT &key) {
+    size_t i = 0;
+    while (i < node->count_ && !(key < node->keys_[i])) {
+      ++i;
+    }
+    return i;
+  }
+
+  static size_t lower_bound(const LeafNode *leaf, const KeyT &key) {
+    size_t pos = 0;
+    while (pos < leaf->count_ && leaf->keys_[pos] < key) {
+      ++pos;
+    }
+    return pos;
   }
 
+  // the leftmost leaf that may hold key.
+  LeafNode* find_leaf(const KeyT &key) const {
+    void *node = root_;
+    for (size_t level = height_; level > 0; --level) {
+      InnerNode *inner = static_cast<InnerNode*>(node);
+      node = get_child(inner, lower_child(inner, key), level);
+    }
+    return static_cast<LeafNode*>(node);
+  }
+
+  static void* get_child(InnerNode *node, const size_t i, const size_t level) {
+    if (level == 1) {
+      return static_cast<LeafNode*>(node->children_) + i;
+    }
+    return static_cast<InnerNode*>(node->children_) + i;
+  }
+
+  // return true if the leaf split. the leaf then keeps the lower half, and right receives the upper half,
+  // which the caller places after the leaf. split_key is the largest key of the lower half.
+  bool insert_leaf(LeafNode *leaf, const KeyT &key, const Uint64 value, KeyT &split_key, LeafNode &right) {
+
+    size_t pos = leaf->count_;
+    while (pos > 0 && key < leaf->keys_[pos - 1]) {
+      --pos;
+    }
+
+    if (leaf->count_ < LEAF_KEYS) {
+      for (size_t i = leaf->count_; i > pos; --i) {
+        leaf->keys_[i] = leaf->keys_[i - 1];
+        leaf->values_[i] = leaf->values_[i - 1];
+      }
+      leaf->keys_[pos] = key;
+      leaf->values_[pos] = value;
+      ++leaf->count_;
+      return false;
+    }
+
+    KeyT keys[LEAF_KEYS + 1];
+    Uint64 values[LEAF_KEYS + 1];
+    for (size_t i = 0, j = 0; i <= LEAF_KEYS; ++i) {
+      if (i == pos) {
+        keys[i] = key;
+        values[i] = value;
+      } else {
+        keys[i] = leaf->keys_[j];
+        values[i] = leaf->values_[j];
+        ++j;
+      }
+    }
+
+    size_t left_count = (LEAF_KEYS + 1) / 2;
+    leaf->count_ = left_count;
+    right.count_ = LEAF_KEYS + 1 - left_count;
+    for (size_t i = 0; i < left_count; ++i) {
+      leaf->keys_[i] = keys[i];
+      leaf->values_[i] = values[i];
+    }
+    for (size_t i = 0; i < right.count_; ++i) {
+      right.keys_[i] = keys[left_count + i];
+      right.values_[i] = values[left_count + i];
+    }
+    split_key = keys[left_count - 1];
+    ++leaf_count_;
+    return true;
+  }
+
+  // like insert_leaf(), for the subtree of an inner node at level.
+  // a key equal to a separator goes to the right, after the values it already has.
+  bool insert_inner(InnerNode *node, const size_t level, const KeyT &key, const Uint64 value, KeyT &split_key, InnerNode &right) {
+
+    size_t i = upper_child(node, key);
+    KeyT child_split_key;
+
+    if (level == 1) {
+      LeafNode child_right;
+      if (!insert_leaf(static_cast<LeafNode*>(node->children_) + i, key, value, child_split_key, child_right)) {
+        return false;
+      }
+      return add_child(node, i, child_split_key, child_right, split_key, right);
+    }
+
+    InnerNode child_right;
+    if (!insert_inner(static_cast<InnerNode*>(node->children_) + i, level - 1, key, value, child_split_key, child_right)) {
+      return false;
+    }
+    return add_child(node, i, child_split_key, child_right, split_key, right);
+  }
+
+  // place child_right after child i of node, in a new group. if node is full, it splits like a leaf,
+  // and its children are divided into two new groups. split_key then moves up instead of staying in a node.
+  template<typename NodeT>
+  bool add_child(InnerNode *node, const size_t i, const KeyT &child_split_key, const NodeT &child_right, KeyT &split_key, InnerNode &right) {
+
+    NodeT *old_group = static_cast<NodeT*>(node->children_);
+    size_t key_count = node->count_ + 1;
+
+    KeyT keys[INNER_KEYS + 1];
+    const NodeT *children[INNER_KEYS + 2];
+    for (size_t j = 0, k = 0; j < key_count; ++j) {
+      keys[j] = (j == i) ? child_split_key : node->keys_[k++];
+    }
+    for (size_t j = 0, k = 0; j <= key_count; ++j) {
+      children[j] = (j == i + 1) ? &child_right : &old_group[k++];
+    }
+
+    bool is_split = (key_count > INNER_KEYS);
+
+    if (!is_split) {
+      NodeT *group = new_group<NodeT>(key_count + 1);
+      for (size_t j = 0; j <= key_count; ++j) {
+        group[j] = *children[j];
+      }
+      relink(old_group, node->count_ + 1, group, key_count + 1, nullptr, 0);
+
+      for (size_t j = 0; j < key_count; ++j) {
+        node->keys_[j] = keys[j];
+      }
+      node->count_ = key_count;
+      node->children_ = group;
+
+    } else {
+      // the middle key moves up
+      size_t left_count = key_count / 2;
+      size_t right_count = key_count - left_count - 1;
+
+      NodeT *left_group = new_group<NodeT>(left_count + 1);
+      NodeT *right_group = new_group<NodeT>(right_count + 1);
+      for (size_t j = 0; j <= left_count; ++j) {
+        left_group[j] = *children[j];
+      }
+      for (size_t j = 0; j <= right_count; ++j) {
+        right_group[j] = *children[left_count + 1 + j];
+      }
+      relink(old_group, node->count_ + 1, left_group, left_count + 1, right_group, right_count + 1);
+
+      for (size_t j = 0; j < left_count; ++j) {
+        node->keys_[j] = keys[j];
+      }
+      node->count_ = left_count;
+      node->children_ = left_group;
+
+      for (size_t j = 0; j < right_count; ++j) {
+        right.keys_[j] = keys[left_count + 1 + j];
+      }
+      right.count_ = right_count;
+      right.children_ = right_group;
+
+      split_key = keys[left_count];
+      ++inner_count_;
+    }
+
+    delete_node_group(old_group);
+    return is_split;
+  }
+
+  // the root is a group of one. a split root moves into a group of two below a new root.
+  template<typename NodeT>
+  void grow_root(NodeT *root, const KeyT &split_key, const NodeT &right) {
+    NodeT *group = new_group<NodeT>(2);
+    group[0] = *root;
+    group[1] = right;
+    relink(root, 1, group, 2, nullptr, 0);
+    delete_node_group(root);
+
+    InnerNode *new_root = new_group<InnerNode>(1);
+    new_root->count_ = 1;
+    new_root->keys_[0] = split_key;
+    new_root->children_ = group;
+
+    root_ = new_root;
+    ++height_;
+    ++inner_count_;
+  }
+
+  // inner nodes are not linked.
+  void relink(InnerNode *old_group, const size_t old_count, InnerNode *group, const size_t count, InnerNode *next_group, const size_t next_count) {}
+
+  // link the leaves of group, and of next_group if any, in place of those of old_group.
+  void relink(LeafNode *old_group, const size_t old_count, LeafNode *group, const size_t count, LeafNode *next_group, const size_t next_count) {
+    LeafNode *prev = old_group[0].prev_;
+    LeafNode *last_next = old_group[old_count - 1].next_;
+
+    LeafNode *groups[2] = { group, next_group };
+    size_t counts[2] = { count, next_count };
+    for (size_t g = 0; g < 2; ++g) {
+      for (size_t j = 0; j < counts[g]; ++j) {
+        LeafNode *leaf = &groups[g][j];
+        leaf->prev_ = prev;
+        if (prev != nullptr) {
+          prev->next_ = leaf;
+        } else {
+          first_leaf_ = leaf;
+        }
+        prev = leaf;
+      }
+    }
+    prev->next_ = last_next;
+    if (last_next != nullptr) {
+      last_next->prev_ = prev;
+    } else {
+      last_leaf_ = prev;
+    }
+  }
+
+  template<typename NodeT>
+  static NodeT* new_group(const size_t count) {
+    return aligned_new_array<NodeT>(count, CACHELINE_SIZE);
+  }
+
+  template<typename NodeT>
+  static void delete_node_group(NodeT *group) {
+    aligned_delete_array(group);
+  }
+
+  // free group and the subtrees below it. level 0 holds leaves.
+  static void delete_group(void *group, const size_t level, const size_t count) {
+    if (level > 0) {
+      InnerNode *nodes = static_cast<InnerNode*>(group);
+      for (size_t i = 0; i < count; ++i) {
+        delete_group(nodes[i].children_, level - 1, nodes[i].count_ + 1);
+      }
+    }
+    aligned_delete_array(static_cast<char*>(group));
+  }
+
+private:
+  CSBTreeIndex(const CSBTreeIndex &);
+  CSBTreeIndex& operator=(const CSBTreeIndex &);
+
+private:
+  // a group of one node. a leaf if height_ is 0.
+  void *root_;
+  size_t height_;
+  size_t size_;
+
+  size_t inner_count_;
+  size_t leaf_count_;
+
+  LeafNode *first_leaf_;
+  LeafNode *last_leaf_;
 };
 
 }
@@ -1,36 +1,220 @@
 #pragma once
 
+#include <cstdlib>
+#include <new>
+
+#include "fast_random.h"
+
 #include "base_dynamic_index.h"
 
 namespace dynamic_index {
 namespace singlethread {
 
+// a skiplist that keeps each key, its value and its tower of next pointers in a single allocation,
+// so that every step of a search touches one cache line.
+// a node is promoted to the next level with probability 1/4, which keeps towers at 1.33 pointers on average.
+// duplicate keys are kept in insertion order. the bottom level is linked both ways for reverse scans.
 template<typename KeyT, typename ValueT>
 class SkiplistIndex : public BaseDynamicIndex<KeyT, ValueT> {
 
+  // enough levels for 4^16 entries.
+  static const size_t MAX_HEIGHT = 16;
+
+  struct Node {
+    KeyT key_;
+    Uint64 value_;
+    // the previous node on the bottom level. head_ for the first node.
+    Node *prev_;
+    size_t height_;
+    // height_ pointers follow in the same allocation.
+    Node *next_[1];
+  };
+
 public:
-  SkiplistIndex(DataTable<KeyT, ValueT> *table_ptr) : BaseDynamicIndex<KeyT, ValueT>(table_ptr) {
-  }
-  
+  SkiplistIndex(DataTable<KeyT, ValueT> *table_ptr) : BaseDynamicIndex<KeyT, ValueT>(table_ptr),
+    head_(new_node(KeyT(), 0, MAX_HEIGHT)), tail_(nullptr), level_(1), size_(0) {}
+
   virtual ~SkiplistIndex() {
+    Node *node = head_;
+    while (node != nullptr) {
+      Node *next = node->next_[0];
+      free(node);
+      node = next;
+    }
+    head_ = nullptr;
+    tail_ = nullptr;
   }
 
+  // a new key goes after the keys that are equal to it.
   virtual void insert(const KeyT &key, const Uint64 &value) final {
+
+    Node *update[MAX_HEIGHT];
+    Node *x = head_;
+    for (size_t level = level_; level-- > 0; ) {
+      while (x->next_[level] != nullptr && !(key < x->next_[level]->key_)) {
+        x = x->next_[level];
+      }
+      update[level] = x;
+    }
+
+    size_t height = random_height();
+    for (; level_ < height; ++level_) {
+      update[level_] = head_;
+    }
+
+    Node *node = new_node(key, value, height);
+    for (size_t level = 0; level < height; ++level) {
+      node->next_[level] = update[level]->next_[level];
+      update[level]->next_[level] = node;
+    }
+
+    node->prev_ = update[0];
+    if (node->next_[0] != nullptr) {
+      node->next_[0]->prev_ = node;
+    } else {
+      tail_ = node;
+    }
+
+    ++size_;
+  }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+    for (Node *node = lower_bound(key); node != nullptr && node->key_ == key; node = node->next_[0]) {
+      if (!values.push_back(node->value_)) { return; }
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
+
+    for (Node *node = lower_bound(lhs_key); node != nullptr && !(rhs_key < node->key_); node = node->next_[0]) {
+      if (!values.push_back(node->value_)) { return; }
+    }
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {    
+  virtual void scan(const KeyT &key, ResultSink &values) final {
+    for (Node *node = head_->next_[0]; node != nullptr; node = node->next_[0]) {
+      if (node->key_ == key) {
+        if (!values.push_back(node->value_)) { return; }
+      }
+      if (node->key_ > key) {
+        return;
+      }
+    }
   }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) final {
+    for (Node *node = tail_; node != nullptr && node != head_; node = node->prev_) {
+      if (node->key_ == key) {
+        if (!values.push_back(node->value_)) { return; }
+      }
+      if (node->key_ < key) {
+        return;
+      }
+    }
   }
 
+  virtual void scan_full(ResultSink &values, const size_t count) final {
+    size_t i = 0;
+    for (Node *node = head_->next_[0]; node != nullptr && i < count; node = node->next_[0], ++i) {
+      if (!values.push_back(node->value_)) { return; }
+    }
+  }
+
+  // remove all values of key.
   virtual void erase(const KeyT &key) final {
+
+    Node *update[MAX_HEIGHT];
+    Node *x = head_;
+    for (size_t level = level_; level-- > 0; ) {
+      while (x->next_[level] != nullptr && x->next_[level]->key_ < key) {
+        x = x->next_[level];
+      }
+      update[level] = x;
+    }
+
+    // the first node of key is the first one at every level it reaches, and so are the ones after it.
+    Node *node = update[0]->next_[0];
+    while (node != nullptr && node->key_ == key) {
+      for (size_t level = 0; level < node->height_; ++level) {
+        update[level]->next_[level] = node->next_[level];
+      }
+
+      Node *next = node->next_[0];
+      if (next != nullptr) {
+        next->prev_ = update[0];
+      } else {
+        tail_ = (update[0] != head_) ? update[0] : nullptr;
+      }
+
+      free(node);
+      --size_;
+      node = next;
+    }
+
+    while (level_ > 1 && head_->next_[level_ - 1] == nullptr) {
+      --level_;
+    }
   }
 
   virtual size_t size() const final {
-    return 0;
+    return size_;
+  }
+
+  virtual void print() const final {
+    std::cout << "size = " << size_ << ", levels = " << level_ << std::endl;
+  }
+
+private:
+  // the first node whose key is not less than key.
+  Node* lower_bound(const KeyT &key) const {
+    Node *x = head_;
+    for (size_t level = level_; level-- > 0; ) {
+      while (x->next_[level] != nullptr && x->next_[level]->key_ < key) {
+        x = x->next_[level];
+      }
+    }
+    return x->next_[0];
+  }
+
+  size_t random_height() {
+    uint64_t bits = rand_gen_.next<uint64_t>();
+    size_t height = 1;
+    while ((bits & 3) == 0 && height < MAX_HEIGHT) {
+      bits >>= 2;
+      ++height;
+    }
+    return height;
+  }
+
+  static Node* new_node(const KeyT &key, const Uint64 value, const size_t height) {
+    Node *node = static_cast<Node*>(malloc(sizeof(Node) + (height - 1) * sizeof(Node*)));
+    if (node == nullptr) {
+      throw std::bad_alloc();
+    }
+    node->key_ = key;
+    node->value_ = value;
+    node->prev_ = nullptr;
+    node->height_ = height;
+    for (size_t level = 0; level < height; ++level) {
+      node->next_[level] = nullptr;
+    }
+    return node;
   }
 
+private:
+  SkiplistIndex(const SkiplistIndex &);
+  SkiplistIndex& operator=(const SkiplistIndex &);
+
+private:
+  Node *head_;
+  // the last node on the bottom level, if any
+  Node *tail_;
+  // number of levels in use
+  size_t level_;
+  size_t size_;
+  FastRandom rand_gen_;
 };
 
 }
@@ -1623,6 +1623,19 @@ public:
         return const_reverse_iterator(begin());
     }
 
+private:
+    // *** B+ Tree Node Prefetching
+
+    /// Issues prefetches for all cache lines of node n. The node type is
+    /// unknown before n is read, so the larger of both node sizes is used.
+    inline void prefetch_node(const node* n) const
+    {
+        const size_t nodesize = std::max(sizeof(inner_node), sizeof(leaf_node));
+
+        for (size_t offset = 0; offset < nodesize; offset += 64)
+            __builtin_prefetch(reinterpret_cast<const char*>(n) + offset);
+    }
+
 private:
     // *** B+ Tree Node Binary Search Functions
 
@@ -1892,6 +1905,52 @@ public:
         return const_iterator(leaf, slot);
     }
 
+    /// Searches the B+ tree for a batch of keys and stores an iterator to the
+    /// first pair equal to or greater than keys[i] into results[i]. As all
+    /// leaves are on the same level, the lookups descend the tree in lockstep,
+    /// and the next node of each lookup is prefetched before the remaining
+    /// lookups are advanced. This overlaps the cache misses of the lookups.
+    void lower_bound_batch(const key_type* keys, size_type count, iterator* results)
+    {
+        const size_type groupsize = 16;
+        node* nodes[groupsize];
+
+        for (size_type begin = 0; begin < count; begin += groupsize)
+        {
+            size_type n = std::min(groupsize, count - begin);
+
+            if (!m_root)
+            {
+                for (size_type i = 0; i < n; ++i)
+                    results[begin + i] = end();
+                continue;
+            }
+
+            for (size_type i = 0; i < n; ++i)
+                nodes[i] = m_root;
+
+            for (unsigned short level = m_root->level; level > 0; --level)
+            {
+                for (size_type i = 0; i < n; ++i)
+                {
+                    const inner_node* inner = static_cast<const inner_node*>(nodes[i]);
+                    int slot = find_lower(inner, keys[begin + i]);
+
+                    nodes[i] = inner->childid[slot];
+                    prefetch_node(nodes[i]);
+                }
+            }
+
+            for (size_type i = 0; i < n; ++i)
+            {
+                leaf_node* leaf = static_cast<leaf_node*>(nodes[i]);
+
+                int slot = find_lower(leaf, keys[begin + i]);
+                results[begin + i] = iterator(leaf, slot);
+            }
+        }
+    }
+
     /// Searches the B+ tree and returns an iterator to the first pair
     /// greater than key, or end() if all keys are smaller or equal.
     iterator upper_bound(const key_type& key)
@@ -373,6 +373,13 @@ public:
         return tree.lower_bound(key);
     }
 
+    /// Searches the B+ tree for a batch of keys and stores an iterator to the
+    /// first pair equal to or greater than keys[i] into results[i].
+    void lower_bound_batch(const key_type* keys, size_type count, iterator* results)
+    {
+        tree.lower_bound_batch(keys, count, results);
+    }
+
     /// Searches the B+ tree and returns an iterator to the first pair
     /// greater than key, or end() if all keys are smaller or equal.
     iterator upper_bound(const key_type& key)
@@ -20,14 +20,14 @@ public:
     container_.insert(std::pair<GenericKey, Uint64>(key, value));
   }
 
-  virtual void find(const GenericKey &key, std::vector<Uint64> &values) final {
+  virtual void find(const GenericKey &key, ResultSink &values) final {
     auto ret = container_.equal_range(key);
     for (auto iter = ret.first; iter != ret.second; ++iter) {
-      values.push_back(iter->second);
+      if (!values.push_back(iter->second)) { return; }
     }
   }
 
-  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_range(const GenericKey &lhs_key, const GenericKey &rhs_key, ResultSink &values) final {
 
     if (lhs_key > rhs_key) { return; }
 
@@ -40,14 +40,14 @@ public:
     auto itup = container_.upper_bound(rhs_key);
 
     for (auto it = itlow; it != itup; ++it) {
-      values.push_back(it->second);
+      if (!values.push_back(it->second)) { return; }
     }
   }
 
-  virtual void scan(const GenericKey &key, std::vector<Uint64> &values) final {
+  virtual void scan(const GenericKey &key, ResultSink &values) final {
     for (auto it = container_.begin(); it != container_.end(); ++it) {
       if (it->first == key) {
-        values.push_back(it->second);
+        if (!values.push_back(it->second)) { return; }
       }
       if (it->first > key) {
         return;
@@ -55,13 +55,13 @@ public:
     }
   }
 
-  virtual void scan_reverse(const GenericKey &key, std::vector<Uint64> &values) final {}
+  virtual void scan_reverse(const GenericKey &key, ResultSink &values) final {}
 
-  virtual void scan_full(std::vector<Uint64> &values, const size_t count) final {
+  virtual void scan_full(ResultSink &values, const size_t count) final {
     size_t i = 0;
     for (auto it = container_.begin(); it != container_.end(); ++it) {
       if (i < count) {
-        values.push_back(it->second);
+        if (!values.push_back(it->second)) { return; }
         ++i;
       } else {
         return;
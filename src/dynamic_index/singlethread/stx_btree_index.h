@@ -20,14 +20,33 @@ public:
     container_.insert(std::pair<KeyT, Uint64>(key, value));
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {
+  virtual void find(const KeyT &key, ResultSink &values) final {
     auto ret = container_.equal_range(key);
     for (auto iter = ret.first; iter != ret.second; ++iter) {
-      values.push_back(iter->second);
+      if (!values.push_back(iter->second)) { return; }
     }
   }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
+    
+    typename stx::btree_multimap<KeyT, Uint64>::iterator iters[PREFETCH_GROUP_SIZE];
+
+    for (size_t group_begin = 0; group_begin < count; group_begin += PREFETCH_GROUP_SIZE) {
+
+      const KeyT *group_keys = keys + group_begin;
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, count - group_begin);
+
+      container_.lower_bound_batch(group_keys, group_size, iters);
+
+      for (size_t i = 0; i < group_size; ++i) {
+        for (auto iter = iters[i]; iter != container_.end() && iter->first == group_keys[i]; ++iter) {
+          if (!values[group_begin + i].push_back(iter->second)) { break; }
+        }
+      }
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
     
     if (lhs_key > rhs_key) { return; }
 
@@ -40,14 +59,14 @@ public:
     auto itup = container_.upper_bound(rhs_key);
 
     for (auto it = itlow; it != itup; ++it) {
-      values.push_back(it->second);
+      if (!values.push_back(it->second)) { return; }
     }
   }
 
-  virtual void scan(const KeyT &key, std::vector<Uint64> &values) final {
+  virtual void scan(const KeyT &key, ResultSink &values) final {
     for (auto it = container_.begin(); it != container_.end(); ++it) {
       if (it->first == key) {
-        values.push_back(it->second);
+        if (!values.push_back(it->second)) { return; }
       }
       if (it->first > key) {
         return;
@@ -55,13 +74,13 @@ public:
     }
   }
 
-  virtual void scan_reverse(const KeyT &key, std::vector<Uint64> &values) final {}
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) final {}
 
-  virtual void scan_full(std::vector<Uint64> &values, const size_t count) final {
+  virtual void scan_full(ResultSink &values, const size_t count) final {
     size_t i = 0;
     for (auto it = container_.begin(); it != container_.end(); ++it) {
       if (i < count) {
-        values.push_back(it->second);
+        if (!values.push_back(it->second)) { return; }
         ++i;
       } else {
         return;
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "utils.h"
+
+// epoch-based reclamation of objects that readers may still hold after they were unlinked.
+// a reader announces the global epoch in its slot while it reads. an object that was retired in an epoch
+// is freed once every reader has left that epoch, so that none of them can still hold it.
+class EpochManager {
+
+  // one cacheline per thread, so that readers do not share lines.
+  struct alignas(64) EpochSlot {
+    EpochSlot() : epoch_(QUIESCENT_EPOCH) {}
+
+    std::atomic<uint64_t> epoch_;
+  };
+
+  struct RetiredObject {
+    uint64_t epoch_;
+    std::function<void()> deleter_;
+  };
+
+public:
+  EpochManager() : global_epoch_(1), slots_(nullptr), thread_count_(0) {}
+
+  // frees all retired objects. no reader may be left.
+  ~EpochManager() {
+    for (auto &object : retired_objects_) {
+      object.deleter_();
+    }
+    aligned_delete_array(slots_);
+    slots_ = nullptr;
+  }
+
+  // must be called before any thread reads.
+  void prepare_threads(const size_t thread_count) {
+    aligned_delete_array(slots_);
+    slots_ = aligned_new_array<EpochSlot>(thread_count);
+    for (size_t thread_id = 0; thread_id < thread_count; ++thread_id) {
+      new (&slots_[thread_id]) EpochSlot();
+    }
+    thread_count_ = thread_count;
+  }
+
+  size_t thread_count() const { return thread_count_; }
+
+  // the object that a reader loads after entering stays valid until it exits.
+  void enter(const size_t thread_id) {
+    ASSERT(thread_id < thread_count_, "unprepared thread: " << thread_id << " " << thread_count_);
+    slots_[thread_id].epoch_.store(global_epoch_.load());
+  }
+
+  void exit(const size_t thread_id) {
+    slots_[thread_id].epoch_.store(QUIESCENT_EPOCH, std::memory_order_release);
+  }
+
+  // hand over an object that no new reader can reach any more. deleter frees it once no reader holds it.
+  void retire(const std::function<void()> &deleter) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    RetiredObject object;
+    object.epoch_ = global_epoch_.fetch_add(1);
+    object.deleter_ = deleter;
+    retired_objects_.push_back(object);
+  }
+
+  // free the retired objects that no reader can hold, and return the number of those left.
+  size_t reclaim() {
+    std::lock_guard<std::mutex> guard(mutex_);
+
+    uint64_t min_epoch = QUIESCENT_EPOCH;
+    for (size_t thread_id = 0; thread_id < thread_count_; ++thread_id) {
+      min_epoch = std::min(min_epoch, slots_[thread_id].epoch_.load());
+    }
+
+    // readers in a later epoch entered after the object was unlinked.
+    size_t kept_count = 0;
+    for (auto &object : retired_objects_) {
+      if (object.epoch_ < min_epoch) {
+        object.deleter_();
+      } else {
+        retired_objects_[kept_count++] = object;
+      }
+    }
+    retired_objects_.resize(kept_count);
+    return kept_count;
+  }
+
+private:
+  EpochManager(const EpochManager &);
+  EpochManager& operator=(const EpochManager &);
+
+private:
+  static const uint64_t QUIESCENT_EPOCH = std::numeric_limits<uint64_t>::max();
+
+  std::atomic<uint64_t> global_epoch_;
+
+  EpochSlot *slots_;
+  size_t thread_count_;
+
+  std::mutex mutex_;
+  std::vector<RetiredObject> retired_objects_;
+};
+
+// keeps a reader in the current epoch for its lifetime.
+class EpochGuard {
+
+public:
+  EpochGuard(EpochManager &epoch_manager, const size_t thread_id) :
+    epoch_manager_(epoch_manager), thread_id_(thread_id) {
+    epoch_manager_.enter(thread_id_);
+  }
+
+  ~EpochGuard() {
+    epoch_manager_.exit(thread_id_);
+  }
+
+private:
+  EpochGuard(const EpochGuard &);
+  EpochGuard& operator=(const EpochGuard &);
+
+private:
+  EpochManager &epoch_manager_;
+  size_t thread_id_;
+};
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "dynamic_index/singlethread/stx_btree/btree_multimap.h"
+
+#include "base_static_index.h"
+#include "time_measurer.h"
+
+// a static index that takes inserts. new entries go to a small write buffer, and a background thread
+// merges the buffer into a freshly built static index once it holds merge_threshold entries.
+// reads see the static part, the buffer that is being merged, and the buffer that takes inserts.
+// a merge only takes the lock to freeze the buffer and to publish the new static part,
+// so readers are not blocked while the static part is rebuilt.
+// values from the static part come before those from the buffers.
+template<typename KeyT, typename ValueT>
+class HybridIndex : public BaseIndex<KeyT, ValueT> {
+
+  typedef stx::btree_multimap<KeyT, Uint64> WriteBuffer;
+  typedef typename BaseStaticIndex<KeyT, ValueT>::KeyValuePair KeyValuePair;
+
+public:
+  static const size_t DEFAULT_MERGE_THRESHOLD = 1 << 16;
+
+  HybridIndex(DataTable<KeyT, ValueT> *table_ptr, const StaticIndexFactory<KeyT, ValueT> &factory, const size_t merge_threshold = DEFAULT_MERGE_THRESHOLD, const size_t build_thread_count = 1) :
+    BaseIndex<KeyT, ValueT>(table_ptr), factory_(factory), merge_threshold_(std::max(merge_threshold, size_t(1))), build_thread_count_(std::max(build_thread_count, size_t(1))),
+    static_index_(nullptr), active_buffer_(new WriteBuffer()), frozen_buffer_(nullptr),
+    active_size_(0), is_stopping_(false), is_merging_(false), merge_count_(0), merge_time_ms_(0) {}
+
+  virtual ~HybridIndex() {
+    stop_merge_thread();
+
+    delete static_index_;
+    static_index_ = nullptr;
+
+    delete active_buffer_;
+    active_buffer_ = nullptr;
+
+    delete frozen_buffer_;
+    frozen_buffer_ = nullptr;
+  }
+
+  // before the first reorganize, tuples are left to the data table, which the static part is built from.
+  virtual void insert(const KeyT &key, const Uint64 &value) final {
+    lock_.lock();
+    if (static_index_ == nullptr) {
+      lock_.unlock();
+      return;
+    }
+    active_buffer_->insert(std::pair<KeyT, Uint64>(key, value));
+    lock_.unlock();
+    active_size_.fetch_add(1);
+  }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+    lock_.lock_shared();
+    if (static_index_ != nullptr) {
+      static_index_->find(key, values);
+    }
+    find_buffers(key, values);
+    lock_.unlock_shared();
+  }
+
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
+    lock_.lock_shared();
+    if (static_index_ != nullptr) {
+      static_index_->find_batch(keys, count, values);
+    }
+    for (size_t i = 0; i < count; ++i) {
+      find_buffers(keys[i], values[i]);
+    }
+    lock_.unlock_shared();
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
+
+    lock_.lock_shared();
+    if (static_index_ != nullptr) {
+      static_index_->find_range(lhs_key, rhs_key, values);
+    }
+    WriteBuffer *buffers[2] = { frozen_buffer_, active_buffer_ };
+    for (size_t i = 0; i < 2 && !values.full(); ++i) {
+      if (buffers[i] == nullptr) { continue; }
+      for (auto it = buffers[i]->lower_bound(lhs_key); it != buffers[i]->end() && !(rhs_key < it->first); ++it) {
+        if (!values.push_back(it->second)) { break; }
+      }
+    }
+    lock_.unlock_shared();
+  }
+
+  virtual void scan(const KeyT &key, ResultSink &values) final {
+    lock_.lock_shared();
+    if (static_index_ != nullptr) {
+      static_index_->scan(key, values);
+    }
+    find_buffers(key, values);
+    lock_.unlock_shared();
+  }
+
+  // values come in the reverse order of find().
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) final {
+    lock_.lock_shared();
+    WriteBuffer *buffers[2] = { active_buffer_, frozen_buffer_ };
+    for (size_t i = 0; i < 2 && !values.full(); ++i) {
+      if (buffers[i] == nullptr) { continue; }
+      auto range = buffers[i]->equal_range(key);
+      for (auto it = range.second; it != range.first; ) {
+        --it;
+        if (!values.push_back(it->second)) { break; }
+      }
+    }
+    if (static_index_ != nullptr && !values.full()) {
+      static_index_->scan_reverse(key, values);
+    }
+    lock_.unlock_shared();
+  }
+
+  virtual void scan_full(ResultSink &values, const size_t count) final {
+    lock_.lock_shared();
+    size_t base_size = values.size();
+    if (static_index_ != nullptr) {
+      static_index_->scan_full(values, count);
+    }
+    WriteBuffer *buffers[2] = { frozen_buffer_, active_buffer_ };
+    for (size_t i = 0; i < 2 && !values.full(); ++i) {
+      if (buffers[i] == nullptr) { continue; }
+      for (auto it = buffers[i]->begin(); it != buffers[i]->end() && values.size() - base_size < count; ++it) {
+        if (!values.push_back(it->second)) { break; }
+      }
+    }
+    lock_.unlock_shared();
+  }
+
+  // like the static part, the index does not support erase.
+  virtual void erase(const KeyT &key) final {}
+
+  virtual size_t size() const final {
+    lock_.lock_shared();
+    size_t size = active_buffer_->size();
+    if (static_index_ != nullptr) {
+      size += static_index_->size();
+    }
+    if (frozen_buffer_ != nullptr) {
+      size += frozen_buffer_->size();
+    }
+    lock_.unlock_shared();
+    return size;
+  }
+
+  // build the static part from all tuples of the data table, drop the buffers, and start merging in the background.
+  // must not run concurrently with any other operation.
+  virtual void reorganize(const size_t thread_count) final {
+
+    stop_merge_thread();
+
+    delete static_index_;
+    static_index_ = factory_();
+    static_index_->reorganize(thread_count);
+
+    delete frozen_buffer_;
+    frozen_buffer_ = nullptr;
+
+    active_buffer_->clear();
+    active_size_ = 0;
+
+    is_stopping_ = false;
+    merge_thread_ = std::thread(&HybridIndex::run_merge_thread, this);
+  }
+
+  virtual void prepare_threads(const size_t thread_count) final {}
+
+  virtual void register_thread(const size_t thread_id) final {}
+
+  virtual void print() const final {
+    if (static_index_ != nullptr) {
+      static_index_->print();
+    }
+    std::cout << "buffered entries = " << active_size_.load() << ", merge threshold = " << merge_threshold_ << std::endl;
+    std::cout << "merges = " << merge_count_.load() << ", merge time = " << merge_time_ms_.load() << " ms" << std::endl;
+  }
+
+  // merge the buffer into a new static part on the calling thread, and wait for it to be published.
+  // merges are serialized, so this also waits for a background merge that is under way.
+  void merge() {
+
+    std::lock_guard<std::mutex> guard(merge_mutex_);
+
+    if (static_index_ == nullptr) {
+      return;
+    }
+
+    // freeze the buffer. only this merge reads it from now on, besides readers.
+    lock_.lock();
+    if (active_buffer_->size() == 0) {
+      lock_.unlock();
+      return;
+    }
+    frozen_buffer_ = active_buffer_;
+    active_buffer_ = new WriteBuffer();
+    active_size_ = 0;
+    lock_.unlock();
+
+    is_merging_ = true;
+
+    TimeMeasurer timer;
+    timer.tic();
+
+    // static_index_ only changes under merge_mutex_, so it can be read without the lock here.
+    size_t static_count = static_index_->size();
+    size_t count = static_count + frozen_buffer_->size();
+
+    KeyValuePair *static_entries = huge_page_new_array<KeyValuePair>(static_count);
+    static_index_->export_entries(static_entries);
+
+    // merge both sorted sequences. equal keys keep static entries first.
+    KeyValuePair *entries = huge_page_new_array<KeyValuePair>(count);
+    size_t static_pos = 0;
+    size_t pos = 0;
+    for (auto it = frozen_buffer_->begin(); it != frozen_buffer_->end(); ++it) {
+      while (static_pos < static_count && !(it->first < static_entries[static_pos].key_)) {
+        entries[pos++] = static_entries[static_pos++];
+      }
+      entries[pos++] = KeyValuePair(it->first, it->second);
+    }
+    while (static_pos < static_count) {
+      entries[pos++] = static_entries[static_pos++];
+    }
+
+    huge_page_delete_array(static_entries);
+
+    BaseStaticIndex<KeyT, ValueT> *merged_index = factory_();
+    merged_index->reorganize_from(entries, count, build_thread_count_);
+
+    huge_page_delete_array(entries);
+
+    // publish. readers that took the lock before are done with the old static part and the frozen buffer.
+    lock_.lock();
+    BaseStaticIndex<KeyT, ValueT> *old_index = static_index_;
+    WriteBuffer *old_buffer = frozen_buffer_;
+    static_index_ = merged_index;
+    frozen_buffer_ = nullptr;
+    lock_.unlock();
+
+    delete old_index;
+    delete old_buffer;
+
+    timer.toc();
+    merge_time_ms_.fetch_add(timer.time_ms());
+    merge_count_.fetch_add(1);
+
+    is_merging_ = false;
+  }
+
+  bool is_merging() const { return is_merging_.load(); }
+
+  size_t merge_count() const { return merge_count_.load(); }
+
+  // total time spent in merges. unit: ms
+  size_t merge_time_ms() const { return merge_time_ms_.load(); }
+
+  size_t merge_threshold() const { return merge_threshold_; }
+
+private:
+  // return false if the sink does not accept any more values.
+  bool find_buffers(const KeyT &key, ResultSink &values) {
+    WriteBuffer *buffers[2] = { frozen_buffer_, active_buffer_ };
+    for (size_t i = 0; i < 2; ++i) {
+      if (values.full()) { return false; }
+      if (buffers[i] == nullptr) { continue; }
+      auto range = buffers[i]->equal_range(key);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (!values.push_back(it->second)) { return false; }
+      }
+    }
+    return !values.full();
+  }
+
+  void run_merge_thread() {
+    while (!is_stopping_.load()) {
+      if (active_size_.load() >= merge_threshold_) {
+        merge();
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  }
+
+  void stop_merge_thread() {
+    if (merge_thread_.joinable()) {
+      is_stopping_ = true;
+      merge_thread_.join();
+    }
+  }
+
+private:
+  HybridIndex(const HybridIndex &);
+  HybridIndex& operator=(const HybridIndex &);
+
+private:
+  // creates an empty static index of the wrapped type, for the first reorganize and for every merge
+  StaticIndexFactory<KeyT, ValueT> factory_;
+  const size_t merge_threshold_;
+  const size_t build_thread_count_;
+
+  // readers share the lock. inserts, and a merge freezing the buffer or publishing its result, hold it alone.
+  mutable ReadWriteSpinLock lock_;
+
+  BaseStaticIndex<KeyT, ValueT> *static_index_;
+
+  // takes inserts
+  WriteBuffer *active_buffer_;
+  // being merged into the next static part, if not null
+  WriteBuffer *frozen_buffer_;
+
+  // entries in the active buffer, for triggering merges. may be off by the inserts that race with a freeze.
+  std::atomic<size_t> active_size_;
+
+  std::mutex merge_mutex_;
+  std::thread merge_thread_;
+  std::atomic<bool> is_stopping_;
+  std::atomic<bool> is_merging_;
+  std::atomic<size_t> merge_count_;
+  std::atomic<size_t> merge_time_ms_;
+};
@@ -6,6 +6,14 @@
 #include "static_index/binary_index.h"
 #include "static_index/kary_index.h"
 #include "static_index/fast_index.h"
+#include "static_index/eytzinger_index.h"
+#include "static_index/veb_index.h"
+#include "static_index/pgm_index.h"
+#include "static_index/compressed_index.h"
+
+#include "hybrid_index.h"
+#include "static_index_handle.h"
+#include "sharded_index.h"
 
 #include "dynamic_index/singlethread/stx_btree_index.h"
 #include "dynamic_index/singlethread/art_tree_index.h"
@@ -16,6 +24,8 @@
 #include "dynamic_index/multithread/art_tree_index.h"
 #include "dynamic_index/multithread/bw_tree_index.h"
 #include "dynamic_index/multithread/masstree_index.h"
+#include "dynamic_index/multithread/skiplist_index.h"
+#include "dynamic_index/multithread/btree_olc_index.h"
 
 #include "dynamic_index/singlethread/stx_btree_generic_index.h"
 #include "dynamic_index/singlethread/art_tree_generic_index.h"
@@ -32,6 +42,10 @@ enum class IndexType {
   S_Binary, 
   S_KAry, 
   S_Fast,
+  S_Eytzinger,
+  S_Veb,
+  S_Pgm,
+  S_Compressed,
 
   // dynamic indexes - singlethread
   D_ST_StxBtree = 10,
@@ -44,6 +58,8 @@ enum class IndexType {
   D_MT_ArtTree,
   D_MT_BwTree,
   D_MT_Masstree,
+  D_MT_Skiplist,
+  D_MT_BTreeOLC,
 
 };
 
@@ -57,12 +73,22 @@ static std::string get_index_name(const IndexType index_type) {
     return "static - k-ary index";
   } else if (index_type == IndexType::S_Fast) {
     return "static - fast index";
+  } else if (index_type == IndexType::S_Eytzinger) {
+    return "static - eytzinger index";
+  } else if (index_type == IndexType::S_Veb) {
+    return "static - van emde boas index";
+  } else if (index_type == IndexType::S_Pgm) {
+    return "static - pgm index";
+  } else if (index_type == IndexType::S_Compressed) {
+    return "static - compressed index";
   } else if (index_type == IndexType::D_ST_StxBtree) {
     return "dynamic - singlethread - stx-btree index";
   } else if (index_type == IndexType::D_ST_ArtTree) {
     return "dynamic - singlethread - art-tree index";
   } else if (index_type == IndexType::D_ST_Skiplist) {
     return "dynamic - singlethread - skiplist index";
+  } else if (index_type == IndexType::D_ST_CSBtree) {
+    return "dynamic - singlethread - csb+-tree index";
   } else if (index_type == IndexType::D_MT_Libcuckoo) {
     return "dynamic - multithread - libcuckoo index";
   } else if (index_type == IndexType::D_MT_ArtTree) {
@@ -71,6 +97,10 @@ static std::string get_index_name(const IndexType index_type) {
     return "dynamic - multithread - bw-tree index";
   } else if (index_type == IndexType::D_MT_Masstree) {
     return "dynamic - multithread - masstree index";
+  } else if (index_type == IndexType::D_MT_Skiplist) {
+    return "dynamic - multithread - skiplist index";
+  } else if (index_type == IndexType::D_MT_BTreeOLC) {
+    return "dynamic - multithread - olc b+-tree index";
   } else {
     ASSERT(false, "invalid index type");
     return "";
@@ -79,19 +109,31 @@ static std::string get_index_name(const IndexType index_type) {
 
 static const int INVALID_INDEX_PARAM = -1;
 
-// make sure that required parameters are set
-static void validate_index_params(const IndexType index_type, const int index_param_1, const int index_param_2) {
+// make sure that required parameters are set. key_size is in bytes.
+static void validate_index_params(const IndexType index_type, const int index_param_1, const int index_param_2, const size_t key_size = 8) {
   if (index_type == IndexType::S_Interpolation) {
 
-    if (index_param_1 == INVALID_INDEX_PARAM) {
+    // adaptive segmentation picks the number of segments by itself
+    if (index_param_1 == INVALID_INDEX_PARAM && index_param_2 == INVALID_INDEX_PARAM) {
       std::cerr << "expected index type: static - interpolation index" << std::endl;
       std::cerr << "error: number of segments is unset!" << std::endl;
       exit(EXIT_FAILURE);
       return;
     }
 
+    if (index_param_2 != INVALID_INDEX_PARAM && index_param_2 < 1) {
+      std::cerr << "expected index type: static - interpolation index" << std::endl;
+      std::cerr << "error: target error must be larger than or equal to 1!" << std::endl;
+      exit(EXIT_FAILURE);
+      return;
+    }
+
     std::cout << "index type: static - interpolation index" << std::endl;
-    std::cout << "number of segments: " << index_param_1 << std::endl;
+    if (index_param_2 != INVALID_INDEX_PARAM) {
+      std::cout << "adaptive segmentation, target error: " << index_param_2 << std::endl;
+    } else {
+      std::cout << "number of segments: " << index_param_1 << std::endl;
+    }
 
   } else if (index_type == IndexType::S_Binary) {
     
@@ -141,8 +183,65 @@ static void validate_index_params(const IndexType index_type, const int index_pa
       return;
     }
     
+    if (index_param_2 != INVALID_INDEX_PARAM && index_param_2 != 128 && index_param_2 != 256 && index_param_2 != 512) {
+      std::cerr << "expected index type: static - fast index" << std::endl;
+      std::cerr << "error: simd width must be 128, 256 or 512!" << std::endl;
+      exit(EXIT_FAILURE);
+      return;
+    }
+
+    if (index_param_1 % static_index::fast_node_depth(key_size) != 0) {
+      std::cerr << "expected index type: static - fast index" << std::endl;
+      std::cerr << "error: number of layers must be a multiple of " << static_index::fast_node_depth(key_size) << " with " << key_size << "-byte keys!" << std::endl;
+      exit(EXIT_FAILURE);
+      return;
+    }
+
     std::cout << "index type: static - fast index" << std::endl;
     std::cout << "number of layers: " << index_param_1 << std::endl;
+    if (index_param_2 != INVALID_INDEX_PARAM) {
+      std::cout << "simd width: " << index_param_2 << std::endl;
+    } else {
+      std::cout << "simd width: " << simd_max_width() * 8 << std::endl;
+    }
+
+  } else if (index_type == IndexType::S_Pgm) {
+
+    if (index_param_1 != INVALID_INDEX_PARAM && index_param_1 < 1) {
+      std::cerr << "expected index type: static - pgm index" << std::endl;
+      std::cerr << "error: error bound must be larger than or equal to 1!" << std::endl;
+      exit(EXIT_FAILURE);
+      return;
+    }
+
+    if (index_param_2 != INVALID_INDEX_PARAM && index_param_2 < 1) {
+      std::cerr << "expected index type: static - pgm index" << std::endl;
+      std::cerr << "error: inner error bound must be larger than or equal to 1!" << std::endl;
+      exit(EXIT_FAILURE);
+      return;
+    }
+
+    std::cout << "index type: static - pgm index" << std::endl;
+    if (index_param_1 != INVALID_INDEX_PARAM) {
+      std::cout << "error bound: " << index_param_1 << std::endl;
+    }
+    if (index_param_2 != INVALID_INDEX_PARAM) {
+      std::cout << "inner error bound: " << index_param_2 << std::endl;
+    }
+
+  } else if (index_type == IndexType::S_Compressed) {
+
+    if (index_param_1 != INVALID_INDEX_PARAM && (index_param_1 < 1 || (index_param_1 & (index_param_1 - 1)) != 0)) {
+      std::cerr << "expected index type: static - compressed index" << std::endl;
+      std::cerr << "error: block size must be a power of 2!" << std::endl;
+      exit(EXIT_FAILURE);
+      return;
+    }
+
+    std::cout << "index type: static - compressed index" << std::endl;
+    if (index_param_1 != INVALID_INDEX_PARAM) {
+      std::cout << "block size: " << index_param_1 << std::endl;
+    }
 
   } else {
     
@@ -152,24 +251,42 @@ static void validate_index_params(const IndexType index_type, const int index_pa
   }
 }
 
+// layout is only used by static indexes.
 template<typename KeyT, typename ValueT>
-static BaseIndex<KeyT, ValueT>* create_numeric_index(const IndexType index_type, DataTable<KeyT, uint64_t> *table_ptr, const int index_param_1 = INVALID_INDEX_PARAM, const int index_param_2 = INVALID_INDEX_PARAM) {
+static BaseIndex<KeyT, ValueT>* create_numeric_index(const IndexType index_type, DataTable<KeyT, uint64_t> *table_ptr, const int index_param_1 = INVALID_INDEX_PARAM, const int index_param_2 = INVALID_INDEX_PARAM, const LayoutType layout = LayoutType::AoSLayout) {
 
   if (index_type == IndexType::S_Interpolation) {
 
-    return new static_index::InterpolationIndex<KeyT, ValueT>(table_ptr, index_param_1);
+    size_t num_segments = (index_param_1 != INVALID_INDEX_PARAM) ? index_param_1 : 1;
+    return new static_index::InterpolationIndex<KeyT, ValueT>(table_ptr, num_segments, index_param_2, layout);
   
   } else if (index_type == IndexType::S_Binary) {
 
-    return new static_index::BinaryIndex<KeyT, ValueT>(table_ptr, index_param_1);
+    return new static_index::BinaryIndex<KeyT, ValueT>(table_ptr, index_param_1, layout);
 
   } else if (index_type == IndexType::S_KAry) {
 
-    return new static_index::KAryIndex<KeyT, ValueT>(table_ptr, index_param_1, index_param_2);
+    return new static_index::KAryIndex<KeyT, ValueT>(table_ptr, index_param_1, index_param_2, layout);
 
   } else if (index_type == IndexType::S_Fast) {
 
-    return new static_index::FastIndex<KeyT, ValueT>(table_ptr, index_param_1);
+    return new static_index::FastIndex<KeyT, ValueT>(table_ptr, index_param_1, index_param_2, layout);
+
+  } else if (index_type == IndexType::S_Eytzinger) {
+
+    return new static_index::EytzingerIndex<KeyT, ValueT>(table_ptr, layout);
+
+  } else if (index_type == IndexType::S_Veb) {
+
+    return new static_index::VebIndex<KeyT, ValueT>(table_ptr, layout);
+
+  } else if (index_type == IndexType::S_Pgm) {
+
+    return new static_index::PgmIndex<KeyT, ValueT>(table_ptr, index_param_1, index_param_2, layout);
+
+  } else if (index_type == IndexType::S_Compressed) {
+
+    return new static_index::CompressedIndex<KeyT, ValueT>(table_ptr, index_param_1, layout);
 
   } else if (index_type == IndexType::D_ST_StxBtree) {
 
@@ -183,6 +300,10 @@ static BaseIndex<KeyT, ValueT>* create_numeric_index(const IndexType index_type,
 
     return new dynamic_index::singlethread::SkiplistIndex<KeyT, ValueT>(table_ptr);
 
+  } else if (index_type == IndexType::D_ST_CSBtree) {
+
+    return new dynamic_index::singlethread::CSBTreeIndex<KeyT, ValueT>(table_ptr);
+
   } else if (index_type == IndexType::D_MT_Libcuckoo) {
 
     return new dynamic_index::multithread::LibcuckooIndex<KeyT, ValueT>(table_ptr);
@@ -199,6 +320,14 @@ static BaseIndex<KeyT, ValueT>* create_numeric_index(const IndexType index_type,
 
     return new dynamic_index::multithread::MasstreeIndex<KeyT, ValueT>(table_ptr);
 
+  } else if (index_type == IndexType::D_MT_Skiplist) {
+
+    return new dynamic_index::multithread::SkiplistIndex<KeyT, ValueT>(table_ptr);
+
+  } else if (index_type == IndexType::D_MT_BTreeOLC) {
+
+    return new dynamic_index::multithread::BTreeOLCIndex<KeyT, ValueT>(table_ptr);
+
   } else {
 
     ASSERT(false, "unsupported index type");
@@ -207,6 +336,141 @@ static BaseIndex<KeyT, ValueT>* create_numeric_index(const IndexType index_type,
 }
 
 
+static bool is_static_index(const IndexType index_type) {
+  return int(index_type) < int(IndexType::D_ST_StxBtree);
+}
+
+// creates empty static indexes of index_type. configure, if set, is applied to each of them before it is built.
+template<typename KeyT, typename ValueT>
+static StaticIndexFactory<KeyT, ValueT> make_static_index_factory(const IndexType index_type, DataTable<KeyT, uint64_t> *table_ptr, const int index_param_1, const int index_param_2, const LayoutType layout, const std::function<void(BaseStaticIndex<KeyT, ValueT>*)> &configure) {
+
+  ASSERT(is_static_index(index_type), "not a static index type");
+
+  return [=]() {
+    auto static_index = static_cast<BaseStaticIndex<KeyT, ValueT>*>(create_numeric_index<KeyT, ValueT>(index_type, table_ptr, index_param_1, index_param_2, layout));
+    if (configure) {
+      configure(static_index);
+    }
+    return static_index;
+  };
+}
+
+// wrap a static index of index_type in a hybrid index, whose write buffer is merged into 
+// a new static index once it holds merge_threshold entries. see hybrid_index.h.
+template<typename KeyT, typename ValueT>
+static HybridIndex<KeyT, ValueT>* create_hybrid_index(const IndexType index_type, DataTable<KeyT, uint64_t> *table_ptr, const int index_param_1 = INVALID_INDEX_PARAM, const int index_param_2 = INVALID_INDEX_PARAM, const LayoutType layout = LayoutType::AoSLayout, const size_t merge_threshold = HybridIndex<KeyT, ValueT>::DEFAULT_MERGE_THRESHOLD, const size_t build_thread_count = 1, const std::function<void(BaseStaticIndex<KeyT, ValueT>*)> &configure = nullptr) {
+
+  auto factory = make_static_index_factory<KeyT, ValueT>(index_type, table_ptr, index_param_1, index_param_2, layout, configure);
+  return new HybridIndex<KeyT, ValueT>(table_ptr, factory, merge_threshold, build_thread_count);
+}
+
+// wrap a static index of index_type in a handle that rebuilds it in the background. see static_index_handle.h.
+template<typename KeyT, typename ValueT>
+static StaticIndexHandle<KeyT, ValueT>* create_static_index_handle(const IndexType index_type, DataTable<KeyT, uint64_t> *table_ptr, const int index_param_1 = INVALID_INDEX_PARAM, const int index_param_2 = INVALID_INDEX_PARAM, const LayoutType layout = LayoutType::AoSLayout, const size_t build_thread_count = 1, const std::function<void(BaseStaticIndex<KeyT, ValueT>*)> &configure = nullptr) {
+
+  auto factory = make_static_index_factory<KeyT, ValueT>(index_type, table_ptr, index_param_1, index_param_2, layout, configure);
+  return new StaticIndexHandle<KeyT, ValueT>(table_ptr, factory, build_thread_count);
+}
+
+// spread keys over shard_count dynamic indexes of index_type. see sharded_index.h.
+template<typename KeyT, typename ValueT>
+static ShardedIndex<KeyT, ValueT>* create_sharded_index(const IndexType index_type, DataTable<KeyT, uint64_t> *table_ptr, const size_t shard_count, const ShardingType sharding_type, const std::vector<KeyT> &split_keys = std::vector<KeyT>()) {
+
+  ASSERT(!is_static_index(index_type), "static indexes cannot be sharded");
+
+  std::vector<BaseIndex<KeyT, ValueT>*> shards;
+  for (size_t shard_id = 0; shard_id < shard_count; ++shard_id) {
+    shards.push_back(create_numeric_index<KeyT, ValueT>(index_type, table_ptr));
+  }
+  return new ShardedIndex<KeyT, ValueT>(table_ptr, shards, sharding_type, split_keys);
+}
+
+
+// call func with the index cast to its concrete type. 
+// func is instantiated once per index type, so calls it makes on the index 
+// are resolved at compile time and can be inlined.
+template<typename KeyT, typename ValueT, typename FuncT>
+static void dispatch_numeric_index(const IndexType index_type, BaseIndex<KeyT, ValueT> *index, FuncT &func) {
+
+  if (index_type == IndexType::S_Interpolation) {
+
+    func(static_cast<static_index::InterpolationIndex<KeyT, ValueT>*>(index));
+  
+  } else if (index_type == IndexType::S_Binary) {
+
+    func(static_cast<static_index::BinaryIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::S_KAry) {
+
+    func(static_cast<static_index::KAryIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::S_Fast) {
+
+    func(static_cast<static_index::FastIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::S_Eytzinger) {
+
+    func(static_cast<static_index::EytzingerIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::S_Veb) {
+
+    func(static_cast<static_index::VebIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::S_Pgm) {
+
+    func(static_cast<static_index::PgmIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::S_Compressed) {
+
+    func(static_cast<static_index::CompressedIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::D_ST_StxBtree) {
+
+    func(static_cast<dynamic_index::singlethread::StxBtreeIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::D_ST_ArtTree) {
+
+    func(static_cast<dynamic_index::singlethread::ArtTreeIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::D_ST_Skiplist) {
+
+    func(static_cast<dynamic_index::singlethread::SkiplistIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::D_ST_CSBtree) {
+
+    func(static_cast<dynamic_index::singlethread::CSBTreeIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::D_MT_Libcuckoo) {
+
+    func(static_cast<dynamic_index::multithread::LibcuckooIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::D_MT_ArtTree) {
+
+    func(static_cast<dynamic_index::multithread::ArtTreeIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::D_MT_BwTree) {
+
+    func(static_cast<dynamic_index::multithread::BwTreeIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::D_MT_Masstree) {
+
+    func(static_cast<dynamic_index::multithread::MasstreeIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::D_MT_Skiplist) {
+
+    func(static_cast<dynamic_index::multithread::SkiplistIndex<KeyT, ValueT>*>(index));
+
+  } else if (index_type == IndexType::D_MT_BTreeOLC) {
+
+    func(static_cast<dynamic_index::multithread::BTreeOLCIndex<KeyT, ValueT>*>(index));
+
+  } else {
+
+    ASSERT(false, "unsupported index type");
+  }
+}
+
+
 static BaseGenericIndex* create_generic_index(const IndexType index_type, GenericDataTable *table_ptr) {
 
   if (index_type == IndexType::D_ST_StxBtree) {
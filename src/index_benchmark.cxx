@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <vector>
@@ -7,8 +8,10 @@
 #include <atomic>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <fstream>
 #include <cstring>
+#include <string>
 #include <unistd.h>
 #include <getopt.h>
 
@@ -16,6 +19,8 @@
 #include "data_table.h"
 #include "index_all.h"
 #include "key_generator_all.h"
+#include "perf_profiler.h"
+#include "latency_histogram.h"
 // #include "papi_profiler.h"
 
 
@@ -29,25 +34,78 @@ void usage(FILE *out) {
           "                              --  (1) static  - binary index \n"
           "                              --  (2) static  - kary index \n"
           "                              --  (3) static  - fast index \n"
+          "                              --  (4) static  - eytzinger index \n"
+          "                              --  (5) static  - van emde boas index \n"
+          "                              --  (6) static  - pgm index \n"
+          "                              --  (7) static  - compressed index \n"
           "                              -- (10) dynamic - singlethread - stx-btree index \n"
           "                              -- (11) dynamic - singlethread - art-tree index \n"
-          "                              -- (12) dynamic - singlethread - skiplist index (unsupported) \n"
-          "                              -- (13) dynamic - singlethread - btree index (unsupported) \n"
+          "                              -- (12) dynamic - singlethread - skiplist index \n"
+          "                              -- (13) dynamic - singlethread - csb+-tree index \n"
           "                              -- (20) dynamic - multithread  - libcuckoo index \n"
           "                              -- (21) dynamic - multithread  - art-tree index \n"
           "                              -- (22) dynamic - multithread  - bw-tree index \n"
           "                              -- (23) dynamic - multithread  - masstree index \n"
+          "                              -- (24) dynamic - multithread  - skiplist index \n"
+          "                              -- (25) dynamic - multithread  - olc b+-tree index \n"
           "   -k --key_size          :  index key size (default: 8 bytes) \n"
           "   -S --index_param_1     :  1st index parameter \n"
           "   -T --index_param_2     :  2nd index parameter \n"
+          "   -L --layout            :  static index layout: \n"
+          "                              -- (0) array of structs (default) \n"
+          "                              -- (1) struct of arrays \n"
+          "   -E --leaf_scan         :  static index leaf search switches to a linear scan \n"
+          "                             within this many cachelines (default: 0, disabled) \n"
+          "   -N --node_search       :  k-ary index node search, and compressed index block unpacking: \n"
+          "                              -- (0) simd (default) \n"
+          "                              -- (1) scalar \n"
+          "   -W --write_image       :  write the built static index to an image at this path \n"
+          "   -I --image             :  load the static index from an image at this path instead of building it \n"
+          "   -M --image_map         :  image mapping: \n"
+          "                              -- (0) fault pages in on access (default) \n"
+          "                              -- (1) populate \n"
+          "                              -- (2) populate, with transparent huge pages \n"
+          "   -H --huge_pages        :  huge pages for the table and the static index arrays: \n"
+          "                              -- (0) none (default) \n"
+          "                              -- (1) transparent huge pages \n"
+          "                              -- (2) reserved huge pages, falling back to transparent huge pages \n"
+          "   -X --hybrid            :  wrap the static index in a hybrid index that takes inserts into a write buffer, \n"
+          "                             and merges it into the static index in the background at this many entries \n"
+          "   -Y --rebuild           :  serve the static index through a handle that rebuilds it from a table snapshot \n"
+          "                             in the background, once every this many profile rounds \n"
+          "   -G --shards            :  spread the keys of a dynamic index over this many instances, each behind its own lock \n"
+          "   -J --sharding          :  how keys are spread over shards: \n"
+          "                              -- (0) by key hash (default) \n"
+          "                              -- (1) by key range, split evenly over the initial keys \n"
           // configuration
           "   -t --time_duration     :  time duration (default: 10) \n"
           "   -y --read_type         :  read type: \n"
           "                              -- (0) index lookup (default) \n"
           "                              -- (1) index scan \n"
           "                              -- (2) index reverse scan \n"
+          "                              -- (3) batched index lookup \n"
+          "                              -- (4) index range lookup \n"
+          "   -b --batch_size        :  number of keys per batched lookup (default: 16) \n"
+          "   -R --selectivity       :  fraction of the key range covered by a range lookup (default: 0.001) \n"
+          "   -D --dispatch          :  index call dispatch: \n"
+          "                              -- (0) virtual (default) \n"
+          "                              -- (1) devirtualized \n"
+          "                              -- (2) both, one after the other \n"
           "   -r --read_ratio        :  read ratio (default: 1.0) \n"
           "   -s --thread_count      :  thread count (default: 1) \n"
+          "   -B --build_thread_count:  thread count for building static indexes (default: 1) \n"
+          "   -l --latency           :  report operation latencies \n"
+          "   -C --pin               :  pin worker threads to cores: \n"
+          "                              -- (0) no pinning (default) \n"
+          "                              -- (1) compact, filling one numa node after another \n"
+          "                              -- (2) scatter, taking cores from each numa node in turn \n"
+          "   -K --cores             :  pin worker threads to the cores in this list, such as 0-7,16-23 \n"
+          "   -O --table_blocks      :  data table blocks that inserts fill: \n"
+          "                              -- (0) a single block shared by all threads (default) \n"
+          "                              -- (1) a block per numa node, allocated on that node \n"
+          "                              -- (2) a block per core, allocated on the numa node of the core \n"
+          "   -F --table_sweep       :  only measure data table insert throughput with each table block placement, \n"
+          "                             at 1, 2, 4, ... threads up to the thread count \n"
           "   -m --key_count         :  key count (default: 1ull<<20) \n"
           // numeric data distribution
           "   -d --distribution      :  numerical data distribution: \n"
@@ -55,6 +113,7 @@ void usage(FILE *out) {
           "                              -- (1) uniform distribution \n"
           "                              -- (2) normal distribution \n"
           "                              -- (3) log-normal distribution \n"
+          "   -U --duplicates        :  number of tuples inserted with each generated key (default: 1) \n"
           "   -P --key_bound         :  key upper bound \n"
           "   -Q --key_stddev        :  key standard deviation \n"
           // workload configuration
@@ -71,14 +130,35 @@ static struct option opts[] = {
     { "key_size",          optional_argument, NULL, 'k' },
     { "index_param_1",     optional_argument, NULL, 'S' },
     { "index_param_2",     optional_argument, NULL, 'T' },
+    { "layout",            optional_argument, NULL, 'L' },
+    { "leaf_scan",         optional_argument, NULL, 'E' },
+    { "node_search",       optional_argument, NULL, 'N' },
+    { "write_image",       optional_argument, NULL, 'W' },
+    { "image",             optional_argument, NULL, 'I' },
+    { "image_map",         optional_argument, NULL, 'M' },
+    { "huge_pages",        optional_argument, NULL, 'H' },
+    { "hybrid",            optional_argument, NULL, 'X' },
+    { "rebuild",           optional_argument, NULL, 'Y' },
+    { "shards",            optional_argument, NULL, 'G' },
+    { "sharding",          optional_argument, NULL, 'J' },
     // configuration
     { "time_duration",     optional_argument, NULL, 't' },
     { "read_type",         optional_argument, NULL, 'y' },
+    { "batch_size",        optional_argument, NULL, 'b' },
+    { "selectivity",       optional_argument, NULL, 'R' },
+    { "dispatch",          optional_argument, NULL, 'D' },
     { "read_ratio",        optional_argument, NULL, 'r' },
     { "thread_count",      optional_argument, NULL, 's' },
+    { "build_thread_count", optional_argument, NULL, 'B' },
+    { "latency",           optional_argument, NULL, 'l' },
+    { "pin",               optional_argument, NULL, 'C' },
+    { "cores",             optional_argument, NULL, 'K' },
+    { "table_blocks",      optional_argument, NULL, 'O' },
+    { "table_sweep",       optional_argument, NULL, 'F' },
     // data distribution
     { "key_count",         optional_argument, NULL, 'm' },
     { "distribution",      optional_argument, NULL, 'd' },
+    { "duplicates",        optional_argument, NULL, 'U' },
     { "key_bound",         optional_argument, NULL, 'P' },
     { "key_stddev",        optional_argument, NULL, 'Q' },
     { "record",            optional_argument, NULL, 'c' },
@@ -86,10 +166,18 @@ static struct option opts[] = {
     { NULL, 0, NULL, 0 }
 };
 
+enum class DispatchType {
+  VirtualType = 0,
+  DevirtualizedType,
+  BothType,
+};
+
 enum class ReadType {
   IndexLookupType = 0,
   IndexScanType,
   IndexScanReverseType,
+  IndexBatchLookupType,
+  IndexRangeLookupType,
 };
 
 struct Config {
@@ -98,15 +186,37 @@ struct Config {
   int key_size_ = 8; // unit: bytes
   int index_param_1_ = INVALID_INDEX_PARAM;
   int index_param_2_ = INVALID_INDEX_PARAM;
+  LayoutType layout_ = LayoutType::AoSLayout;
+  int leaf_scan_cachelines_ = 0;
+  bool scalar_node_search_ = false;
+  std::string write_image_path_;
+  std::string image_path_;
+  int image_map_ = 0;
+  HugePageMode huge_page_mode_ = HugePageNone;
+  uint64_t merge_threshold_ = 0; // 0: no hybrid index
+  uint64_t rebuild_period_ = 0; // unit: profile rounds. 0: no background rebuilds
+  uint64_t shard_count_ = 0; // 0: no sharded index
+  ShardingType sharding_type_ = ShardingType::HashSharding;
   // configuration
   const double profile_duration_ = 0.5; // fixed
   int time_duration_ = 10;
   ReadType index_read_type_ = ReadType::IndexLookupType;
+  DispatchType dispatch_type_ = DispatchType::VirtualType;
+  int batch_size_ = 16;
+  double selectivity_ = 0.001;
   double read_ratio_ = 1.0;
   int thread_count_ = 1;
+  int build_thread_count_ = 1;
+  bool latency_ = false;
+  CorePlacement core_placement_ = CorePlacementNone;
+  std::string core_list_;
+  std::vector<size_t> thread_cores_; // core of each worker thread. empty: no pinning
+  BlockPlacement block_placement_ = BlockPlacement::SharedBlock;
+  bool table_sweep_ = false;
   // data distribution
   uint64_t key_count_ = 1ull << 20;
   DistributionType distribution_type_ = DistributionType::SequenceType;
+  uint64_t duplicate_count_ = 1;
   uint64_t key_bound_ = DEFAULT_KEY_BOUND;
   double key_stddev_ = INVALID_KEY_STDDEV;
   bool record_ = false;
@@ -117,11 +227,50 @@ struct Config {
     std::cout << "=====     INDEX STRUCTURE    =====" << std::endl;
     std::cout << "key size: " << key_size_ << std::endl;
     std::cout << "index param " << index_param_1_ << ", " << index_param_2_ << std::endl;
+    std::cout << "layout: " << int(layout_) << std::endl;
+    std::cout << "leaf scan cachelines: " << leaf_scan_cachelines_ << std::endl;
+    if (index_type_ == IndexType::S_KAry || index_type_ == IndexType::S_Compressed) {
+      std::cout << "node search: " << (scalar_node_search_ ? "scalar" : "simd") << std::endl;
+    }
+    if (!image_path_.empty()) {
+      std::cout << "image: " << image_path_ << ", map: " << image_map_ << std::endl;
+    }
+    std::cout << "huge pages: " << int(huge_page_mode_) << std::endl;
+    if (merge_threshold_ != 0) {
+      std::cout << "hybrid merge threshold: " << merge_threshold_ << std::endl;
+    }
+    if (rebuild_period_ != 0) {
+      std::cout << "rebuild period: " << rebuild_period_ << " rounds" << std::endl;
+    }
+    if (shard_count_ != 0) {
+      std::cout << "shards: " << shard_count_ << ", sharding: " << (sharding_type_ == ShardingType::HashSharding ? "hash" : "range") << std::endl;
+    }
     std::cout << "===== WORKLOAD CONFIGURATION =====" << std::endl;
+    std::cout << "read type: " << int(index_read_type_) << std::endl;
+    if (index_read_type_ == ReadType::IndexBatchLookupType) {
+      std::cout << "batch size: " << batch_size_ << std::endl;
+    }
+    if (index_read_type_ == ReadType::IndexRangeLookupType) {
+      std::cout << "selectivity: " << selectivity_ << std::endl;
+    }
+    std::cout << "dispatch type: " << int(dispatch_type_) << std::endl;
     std::cout << "read ratio: " << read_ratio_ << std::endl;
     std::cout << "thread count: " << thread_count_ << std::endl;
+    std::cout << "build thread count: " << build_thread_count_ << std::endl;
+    std::cout << "latency: " << (latency_ ? "on" : "off") << std::endl;
+    std::cout << "numa nodes: " << numa_topology().node_count() << std::endl;
+    std::cout << "thread cores:";
+    if (thread_cores_.empty()) {
+      std::cout << " not pinned";
+    }
+    for (auto core : thread_cores_) {
+      std::cout << " " << core;
+    }
+    std::cout << std::endl;
+    std::cout << "table blocks: " << get_block_placement_name(block_placement_) << std::endl;
     std::cout << "=====    DATA DISTRIBUTION   =====" << std::endl;
     std::cout << "key count: " << key_count_ << std::endl;
+    std::cout << "duplicates: " << duplicate_count_ << std::endl;
     std::cout << "key bound: " << key_bound_ << std::endl;
     std::cout << "key stddev: " << key_stddev_ << std::endl;
     std::cout << ">>>>>>>>>>>>>>>>>>>>>>" << std::endl;
@@ -134,7 +283,7 @@ void parse_args(int argc, char* argv[], Config &config) {
   
   while (1) {
     int idx = 0;
-    int c = getopt_long(argc, argv, "hcvi:k:S:T:t:y:r:s:m:d:P:Q:", opts, &idx);
+    int c = getopt_long(argc, argv, "hcvlFi:k:S:T:L:E:N:W:I:M:H:X:Y:G:J:t:y:b:R:D:r:s:B:C:K:O:m:d:U:P:Q:", opts, &idx);
 
     if (c == -1) break;
 
@@ -155,6 +304,50 @@ void parse_args(int argc, char* argv[], Config &config) {
         config.index_param_2_ = atoi(optarg);
         break;
       }
+      case 'L': {
+        config.layout_ = (LayoutType)atoi(optarg);
+        break;
+      }
+      case 'E': {
+        config.leaf_scan_cachelines_ = atoi(optarg);
+        break;
+      }
+      case 'N': {
+        config.scalar_node_search_ = (atoi(optarg) == 1);
+        break;
+      }
+      case 'W': {
+        config.write_image_path_ = optarg;
+        break;
+      }
+      case 'I': {
+        config.image_path_ = optarg;
+        break;
+      }
+      case 'M': {
+        config.image_map_ = atoi(optarg);
+        break;
+      }
+      case 'H': {
+        config.huge_page_mode_ = (HugePageMode)atoi(optarg);
+        break;
+      }
+      case 'X': {
+        config.merge_threshold_ = (uint64_t)strtoull(optarg, nullptr, 10);
+        break;
+      }
+      case 'Y': {
+        config.rebuild_period_ = (uint64_t)strtoull(optarg, nullptr, 10);
+        break;
+      }
+      case 'G': {
+        config.shard_count_ = (uint64_t)strtoull(optarg, nullptr, 10);
+        break;
+      }
+      case 'J': {
+        config.sharding_type_ = (ShardingType)atoi(optarg);
+        break;
+      }
       case 't': {
         config.time_duration_ = atoi(optarg);
         break;
@@ -163,6 +356,18 @@ void parse_args(int argc, char* argv[], Config &config) {
         config.index_read_type_ = (ReadType)atoi(optarg);
         break;
       }
+      case 'b': {
+        config.batch_size_ = atoi(optarg);
+        break;
+      }
+      case 'R': {
+        config.selectivity_ = (double)atof(optarg);
+        break;
+      }
+      case 'D': {
+        config.dispatch_type_ = (DispatchType)atoi(optarg);
+        break;
+      }
       case 'r': {
         config.read_ratio_ = (double)atof(optarg);
         break;
@@ -171,6 +376,30 @@ void parse_args(int argc, char* argv[], Config &config) {
         config.thread_count_ = atoi(optarg);
         break;
       }
+      case 'B': {
+        config.build_thread_count_ = atoi(optarg);
+        break;
+      }
+      case 'l': {
+        config.latency_ = true;
+        break;
+      }
+      case 'C': {
+        config.core_placement_ = (CorePlacement)atoi(optarg);
+        break;
+      }
+      case 'K': {
+        config.core_list_ = optarg;
+        break;
+      }
+      case 'O': {
+        config.block_placement_ = (BlockPlacement)atoi(optarg);
+        break;
+      }
+      case 'F': {
+        config.table_sweep_ = true;
+        break;
+      }
       case 'm': {
         config.key_count_ = (uint64_t)strtoull(optarg, nullptr, 10); // uint64_t
         break;
@@ -179,6 +408,10 @@ void parse_args(int argc, char* argv[], Config &config) {
         config.distribution_type_ = (DistributionType)atoi(optarg);
         break;
       }
+      case 'U': {
+        config.duplicate_count_ = std::max((uint64_t)strtoull(optarg, nullptr, 10), uint64_t(1));
+        break;
+      }
       case 'P': {
         config.key_bound_ = (uint64_t)strtoull(optarg, nullptr, 10); // uint64_t
         break;
@@ -209,7 +442,82 @@ void parse_args(int argc, char* argv[], Config &config) {
     }
   }
 
-  validate_index_params(config.index_type_, config.index_param_1_, config.index_param_2_);
+  // a table sweep builds no index
+  if (!config.table_sweep_) {
+    validate_index_params(config.index_type_, config.index_param_1_, config.index_param_2_, config.key_size_);
+  }
+
+  if (config.batch_size_ <= 0) {
+    std::cerr << "error: batch size must be positive!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (config.selectivity_ < 0 || config.selectivity_ > 1) {
+    std::cerr << "error: selectivity must be between 0 and 1!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (config.build_thread_count_ <= 0) {
+    std::cerr << "error: build thread count must be positive!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (config.merge_threshold_ != 0 && !is_static_index(config.index_type_)) {
+    std::cerr << "error: hybrid indexes wrap static indexes only!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (config.rebuild_period_ != 0 && !is_static_index(config.index_type_)) {
+    std::cerr << "error: only static indexes are rebuilt!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (config.rebuild_period_ != 0 && config.merge_threshold_ != 0) {
+    std::cerr << "error: a hybrid index cannot be rebuilt periodically!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (config.shard_count_ != 0 && is_static_index(config.index_type_)) {
+    std::cerr << "error: only dynamic indexes are sharded!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (config.sharding_type_ != ShardingType::HashSharding && config.sharding_type_ != ShardingType::RangeSharding) {
+    std::cerr << "error: unknown sharding type!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (config.core_placement_ < CorePlacementNone || config.core_placement_ > CorePlacementScatter) {
+    std::cerr << "error: unknown core placement!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (config.block_placement_ < BlockPlacement::SharedBlock || config.block_placement_ > BlockPlacement::CoreLocalBlock) {
+    std::cerr << "error: unknown table block placement!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // a core list takes precedence over a placement. with more threads than cores, cores are used again.
+  if (!config.core_list_.empty()) {
+    std::vector<size_t> cores = parse_core_list(config.core_list_);
+    if (cores.empty()) {
+      std::cerr << "error: empty core list!" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    for (int thread_id = 0; thread_id < config.thread_count_; ++thread_id) {
+      config.thread_cores_.push_back(cores[thread_id % cores.size()]);
+    }
+  } else {
+    config.thread_cores_ = assign_cores(config.thread_count_, config.core_placement_);
+  }
+
+  // with per-node or per-core blocks, tuple offsets follow the cores that populate runs on,
+  // so an image only matches the table of another run if populate is pinned.
+  if ((!config.image_path_.empty() || !config.write_image_path_.empty()) &&
+      config.block_placement_ != BlockPlacement::SharedBlock && config.thread_cores_.empty()) {
+    std::cerr << "error: images with " << get_block_placement_name(config.block_placement_) << " table blocks need pinned threads (-C or -K)!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
 
   validate_key_generator_params(config.distribution_type_, config.key_bound_, config.key_stddev_);
 
@@ -222,10 +530,28 @@ void parse_args(int argc, char* argv[], Config &config) {
 bool is_running = false;
 uint64_t *operation_counts = nullptr;
 
-template<typename KeyT, typename ValueT>
-void run_thread(const size_t &thread_id, const Config &config, const KeyT *read_keys, DataTable<KeyT, ValueT> *data_table, BaseIndex<KeyT, ValueT> *data_index) {
+// profile round that the workload is in. 
+std::atomic<uint64_t> current_round(0);
+
+// latencies of each thread in each profile round, if measured. unit: ns
+LatencyHistogram **latency_histograms = nullptr;
+
+// width of the key range covered by a range lookup. set from the loaded keys and the selectivity.
+uint64_t range_key_width = 0;
 
-  pin_to_core(thread_id);
+// range lookups consume their values without storing them.
+static void checksum_visitor(void *context, const Uint64 value) {
+  *reinterpret_cast<Uint64*>(context) += value;
+}
+
+// IndexT is either BaseIndex<KeyT, ValueT>, which goes through virtual calls, 
+// or a concrete index type, whose calls are resolved at compile time.
+template<typename KeyT, typename ValueT, typename IndexT>
+void run_thread(const size_t &thread_id, const Config &config, const KeyT *read_keys, DataTable<KeyT, ValueT> *data_table, IndexT *data_index) {
+
+  if (!config.thread_cores_.empty() && !pin_to_core(config.thread_cores_[thread_id])) {
+    std::cerr << "warning: cannot pin thread " << thread_id << " to core " << config.thread_cores_[thread_id] << std::endl;
+  }
 
   data_index->register_thread(thread_id);
 
@@ -236,17 +562,69 @@ void run_thread(const size_t &thread_id, const Config &config, const KeyT *read_
 
   FastRandom rand_gen(thread_id);
 
+  std::unique_ptr<KeyT[]> batch_keys(new KeyT[config.batch_size_]);
+  std::vector<ResultSink> batch_values(config.batch_size_);
+
+  LatencyHistogram *histograms = config.latency_ ? latency_histograms[thread_id] : nullptr;
+  auto last_time = std::chrono::steady_clock::now();
+  uint64_t last_round = 0;
+
   while (true) {
     if (is_running == false) {
       break;
     }
 
+    // the latency of an operation is the time from its start to the start of the next one.
+    if (histograms != nullptr) {
+      auto now = std::chrono::steady_clock::now();
+      if (operation_count != 0) {
+        histograms[last_round].record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_time).count());
+      }
+      last_time = now;
+      last_round = current_round.load(std::memory_order_relaxed);
+    }
+
     double next_rand = rand_gen.next_uniform();
 
+    if (next_rand < config.read_ratio_ && config.index_read_type_ == ReadType::IndexBatchLookupType) {
+      
+      for (size_t i = 0; i < config.batch_size_; ++i) {
+        batch_keys[i] = read_keys[(operation_count + i) % config.generated_read_key_count_];
+      }
+
+      for (auto &values : batch_values) {
+        values.clear();
+      }
+
+      // retrieve tuple locations of all keys in the batch
+      data_index->find_batch(batch_keys.get(), config.batch_size_, batch_values.data());
+
+      operation_count += config.batch_size_;
+      continue;
+    }
+
+    if (next_rand < config.read_ratio_ && config.index_read_type_ == ReadType::IndexRangeLookupType) {
+
+      KeyT lhs_key = read_keys[operation_count % config.generated_read_key_count_];
+      KeyT rhs_key = std::numeric_limits<KeyT>::max();
+      if (rhs_key - lhs_key > range_key_width) {
+        rhs_key = lhs_key + range_key_width;
+      }
+
+      Uint64 checksum = 0;
+      ResultSink values(checksum_visitor, &checksum);
+
+      // retrieve tuple locations of all keys in the range
+      data_index->find_range(lhs_key, rhs_key, values);
+
+      ++operation_count;
+      continue;
+    }
+
     if (next_rand < config.read_ratio_) {
       KeyT key = read_keys[operation_count % config.generated_read_key_count_];
 
-      std::vector<Uint64> values;
+      ResultSink values;
 
       // retrieve tuple locations
       data_index->find(key, values);
@@ -268,82 +646,57 @@ void run_thread(const size_t &thread_id, const Config &config, const KeyT *read_
   }
 }
 
+// launches worker threads that drive the index through its concrete type.
 template<typename KeyT, typename ValueT>
-void run_workload(const Config &config) {
-
-  // create table
-  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(nullptr);
-  data_table.reset(new DataTable<KeyT, ValueT>());
-
-  // create index
-  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(nullptr);
-  data_index.reset(create_numeric_index<KeyT, ValueT>(config.index_type_, data_table.get(), config.index_param_1_, config.index_param_2_));
-
-  // prepare threads
-  data_index->prepare_threads(config.thread_count_);
-  data_index->register_thread(0);
-
-  //=================================
-  // populate table
-  //=================================
-  std::unique_ptr<BaseKeyGenerator<KeyT>> key_generator(construct_key_generator<KeyT>(config.distribution_type_, 0, config.key_bound_, config.key_stddev_));
-
-  KeyT *init_keys = new KeyT[config.key_count_]; // store all init keys
-
-  for (size_t i = 0; i < config.key_count_; ++i) {
-
-    KeyT key = key_generator->get_next_key();
-    ValueT value = 100;
-    
-    OffsetT offset = data_table->insert_tuple(key, value);
-
-    data_index->insert(key, offset.raw_data());
-
-    // record init input keys
-    init_keys[i] = key;
-  }
-  data_index->reorganize();
-  //=================================
-
-  //=================================
-  // write all init keys to output file
-  //=================================
-  if (config.record_ == true) {
-
-    std::ofstream record_file;
-    record_file.open("data.txt");
-    
-    for (size_t i = 0; i < config.key_count_; ++i) {
-      record_file << init_keys[i] << std::endl;
+struct DevirtualizedLauncher {
+  DevirtualizedLauncher(const Config &config, KeyT **read_keys, DataTable<KeyT, ValueT> *data_table, std::vector<std::thread> &worker_threads) :
+    config_(config), read_keys_(read_keys), data_table_(data_table), worker_threads_(worker_threads) {}
+
+  template<typename IndexT>
+  void operator()(IndexT *data_index) {
+    for (uint64_t thread_id = 0; thread_id < config_.thread_count_; ++thread_id) {
+      worker_threads_.push_back(std::move(std::thread(run_thread<KeyT, ValueT, IndexT>, thread_id, std::ref(config_), read_keys_[thread_id], data_table_, data_index)));
     }
-    record_file.close();
-
-    // return;
   }
-  //=================================
 
-  //=================================
-  // prepare query keys
-  //=================================
-  KeyT** read_keys = new KeyT*[config.thread_count_];
-  
-  // generate keys for each thread
-  for (size_t i = 0; i < config.thread_count_; ++i) {
+  const Config &config_;
+  KeyT **read_keys_;
+  DataTable<KeyT, ValueT> *data_table_;
+  std::vector<std::thread> &worker_threads_;
+};
 
-    read_keys[i] = new KeyT[config.generated_read_key_count_];
+static void print_latency(const std::string &label, const LatencyHistogram &histogram) {
+  std::cout << std::fixed << std::setprecision(2)
+            << label << " latency (us): "
+            << "p50 " << histogram.percentile(0.5) / 1000.0
+            << ", p99 " << histogram.percentile(0.99) / 1000.0
+            << ", p99.9 " << histogram.percentile(0.999) / 1000.0
+            << ", p99.99 " << histogram.percentile(0.9999) / 1000.0
+            << ", max " << histogram.max() / 1000.0
+            << std::endl;
+}
 
-    FastRandom rand_gen(i);
-    
-    for (size_t j = 0; j < config.generated_read_key_count_; ++j) {
-      read_keys[i][j] = init_keys[rand_gen.next<uint64_t>() % config.key_count_];
-    }
+// resident memory of the whole process on each numa node, including the query keys.
+static void print_numa_memory(const std::string &label) {
+  std::vector<double> node_memory = get_numa_node_memory_mb();
+  if (node_memory.empty()) {
+    return;
   }
+  std::cout << std::fixed << std::setprecision(2) << label << " memory per numa node (MB):";
+  for (size_t node = 0; node < node_memory.size(); ++node) {
+    std::cout << " [" << node << "] " << node_memory[node];
+  }
+  std::cout << std::endl;
+}
 
-  double query_key_size_mb = (config.key_count_ + config.generated_read_key_count_) * sizeof(KeyT) / 1024 / 1024;
+// run the workload for the configured duration, and return the average throughput (M ops).
+template<typename KeyT, typename ValueT>
+double run_phase(const Config &config, KeyT **read_keys, DataTable<KeyT, ValueT> *data_table, BaseIndex<KeyT, ValueT> *data_index, const bool devirtualized, const double query_key_size_mb) {
 
-  //=================================
+  std::cout << "dispatch: " << (devirtualized ? "devirtualized" : "virtual") << std::endl;
 
   operation_counts = new uint64_t[config.thread_count_];
+  memset(operation_counts, 0, config.thread_count_ * sizeof(uint64_t));
   uint64_t profile_round = (uint64_t)(config.time_duration_ / config.profile_duration_);
 
   uint64_t **operation_counts_profiles = new uint64_t*[profile_round];
@@ -356,24 +709,65 @@ void run_workload(const Config &config) {
 
   std::vector<uint64_t> total_operation_counts; // number of total operations performed.
 
-  double init_mem_size = get_memory_mb();
-  std::cout << "init memory size (index + table): " << (init_mem_size - query_key_size_mb) << " MB" << std::endl;
-  
+  // rounds in which a hybrid index was merging, or a static index handle was rebuilding
+  auto hybrid_index = dynamic_cast<HybridIndex<KeyT, ValueT>*>(data_index);
+  auto index_handle = dynamic_cast<StaticIndexHandle<KeyT, ValueT>*>(data_index);
+  auto sharded_index = dynamic_cast<ShardedIndex<KeyT, ValueT>*>(data_index);
+  bool has_background_work = (hybrid_index != nullptr || index_handle != nullptr);
+  std::string work_name = (hybrid_index != nullptr) ? "merges" : "rebuilds";
+  std::string busy_name = (hybrid_index != nullptr) ? "merging" : "rebuilding";
+  auto background_count = [&]() -> size_t {
+    return (hybrid_index != nullptr) ? hybrid_index->merge_count() : index_handle->version_count();
+  };
+  auto is_background_busy = [&]() -> bool {
+    return (hybrid_index != nullptr) ? hybrid_index->is_merging() : index_handle->is_rebuilding();
+  };
+  std::vector<bool> busy_rounds;
+  size_t last_count = has_background_work ? background_count() : 0;
+  bool was_busy = has_background_work && is_background_busy();
+
+  // one more round for operations that start after the last one
+  current_round = 0;
+  if (config.latency_) {
+    latency_histograms = new LatencyHistogram*[config.thread_count_];
+    for (uint64_t thread_id = 0; thread_id < config.thread_count_; ++thread_id) {
+      latency_histograms[thread_id] = new LatencyHistogram[profile_round + 1];
+    }
+  }
+
   // launch a group of threads
   is_running = true;
   std::vector<std::thread> worker_threads;
   
   // PAPIProfiler::init_papi();
   // PAPIProfiler::start_measure_cache_miss_rate();
+
+  PerfProfiler perf_profiler;
+  perf_profiler.start();
   
-  for (uint64_t thread_id = 0; thread_id < config.thread_count_; ++thread_id) {
-    worker_threads.push_back(std::move(std::thread(run_thread<KeyT, ValueT>, thread_id, std::ref(config), read_keys[thread_id], data_table.get(), data_index.get())));
+  if (devirtualized == true) {
+    DevirtualizedLauncher<KeyT, ValueT> launcher(config, read_keys, data_table, worker_threads);
+    if (hybrid_index != nullptr) {
+      launcher(hybrid_index);
+    } else if (index_handle != nullptr) {
+      launcher(index_handle);
+    } else if (sharded_index != nullptr) {
+      launcher(sharded_index);
+    } else {
+      dispatch_numeric_index<KeyT, ValueT>(config.index_type_, data_index, launcher);
+    }
+  } else {
+    for (uint64_t thread_id = 0; thread_id < config.thread_count_; ++thread_id) {
+      worker_threads.push_back(std::move(std::thread(run_thread<KeyT, ValueT, BaseIndex<KeyT, ValueT>>, thread_id, std::ref(config), read_keys[thread_id], data_table, data_index)));
+    }
   }
 
   std::cout << "        TIME       THROUGHPUT   RAM (tot.)   RAM (tab.)" << std::endl;
 
   for (uint64_t round_id = 0; round_id < profile_round; ++round_id) {
     std::this_thread::sleep_for(std::chrono::milliseconds(int(config.profile_duration_ * 1000)));
+
+    current_round.fetch_add(1);
     
     memcpy(operation_counts_profiles[round_id], operation_counts, sizeof(uint64_t) * config.thread_count_);
 
@@ -421,8 +815,22 @@ void run_workload(const Config &config) {
               << " MB  |  "
               << std::setw(5)
               << table_size_profiles.at(round_id)
-              << " MB"
-              << std::endl;
+              << " MB";
+
+    if (has_background_work) {
+      size_t count = background_count();
+      bool is_busy = is_background_busy();
+      busy_rounds.push_back(was_busy || is_busy || count != last_count);
+      std::cout << "  |  " << count - last_count << " " << work_name << (is_busy ? ", " + busy_name : "");
+      last_count = count;
+      was_busy = is_busy;
+    }
+    std::cout << std::endl;
+
+    // the next round shows the rebuild
+    if (index_handle != nullptr && (round_id + 1) % config.rebuild_period_ == 0) {
+      was_busy = index_handle->rebuild() || was_busy;
+    }
   }
   
   // join all the threads
@@ -433,17 +841,90 @@ void run_workload(const Config &config) {
   }
 
   // PAPIProfiler::stop_measure_cache_miss_rate();
+
+  perf_profiler.stop();
   
   uint64_t total_count = 0;
   for (uint64_t i = 0; i < config.thread_count_; ++i) {
     total_count += operation_counts[i];
   }
 
-  std::cout << "average throughput: " << total_count * 1.0 / config.time_duration_ / 1000 / 1000 << " M ops" 
+  double throughput = total_count * 1.0 / config.time_duration_ / 1000 / 1000;
+
+  std::cout << "average throughput: " << throughput << " M ops" 
             << std::endl;
 
-  if (config.verbose_ == true) {
-    data_index->print(); 
+  print_numa_memory("final");
+
+  if (perf_profiler.is_available() && total_count != 0) {
+    std::cout << "llc misses per op: " << perf_profiler.llc_misses() * 1.0 / total_count << std::endl;
+    std::cout << "l1d misses per op: " << perf_profiler.l1d_misses() * 1.0 / total_count << std::endl;
+    std::cout << "dtlb misses per op: " << perf_profiler.dtlb_misses() * 1.0 / total_count << std::endl;
+  }
+
+  if (hybrid_index != nullptr) {
+    std::cout << "merges: " << hybrid_index->merge_count() << ", merge time: " << hybrid_index->merge_time_ms() << " ms" << std::endl;
+  }
+  if (index_handle != nullptr) {
+    index_handle->wait_rebuild();
+    std::cout << "versions: " << index_handle->version_count() << ", rebuild time: " << index_handle->rebuild_time_ms() << " ms" << std::endl;
+  }
+
+  if (has_background_work) {
+    // throughput of the rounds with and without background work
+    uint64_t operation_counts_by_busy[2] = { 0, 0 };
+    uint64_t round_counts_by_busy[2] = { 0, 0 };
+    for (uint64_t round_id = 0; round_id < profile_round; ++round_id) {
+      operation_counts_by_busy[busy_rounds[round_id]] += total_operation_counts[round_id];
+      round_counts_by_busy[busy_rounds[round_id]] += 1;
+    }
+    for (size_t busy = 0; busy < 2; ++busy) {
+      if (round_counts_by_busy[busy] == 0) { continue; }
+      std::cout << (busy ? "during " : "between ") << work_name << " throughput: "
+                << operation_counts_by_busy[busy] * 1.0 / (round_counts_by_busy[busy] * config.profile_duration_) / 1000 / 1000
+                << " M ops" << std::endl;
+    }
+  }
+
+  if (config.latency_) {
+    LatencyHistogram total_histogram;
+    LatencyHistogram busy_histograms[2];
+
+    std::cout << "        TIME         P50        P99      P99.9        MAX   (us)" << std::endl;
+
+    for (uint64_t round_id = 0; round_id < profile_round; ++round_id) {
+      LatencyHistogram round_histogram;
+      for (uint64_t thread_id = 0; thread_id < config.thread_count_; ++thread_id) {
+        round_histogram.add(latency_histograms[thread_id][round_id]);
+      }
+      total_histogram.add(round_histogram);
+      if (has_background_work) {
+        busy_histograms[busy_rounds[round_id]].add(round_histogram);
+      }
+
+      std::cout << std::fixed << std::setprecision(2) << std::right
+                << "[" << std::setw(5) << config.profile_duration_ * round_id << " - " 
+                << std::setw(5) << config.profile_duration_ * (round_id + 1) << " s]:  "
+                << std::setw(9) << round_histogram.percentile(0.5) / 1000.0 << "  "
+                << std::setw(9) << round_histogram.percentile(0.99) / 1000.0 << "  "
+                << std::setw(9) << round_histogram.percentile(0.999) / 1000.0 << "  "
+                << std::setw(9) << round_histogram.max() / 1000.0
+                << std::endl;
+    }
+
+    print_latency("total", total_histogram);
+    if (has_background_work) {
+      for (size_t busy = 0; busy < 2; ++busy) {
+        if (busy_histograms[busy].count() == 0) { continue; }
+        print_latency((busy ? "during " : "between ") + work_name, busy_histograms[busy]);
+      }
+    }
+
+    for (uint64_t thread_id = 0; thread_id < config.thread_count_; ++thread_id) {
+      delete[] latency_histograms[thread_id];
+    }
+    delete[] latency_histograms;
+    latency_histograms = nullptr;
   }
 
   for (uint64_t round_id = 0; round_id < profile_round; ++round_id) {
@@ -457,6 +938,302 @@ void run_workload(const Config &config) {
   delete[] operation_counts;
   operation_counts = nullptr;
 
+  return throughput;
+}
+
+// insert-only throughput of the data table alone, at 1, 2, 4, ... threads up to the thread count,
+// with each table block placement. every run inserts key count tuples in all.
+template<typename KeyT, typename ValueT>
+void run_table_sweep(const Config &config) {
+
+  set_huge_page_mode(config.huge_page_mode_);
+
+  std::vector<BlockPlacement> block_placements { 
+    BlockPlacement::SharedBlock, 
+    BlockPlacement::NumaLocalBlock, 
+    BlockPlacement::CoreLocalBlock 
+  };
+
+  std::vector<size_t> thread_counts;
+  for (size_t thread_count = 1; thread_count < size_t(config.thread_count_); thread_count *= 2) {
+    thread_counts.push_back(thread_count);
+  }
+  thread_counts.push_back(config.thread_count_);
+
+  std::cout << "table insert throughput (M ops)" << std::endl;
+  std::cout << "THREADS";
+  for (auto block_placement : block_placements) {
+    std::cout << std::setw(12) << get_block_placement_name(block_placement);
+  }
+  std::cout << std::endl;
+
+  for (auto thread_count : thread_counts) {
+    std::cout << std::setw(7) << thread_count;
+
+    for (auto block_placement : block_placements) {
+      std::unique_ptr<DataTable<KeyT, ValueT>> data_table(new DataTable<KeyT, ValueT>(MaxBlockCapacity, block_placement));
+
+      // threads start inserting together, once all of them are pinned.
+      std::atomic<size_t> ready_count(0);
+      std::atomic<bool> is_started(false);
+
+      std::vector<std::thread> threads;
+      for (size_t thread_id = 0; thread_id < thread_count; ++thread_id) {
+        threads.push_back(std::thread([&, thread_id]() {
+          if (!config.thread_cores_.empty()) {
+            pin_to_core(config.thread_cores_[thread_id]);
+          }
+          ready_count.fetch_add(1);
+          while (!is_started.load()) {
+            std::this_thread::yield();
+          }
+
+          ValueT value = 100;
+          for (size_t i = thread_id; i < config.key_count_; i += thread_count) {
+            data_table->insert_tuple(KeyT(i), value);
+          }
+        }));
+      }
+
+      while (ready_count.load() != thread_count) {
+        std::this_thread::yield();
+      }
+
+      TimeMeasurer timer;
+      timer.tic();
+      is_started = true;
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      timer.toc();
+
+      std::cout << std::fixed << std::setprecision(2) << std::setw(12) 
+                << config.key_count_ * 1.0 / std::max(timer.time_us(), 1ll);
+    }
+    std::cout << std::endl;
+  }
+}
+
+template<typename KeyT, typename ValueT>
+void run_workload(const Config &config) {
+
+  // the table allocates its first block right away.
+  set_huge_page_mode(config.huge_page_mode_);
+
+  // create table
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(nullptr);
+  data_table.reset(new DataTable<KeyT, ValueT>(MaxBlockCapacity, config.block_placement_));
+
+  // apply the static index options. a hybrid index or a handle applies them to each static index it builds.
+  auto configure = [&config](BaseStaticIndex<KeyT, ValueT> *index) {
+    if (config.leaf_scan_cachelines_ > 0) {
+      index->set_leaf_scan_cachelines(config.leaf_scan_cachelines_);
+    }
+
+    if (config.scalar_node_search_ && config.index_type_ == IndexType::S_KAry) {
+      static_cast<static_index::KAryIndex<KeyT, ValueT>*>(index)->set_simd_search(false);
+    }
+
+    if (config.scalar_node_search_ && config.index_type_ == IndexType::S_Compressed) {
+      static_cast<static_index::CompressedIndex<KeyT, ValueT>*>(index)->set_simd_unpack(false);
+    }
+  };
+
+  //=================================
+  // generate init keys
+  //=================================
+  std::unique_ptr<BaseKeyGenerator<KeyT>> key_generator(construct_key_generator<KeyT>(config.distribution_type_, 0, config.key_bound_, config.key_stddev_));
+
+  KeyT *init_keys = new KeyT[config.key_count_]; // store all init keys
+
+  KeyT key = 0;
+
+  for (size_t i = 0; i < config.key_count_; ++i) {
+
+    // each generated key is inserted duplicate_count_ times
+    if (i % config.duplicate_count_ == 0) {
+      key = key_generator->get_next_key();
+    }
+    init_keys[i] = key;
+  }
+
+  // create index
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(nullptr);
+  if (config.shard_count_ != 0) {
+    // range shards are split by the init keys, so keys inserted later may pile up in the outer shards.
+    std::vector<KeyT> split_keys;
+    if (config.sharding_type_ == ShardingType::RangeSharding) {
+      split_keys = choose_split_keys(init_keys, config.key_count_, config.shard_count_);
+    }
+    data_index.reset(create_sharded_index<KeyT, ValueT>(config.index_type_, data_table.get(), config.shard_count_, config.sharding_type_, split_keys));
+  } else if (config.merge_threshold_ != 0) {
+    data_index.reset(create_hybrid_index<KeyT, ValueT>(config.index_type_, data_table.get(), config.index_param_1_, config.index_param_2_, config.layout_, config.merge_threshold_, config.build_thread_count_, configure));
+  } else if (config.rebuild_period_ != 0) {
+    data_index.reset(create_static_index_handle<KeyT, ValueT>(config.index_type_, data_table.get(), config.index_param_1_, config.index_param_2_, config.layout_, config.build_thread_count_, configure));
+  } else {
+    data_index.reset(create_numeric_index<KeyT, ValueT>(config.index_type_, data_table.get(), config.index_param_1_, config.index_param_2_, config.layout_));
+
+    if (is_static_index(config.index_type_)) {
+      configure(static_cast<BaseStaticIndex<KeyT, ValueT>*>(data_index.get()));
+    }
+  }
+
+  // prepare threads
+  data_index->prepare_threads(config.thread_count_);
+  data_index->register_thread(0);
+
+  // populate from the core of worker 0, so that the table and the index start out on its node.
+  // the main thread is unpinned afterwards, so that build threads and background threads may run anywhere.
+  cpu_set_t main_affinity = get_thread_affinity();
+  if (!config.thread_cores_.empty() && !pin_to_core(config.thread_cores_[0])) {
+    std::cerr << "warning: cannot pin the main thread to core " << config.thread_cores_[0] << std::endl;
+  }
+
+  //=================================
+  // populate table
+  //=================================
+  for (size_t i = 0; i < config.key_count_; ++i) {
+
+    ValueT value = 100;
+    
+    OffsetT offset = data_table->insert_tuple(init_keys[i], value);
+
+    data_index->insert(init_keys[i], offset.raw_data());
+  }
+
+  if (!config.thread_cores_.empty()) {
+    set_thread_affinity(main_affinity);
+  }
+
+  if (config.index_read_type_ == ReadType::IndexRangeLookupType) {
+    KeyT key_min = *std::min_element(init_keys, init_keys + config.key_count_);
+    KeyT key_max = *std::max_element(init_keys, init_keys + config.key_count_);
+    range_key_width = (key_max - key_min) * config.selectivity_;
+    std::cout << "range key width: " << range_key_width << std::endl;
+  }
+
+  auto static_index = dynamic_cast<BaseStaticIndex<KeyT, ValueT>*>(data_index.get());
+
+  if ((!config.image_path_.empty() || !config.write_image_path_.empty()) && static_index == nullptr) {
+    std::cerr << "error: images are only supported by static indexes!" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // time to first query covers building or loading the index, and a single lookup.
+  TimeMeasurer first_query_timer;
+  first_query_timer.tic();
+
+  if (!config.image_path_.empty()) {
+
+    TimeMeasurer load_timer;
+    load_timer.tic();
+
+    if (!static_index->load(config.image_path_, config.image_map_ >= 1, config.image_map_ >= 2)) {
+      std::cerr << "error: cannot load image " << config.image_path_ << "!" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+    load_timer.toc();
+    std::cout << "load time: " << load_timer.time_ms() << " ms" << std::endl;
+
+  } else {
+
+    TimeMeasurer reorganize_timer;
+    reorganize_timer.tic();
+
+    data_index->reorganize(config.build_thread_count_);
+
+    reorganize_timer.toc();
+    std::cout << "reorganize time: " << reorganize_timer.time_ms() << " ms" << std::endl;
+  }
+
+  std::vector<Uint64> first_query_values;
+  data_index->find(init_keys[0], first_query_values);
+
+  first_query_timer.toc();
+  std::cout << "time to first query: " << first_query_timer.time_us() << " us" << std::endl;
+
+  if (config.index_type_ == IndexType::S_Compressed && static_index != nullptr) {
+    size_t compressed_size = static_cast<static_index::CompressedIndex<KeyT, ValueT>*>(data_index.get())->compressed_size();
+    std::cout << "index bytes per key: " << compressed_size * 1.0 / config.key_count_ << std::endl;
+  }
+
+  if (!config.write_image_path_.empty()) {
+    if (!static_index->serialize(config.write_image_path_)) {
+      std::cerr << "error: cannot write image " << config.write_image_path_ << "!" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    std::cout << "image written: " << config.write_image_path_ << std::endl;
+  }
+  //=================================
+
+  //=================================
+  // write all init keys to output file
+  //=================================
+  if (config.record_ == true) {
+
+    std::ofstream record_file;
+    record_file.open("data.txt");
+    
+    for (size_t i = 0; i < config.key_count_; ++i) {
+      record_file << init_keys[i] << std::endl;
+    }
+    record_file.close();
+
+    // return;
+  }
+  //=================================
+
+  //=================================
+  // prepare query keys
+  //=================================
+  KeyT** read_keys = new KeyT*[config.thread_count_];
+  
+  // generate keys for each thread
+  for (size_t i = 0; i < config.thread_count_; ++i) {
+
+    read_keys[i] = new KeyT[config.generated_read_key_count_];
+
+    FastRandom rand_gen(i);
+    
+    for (size_t j = 0; j < config.generated_read_key_count_; ++j) {
+      read_keys[i][j] = init_keys[rand_gen.next<uint64_t>() % config.key_count_];
+    }
+  }
+
+  double query_key_size_mb = (config.key_count_ + config.generated_read_key_count_) * sizeof(KeyT) / 1024 / 1024;
+
+  //=================================
+
+  double init_mem_size = get_memory_mb();
+  std::cout << "init memory size (index + table): " << (init_mem_size - query_key_size_mb) << " MB" << std::endl;
+  if (config.huge_page_mode_ != HugePageNone) {
+    std::cout << "reserved huge pages: " << huge_page_explicit_bytes() / 1024 / 1024 << " MB, "
+              << "transparent huge pages: " << huge_page_transparent_bytes() / 1024 / 1024 << " MB" << std::endl;
+  }
+  print_numa_memory("init");
+
+  if (config.dispatch_type_ == DispatchType::VirtualType) {
+
+    run_phase<KeyT, ValueT>(config, read_keys, data_table.get(), data_index.get(), false, query_key_size_mb);
+
+  } else if (config.dispatch_type_ == DispatchType::DevirtualizedType) {
+
+    run_phase<KeyT, ValueT>(config, read_keys, data_table.get(), data_index.get(), true, query_key_size_mb);
+
+  } else {
+
+    double virtual_throughput = run_phase<KeyT, ValueT>(config, read_keys, data_table.get(), data_index.get(), false, query_key_size_mb);
+
+    double devirtualized_throughput = run_phase<KeyT, ValueT>(config, read_keys, data_table.get(), data_index.get(), true, query_key_size_mb);
+
+    std::cout << "devirtualization speedup: " << (devirtualized_throughput / virtual_throughput - 1) * 100 << " %" << std::endl;
+  }
+
+  if (config.verbose_ == true) {
+    data_index->print(); 
+  }
+
   delete[] init_keys;
   init_keys = nullptr;
 }
@@ -467,6 +1244,15 @@ int main(int argc, char* argv[]) {
 
   parse_args(argc, argv, config);
   
+  if (config.table_sweep_) {
+    if (config.key_size_ == 4) {
+      run_table_sweep<Uint32, Uint64>(config);
+    } else {
+      run_table_sweep<Uint64, Uint64>(config);
+    }
+    return 0;
+  }
+  
   if (config.key_size_ == 4) {
     run_workload<Uint32, Uint64>(config);
   }
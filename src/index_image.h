@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+// on-disk image of a static index: a header, then the values and arrays of the index in the order
+// they are written. arrays start on a page boundary, so that they are used in place once the image is mapped.
+// an image is only valid on the machine that wrote it, with the same data table.
+
+static const uint64_t INDEX_IMAGE_MAGIC = 0x45474d4958444e49ull; // "INDXIMGE"
+
+// bump whenever the format of any index changes.
+static const uint64_t INDEX_IMAGE_VERSION = 4;
+
+static const size_t INDEX_IMAGE_ALIGNMENT = 4096; // unit: byte
+
+static const size_t INDEX_IMAGE_NAME_SIZE = 128;
+
+struct IndexImageHeader {
+  uint64_t magic_;
+  uint64_t version_;
+  // type of the index, including its key and value types
+  char index_name_[INDEX_IMAGE_NAME_SIZE];
+  // the data table that the values are offsets into
+  uint64_t table_size_;
+  uint64_t table_block_capacity_;
+  uint64_t table_block_placement_;
+};
+
+
+class IndexImageWriter {
+
+public:
+  IndexImageWriter(const std::string &path) : offset_(0), is_valid_(true) {
+    file_ = fopen(path.c_str(), "wb");
+    is_valid_ = (file_ != nullptr);
+  }
+
+  ~IndexImageWriter() {
+    if (file_ != nullptr) {
+      fclose(file_);
+    }
+  }
+
+  // false once anything failed to be written.
+  bool close() {
+    if (file_ != nullptr) {
+      is_valid_ = (fclose(file_) == 0) && is_valid_;
+      file_ = nullptr;
+    }
+    return is_valid_;
+  }
+
+  template<typename T>
+  void write_value(const T &value) {
+    write_bytes(&value, sizeof(T));
+  }
+
+  // the element count, then the elements from the next page boundary.
+  template<typename T>
+  void write_array(const T *array, const size_t count) {
+    write_value(uint64_t(count));
+    pad_to(INDEX_IMAGE_ALIGNMENT);
+    write_bytes(array, count * sizeof(T));
+  }
+
+private:
+  void write_bytes(const void *data, const size_t size) {
+    if (!is_valid_ || size == 0) { return; }
+    is_valid_ = (fwrite(data, 1, size, file_) == size);
+    offset_ += size;
+  }
+
+  void pad_to(const size_t alignment) {
+    static const char zeros[INDEX_IMAGE_ALIGNMENT] = { 0 };
+    write_bytes(zeros, (alignment - offset_ % alignment) % alignment);
+  }
+
+private:
+  FILE *file_;
+  size_t offset_;
+  bool is_valid_;
+};
+
+
+// maps an image read-only, and hands out pointers into the mapping in the order the writer wrote them.
+// the mapping outlives the reader: it is handed over with release(), and unmapped with unmap_image().
+class IndexImageReader {
+
+public:
+  // populate faults in the whole image while mapping it.
+  // huge_pages asks the kernel to back the mapping with transparent huge pages where it can.
+  IndexImageReader(const std::string &path, const bool populate = false, const bool huge_pages = false) :
+    image_(nullptr), image_size_(0), offset_(0), is_valid_(false), is_owner_(true) {
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || size_t(file_stat.st_size) < sizeof(IndexImageHeader)) {
+      ::close(fd);
+      return;
+    }
+
+    image_size_ = file_stat.st_size;
+
+    void *image = mmap(nullptr, image_size_, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+    ::close(fd);
+
+    if (image == MAP_FAILED) {
+      return;
+    }
+
+    image_ = static_cast<char*>(image);
+    is_valid_ = true;
+
+    if (huge_pages) {
+      madvise(image_, image_size_, MADV_HUGEPAGE);
+    }
+  }
+
+  ~IndexImageReader() {
+    if (is_owner_) {
+      unmap_image(image_, image_size_);
+    }
+  }
+
+  // false once the image could not be mapped, or anything was read beyond its end.
+  bool is_valid() const { return is_valid_; }
+
+  template<typename T>
+  T read_value() {
+    T value = T();
+    const char *data = read_bytes(sizeof(T));
+    if (data != nullptr) {
+      memcpy(&value, data, sizeof(T));
+    }
+    return value;
+  }
+
+  // the elements stay in the mapping, and must not be written.
+  template<typename T>
+  T* read_array(size_t &count) {
+    count = read_value<uint64_t>();
+    offset_ = (offset_ + INDEX_IMAGE_ALIGNMENT - 1) / INDEX_IMAGE_ALIGNMENT * INDEX_IMAGE_ALIGNMENT;
+    return reinterpret_cast<T*>(const_cast<char*>(read_bytes(count * sizeof(T))));
+  }
+
+  // hand the mapping over to the caller. it can still be read from until the reader is gone.
+  void release(char *&image, size_t &image_size) {
+    image = image_;
+    image_size = image_size_;
+    is_owner_ = false;
+  }
+
+  static void unmap_image(char *image, const size_t image_size) {
+    if (image != nullptr) {
+      munmap(image, image_size);
+    }
+  }
+
+private:
+  const char *read_bytes(const size_t size) {
+    if (!is_valid_ || offset_ + size > image_size_) {
+      is_valid_ = false;
+      return nullptr;
+    }
+    const char *data = image_ + offset_;
+    offset_ += size;
+    return data;
+  }
+
+private:
+  char *image_;
+  size_t image_size_;
+  size_t offset_;
+  bool is_valid_;
+  bool is_owner_;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// counts latencies in buckets whose width grows with the latency, so that any percentile
+// is reported within 1/64 of its value, in constant space.
+// latencies below 128 get a bucket each. above that, each power of 2 is split into 64 buckets.
+class LatencyHistogram {
+
+public:
+  LatencyHistogram() : count_(0), max_(0) {
+    memset(buckets_, 0, sizeof(buckets_));
+  }
+
+  void record(const uint64_t latency) {
+    ++buckets_[bucket_of(latency)];
+    ++count_;
+    max_ = std::max(max_, latency);
+  }
+
+  void add(const LatencyHistogram &other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    max_ = std::max(max_, other.max_);
+  }
+
+  uint64_t count() const { return count_; }
+
+  uint64_t max() const { return max_; }
+
+  // the smallest latency that at least a fraction of the recorded latencies do not exceed,
+  // rounded up to the end of its bucket.
+  uint64_t percentile(const double fraction) const {
+    if (count_ == 0) {
+      return 0;
+    }
+    uint64_t rank = std::max(uint64_t(fraction * count_ + 0.5), uint64_t(1));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+      seen += buckets_[i];
+      if (seen >= rank) {
+        return std::min(bucket_end(i), max_);
+      }
+    }
+    return max_;
+  }
+
+private:
+  static const size_t SUB_BUCKET_BITS = 6;
+  static const size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+  static const size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+  static size_t bucket_of(const uint64_t latency) {
+    if (latency < 2 * SUB_BUCKET_COUNT) {
+      return latency;
+    }
+    size_t shift = 63 - __builtin_clzll(latency) - SUB_BUCKET_BITS;
+    return shift * SUB_BUCKET_COUNT + (latency >> shift);
+  }
+
+  // the largest latency that falls into bucket.
+  static uint64_t bucket_end(const size_t bucket) {
+    if (bucket < 2 * SUB_BUCKET_COUNT) {
+      return bucket;
+    }
+    size_t shift = bucket / SUB_BUCKET_COUNT - 1;
+    uint64_t sub_bucket = bucket - shift * SUB_BUCKET_COUNT;
+    return ((sub_bucket + 1) << shift) - 1;
+  }
+
+private:
+  uint64_t buckets_[BUCKET_COUNT];
+  uint64_t count_;
+  uint64_t max_;
+};
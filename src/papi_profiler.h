@@ -56,4 +56,31 @@ public:
     return;
   }
 
+  static void start_measure_tlb_miss_rate() {
+    const size_t num_counters = 2;
+    int events[num_counters] = {PAPI_TLB_DM, PAPI_LD_INS};
+    int retval;
+
+    if ((retval = PAPI_start_counters(events, num_counters)) != PAPI_OK) {
+      fprintf(stderr, "PAPI failed to start counters: %s\n", PAPI_strerror(retval));
+      exit(EXIT_FAILURE);
+    }
+    return;
+  }
+
+  static void stop_measure_tlb_miss_rate() {
+    const size_t num_counters = 2;
+    long long counters[num_counters];
+    int retval;
+
+    if ((retval = PAPI_stop_counters(counters, num_counters)) != PAPI_OK) {
+      fprintf(stderr, "PAPI failed to stop counters: %s\n", PAPI_strerror(retval));
+      exit(EXIT_FAILURE);
+    }
+
+    std::cout << "counters: " << counters[0] << " " << counters[1] << std::endl;
+    std::cout << "dtlb miss rate = " << counters[0] * 1.0 / counters[1] << std::endl;
+    return;
+  }
+
 };
\ No newline at end of file
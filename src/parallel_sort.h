@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "radix_sort.h"
+#include "utils.h"
+
+// number of partitions created by the first pass of parallel_sort().
+static const size_t PARALLEL_SORT_PARTITION_COUNT = 1024;
+
+// sort data[0, size) by the integer member key_ of its elements.
+// the elements are first scattered into partitions by the most significant bits of their keys
+// (one pass of MSD radix sort), then the partitions are sorted independently by sort_by_key().
+// every step runs on thread_count threads.
+template<typename T>
+static void parallel_sort(T *data, const size_t size, const size_t thread_count) {
+
+  typedef decltype(data->key_) KeyT;
+
+  if (thread_count <= 1 || size < thread_count * PARALLEL_SORT_PARTITION_COUNT) {
+    sort_by_key(data, size);
+    return;
+  }
+
+  // each thread works on a contiguous chunk of the input.
+  auto chunk_begin = [&](const size_t thread_id) { return size * thread_id / thread_count; };
+
+  // find key range
+  std::vector<KeyT> key_mins(thread_count, data[0].key_);
+  std::vector<KeyT> key_maxs(thread_count, data[0].key_);
+
+  run_parallel(thread_count, [&](const size_t thread_id) {
+    for (size_t i = chunk_begin(thread_id); i < chunk_begin(thread_id + 1); ++i) {
+      key_mins[thread_id] = std::min(key_mins[thread_id], data[i].key_);
+      key_maxs[thread_id] = std::max(key_maxs[thread_id], data[i].key_);
+    }
+  });
+
+  KeyT key_min = *std::min_element(key_mins.begin(), key_mins.end());
+  KeyT key_max = *std::max_element(key_maxs.begin(), key_maxs.end());
+
+  size_t shift = 0;
+  while ((Uint64(key_max - key_min) >> shift) >= PARALLEL_SORT_PARTITION_COUNT) {
+    ++shift;
+  }
+
+  auto partition_id = [&](const KeyT &key) { return size_t(Uint64(key - key_min) >> shift); };
+
+  // histograms[thread_id * PARALLEL_SORT_PARTITION_COUNT + partition_id]
+  std::vector<size_t> histograms(thread_count * PARALLEL_SORT_PARTITION_COUNT, 0);
+
+  run_parallel(thread_count, [&](const size_t thread_id) {
+    size_t *histogram = histograms.data() + thread_id * PARALLEL_SORT_PARTITION_COUNT;
+    for (size_t i = chunk_begin(thread_id); i < chunk_begin(thread_id + 1); ++i) {
+      ++histogram[partition_id(data[i].key_)];
+    }
+  });
+
+  // turn the histograms into the write position of each thread in each partition.
+  std::vector<size_t> partition_begins(PARALLEL_SORT_PARTITION_COUNT + 1, 0);
+
+  size_t offset = 0;
+  for (size_t p = 0; p < PARALLEL_SORT_PARTITION_COUNT; ++p) {
+    partition_begins[p] = offset;
+    for (size_t thread_id = 0; thread_id < thread_count; ++thread_id) {
+      size_t count = histograms[thread_id * PARALLEL_SORT_PARTITION_COUNT + p];
+      histograms[thread_id * PARALLEL_SORT_PARTITION_COUNT + p] = offset;
+      offset += count;
+    }
+  }
+  partition_begins[PARALLEL_SORT_PARTITION_COUNT] = offset;
+
+  ASSERT(offset == size, "incorrect histograms: " << offset << " " << size);
+
+  T *tmp = new T[size];
+
+  run_parallel(thread_count, [&](const size_t thread_id) {
+    size_t *positions = histograms.data() + thread_id * PARALLEL_SORT_PARTITION_COUNT;
+    for (size_t i = chunk_begin(thread_id); i < chunk_begin(thread_id + 1); ++i) {
+      tmp[positions[partition_id(data[i].key_)]++] = data[i];
+    }
+  });
+
+  // partitions may differ a lot in size, so threads grab them one at a time.
+  std::atomic<size_t> next_partition(0);
+
+  run_parallel(thread_count, [&](const size_t thread_id) {
+    while (true) {
+      size_t p = next_partition.fetch_add(1);
+      if (p >= PARALLEL_SORT_PARTITION_COUNT) {
+        break;
+      }
+      T *begin = tmp + partition_begins[p];
+      T *end = tmp + partition_begins[p + 1];
+
+      sort_by_key(begin, end - begin);
+      std::copy(begin, end, data + partition_begins[p]);
+    }
+  });
+
+  delete[] tmp;
+  tmp = nullptr;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstring>
+#include <iostream>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// hardware event counters through linux perf events, without depending on PAPI.
+// counters cover the calling thread and all threads it creates after start().
+// if the kernel does not allow perf events, the profiler is unavailable and reports -1.
+class PerfProfiler {
+
+  static const size_t NUM_COUNTERS = 3;
+
+public:
+  PerfProfiler() {
+    uint64_t configs[NUM_COUNTERS] = {
+      PERF_COUNT_HW_CACHE_MISSES, // last level cache misses
+      PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+      PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    };
+    uint32_t types[NUM_COUNTERS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE };
+
+    for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.type = types[i];
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.disabled = 1;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+
+      fds_[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+      counters_[i] = -1;
+    }
+  }
+
+  ~PerfProfiler() {
+    for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+      if (fds_[i] >= 0) { close(fds_[i]); }
+    }
+  }
+
+  bool is_available() const { return fds_[0] >= 0; }
+
+  void start() {
+    for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+      if (fds_[i] < 0) { continue; }
+      ioctl(fds_[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  // must be called after the threads created since start() have exited.
+  void stop() {
+    for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+      if (fds_[i] < 0) { continue; }
+      ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fds_[i], &counters_[i], sizeof(long long)) != sizeof(long long)) {
+        counters_[i] = -1;
+      }
+    }
+  }
+
+  long long llc_misses() const { return counters_[0]; }
+
+  long long l1d_misses() const { return counters_[1]; }
+
+  // data TLB misses of loads. -1 if the CPU does not count them.
+  long long dtlb_misses() const { return counters_[2]; }
+
+  void print() const {
+    if (!is_available()) {
+      std::cout << "cache misses: unavailable" << std::endl;
+      return;
+    }
+    std::cout << "llc misses: " << llc_misses() << std::endl;
+    std::cout << "l1d misses: " << l1d_misses() << std::endl;
+    std::cout << "dtlb misses: " << dtlb_misses() << std::endl;
+  }
+
+private:
+  int fds_[NUM_COUNTERS];
+  long long counters_[NUM_COUNTERS];
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "utils.h"
+
+// number of key bits consumed by each pass of radix_sort().
+static const size_t RADIX_SORT_DIGIT_BITS = 8;
+static const size_t RADIX_SORT_BUCKET_COUNT = 1 << RADIX_SORT_DIGIT_BITS;
+
+// inputs smaller than this are sorted by std::sort.
+static const size_t RADIX_SORT_THRESHOLD = 4096;
+
+// size of each write-combining buffer. unit: byte
+static const size_t RADIX_SORT_BUFFER_SIZE = 64;
+
+// least significant digit radix sort on the integer member key_ of the elements.
+// each pass scatters the elements into 256 buckets. instead of writing every element
+// straight to its bucket, which touches 256 different cachelines in turn, elements are
+// staged in a cacheline-sized buffer per bucket and copied out one full buffer at a time
+// (software write-combining). passes in which all keys share the same digit are skipped.
+template<typename T>
+static void radix_sort(T *data, const size_t size) {
+
+  typedef decltype(data->key_) KeyT;
+
+  static_assert(std::is_integral<KeyT>::value && std::is_unsigned<KeyT>::value, "radix sort requires unsigned integer keys");
+  static_assert(sizeof(T) <= RADIX_SORT_BUFFER_SIZE, "element does not fit in a write-combining buffer");
+
+  const size_t pass_count = sizeof(KeyT) * 8 / RADIX_SORT_DIGIT_BITS;
+  const size_t buffer_capacity = RADIX_SORT_BUFFER_SIZE / sizeof(T);
+  const KeyT digit_mask = RADIX_SORT_BUCKET_COUNT - 1;
+
+  if (size <= 1) {
+    return;
+  }
+
+  // histograms of all digits, computed in a single read of the input.
+  std::vector<size_t> histograms(pass_count * RADIX_SORT_BUCKET_COUNT, 0);
+
+  for (size_t i = 0; i < size; ++i) {
+    KeyT key = data[i].key_;
+    for (size_t pass = 0; pass < pass_count; ++pass) {
+      ++histograms[pass * RADIX_SORT_BUCKET_COUNT + ((key >> (pass * RADIX_SORT_DIGIT_BITS)) & digit_mask)];
+    }
+  }
+
+  alignas(64) T buffers[RADIX_SORT_BUCKET_COUNT * (RADIX_SORT_BUFFER_SIZE / sizeof(T))];
+  size_t buffer_sizes[RADIX_SORT_BUCKET_COUNT];
+  size_t offsets[RADIX_SORT_BUCKET_COUNT];
+
+  T *tmp = new T[size];
+
+  T *src = data;
+  T *dst = tmp;
+
+  for (size_t pass = 0; pass < pass_count; ++pass) {
+
+    const size_t *histogram = histograms.data() + pass * RADIX_SORT_BUCKET_COUNT;
+    const size_t shift = pass * RADIX_SORT_DIGIT_BITS;
+
+    // all keys fall into the same bucket
+    if (histogram[(src[0].key_ >> shift) & digit_mask] == size) {
+      continue;
+    }
+
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < RADIX_SORT_BUCKET_COUNT; ++bucket) {
+      offsets[bucket] = offset;
+      offset += histogram[bucket];
+      buffer_sizes[bucket] = 0;
+    }
+
+    for (size_t i = 0; i < size; ++i) {
+      size_t bucket = (src[i].key_ >> shift) & digit_mask;
+      T *buffer = buffers + bucket * buffer_capacity;
+
+      buffer[buffer_sizes[bucket]] = src[i];
+      ++buffer_sizes[bucket];
+
+      if (buffer_sizes[bucket] == buffer_capacity) {
+        memcpy(dst + offsets[bucket], buffer, sizeof(T) * buffer_capacity);
+        offsets[bucket] += buffer_capacity;
+        buffer_sizes[bucket] = 0;
+      }
+    }
+
+    // flush partially filled buffers
+    for (size_t bucket = 0; bucket < RADIX_SORT_BUCKET_COUNT; ++bucket) {
+      memcpy(dst + offsets[bucket], buffers + bucket * buffer_capacity, sizeof(T) * buffer_sizes[bucket]);
+    }
+
+    std::swap(src, dst);
+  }
+
+  if (src != data) {
+    memcpy(data, src, sizeof(T) * size);
+  }
+
+  delete[] tmp;
+  tmp = nullptr;
+}
+
+template<typename T>
+static void sort_by_key(T *data, const size_t size, std::true_type) {
+  if (size >= RADIX_SORT_THRESHOLD) {
+    radix_sort(data, size);
+  } else {
+    std::sort(data, data + size, [](const T &lhs, const T &rhs) { return lhs.key_ < rhs.key_; });
+  }
+}
+
+template<typename T>
+static void sort_by_key(T *data, const size_t size, std::false_type) {
+  std::sort(data, data + size, [](const T &lhs, const T &rhs) { return lhs.key_ < rhs.key_; });
+}
+
+// sort data[0, size) by the member key_ of its elements.
+// 32-bit and 64-bit keys go through radix_sort(), other keys through std::sort.
+template<typename T>
+static void sort_by_key(T *data, const size_t size) {
+
+  typedef decltype(data->key_) KeyT;
+
+  sort_by_key(data, size, std::integral_constant<bool, std::is_same<KeyT, Uint32>::value || std::is_same<KeyT, Uint64>::value>());
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "utils.h"
+
+// a visitor receives each value as soon as the index finds it.
+typedef void (*ResultVisitor)(void *context, const Uint64 value);
+
+// destination of the values returned by index read operations.
+// a sink works in one of three modes:
+// (1) inline: values are kept in a small buffer inside the sink.
+//     the heap is touched only when the buffer overflows.
+// (2) vector: values are appended to an external vector.
+// (3) visitor: values are handed to a callback and not stored at all.
+// in every mode, the sink accepts at most `limit` values.
+// indexes stop searching once the sink is full, so that a limit of 1 gives
+// a lookup that terminates at the first match.
+class ResultSink {
+
+public:
+  static const size_t INLINE_CAPACITY = 8;
+  static const size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+  explicit ResultSink(const size_t limit = UNLIMITED) :
+    vector_(nullptr), visitor_(nullptr), context_(nullptr), limit_(limit), size_(0) {}
+
+  explicit ResultSink(std::vector<Uint64> &values, const size_t limit = UNLIMITED) :
+    vector_(&values), visitor_(nullptr), context_(nullptr), limit_(limit), size_(0) {}
+
+  ResultSink(ResultVisitor visitor, void *context, const size_t limit = UNLIMITED) :
+    vector_(nullptr), visitor_(visitor), context_(context), limit_(limit), size_(0) {}
+
+  // append a value. return false if the sink does not accept any more values.
+  bool push_back(const Uint64 value) {
+    if (size_ >= limit_) {
+      return false;
+    }
+    if (vector_ != nullptr) {
+      vector_->push_back(value);
+    } else if (visitor_ != nullptr) {
+      visitor_(context_, value);
+    } else if (size_ < INLINE_CAPACITY) {
+      buffer_[size_] = value;
+    } else {
+      overflow_.push_back(value);
+    }
+    ++size_;
+    return size_ < limit_;
+  }
+
+  // append values in order. return false if the sink does not accept any more values.
+  bool append(const std::vector<Uint64> &values) {
+    for (auto value : values) {
+      if (!push_back(value)) { return false; }
+    }
+    return !full();
+  }
+
+  // append count contiguous values in order, as far as the limit allows.
+  // return false if the sink does not accept any more values.
+  bool append(const Uint64 *values, const size_t count) {
+    size_t accepted = std::min(count, limit_ - std::min(size_, limit_));
+    if (vector_ != nullptr) {
+      vector_->insert(vector_->end(), values, values + accepted);
+      size_ += accepted;
+      return size_ < limit_;
+    }
+    for (size_t i = 0; i < accepted; ++i) {
+      push_back(values[i]);
+    }
+    return size_ < limit_;
+  }
+
+  bool full() const { return size_ >= limit_; }
+
+  // number of values accepted since construction or the last clear().
+  size_t size() const { return size_; }
+
+  size_t limit() const { return limit_; }
+
+  // only valid in inline mode.
+  Uint64 operator[](const size_t i) const {
+    ASSERT(vector_ == nullptr && visitor_ == nullptr, "values are not stored in the sink");
+    ASSERT(i < size_, "out of range: " << i << " " << size_);
+
+    if (i < INLINE_CAPACITY) {
+      return buffer_[i];
+    } else {
+      return overflow_[i - INLINE_CAPACITY];
+    }
+  }
+
+  // reset the sink for reuse. an external vector is left untouched.
+  void clear() {
+    overflow_.clear();
+    size_ = 0;
+  }
+
+private:
+  std::vector<Uint64> *vector_;
+  ResultVisitor visitor_;
+  void *context_;
+
+  size_t limit_;
+  size_t size_;
+
+  Uint64 buffer_[INLINE_CAPACITY];
+  std::vector<Uint64> overflow_;
+};
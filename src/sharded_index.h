@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include "base_index.h"
+#include "utils.h"
+
+enum class ShardingType {
+  HashSharding = 0,
+  RangeSharding,
+};
+
+// spreads keys over several instances of an index, so that single-thread indexes can serve many threads.
+// each shard is guarded by its own reader-writer spin lock: reads of a shard run in parallel, writes alone.
+// with hash sharding, a key goes to the shard picked by its hash. with range sharding, shard i holds
+// the keys in [split_keys[i - 1], split_keys[i]), so range reads return values in key order.
+// all values of a key are kept by a single shard, so lookups and scans of a key visit one shard only.
+template<typename KeyT, typename ValueT>
+class ShardedIndex : public BaseIndex<KeyT, ValueT> {
+
+  // one cacheline per shard, so that threads working on different shards do not share lines.
+  struct alignas(64) ShardLock {
+    ReadWriteSpinLock lock_;
+  };
+
+public:
+  // takes over the shards. range sharding needs shards.size() - 1 sorted split keys.
+  ShardedIndex(DataTable<KeyT, ValueT> *table_ptr, const std::vector<BaseIndex<KeyT, ValueT>*> &shards, const ShardingType sharding_type, const std::vector<KeyT> &split_keys = std::vector<KeyT>()) :
+    BaseIndex<KeyT, ValueT>(table_ptr), shards_(shards), sharding_type_(sharding_type), split_keys_(split_keys) {
+
+    ASSERT(shards_.size() > 0, "no shards");
+    ASSERT(sharding_type_ == ShardingType::HashSharding || split_keys_.size() + 1 == shards_.size(),
+           "range sharding needs " << shards_.size() - 1 << " split keys, got " << split_keys_.size());
+    ASSERT(std::is_sorted(split_keys_.begin(), split_keys_.end()), "split keys are not sorted");
+
+    locks_ = aligned_new_array<ShardLock>(shards_.size());
+    for (size_t shard_id = 0; shard_id < shards_.size(); ++shard_id) {
+      new (&locks_[shard_id]) ShardLock();
+    }
+  }
+
+  virtual ~ShardedIndex() {
+    for (size_t shard_id = 0; shard_id < shards_.size(); ++shard_id) {
+      delete shards_[shard_id];
+      locks_[shard_id].~ShardLock();
+    }
+    shards_.clear();
+
+    aligned_delete_array(locks_);
+    locks_ = nullptr;
+  }
+
+  virtual void insert(const KeyT &key, const Uint64 &value) final {
+    size_t shard_id = route(key);
+    locks_[shard_id].lock_.lock();
+    shards_[shard_id]->insert(key, value);
+    locks_[shard_id].lock_.unlock();
+  }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+    size_t shard_id = route(key);
+    locks_[shard_id].lock_.lock_shared();
+    shards_[shard_id]->find(key, values);
+    locks_[shard_id].lock_.unlock_shared();
+  }
+
+  // with range sharding, only the shards that overlap the range are visited, in key order.
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
+
+    size_t begin = 0;
+    size_t end = shards_.size();
+    if (sharding_type_ == ShardingType::RangeSharding) {
+      begin = route(lhs_key);
+      end = route(rhs_key) + 1;
+    }
+
+    for (size_t shard_id = begin; shard_id < end && !values.full(); ++shard_id) {
+      locks_[shard_id].lock_.lock_shared();
+      shards_[shard_id]->find_range(lhs_key, rhs_key, values);
+      locks_[shard_id].lock_.unlock_shared();
+    }
+  }
+
+  // scans the shard of key only.
+  virtual void scan(const KeyT &key, ResultSink &values) final {
+    size_t shard_id = route(key);
+    locks_[shard_id].lock_.lock_shared();
+    shards_[shard_id]->scan(key, values);
+    locks_[shard_id].lock_.unlock_shared();
+  }
+
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) final {
+    size_t shard_id = route(key);
+    locks_[shard_id].lock_.lock_shared();
+    shards_[shard_id]->scan_reverse(key, values);
+    locks_[shard_id].lock_.unlock_shared();
+  }
+
+  // shards are visited in order. so values are in key order with range sharding only.
+  virtual void scan_full(ResultSink &values, const size_t count) final {
+    size_t base_size = values.size();
+    for (size_t shard_id = 0; shard_id < shards_.size() && !values.full(); ++shard_id) {
+      size_t scanned_count = values.size() - base_size;
+      if (scanned_count >= count) { return; }
+
+      locks_[shard_id].lock_.lock_shared();
+      shards_[shard_id]->scan_full(values, count - scanned_count);
+      locks_[shard_id].lock_.unlock_shared();
+    }
+  }
+
+  virtual void erase(const KeyT &key) final {
+    size_t shard_id = route(key);
+    locks_[shard_id].lock_.lock();
+    shards_[shard_id]->erase(key);
+    locks_[shard_id].lock_.unlock();
+  }
+
+  virtual size_t size() const final {
+    size_t size = 0;
+    for (size_t shard_id = 0; shard_id < shards_.size(); ++shard_id) {
+      locks_[shard_id].lock_.lock_shared();
+      size += shards_[shard_id]->size();
+      locks_[shard_id].lock_.unlock_shared();
+    }
+    return size;
+  }
+
+  // the shards hold disjoint parts of the table, so only dynamic indexes can be sharded, and this does nothing for them.
+  virtual void reorganize(const size_t thread_count) final {
+    for (auto shard : shards_) {
+      shard->reorganize(thread_count);
+    }
+  }
+
+  // every thread may reach every shard.
+  virtual void prepare_threads(const size_t thread_count) final {
+    for (auto shard : shards_) {
+      shard->prepare_threads(thread_count);
+    }
+  }
+
+  virtual void register_thread(const size_t thread_id) final {
+    for (auto shard : shards_) {
+      shard->register_thread(thread_id);
+    }
+  }
+
+  virtual void print() const final {
+    std::cout << "shards = " << shards_.size() << ", sharding = " << (sharding_type_ == ShardingType::HashSharding ? "hash" : "range") << std::endl;
+    for (size_t shard_id = 0; shard_id < shards_.size(); ++shard_id) {
+      std::cout << "shard " << shard_id << ": size = " << shards_[shard_id]->size() << std::endl;
+    }
+  }
+
+  size_t shard_count() const { return shards_.size(); }
+
+  size_t route(const KeyT &key) const {
+    if (sharding_type_ == ShardingType::RangeSharding) {
+      return std::upper_bound(split_keys_.begin(), split_keys_.end(), key) - split_keys_.begin();
+    }
+    // fibonacci hashing, and a multiply-shift to map the hash to a shard without a division.
+    uint64_t hash = uint64_t(key) * 0x9E3779B97F4A7C15ull;
+    return ((hash >> 32) * shards_.size()) >> 32;
+  }
+
+private:
+  ShardedIndex(const ShardedIndex &);
+  ShardedIndex& operator=(const ShardedIndex &);
+
+private:
+  std::vector<BaseIndex<KeyT, ValueT>*> shards_;
+  mutable ShardLock *locks_;
+
+  const ShardingType sharding_type_;
+  const std::vector<KeyT> split_keys_;
+};
+
+// split keys that give each of shard_count shards about the same number of the given keys.
+// keys are sampled evenly, so that the split stays cheap for large key sets.
+template<typename KeyT>
+static std::vector<KeyT> choose_split_keys(const KeyT *keys, const size_t key_count, const size_t shard_count, const size_t sample_count = 1 << 16) {
+
+  std::vector<KeyT> samples;
+  size_t step = std::max(key_count / sample_count, size_t(1));
+  for (size_t i = 0; i < key_count; i += step) {
+    samples.push_back(keys[i]);
+  }
+  std::sort(samples.begin(), samples.end());
+
+  std::vector<KeyT> split_keys;
+  for (size_t shard_id = 1; shard_id < shard_count; ++shard_id) {
+    split_keys.push_back(samples.empty() ? KeyT() : samples[samples.size() * shard_id / shard_count]);
+  }
+  return split_keys;
+}
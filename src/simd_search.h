@@ -0,0 +1,245 @@
+#pragma once
+
+#include <immintrin.h>
+#include <cstring>
+#include <type_traits>
+
+#include "utils.h"
+
+// number of keys in keys[0, length) that are smaller than key.
+// keys must be sorted, so the result is also the lower bound of key.
+// the loop has no data-dependent branches, and is vectorized by the compiler where possible.
+template<typename KeyT>
+static size_t simd_count_less(const KeyT *keys, const KeyT key, const size_t length) {
+  size_t count = 0;
+  for (size_t i = 0; i < length; ++i) {
+    count += (keys[i] < key);
+  }
+  return count;
+}
+
+// 4 keys per SSE2 comparison. SSE2 only compares signed integers,
+// so the sign bit of both sides is flipped to get an unsigned comparison.
+static size_t simd_count_less(const Uint32 *keys, const Uint32 key, const size_t length) {
+  const __m128i xmm_flip = _mm_set1_epi32(0x80000000);
+  const __m128i xmm_key = _mm_xor_si128(_mm_set1_epi32(key), xmm_flip);
+
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    __m128i xmm_keys = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), xmm_flip);
+    __m128i xmm_mask = _mm_cmpgt_epi32(xmm_key, xmm_keys);
+    count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(xmm_mask)));
+  }
+  for (; i < length; ++i) {
+    count += (keys[i] < key);
+  }
+  return count;
+}
+
+// register widths of the supported instruction sets. unit: byte
+static const size_t SSE2_WIDTH = 16;
+static const size_t AVX2_WIDTH = 32;
+static const size_t AVX512_WIDTH = 64;
+
+// widest register that the running CPU supports. SSE2 is always available on x86-64.
+static size_t simd_max_width() {
+  if (__builtin_cpu_supports("avx512f")) { return AVX512_WIDTH; }
+  if (__builtin_cpu_supports("avx2")) { return AVX2_WIDTH; }
+  return SSE2_WIDTH;
+}
+
+// keys as seen by the signed SIMD comparisons: signed integers of 4 or 8 bytes.
+// smaller keys are widened, and unsigned keys of the same size get their sign bit flipped.
+// both keep the order of the keys.
+template<typename KeyT>
+struct SimdKey {
+  typedef typename std::conditional<sizeof(KeyT) <= 4, int32_t, int64_t>::type type;
+  typedef typename std::make_unsigned<type>::type unsigned_type;
+
+  static const bool FLIP_SIGN = std::is_unsigned<KeyT>::value && sizeof(KeyT) == sizeof(type);
+
+  static type encode(const KeyT key) {
+    if (!FLIP_SIGN) { return type(key); }
+    return type(unsigned_type(key) ^ (unsigned_type(1) << (sizeof(type) * 8 - 1)));
+  }
+
+  static KeyT decode(const type key) {
+    if (!FLIP_SIGN) { return KeyT(key); }
+    return KeyT(unsigned_type(key) ^ (unsigned_type(1) << (sizeof(type) * 8 - 1)));
+  }
+};
+
+// the simd_block_count_less_*() functions count the keys in keys[0, count) 
+// that are smaller than key with a single comparison.
+// a whole register is loaded from keys, so it must be readable up to the register width,
+// and count must not exceed the number of keys in a register.
+
+static size_t simd_block_count_less_sse2(const int32_t *keys, const int32_t key, const size_t count) {
+  __m128i xmm_mask = _mm_cmpgt_epi32(_mm_set1_epi32(key), _mm_loadu_si128((const __m128i*)keys));
+  unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(xmm_mask));
+  return __builtin_popcount(mask & ((1u << count) - 1));
+}
+
+// SSE2 has no 64-bit comparison, and SSE4.2 adds one.
+// CPUs without SSE4.2 compare the keys one by one.
+static bool simd_supports_sse42() {
+  return __builtin_cpu_supports("sse4.2");
+}
+
+__attribute__((target("sse4.2")))
+static size_t simd_block_count_less_sse42(const int64_t *keys, const int64_t key, const size_t count) {
+  __m128i xmm_mask = _mm_cmpgt_epi64(_mm_set1_epi64x(key), _mm_loadu_si128((const __m128i*)keys));
+  unsigned mask = _mm_movemask_pd(_mm_castsi128_pd(xmm_mask));
+  return __builtin_popcount(mask & ((1u << count) - 1));
+}
+
+static size_t simd_block_count_less_sse2(const int64_t *keys, const int64_t key, const size_t count) {
+  if (simd_supports_sse42()) {
+    return simd_block_count_less_sse42(keys, key, count);
+  }
+  size_t result = 0;
+  for (size_t i = 0; i < count; ++i) {
+    result += (keys[i] < key);
+  }
+  return result;
+}
+
+// instruction set that the simd_block_count_less_*() functions use with registers of simd_width bytes
+// and keys of key_size bytes.
+static const char* simd_block_search_name(const size_t simd_width, const size_t key_size) {
+  if (simd_width == AVX512_WIDTH) { return "avx512"; }
+  if (simd_width == AVX2_WIDTH) { return "avx2"; }
+  if (key_size == 8) { return simd_supports_sse42() ? "sse4.2" : "scalar (no 64-bit sse2 comparison)"; }
+  return "sse2";
+}
+
+__attribute__((target("avx2")))
+static size_t simd_block_count_less_avx2(const int32_t *keys, const int32_t key, const size_t count) {
+  __m256i ymm_mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(key), _mm256_loadu_si256((const __m256i*)keys));
+  unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(ymm_mask));
+  return __builtin_popcount(mask & ((1u << count) - 1));
+}
+
+__attribute__((target("avx2")))
+static size_t simd_block_count_less_avx2(const int64_t *keys, const int64_t key, const size_t count) {
+  __m256i ymm_mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(key), _mm256_loadu_si256((const __m256i*)keys));
+  unsigned mask = _mm256_movemask_pd(_mm256_castsi256_pd(ymm_mask));
+  return __builtin_popcount(mask & ((1u << count) - 1));
+}
+
+__attribute__((target("avx512f")))
+static size_t simd_block_count_less_avx512(const int32_t *keys, const int32_t key, const size_t count) {
+  unsigned mask = _mm512_cmpgt_epi32_mask(_mm512_set1_epi32(key), _mm512_loadu_si512((const void*)keys));
+  return __builtin_popcount(mask & ((1u << count) - 1));
+}
+
+__attribute__((target("avx512f")))
+static size_t simd_block_count_less_avx512(const int64_t *keys, const int64_t key, const size_t count) {
+  unsigned mask = _mm512_cmpgt_epi64_mask(_mm512_set1_epi64(key), _mm512_loadu_si512((const void*)keys));
+  return __builtin_popcount(mask & ((1u << count) - 1));
+}
+
+// bit-packed streams store values of width bits back to back, starting at a byte.
+// all readers may load up to BIT_PACKED_PADDING bytes past the last value, 
+// so streams must be allocated with that much padding.
+static const size_t BIT_PACKED_PADDING = 128; // unit: byte
+
+// the value at bit offset of the stream. width is at most 64.
+static uint64_t bit_unpack(const char *stream, const uint64_t bit_offset, const size_t width) {
+  const char *data = stream + (bit_offset >> 3);
+  const size_t shift = bit_offset & 7;
+
+  uint64_t word;
+  memcpy(&word, data, sizeof(word));
+  uint64_t value = word >> shift;
+  if (shift + width > 64) {
+    value |= uint64_t(uint8_t(data[8])) << (64 - shift);
+  }
+  return width == 64 ? value : value & ((uint64_t(1) << width) - 1);
+}
+
+// the bit_packed_count_less_*() functions count the values in a bit-packed run of count values 
+// that are smaller than target. the values must be sorted, so the result is also the lower bound of target.
+// vectors of values are unpacked with gathers, and the scan stops at the first vector holding a value 
+// that is not smaller than target.
+
+static size_t bit_packed_count_less_scalar(const char *stream, const size_t width, const uint64_t target, const size_t count) {
+  size_t base = 0;
+  size_t length = count;
+  while (length > 0) {
+    size_t half = length / 2;
+    if (bit_unpack(stream, (base + half) * width, width) < target) {
+      base += half + 1;
+      length -= half + 1;
+    } else {
+      length = half;
+    }
+  }
+  return base;
+}
+
+// 8 values per step. a 4-byte gather covers a value of up to 25 bits at any bit shift.
+__attribute__((target("avx2")))
+static size_t bit_packed_count_less_avx2_32(const char *stream, const size_t width, const uint64_t target, const size_t count) {
+  const __m256i ymm_target = _mm256_set1_epi32(int32_t(std::min(target, uint64_t(1) << width)));
+  const __m256i ymm_mask = _mm256_set1_epi32(int32_t((uint64_t(1) << width) - 1));
+  const __m256i ymm_step = _mm256_set1_epi32(int32_t(8 * width));
+  __m256i ymm_bits = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(int32_t(width)));
+
+  size_t result = 0;
+  for (size_t i = 0; i < count; i += 8) {
+    __m256i ymm_values = _mm256_i32gather_epi32((const int*)stream, _mm256_srli_epi32(ymm_bits, 3), 1);
+    ymm_values = _mm256_and_si256(_mm256_srlv_epi32(ymm_values, _mm256_and_si256(ymm_bits, _mm256_set1_epi32(7))), ymm_mask);
+
+    unsigned less = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(ymm_target, ymm_values)));
+    size_t lanes = std::min(count - i, size_t(8));
+    less &= (1u << lanes) - 1;
+    result += __builtin_popcount(less);
+    if (less != (1u << lanes) - 1) {
+      break;
+    }
+    ymm_bits = _mm256_add_epi32(ymm_bits, ymm_step);
+  }
+  return result;
+}
+
+// 4 values per step. an 8-byte gather covers a value of up to 57 bits at any bit shift.
+__attribute__((target("avx2")))
+static size_t bit_packed_count_less_avx2_64(const char *stream, const size_t width, const uint64_t target, const size_t count) {
+  const __m256i ymm_target = _mm256_set1_epi64x(int64_t(std::min(target, uint64_t(1) << width)));
+  const __m256i ymm_mask = _mm256_set1_epi64x(int64_t((uint64_t(1) << width) - 1));
+  const __m256i ymm_step = _mm256_set1_epi64x(int64_t(4 * width));
+  __m256i ymm_bits = _mm256_setr_epi64x(0, width, 2 * width, 3 * width);
+
+  size_t result = 0;
+  for (size_t i = 0; i < count; i += 4) {
+    __m256i ymm_values = _mm256_i64gather_epi64((const long long*)stream, _mm256_srli_epi64(ymm_bits, 3), 1);
+    ymm_values = _mm256_and_si256(_mm256_srlv_epi64(ymm_values, _mm256_and_si256(ymm_bits, _mm256_set1_epi64x(7))), ymm_mask);
+
+    unsigned less = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(ymm_target, ymm_values)));
+    size_t lanes = std::min(count - i, size_t(4));
+    less &= (1u << lanes) - 1;
+    result += __builtin_popcount(less);
+    if (less != (1u << lanes) - 1) {
+      break;
+    }
+    ymm_bits = _mm256_add_epi64(ymm_bits, ymm_step);
+  }
+  return result;
+}
+
+// picks the widest unpacking that fits width. with simd disabled, or wider values, 
+// the run is binary searched with scalar unpacking instead.
+static size_t bit_packed_count_less(const char *stream, const size_t width, const uint64_t target, const size_t count, const bool use_simd) {
+  if (width == 0) {
+    return target > 0 ? count : 0;
+  }
+  if (use_simd && width <= 25) {
+    return bit_packed_count_less_avx2_32(stream, width, target, count);
+  }
+  if (use_simd && width <= 57) {
+    return bit_packed_count_less_avx2_64(stream, width, target, count);
+  }
+  return bit_packed_count_less_scalar(stream, width, target, count);
+}
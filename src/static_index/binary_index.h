@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 #include <cmath>
 
 #include "base_static_index.h"
@@ -10,17 +11,19 @@ namespace static_index {
 template<typename KeyT, typename ValueT>
 class BinaryIndex : public BaseStaticIndex<KeyT, ValueT> {
 
+  typedef typename BaseStaticIndex<KeyT, ValueT>::InnerLayerTask InnerLayerTask;
+
 public:
-  BinaryIndex(DataTable<KeyT, ValueT> *table_ptr, const size_t num_layers) : BaseStaticIndex<KeyT, ValueT>(table_ptr), num_layers_(num_layers) {}
+  BinaryIndex(DataTable<KeyT, ValueT> *table_ptr, const size_t num_layers, const LayoutType layout = LayoutType::AoSLayout) : BaseStaticIndex<KeyT, ValueT>(table_ptr, layout), num_layers_(num_layers), inner_nodes_(nullptr) {}
 
   virtual ~BinaryIndex() {
-    if (num_layers_ != 0) {
-      delete[] inner_nodes_;
+    if (num_layers_ != 0 && !this->is_image()) {
+      huge_page_delete_array(inner_nodes_);
       inner_nodes_ = nullptr;
     }
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {
+  virtual void find(const KeyT &key, ResultSink &values) final {
 
     if (this->size_ == 0) {
       return;
@@ -32,7 +35,7 @@ public:
     if (key_max_ == key_min_) {
       if (key_max_ == key) {
         for (size_t i = 0; i < this->size_; ++i) {
-          values.push_back(this->container_[i].value_);
+          if (!this->push_values(i, values)) { return; }
         }
       }
       return;
@@ -40,10 +43,11 @@ public:
 
     size_t offset_find = this->size_;
     std::pair<int, int> offset_range = find_inner_layers(key);
-    if (offset_range.first == offset_range.second) {
+    // a range of one entry may also be a leaf range that does not hold key
+    if (offset_range.first == offset_range.second && this->key_at(offset_range.first) == key) {
       offset_find = offset_range.first;
     } else {
-      offset_find = find_internal(key, offset_range.first, offset_range.second);
+      offset_find = this->find_leaf(key, offset_range.first, offset_range.second);
     }
 
     if (offset_find == this->size_) {
@@ -51,34 +55,49 @@ public:
       return;
     }
 
-    values.push_back(this->container_[offset_find].value_);
+    this->collect_values(key, offset_find, values);
+  }
 
-    // move left
-    int offset_find_lhs = offset_find - 1;
-    while (offset_find_lhs >= 0) {
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
 
-      if (this->container_[offset_find_lhs].key_ == key) {
-        values.push_back(this->container_[offset_find_lhs].value_);
-        offset_find_lhs -= 1;
-      } else {
-        break;
-      }
+    if (this->size_ == 0) {
+      return;
     }
-    // move right
-    int offset_find_rhs = offset_find + 1;
-    while (offset_find_rhs <= this->size_ - 1) {
 
-      if (this->container_[offset_find_rhs].key_ == key) {
-        values.push_back(this->container_[offset_find_rhs].value_);
-        offset_find_rhs += 1;
-      } else {
-        break;
+    int offset_begins[PREFETCH_GROUP_SIZE];
+    int offset_ends[PREFETCH_GROUP_SIZE];
+    size_t offsets[PREFETCH_GROUP_SIZE];
+
+    for (size_t group_begin = 0; group_begin < count; group_begin += PREFETCH_GROUP_SIZE) {
+
+      const KeyT *group_keys = keys + group_begin;
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, count - group_begin);
+
+      // inner layers are small and likely to be cached
+      for (size_t i = 0; i < group_size; ++i) {
+        if (group_keys[i] > key_max_ || group_keys[i] < key_min_) {
+          offset_begins[i] = 0;
+          offset_ends[i] = -1;
+          continue;
+        }
+        std::pair<int, int> offset_range = find_inner_layers(group_keys[i]);
+        offset_begins[i] = offset_range.first;
+        offset_ends[i] = std::min(offset_range.second, int(this->size_ - 1));
+      }
+
+      this->find_internal_batch(group_keys, group_size, offset_begins, offset_ends, offsets);
+
+      for (size_t i = 0; i < group_size; ++i) {
+        if (offsets[i] != this->size_) {
+          this->collect_values(group_keys[i], offsets[i], values[group_begin + i]);
+        }
       }
     }
   }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
-    assert(lhs_key < rhs_key);
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
 
     if (this->size_ == 0) {
       return;
@@ -87,23 +106,32 @@ public:
       return;
     }
 
-  }
+    if (lhs_key <= key_min_) {
+      this->collect_range(lhs_key, rhs_key, 0, -1, values);
+      return;
+    }
+
+    // locate the lower bound through the inner layers
+    std::pair<int, int> offset_range = find_inner_layers(lhs_key);
 
-  virtual void reorganize() final {
+    this->collect_range(lhs_key, rhs_key, offset_range.first, offset_range.second, values);
+  }
 
-    this->base_reorganize();
+  virtual void reorganize(const size_t thread_count) final {
 
     inner_node_count_ = std::pow(2.0, num_layers_) - 1;
 
+    this->base_reorganize(thread_count, inner_node_count_);
+
     ASSERT(inner_node_count_ < this->size_, "exceed maximum layers");
 
-    key_min_ = this->container_[0].key_;
-    key_max_ = this->container_[this->size_ - 1].key_;
+    key_min_ = this->key_at(0);
+    key_max_ = this->key_at(this->size_ - 1);
     
     if (num_layers_ != 0) {
 
-      inner_nodes_ = new KeyT[inner_node_count_];
-      construct_inner_layers();
+      inner_nodes_ = huge_page_new_array<KeyT>(inner_node_count_);
+      construct_inner_layers(thread_count);
 
     } else {
       inner_nodes_ = nullptr;
@@ -121,57 +149,91 @@ public:
     }
   }
 
+protected:
+
+  virtual void serialize_inner(IndexImageWriter &writer) const final {
+    writer.write_value(uint64_t(num_layers_));
+    if (num_layers_ != 0) {
+      writer.write_array(inner_nodes_, inner_node_count_);
+    }
+  }
+
+  virtual bool load_inner(IndexImageReader &reader) final {
+
+    if (reader.read_value<uint64_t>() != num_layers_) {
+      return false;
+    }
+
+    inner_node_count_ = std::pow(2.0, num_layers_) - 1;
+
+    key_min_ = this->key_at(0);
+    key_max_ = this->key_at(this->size_ - 1);
+
+    inner_nodes_ = nullptr;
+    if (num_layers_ != 0) {
+      size_t count = 0;
+      inner_nodes_ = reader.read_array<KeyT>(count);
+      return count == inner_node_count_;
+    }
+    return true;
+  }
+
 private: 
 
-  void construct_inner_layers() {
+  void construct_inner_layers(const size_t thread_count) {
     ASSERT (num_layers_ != 0, "number of layers cannot be 0");
 
     size_t begin_offset = 0;
     size_t end_offset = this->size_ - 1;
     size_t mid_offset = (begin_offset + end_offset) / 2;
     
-    inner_nodes_[0] = this->container_[mid_offset].key_;
+    inner_nodes_[0] = this->key_at(mid_offset);
     if (num_layers_ == 1) { return; }
 
+    // subtrees rooted at task_layer do not overlap, so they are built in parallel.
+    size_t task_layer = num_layers_;
+    if (thread_count > 1) {
+      task_layer = 1;
+      while (task_layer + 1 < num_layers_ && std::pow(2.0, task_layer) < thread_count * 4) {
+        ++task_layer;
+      }
+    }
+
+    std::vector<InnerLayerTask> tasks;
+
     size_t base_pos = 1;
     size_t next_layer = 1;
-    construct_inner_layers_internal(begin_offset, mid_offset - 1, base_pos, 0, next_layer);
-    construct_inner_layers_internal(mid_offset + 1, end_offset, base_pos, 1, next_layer);
+    construct_inner_layers_internal(begin_offset, mid_offset - 1, base_pos, 0, next_layer, task_layer, tasks);
+    construct_inner_layers_internal(mid_offset + 1, end_offset, base_pos, 1, next_layer, task_layer, tasks);
+
+    this->run_inner_layer_tasks(tasks, thread_count, [&](const InnerLayerTask &task) {
+      construct_inner_layers_internal(task.begin_offset_, task.end_offset_, task.base_pos_, task.dst_pos_, task.layer_, num_layers_, tasks);
+    });
   }
 
-  void construct_inner_layers_internal(const int begin_offset, const int end_offset, const size_t base_pos, const size_t dst_pos, const size_t curr_layer) {
+  // build the subtree rooted at inner node (base_pos + dst_pos).
+  // subtrees rooted at task_layer are not built, but appended to tasks.
+  void construct_inner_layers_internal(const int begin_offset, const int end_offset, const size_t base_pos, const size_t dst_pos, const size_t curr_layer, const size_t task_layer, std::vector<InnerLayerTask> &tasks) {
     if (begin_offset > end_offset) { return; }
 
+    if (curr_layer == task_layer) {
+      tasks.emplace_back(begin_offset, end_offset, base_pos, dst_pos, curr_layer);
+      return;
+    }
+
     size_t mid_offset = (begin_offset + end_offset) / 2;
   
     ASSERT(base_pos + dst_pos < inner_node_count_, 
       "out of array: " << (base_pos + dst_pos) << " " << inner_node_count_);
 
-    inner_nodes_[base_pos + dst_pos] = this->container_[mid_offset].key_;
+    inner_nodes_[base_pos + dst_pos] = this->key_at(mid_offset);
 
     if (num_layers_ == curr_layer + 1) { return; }
 
     size_t new_base_pos = (base_pos + 1) * 2 - 1;
 
-    construct_inner_layers_internal(begin_offset, mid_offset - 1, new_base_pos, dst_pos * 2, curr_layer + 1);
-    construct_inner_layers_internal(mid_offset + 1, end_offset, new_base_pos, dst_pos * 2 + 1, curr_layer + 1);
-  }
-
-  // find in leaf nodes, simple binary search
-  size_t find_internal(const KeyT &key, const int offset_begin, const int offset_end) {
-    if (offset_begin > offset_end) {
-      return this->size_;
-    }
-    int offset_lookup = (offset_begin + offset_end) / 2;
-    KeyT key_lookup = this->container_[offset_lookup].key_;
-    if (key == key_lookup) {
-      return offset_lookup;
-    }
-    if (key > key_lookup) {
-      return find_internal(key, offset_lookup + 1, offset_end);
-    } else {
-      return find_internal(key, offset_begin, offset_lookup - 1);
-    }
+    construct_inner_layers_internal(begin_offset, mid_offset - 1, new_base_pos, dst_pos * 2, curr_layer + 1, task_layer, tasks);
+    construct_inner_layers_internal(mid_offset + 1, end_offset, new_base_pos, dst_pos * 2 + 1, curr_layer + 1, task_layer, tasks);
   }
 
   // find in inner nodes
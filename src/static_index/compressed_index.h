@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "base_static_index.h"
+
+namespace static_index {
+
+// a static index that keeps the sorted entries compressed, and drops the full-width entries of the base index.
+// keys are split into blocks of block_size_ entries. each block stores its first key in full,
+// and the offsets of its keys from that key in a frame of reference of the smallest width that fits them.
+// values are offsets into the data table, numbered densely by tuple and packed to the width of the largest number.
+// a lookup binary searches the first keys of the blocks, and unpacks only the block that may hold the key.
+template<typename KeyT, typename ValueT>
+class CompressedIndex : public BaseStaticIndex<KeyT, ValueT> {
+
+public:
+  // block_size must be a power of 2. the layout only affects how the entries are sorted while building.
+  CompressedIndex(DataTable<KeyT, ValueT> *table_ptr, const int block_size = -1, const LayoutType layout = LayoutType::AoSLayout) :
+    BaseStaticIndex<KeyT, ValueT>(table_ptr, layout),
+    block_size_(block_size > 0 ? block_size : DEFAULT_BLOCK_SIZE), block_shift_(__builtin_ctzll(block_size_)), block_count_(0),
+    block_keys_(nullptr), block_offsets_(nullptr), block_widths_(nullptr), key_stream_(nullptr), key_stream_size_(0),
+    value_stream_(nullptr), value_stream_size_(0), value_width_(0), table_block_capacity_(0),
+    use_simd_(__builtin_cpu_supports("avx2")) {
+
+    ASSERT((block_size_ & (block_size_ - 1)) == 0, "block size must be a power of 2: " << block_size_);
+
+    // every entry is packed on its own
+    this->use_value_runs_ = false;
+  }
+
+  virtual ~CompressedIndex() {
+    if (!this->is_image()) {
+      huge_page_delete_array(block_keys_);
+      huge_page_delete_array(block_offsets_);
+      huge_page_delete_array(block_widths_);
+      huge_page_delete_array(key_stream_);
+      huge_page_delete_array(value_stream_);
+    }
+    block_keys_ = nullptr;
+    block_offsets_ = nullptr;
+    block_widths_ = nullptr;
+    key_stream_ = nullptr;
+    value_stream_ = nullptr;
+  }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    for (size_t offset = lower_bound_entry(key); offset < this->size_ && entry_key(offset) == key; ++offset) {
+      if (!values.push_back(entry_value(offset))) { return; }
+    }
+  }
+
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    size_t blocks[PREFETCH_GROUP_SIZE];
+
+    for (size_t group_begin = 0; group_begin < count; group_begin += PREFETCH_GROUP_SIZE) {
+
+      const KeyT *group_keys = keys + group_begin;
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, count - group_begin);
+
+      // the blocks of all lookups are prefetched before any of them is unpacked.
+      for (size_t i = 0; i < group_size; ++i) {
+        blocks[i] = lower_bound_block(group_keys[i]);
+        if (blocks[i] != 0) {
+          __builtin_prefetch(key_stream_ + block_offsets_[blocks[i] - 1]);
+        }
+      }
+
+      for (size_t i = 0; i < group_size; ++i) {
+        for (size_t offset = lower_bound_entry(group_keys[i], blocks[i]); offset < this->size_ && entry_key(offset) == group_keys[i]; ++offset) {
+          if (!values[group_begin + i].push_back(entry_value(offset))) { break; }
+        }
+      }
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    for (size_t offset = lower_bound_entry(lhs_key); offset < this->size_ && !(rhs_key < entry_key(offset)); ++offset) {
+      if (!values.push_back(entry_value(offset))) { return; }
+    }
+  }
+
+  virtual void scan(const KeyT &key, ResultSink &values) final {
+    find(key, values);
+  }
+
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) final {
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    size_t begin = lower_bound_entry(key);
+    size_t end = begin;
+    while (end < this->size_ && entry_key(end) == key) {
+      ++end;
+    }
+    for (size_t offset = end; offset > begin; --offset) {
+      if (!values.push_back(entry_value(offset - 1))) { return; }
+    }
+  }
+
+  virtual void scan_full(ResultSink &values, const size_t count) final {
+    size_t bound = std::min(count, this->size_);
+    for (size_t offset = 0; offset < bound; ++offset) {
+      if (!values.push_back(entry_value(offset))) { return; }
+    }
+  }
+
+  virtual void export_entries(typename BaseStaticIndex<KeyT, ValueT>::KeyValuePair *entries) const final {
+    for (size_t offset = 0; offset < this->size_; ++offset) {
+      entries[offset].key_ = entry_key(offset);
+      entries[offset].value_ = entry_value(offset);
+    }
+  }
+
+  virtual void reorganize(const size_t thread_count) final {
+
+    this->base_reorganize(thread_count);
+
+    table_block_capacity_ = this->table_ptr_->get_max_block_capacity();
+
+    if (this->size_ != 0) {
+      compress_keys(thread_count);
+      compress_values(thread_count);
+    }
+
+    // the entries are only served from the compressed blocks from now on.
+    this->release_entries();
+  }
+
+  virtual void print() const final {
+    size_t width_sum = 0;
+    for (size_t block_id = 0; block_id < block_count_; ++block_id) {
+      width_sum += block_widths_[block_id];
+    }
+    std::cout << "number of blocks = " << block_count_ << ", block size = " << block_size_ << std::endl;
+    std::cout << "average key width = " << (block_count_ == 0 ? 0 : width_sum * 1.0 / block_count_) << " bits"
+              << ", value width = " << value_width_ << " bits" << std::endl;
+    std::cout << "compressed size = " << compressed_size() << " bytes, "
+              << compressed_size() * 1.0 / std::max(this->size_, size_t(1)) << " bytes per key"
+              << " (uncompressed: " << sizeof(KeyT) + sizeof(Uint64) << " bytes per key)" << std::endl;
+  }
+
+  // size of the blocks and the packed keys and values. unit: byte
+  size_t compressed_size() const {
+    return block_count_ * (sizeof(KeyT) + sizeof(uint64_t) + sizeof(uint8_t)) + key_stream_size_ + value_stream_size_;
+  }
+
+  void set_simd_unpack(const bool use_simd) {
+    use_simd_ = use_simd && __builtin_cpu_supports("avx2");
+  }
+
+protected:
+
+  virtual void serialize_inner(IndexImageWriter &writer) const final {
+    writer.write_value(uint64_t(block_size_));
+    writer.write_value(uint64_t(value_width_));
+    writer.write_value(uint64_t(table_block_capacity_));
+    if (this->size_ != 0) {
+      writer.write_array(block_keys_, block_count_);
+      writer.write_array(block_offsets_, block_count_);
+      writer.write_array(block_widths_, block_count_);
+      writer.write_array(key_stream_, key_stream_size_ + BIT_PACKED_PADDING);
+      writer.write_array(value_stream_, value_stream_size_ + BIT_PACKED_PADDING);
+    }
+  }
+
+  virtual bool load_inner(IndexImageReader &reader) final {
+    if (reader.read_value<uint64_t>() != block_size_) {
+      return false;
+    }
+    value_width_ = reader.read_value<uint64_t>();
+    table_block_capacity_ = reader.read_value<uint64_t>();
+    if (table_block_capacity_ != this->table_ptr_->get_max_block_capacity()) {
+      return false;
+    }
+    if (this->size_ == 0) {
+      return true;
+    }
+
+    block_count_ = (this->size_ + block_size_ - 1) >> block_shift_;
+
+    size_t counts[5];
+    block_keys_ = reader.read_array<KeyT>(counts[0]);
+    block_offsets_ = reader.read_array<uint64_t>(counts[1]);
+    block_widths_ = reader.read_array<uint8_t>(counts[2]);
+    key_stream_ = reader.read_array<char>(counts[3]);
+    value_stream_ = reader.read_array<char>(counts[4]);
+
+    key_stream_size_ = counts[3] - BIT_PACKED_PADDING;
+    value_stream_size_ = counts[4] - BIT_PACKED_PADDING;
+
+    return counts[0] == block_count_ && counts[1] == block_count_ && counts[2] == block_count_ &&
+           counts[3] >= BIT_PACKED_PADDING && counts[4] >= BIT_PACKED_PADDING;
+  }
+
+private:
+
+  // bits needed to store value.
+  static size_t bit_width(const uint64_t value) {
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+  }
+
+  // blocks start on a byte, and their keys are packed in parallel.
+  void compress_keys(const size_t thread_count) {
+
+    block_count_ = (this->size_ + block_size_ - 1) >> block_shift_;
+
+    block_keys_ = huge_page_new_array<KeyT>(block_count_);
+    block_offsets_ = huge_page_new_array<uint64_t>(block_count_);
+    block_widths_ = huge_page_new_array<uint8_t>(block_count_);
+
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      for (size_t block_id = block_count_ * thread_id / thread_count; block_id < block_count_ * (thread_id + 1) / thread_count; ++block_id) {
+        size_t begin = block_id << block_shift_;
+        size_t end = std::min(begin + block_size_, this->size_);
+        block_keys_[block_id] = this->key_at(begin);
+        block_widths_[block_id] = bit_width(uint64_t(this->key_at(end - 1)) - uint64_t(this->key_at(begin)));
+      }
+    });
+
+    key_stream_size_ = 0;
+    for (size_t block_id = 0; block_id < block_count_; ++block_id) {
+      size_t length = std::min(block_size_, this->size_ - (block_id << block_shift_));
+      block_offsets_[block_id] = key_stream_size_;
+      key_stream_size_ += (length * block_widths_[block_id] + 7) / 8;
+    }
+
+    key_stream_ = huge_page_new_array<char>(key_stream_size_ + BIT_PACKED_PADDING);
+    memset(key_stream_, 0, key_stream_size_ + BIT_PACKED_PADDING);
+
+    // blocks do not share bytes, so each thread packs its blocks on its own.
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      for (size_t block_id = block_count_ * thread_id / thread_count; block_id < block_count_ * (thread_id + 1) / thread_count; ++block_id) {
+        size_t begin = block_id << block_shift_;
+        size_t end = std::min(begin + block_size_, this->size_);
+        char *stream = key_stream_ + block_offsets_[block_id];
+        for (size_t offset = begin; offset < end; ++offset) {
+          bit_pack(stream, (offset - begin) * block_widths_[block_id], block_widths_[block_id], uint64_t(this->key_at(offset)) - uint64_t(block_keys_[block_id]));
+        }
+      }
+    });
+  }
+
+  // values are numbered by the position of their tuple in the data table.
+  // the threads pack ranges of a multiple of 8 values, which end on a byte.
+  void compress_values(const size_t thread_count) {
+
+    // the entries may come from reorganize_from(), so the width follows the largest number among them.
+    std::vector<uint64_t> max_tuple_ids(thread_count, 0);
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      uint64_t max_tuple_id = 0;
+      for (size_t offset = this->size_ * thread_id / thread_count; offset < this->size_ * (thread_id + 1) / thread_count; ++offset) {
+        OffsetT tuple_offset(this->value_at(offset));
+        max_tuple_id = std::max(max_tuple_id, uint64_t(tuple_offset.block_id() * table_block_capacity_ + tuple_offset.rel_offset()));
+      }
+      max_tuple_ids[thread_id] = max_tuple_id;
+    });
+
+    value_width_ = bit_width(*std::max_element(max_tuple_ids.begin(), max_tuple_ids.end()));
+
+    value_stream_size_ = (this->size_ * value_width_ + 7) / 8;
+    value_stream_ = huge_page_new_array<char>(value_stream_size_ + BIT_PACKED_PADDING);
+    memset(value_stream_, 0, value_stream_size_ + BIT_PACKED_PADDING);
+
+    size_t group_count = (this->size_ + 7) / 8;
+
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      size_t begin = group_count * thread_id / thread_count * 8;
+      size_t end = std::min(group_count * (thread_id + 1) / thread_count * 8, this->size_);
+      for (size_t offset = begin; offset < end; ++offset) {
+        OffsetT tuple_offset(this->value_at(offset));
+        bit_pack(value_stream_, offset * value_width_, value_width_, tuple_offset.block_id() * table_block_capacity_ + tuple_offset.rel_offset());
+      }
+    });
+  }
+
+  // or value into the zeroed stream at bit offset, a byte at a time.
+  static void bit_pack(char *stream, const uint64_t bit_offset, const size_t width, uint64_t value) {
+    unsigned char *data = reinterpret_cast<unsigned char*>(stream) + (bit_offset >> 3);
+    size_t shift = bit_offset & 7;
+    for (size_t bits = 0; bits < width + shift; bits += 8) {
+      *data++ |= (unsigned char)(bits == 0 ? value << shift : value >> (bits - shift));
+    }
+  }
+
+  // the first block whose first key is not smaller than key, or block_count_ if there is none.
+  size_t lower_bound_block(const KeyT &key) const {
+    size_t base = 0;
+    size_t length = block_count_;
+    while (length > 1) {
+      size_t half = length / 2;
+      base = (block_keys_[base + half - 1] < key) ? base + half : base;
+      length -= half;
+    }
+    return base + (block_keys_[base] < key);
+  }
+
+  // offset of the first entry whose key is not smaller than key, or size_ if there is none,
+  // given the lower bound block of key. the entry is in the block before it, or starts it.
+  size_t lower_bound_entry(const KeyT &key, const size_t block) const {
+    if (block == 0) {
+      return 0;
+    }
+    size_t block_id = block - 1;
+    size_t begin = block_id << block_shift_;
+    size_t length = std::min(block_size_, this->size_ - begin);
+    return begin + bit_packed_count_less(key_stream_ + block_offsets_[block_id], block_widths_[block_id],
+                                         uint64_t(key) - uint64_t(block_keys_[block_id]), length, use_simd_);
+  }
+
+  size_t lower_bound_entry(const KeyT &key) const {
+    return lower_bound_entry(key, lower_bound_block(key));
+  }
+
+  KeyT entry_key(const size_t offset) const {
+    size_t block_id = offset >> block_shift_;
+    size_t width = block_widths_[block_id];
+    return KeyT(uint64_t(block_keys_[block_id]) + bit_unpack(key_stream_ + block_offsets_[block_id], (offset & (block_size_ - 1)) * width, width));
+  }
+
+  Uint64 entry_value(const size_t offset) const {
+    uint64_t tuple_id = bit_unpack(value_stream_, offset * value_width_, value_width_);
+    return OffsetT::construct_raw_data(tuple_id / table_block_capacity_, tuple_id % table_block_capacity_);
+  }
+
+private:
+
+  static const size_t DEFAULT_BLOCK_SIZE = 64;
+
+  const size_t block_size_;
+  const size_t block_shift_;
+  size_t block_count_;
+
+  // first key, byte offset into key_stream_, and key width of each block
+  KeyT *block_keys_;
+  uint64_t *block_offsets_;
+  uint8_t *block_widths_;
+
+  // keys of each block, minus its first key. unit of the size: byte
+  char *key_stream_;
+  size_t key_stream_size_;
+
+  // tuple numbers of all entries, value_width_ bits each. unit of the size: byte
+  char *value_stream_;
+  size_t value_stream_size_;
+  size_t value_width_;
+
+  // tuples per data block of the table that the values were numbered with
+  size_t table_block_capacity_;
+
+  bool use_simd_;
+
+};
+
+}
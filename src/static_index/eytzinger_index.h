@@ -0,0 +1,198 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "base_static_index.h"
+
+namespace static_index {
+
+// a binary search tree over the entire key set, stored in Eytzinger (BFS) order:
+// node i has children 2i and 2i+1, and the root is node 1.
+// a lookup touches one node per level, and the 2^k descendants of a node k levels down
+// are adjacent in memory, so a single prefetch covers the node visited k steps later.
+// the sorted entries are kept by the base index to return values and serve ranges.
+template<typename KeyT, typename ValueT>
+class EytzingerIndex : public BaseStaticIndex<KeyT, ValueT> {
+
+  // number of keys in a cacheline. the descendants of node i that are
+  // log2(CACHELINE_KEYS) levels down start at node (i * CACHELINE_KEYS).
+  static const size_t CACHELINE_KEYS = 64 / sizeof(KeyT);
+
+public:
+  EytzingerIndex(DataTable<KeyT, ValueT> *table_ptr, const LayoutType layout = LayoutType::AoSLayout) :
+    BaseStaticIndex<KeyT, ValueT>(table_ptr, layout), tree_(nullptr), height_(0), last_level_count_(0) {}
+
+  virtual ~EytzingerIndex() {
+    if (!this->is_image()) {
+      huge_page_delete_array(tree_);
+    }
+    tree_ = nullptr;
+  }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    size_t node = lower_bound_node(key);
+
+    if (node == 0 || tree_[node] != key) {
+      // find nothing
+      return;
+    }
+
+    this->collect_values(key, node_rank(node), values);
+  }
+
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    size_t nodes[PREFETCH_GROUP_SIZE];
+
+    for (size_t group_begin = 0; group_begin < count; group_begin += PREFETCH_GROUP_SIZE) {
+
+      const KeyT *group_keys = keys + group_begin;
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, count - group_begin);
+
+      for (size_t i = 0; i < group_size; ++i) {
+        nodes[i] = 1;
+      }
+
+      // all lookups descend in lockstep, so that the cache misses of different lookups overlap.
+      // the last level may be incomplete, hence the extra step.
+      for (size_t level = 0; level <= height_; ++level) {
+        for (size_t i = 0; i < group_size; ++i) {
+          if (nodes[i] > this->size_) { continue; }
+          __builtin_prefetch(tree_ + nodes[i] * CACHELINE_KEYS);
+          nodes[i] = 2 * nodes[i] + (tree_[nodes[i]] < group_keys[i]);
+        }
+      }
+
+      for (size_t i = 0; i < group_size; ++i) {
+        size_t node = nodes[i] >> __builtin_ffsll(~nodes[i]);
+        if (node != 0 && tree_[node] == group_keys[i]) {
+          this->collect_values(group_keys[i], node_rank(node), values[group_begin + i]);
+        }
+      }
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    size_t node = lower_bound_node(lhs_key);
+    if (node == 0) {
+      return;
+    }
+
+    int64_t offset = node_rank(node);
+
+    this->collect_range(lhs_key, rhs_key, offset, offset - 1, values);
+  }
+
+  virtual void reorganize(const size_t thread_count) final {
+
+    this->base_reorganize(thread_count);
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    construct_levels();
+
+    // node 0 is unused
+    tree_ = huge_page_new_array<KeyT>(this->size_ + 1);
+    tree_[0] = KeyT();
+
+    // node ranks are computed directly, so nodes are filled in any order.
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      size_t begin = 1 + this->size_ * thread_id / thread_count;
+      size_t end = 1 + this->size_ * (thread_id + 1) / thread_count;
+      for (size_t node = begin; node < end; ++node) {
+        tree_[node] = this->key_at(node_rank(node));
+      }
+    });
+  }
+
+  virtual void print() const final {
+    for (size_t node = 1; node <= this->size_; ++node) {
+      std::cout << tree_[node] << " ";
+    }
+    std::cout << std::endl;
+  }
+
+protected:
+
+  virtual void serialize_inner(IndexImageWriter &writer) const final {
+    if (this->size_ != 0) {
+      writer.write_array(tree_, this->size_ + 1);
+    }
+  }
+
+  virtual bool load_inner(IndexImageReader &reader) final {
+    if (this->size_ == 0) {
+      return true;
+    }
+
+    construct_levels();
+
+    size_t count = 0;
+    tree_ = reader.read_array<KeyT>(count);
+    return count == this->size_ + 1;
+  }
+
+private:
+
+  // the last level holds the nodes [2^height_, size_]
+  void construct_levels() {
+    height_ = 63 - __builtin_clzll(this->size_);
+    last_level_count_ = this->size_ - (size_t(1) << height_) + 1;
+  }
+
+  // the node holding the first key that is not smaller than key, or 0 if there is none.
+  // each step moves to a child with a conditional move instead of a branch.
+  size_t lower_bound_node(const KeyT &key) const {
+    size_t node = 1;
+    while (node <= this->size_) {
+      __builtin_prefetch(tree_ + node * CACHELINE_KEYS);
+      node = 2 * node + (tree_[node] < key);
+    }
+    // strip the trailing right turns, and the last left turn.
+    return node >> __builtin_ffsll(~node);
+  }
+
+  // position of node in the sorted entries.
+  // the rank of node in a perfect tree of height_ levels is corrected by
+  // the number of missing last level nodes that precede it.
+  size_t node_rank(const size_t node) const {
+    size_t depth = 63 - __builtin_clzll(node);
+    size_t rank = ((2 * (node - (size_t(1) << depth)) + 1) << (height_ - depth)) - 1;
+    // last level nodes have even ranks in a perfect tree
+    size_t last_level_before = (rank + 1) / 2;
+    return rank - (last_level_before > last_level_count_ ? last_level_before - last_level_count_ : 0);
+  }
+
+private:
+
+  // tree_[1, size_] in BFS order. aligned to a cacheline.
+  KeyT *tree_;
+
+  // depth of the last level
+  size_t height_;
+
+  // number of nodes in the last level
+  size_t last_level_count_;
+
+};
+
+}
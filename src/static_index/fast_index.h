@@ -1,48 +1,102 @@
 #pragma once
 
 #include <vector>
-
-#include <emmintrin.h>
+#include <algorithm>
 
 #include "base_static_index.h"
 
 namespace static_index {
 
+// depth of a FAST node: the largest binary subtree of keys of key_size bytes that fits in a cacheline.
+static size_t fast_node_depth(const size_t key_size) {
+  return 63 - __builtin_clzll(64 / key_size);
+}
+
+// FAST: a binary tree over separator keys, blocked at three levels.
+// a SIMD block is a subtree that is searched with one SIMD comparison,
+// a node is a subtree of SIMD blocks that fills a cacheline,
+// and a page group is a subtree of nodes that does not straddle a page.
+// SIMD blocks hold 3 (4-byte keys) or 1 (8-byte keys) separators with SSE2, 7 or 3 with AVX2,
+// and 15 or 7 with AVX-512. the widest instruction set supported by the CPU is picked at runtime.
+// a node holds 15 (4-byte keys) or 7 (8-byte keys) separators whatever the register width,
+// so the SIMD blocks of its last level may be shallower than a register.
+// the number of layers must be a multiple of the node depth.
+// separators are stored with their sign bit flipped, so that unsigned keys
+// can be compared with the signed SIMD comparisons.
 template<typename KeyT, typename ValueT>
 class FastIndex : public BaseStaticIndex<KeyT, ValueT> {
 
-  // the FAST index paper assumes SIMD size is 128 bits.
-  // It is hard to extend its method to 256/512-bit SIMD
-  // as most computers' cacheline size is 64 bytes.
-  const size_t SIMD_SIZE = 16; // unit: byte (128 bits)
+  typedef typename SimdKey<KeyT>::type SignedKeyT;
+
+  static const size_t MAX_SIMD_LEVELS = 4;
+
   const size_t CACHELINE_SIZE = 64; // unit: byte
   const size_t PAGE_SIZE = 4096; // unit: byte (4 KB)
 
-  const size_t KEY_SIZE = 4; // FAST only support 4-byte keys.
-  const size_t SIMD_KEY_CAPACITY = 3; 
-  const size_t CACHELINE_KEY_CAPACITY = 15;
-  const size_t CACHELINE_DEPTH = 4;
-
+  // page groups of the same depth.
+  struct GroupLevel {
+    size_t depth_; // unit: node levels
+    size_t group_keys_; // size of a group. unit: keys
+    size_t groups_per_page_;
+    size_t page_base_; // first page of the groups
+  };
 
 public:
-  FastIndex(DataTable<KeyT, ValueT> *table_ptr, const size_t num_layers)
-    : BaseStaticIndex<KeyT, ValueT>(table_ptr)
-    , num_layers_(num_layers) {
+  // simd_width is the register width in bits (128, 256 or 512).
+  // it is lowered to what the CPU supports, and the widest supported register is used if it is unset.
+  FastIndex(DataTable<KeyT, ValueT> *table_ptr, const size_t num_layers, const int simd_width = -1, const LayoutType layout = LayoutType::AoSLayout)
+    : BaseStaticIndex<KeyT, ValueT>(table_ptr, layout)
+    , num_layers_(num_layers)
+    , inner_nodes_(nullptr)
+    , inner_size_(0) {
+
+    ASSERT(sizeof(KeyT) == 4 || sizeof(KeyT) == 8, "only support 4-byte and 8-byte keys");
+
+    simd_width_ = simd_max_width();
+    if (simd_width > 0) {
+      simd_width_ = std::max(SSE2_WIDTH, std::min(simd_width_, size_t(simd_width) / 8));
+    }
+
+    // the largest binary subtree that fits in a register
+    size_t simd_capacity = simd_width_ / sizeof(KeyT);
+    simd_depth_ = 63 - __builtin_clzll(simd_capacity + 1);
+
+    // the largest binary subtree that fits in a cacheline
+    node_depth_ = fast_node_depth(sizeof(KeyT));
+    node_fanout_ = size_t(1) << node_depth_;
+    node_stride_ = CACHELINE_SIZE / sizeof(KeyT);
+
+    ASSERT(num_layers_ % node_depth_ == 0, "number of layers must be a multiple of " << node_depth_);
+    node_levels_ = num_layers_ / node_depth_;
+
+    // SIMD levels are stored from the deepest one up. the top block then ends right before the end
+    // of the cacheline, and a whole register read from any block stays in the cacheline.
+    simd_levels_ = (node_depth_ + simd_depth_ - 1) / simd_depth_;
+    size_t simd_base = node_fanout_ - 1;
+    for (size_t simd_level = 0; simd_level < simd_levels_; ++simd_level) {
+      simd_level_depths_[simd_level] = std::min(simd_depth_, node_depth_ - simd_level * simd_depth_);
+      size_t level_keys = ((size_t(1) << simd_level_depths_[simd_level]) - 1) << (simd_depth_ * simd_level);
+      simd_base -= level_keys;
+      simd_level_bases_[simd_level] = simd_base;
+    }
 
-    ASSERT(sizeof(KeyT) == KEY_SIZE, "only support 4-byte keys");
+    // the deepest subtree of nodes that fits in a page
+    group_depth_ = 1;
+    while (level_node_count(group_depth_ + 1) * node_stride_ * sizeof(KeyT) <= PAGE_SIZE) {
+      ++group_depth_;
+    }
   }
 
   virtual ~FastIndex() {
-    if (num_layers_ != 0) {
-      delete[] inner_nodes_;
-      inner_nodes_ = nullptr;
-
-      delete num_cachelines_;
-      num_cachelines_ = nullptr;
+    if (!this->is_image()) {
+      huge_page_delete_array(inner_nodes_);
     }
+    inner_nodes_ = nullptr;
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {
+  size_t simd_width() const { return simd_width_ * 8; }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
 
     if (this->size_ == 0) {
       return;
@@ -54,7 +108,7 @@ public:
     if (key_max_ == key_min_) {
       if (key_max_ == key) {
         for (size_t i = 0; i < this->size_; ++i) {
-          values.push_back(this->container_[i].value_);
+          if (!this->push_values(i, values)) { return; }
         }
       }
       return;
@@ -62,10 +116,11 @@ public:
 
     size_t offset_find = this->size_;
     std::pair<int, int> offset_range = find_inner_layers(key);
-    if (offset_range.first == offset_range.second) {
+    // a range of one entry may also be a leaf range that does not hold key
+    if (offset_range.first == offset_range.second && this->key_at(offset_range.first) == key) {
       offset_find = offset_range.first;
     } else {
-      offset_find = find_internal(key, offset_range.first, offset_range.second);
+      offset_find = this->find_leaf(key, offset_range.first, offset_range.second);
     }
 
     if (offset_find == this->size_) {
@@ -73,34 +128,49 @@ public:
       return;
     }
 
-    values.push_back(this->container_[offset_find].value_);
+    this->collect_values(key, offset_find, values);
+  }
 
-    // move left
-    int offset_find_lhs = offset_find - 1;
-    while (offset_find_lhs >= 0) {
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
 
-      if (this->container_[offset_find_lhs].key_ == key) {
-        values.push_back(this->container_[offset_find_lhs].value_);
-        offset_find_lhs -= 1;
-      } else {
-        break;
-      }
+    if (this->size_ == 0) {
+      return;
     }
-    // move right
-    int offset_find_rhs = offset_find + 1;
-    while (offset_find_rhs <= this->size_ - 1) {
-
-      if (this->container_[offset_find_rhs].key_ == key) {
-        values.push_back(this->container_[offset_find_rhs].value_);
-        offset_find_rhs += 1;
-      } else {
-        break;
+
+    int offset_begins[PREFETCH_GROUP_SIZE];
+    int offset_ends[PREFETCH_GROUP_SIZE];
+    size_t offsets[PREFETCH_GROUP_SIZE];
+
+    for (size_t group_begin = 0; group_begin < count; group_begin += PREFETCH_GROUP_SIZE) {
+
+      const KeyT *group_keys = keys + group_begin;
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, count - group_begin);
+
+      // inner layers are small and likely to be cached
+      for (size_t i = 0; i < group_size; ++i) {
+        if (group_keys[i] > key_max_ || group_keys[i] < key_min_) {
+          offset_begins[i] = 0;
+          offset_ends[i] = -1;
+          continue;
+        }
+        std::pair<int, int> offset_range = find_inner_layers(group_keys[i]);
+        offset_begins[i] = offset_range.first;
+        offset_ends[i] = std::min(offset_range.second, int(this->size_ - 1));
+      }
+
+      this->find_internal_batch(group_keys, group_size, offset_begins, offset_ends, offsets);
+
+      for (size_t i = 0; i < group_size; ++i) {
+        if (offsets[i] != this->size_) {
+          this->collect_values(group_keys[i], offsets[i], values[group_begin + i]);
+        }
       }
     }
   }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
-    assert(lhs_key < rhs_key);
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
 
     if (this->size_ == 0) {
       return;
@@ -109,192 +179,277 @@ public:
       return;
     }
 
-  }
+    if (lhs_key <= key_min_) {
+      this->collect_range(lhs_key, rhs_key, 0, -1, values);
+      return;
+    }
 
-  virtual void reorganize() final {
+    // locate the lower bound through the inner layers
+    std::pair<int, int> offset_range = find_inner_layers(lhs_key);
 
-    this->base_reorganize();
+    this->collect_range(lhs_key, rhs_key, offset_range.first, offset_range.second, values);
+  }
 
-    size_t inner_node_size = std::pow(2.0, num_layers_) - 1;
+  virtual void reorganize(const size_t thread_count) final {
 
-    ASSERT(inner_node_size < this->size_, "exceed maximum layers");
+    size_t inner_node_size = std::pow(2.0, num_layers_) - 1;
 
-    cacheline_levels_ = num_layers_ / CACHELINE_DEPTH;
-    num_cachelines_ = new size_t[cacheline_levels_ + 1];
-    for (size_t i = 0; i < cacheline_levels_ + 1; ++i) {
-      num_cachelines_[i] = std::pow(16, i);
-    }
-    
-    lhs_offset_ = 0;
-    rhs_offset_ = this->size_ - 1 - this->size_ % num_cachelines_[cacheline_levels_];
+    this->base_reorganize(thread_count, inner_node_size);
 
-    last_level_step_ = (rhs_offset_ - lhs_offset_ + 1) / num_cachelines_[cacheline_levels_];
+    ASSERT(inner_node_size < this->size_, "exceed maximum layers");
 
-    key_min_ = this->container_[0].key_;
-    key_max_ = this->container_[this->size_ - 1].key_;
+    construct_levels();
 
-    if (num_layers_ != 0) {
+    if (node_levels_ != 0) {
 
-      size_t num_cachelines = inner_node_size / CACHELINE_KEY_CAPACITY;
-      inner_size_ = num_cachelines * CACHELINE_SIZE / sizeof(KeyT);
-      inner_nodes_ = new KeyT[inner_size_];
-      memset(inner_nodes_, 0, sizeof(KeyT) * inner_size_);
+      inner_nodes_ = huge_page_new_array<SignedKeyT>(inner_size_, PAGE_SIZE);
+      memset(inner_nodes_, 0, sizeof(SignedKeyT) * inner_size_);
 
-      construct_inner_layers();
-    } else {
-      inner_nodes_ = nullptr;
+      construct_inner_layers(thread_count);
     }
   }
 
   virtual void print() const final {
+    std::cout << "simd width = " << simd_width() << " bits (" << simd_block_search_name(simd_width_, sizeof(SignedKeyT)) << "), simd block depth = " << simd_depth_
+              << ", node depth = " << node_depth_ << ", node levels = " << node_levels_ << std::endl;
+
     if (inner_nodes_ != nullptr) {
       for (size_t i = 0; i < inner_size_; ++i) {
-        std::cout << inner_nodes_[i] << " ";
+        std::cout << SimdKey<KeyT>::decode(inner_nodes_[i]) << " ";
       }
       std::cout << std::endl;
     }
   }
 
+protected:
+
+  // the layout of the nodes depends on the register width, which the loading CPU must support.
+  virtual void serialize_inner(IndexImageWriter &writer) const final {
+    writer.write_value(uint64_t(num_layers_));
+    writer.write_value(uint64_t(simd_width_));
+    if (node_levels_ != 0) {
+      writer.write_array(inner_nodes_, inner_size_);
+    }
+  }
+
+  virtual bool load_inner(IndexImageReader &reader) final {
+
+    if (reader.read_value<uint64_t>() != num_layers_ || reader.read_value<uint64_t>() != simd_width_) {
+      return false;
+    }
+
+    construct_levels();
+
+    if (node_levels_ != 0) {
+      size_t count = 0;
+      inner_nodes_ = reader.read_array<SignedKeyT>(count);
+      return count == inner_size_;
+    }
+    return true;
+  }
+
 private:
 
-  void construct_inner_layers() {
-    ASSERT(num_layers_ != 0, "number of layers cannot be 0");
+  // number of nodes in the first levels of a subtree of nodes.
+  size_t level_node_count(const size_t levels) const {
+    return ((size_t(1) << (node_depth_ * levels)) - 1) / (node_fanout_ - 1);
+  }
 
-    // cacheline level 0
-    size_t current_pos = 0;
-    construct_cacheline_block(current_pos, lhs_offset_, rhs_offset_);
-    current_pos += 16; // cacheline size
+  // everything but the nodes themselves, which only depends on the number of entries.
+  void construct_levels() {
 
-    // cacheline level i
-    for (size_t i = 1; i < cacheline_levels_; ++i) {
-      size_t num_cachelines = std::pow(16, i);
-      size_t step = (rhs_offset_ - lhs_offset_ + 1) / num_cachelines;
+    last_level_step_ = this->size_ >> (node_depth_ * node_levels_);
 
-      for (size_t j = 0; j < num_cachelines; ++j) {
-        construct_cacheline_block(current_pos, step * j, step * (j + 1) - 1);
-        current_pos += 16;
-      }
+    key_min_ = this->key_at(0);
+    key_max_ = this->key_at(this->size_ - 1);
+
+    if (node_levels_ != 0) {
+      construct_group_levels();
     }
   }
- 
-  // we only support the case for simd key capacity = 3.
-  // in this case, the number of simd blocks in each cacheline block is 5.
-  void construct_cacheline_block(const size_t current_pos, const size_t lhs_offset, const size_t rhs_offset) {
-
-    // simd level 0
-    construct_simd_block(current_pos, lhs_offset, rhs_offset);
-
-    // simd level 1
-    size_t step = (rhs_offset - lhs_offset + 1) / 4;
-    for (size_t i = 0; i < 4; ++i) {
-      construct_simd_block(current_pos + 3 * (i + 1), lhs_offset + step * i, lhs_offset + step * (i + 1) - 1);
+
+  // page groups are packed into pages, and each page group level starts on a new page.
+  void construct_group_levels() {
+
+    size_t page_keys = PAGE_SIZE / sizeof(KeyT);
+    size_t page_count = 0;
+
+    group_levels_.clear();
+
+    for (size_t level = 0; level < node_levels_; level += group_depth_) {
+
+      GroupLevel group_level;
+      group_level.depth_ = std::min(group_depth_, node_levels_ - level);
+      group_level.group_keys_ = level_node_count(group_level.depth_) * node_stride_;
+      group_level.groups_per_page_ = std::max(page_keys / group_level.group_keys_, size_t(1));
+      group_level.page_base_ = page_count;
+
+      size_t group_count = size_t(1) << (node_depth_ * level);
+      size_t group_pages = (group_level.group_keys_ + page_keys - 1) / page_keys;
+      page_count += (group_count + group_level.groups_per_page_ - 1) / group_level.groups_per_page_ * group_pages;
+
+      group_levels_.push_back(group_level);
     }
+
+    inner_size_ = page_count * page_keys;
   }
 
-  // we only support the case for simd key capacity = 3.
-  void construct_simd_block(const size_t current_pos, const size_t lhs_offset, const size_t rhs_offset) {
+  // position of the first key of a group in inner_nodes_.
+  size_t group_position(const GroupLevel &group_level, const size_t group_id) const {
+    size_t page_keys = PAGE_SIZE / sizeof(KeyT);
+    size_t group_pages = (group_level.group_keys_ + page_keys - 1) / page_keys;
+    size_t page_id = group_level.page_base_ + group_id / group_level.groups_per_page_ * group_pages;
+    return page_id * page_keys + (group_id % group_level.groups_per_page_) * group_level.group_keys_;
+  }
+
+  // nodes in the same level do not overlap, so they are built in parallel.
+  void construct_inner_layers(const size_t thread_count) {
+    ASSERT(node_levels_ != 0, "number of node levels cannot be 0");
+
+    for (size_t level = 0; level < node_levels_; ++level) {
 
-    size_t step = (rhs_offset - lhs_offset + 1) / 4;
+      const GroupLevel &group_level = group_levels_[level / group_depth_];
+      size_t group_level_depth = level % group_depth_;
 
-    inner_nodes_[current_pos + 0] = this->container_[lhs_offset + 2 * step - 1].key_;
-    inner_nodes_[current_pos + 1] = this->container_[lhs_offset + 1 * step - 1].key_;
-    inner_nodes_[current_pos + 2] = this->container_[lhs_offset + 3 * step - 1].key_;
+      size_t num_nodes = size_t(1) << (node_depth_ * level);
+      size_t level_thread_count = std::min(thread_count, num_nodes);
 
+      run_parallel(level_thread_count, [&](const size_t thread_id) {
+        for (size_t node_id = thread_id; node_id < num_nodes; node_id += level_thread_count) {
+          // nodes of a group are stored level by level
+          size_t group_id = node_id >> (node_depth_ * group_level_depth);
+          size_t rel_node_id = node_id & ((size_t(1) << (node_depth_ * group_level_depth)) - 1);
+          size_t pos = group_position(group_level, group_id) + (level_node_count(group_level_depth) + rel_node_id) * node_stride_;
+
+          construct_node(pos, level, node_id);
+        }
+      });
+    }
+  }
+
+  // a node splits its entries into node_fanout_ parts of equal size,
+  // and separator i is the last key of part (i - 1).
+  // its SIMD blocks are stored level by level from the deepest one, and each SIMD block holds sorted separators.
+  void construct_node(const size_t pos, const size_t level, const size_t node_id) {
+
+    // unit: leaf parts of last_level_step_ entries
+    size_t child_span = size_t(1) << (node_depth_ * (node_levels_ - level - 1));
+    size_t node_begin = node_id * node_fanout_ * child_span;
+
+    for (size_t simd_level = 0; simd_level < simd_levels_; ++simd_level) {
+
+      size_t depth = simd_level_depths_[simd_level];
+      size_t block_keys = (size_t(1) << depth) - 1;
+      size_t num_blocks = size_t(1) << (simd_depth_ * simd_level);
+      size_t block_span = node_fanout_ / num_blocks; // unit: node parts
+      size_t key_span = block_span >> depth;
+
+      for (size_t block_id = 0; block_id < num_blocks; ++block_id) {
+        size_t block_pos = pos + simd_level_bases_[simd_level] + block_id * block_keys;
+        for (size_t i = 1; i <= block_keys; ++i) {
+          size_t part = block_id * block_span + i * key_span;
+          size_t offset = (node_begin + part * child_span) * last_level_step_ - 1;
+          inner_nodes_[block_pos + i - 1] = SimdKey<KeyT>::encode(this->key_at(offset));
+        }
+      }
+    }
   }
 
   // find in inner nodes
   std::pair<int, int> find_inner_layers(const KeyT &key) {
 
-    if (num_layers_ == 0) { return std::pair<int, int>(0, this->size_ - 1); }
-
-    // cacheline level 0
-    size_t current_pos = 0;
-    size_t branch_id = lookup_cacheline_block(key, current_pos);
-    current_pos += 16; // beginning position in next level
-    
-    size_t num_cachelines = std::pow(16, 1); // number of cachelines in next level
-    
-    for (size_t i = 1; i < cacheline_levels_; ++i) {
-      
-      size_t new_branch_id = lookup_cacheline_block(key, current_pos + branch_id * 16);
-      
-      branch_id = branch_id * 16 + new_branch_id;
-      current_pos += 16 * num_cachelines; // beginning position in next level
-
-      num_cachelines = std::pow(16, (i + 1)); // number of cachelines in next level
-    }
-    
-    if (branch_id < num_cachelines - 1) {
+    if (node_levels_ == 0) { return std::pair<int, int>(0, this->size_ - 1); }
 
-      return std::pair<int, int>(branch_id * last_level_step_, (branch_id + 1) * last_level_step_ - 1);
-    } else {
+    SignedKeyT signed_key = SimdKey<KeyT>::encode(key);
 
-      return std::pair<int, int>(branch_id * last_level_step_, this->size_ - 1);
+    // branch among all nodes at the current level
+    size_t branch_id = 0;
+
+    for (auto &group_level : group_levels_) {
+
+      const SignedKeyT *group = inner_nodes_ + group_position(group_level, branch_id);
+
+      size_t rel_branch_id = 0;
+      size_t level_base = 0;
+
+      for (size_t level = 0; level < group_level.depth_; ++level) {
+        size_t new_branch_id = lookup_node(signed_key, group + (level_base + rel_branch_id) * node_stride_);
+
+        rel_branch_id = rel_branch_id * node_fanout_ + new_branch_id;
+        level_base = level_base * node_fanout_ + 1;
+      }
+
+      branch_id = (branch_id << (node_depth_ * group_level.depth_)) + rel_branch_id;
     }
-    
-  }
 
-  // search in cacheline block
-  size_t lookup_cacheline_block(const KeyT &key, const size_t current_pos) {
+    size_t num_branches = size_t(1) << (node_depth_ * node_levels_);
 
-    size_t branch_id = lookup_simd_block(key, current_pos);
-    
-    size_t new_pos = current_pos + 3 * (branch_id + 1);
+    if (branch_id < num_branches - 1) {
 
-    size_t new_branch_id = lookup_simd_block(key, new_pos); 
+      return std::pair<int, int>(branch_id * last_level_step_, (branch_id + 1) * last_level_step_ - 1);
+    } else {
 
-    return branch_id * 4 + new_branch_id;
+      return std::pair<int, int>(branch_id * last_level_step_, this->size_ - 1);
+    }
   }
 
-  // search in simd block
-  size_t lookup_simd_block(const KeyT &key, const size_t current_pos) {
+  // search in node
+  size_t lookup_node(const SignedKeyT key, const SignedKeyT *node) const {
 
-    __m128i xmm_key_q =_mm_set1_epi32(key);
-    __m128i xmm_tree = _mm_loadu_si128((__m128i*)(inner_nodes_ + current_pos));
-    __m128i xmm_mask = _mm_cmpgt_epi32(xmm_key_q, xmm_tree);
-    unsigned index = _mm_movemask_ps(_mm_castsi128_ps(xmm_mask));
+    size_t branch_id = 0;
 
-    static unsigned table[8] = {0, 9, 1, 2, 9, 9, 9, 3}; // 9 stands for impossible
-    size_t branch_id = table[(index&7)];
+    for (size_t simd_level = 0; simd_level < simd_levels_; ++simd_level) {
+      size_t depth = simd_level_depths_[simd_level];
+      size_t block_keys = (size_t(1) << depth) - 1;
+      size_t new_branch_id = lookup_simd_block(key, node + simd_level_bases_[simd_level] + branch_id * block_keys, block_keys);
 
+      branch_id = (branch_id << depth) + new_branch_id;
+    }
     return branch_id;
   }
 
-
-  // last step
-  // find in leaf nodes, simple binary search [incl., incl.]
-  size_t find_internal(const KeyT &key, const int offset_begin, const int offset_end) {
-    if (offset_begin > offset_end) {
-      return this->size_;
-    }
-    int offset_lookup = (offset_begin + offset_end) / 2;
-    KeyT key_lookup = this->container_[offset_lookup].key_;
-    if (key == key_lookup) {
-      return offset_lookup;
-    }
-    if (key > key_lookup) {
-      return find_internal(key, offset_lookup + 1, offset_end);
+  // search in simd block.
+  // separators are sorted, so the branch is the number of separators smaller than key.
+  size_t lookup_simd_block(const SignedKeyT key, const SignedKeyT *block, const size_t block_keys) const {
+    if (simd_width_ == AVX512_WIDTH) {
+      return simd_block_count_less_avx512(block, key, block_keys);
+    } else if (simd_width_ == AVX2_WIDTH) {
+      return simd_block_count_less_avx2(block, key, block_keys);
     } else {
-      return find_internal(key, offset_begin, offset_lookup - 1);
+      return simd_block_count_less_sse2(block, key, block_keys);
     }
   }
 
 private:
-  
+
   size_t num_layers_;
 
   KeyT key_min_;
   KeyT key_max_;
-  KeyT *inner_nodes_;
+
+  // page groups in BFS order. aligned to a page.
+  SignedKeyT *inner_nodes_;
   size_t inner_size_;
 
-  size_t lhs_offset_;
-  size_t rhs_offset_;
-  size_t last_level_step_;
-  size_t cacheline_levels_;
-  size_t *num_cachelines_;
+  // unit: byte
+  size_t simd_width_;
+
+  size_t simd_depth_;
+  size_t simd_levels_;
+  // depth of the blocks of each SIMD level, and the position of their first block in a node.
+  size_t simd_level_depths_[MAX_SIMD_LEVELS];
+  size_t simd_level_bases_[MAX_SIMD_LEVELS];
+
+  size_t node_depth_;
+  size_t node_fanout_;
+  size_t node_stride_; // unit: keys
+  size_t node_levels_;
 
+  size_t group_depth_; // unit: node levels
+  std::vector<GroupLevel> group_levels_;
+
+  size_t last_level_step_;
 
 };
 
-}
\ No newline at end of file
+}
@@ -1,79 +1,115 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <limits>
+#include <vector>
 
 #include "base_static_index.h"
 
 namespace static_index {
 
+// the entries are split into segments, and a lookup interpolates the offset of a key
+// between the boundaries of its segment.
+// by default, segments cover equal key ranges. in the adaptive mode, segment boundaries are
+// picked so that interpolation within every segment is off by at most target_error entries.
+// either way, the maximum error of each segment is measured when the index is built,
+// and a lookup only searches the error window around its guess.
 template<typename KeyT, typename ValueT>
 class InterpolationIndex : public BaseStaticIndex<KeyT, ValueT> {
 
+  // readers share the stats, so all of it is kept in relaxed atomics of a fixed size, and nothing
+  // is allocated on the lookup path. guess distances go to log2 buckets: bucket b > 0 holds
+  // distances in [2^(b-1), 2^b), and bucket 0 holds exact guesses.
   struct Stats {
 
-    Stats() : 
-      is_first_match_(true), 
-      find_op_count_(0), 
-      find_op_profile_count_(0), 
-      find_op_guess_distance_(0) {}
+    static const size_t bucket_count = 65;
 
-    void increment_find_op_counter() {
-      find_op_count_++;
-      is_first_match_ = true;
+    Stats() :
+      find_op_profile_count_(0),
+      find_op_guess_distance_(0),
+      find_op_guess_distance_max_(0) {
+      for (size_t i = 0; i < bucket_count; ++i) {
+        find_op_guess_distance_buckets_[i].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    // every 1000th find operation of each thread is profiled.
+    // the counter is per thread, so that readers do not write a shared line on every lookup.
+    bool increment_find_op_counter() {
+      static thread_local uint64_t find_op_count = 0;
+      return find_op_count++ % 1000 == 0;
     }
 
     void measure_find_op_guess_distance(const int64_t guess_pos, const int64_t find_pos) {
-      // record guess distance
-      if (find_op_count_ % 1000 == 0) {
-        if (is_first_match_ == true) {
-          find_op_guess_distance_ += std::abs(guess_pos - find_pos);
-          find_op_profile_count_ += 1;
-          is_first_match_ = false;
+      uint64_t distance = std::abs(guess_pos - find_pos);
+      find_op_guess_distance_.fetch_add(distance, std::memory_order_relaxed);
+      find_op_guess_distance_buckets_[bucket_of(distance)].fetch_add(1, std::memory_order_relaxed);
+      find_op_profile_count_.fetch_add(1, std::memory_order_relaxed);
+
+      uint64_t max_distance = find_op_guess_distance_max_.load(std::memory_order_relaxed);
+      while (distance > max_distance &&
+             !find_op_guess_distance_max_.compare_exchange_weak(max_distance, distance, std::memory_order_relaxed)) {}
+    }
+
+    // an upper bound of the guess distance that ratio of the profiled find operations do not exceed.
+    uint64_t guess_distance_percentile(const double ratio) const {
+      uint64_t total = 0;
+      for (size_t i = 0; i < bucket_count; ++i) {
+        total += find_op_guess_distance_buckets_[i].load(std::memory_order_relaxed);
+      }
+      uint64_t max_distance = find_op_guess_distance_max_.load(std::memory_order_relaxed);
+      if (total == 0) {
+        return 0;
+      }
+      uint64_t rank = std::max(uint64_t(std::ceil(total * ratio)), uint64_t(1));
+      uint64_t count = 0;
+      for (size_t i = 0; i < bucket_count; ++i) {
+        count += find_op_guess_distance_buckets_[i].load(std::memory_order_relaxed);
+        if (count >= rank) {
+          uint64_t bucket_max = (i == 0) ? 0 : (i == 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t(1) << i) - 1);
+          return std::min(bucket_max, max_distance);
         }
       }
+      return max_distance;
     }
 
-    bool is_first_match_;
-    uint64_t find_op_count_;
-    uint64_t find_op_profile_count_;
-    uint64_t find_op_guess_distance_;
+    static size_t bucket_of(const uint64_t distance) {
+      return distance == 0 ? 0 : 64 - __builtin_clzll(distance);
+    }
+
+    std::atomic<uint64_t> find_op_profile_count_;
+    std::atomic<uint64_t> find_op_guess_distance_;
+    std::atomic<uint64_t> find_op_guess_distance_max_;
+    std::atomic<uint64_t> find_op_guess_distance_buckets_[bucket_count];
   };
 
 public:
-  InterpolationIndex(DataTable<KeyT, ValueT> *table_ptr, const size_t num_segments = 1) 
-    : BaseStaticIndex<KeyT, ValueT>(table_ptr) {
+  // a target_error of at least 1 selects the adaptive mode, which ignores num_segments.
+  InterpolationIndex(DataTable<KeyT, ValueT> *table_ptr, const size_t num_segments = 1, const int target_error = -1, const LayoutType layout = LayoutType::AoSLayout)
+    : BaseStaticIndex<KeyT, ValueT>(table_ptr, layout) {
 
     ASSERT(num_segments >= 1, "must have at least one segment");
 
-    num_segments_ = num_segments;
-    segment_key_boundaries_ = new KeyT[num_segments_ + 1];
-    memset(segment_key_boundaries_, 0, sizeof(KeyT) * (num_segments_ + 1));
+    is_adaptive_ = (target_error >= 1);
+    target_error_ = is_adaptive_ ? target_error : 0;
 
-    segment_offset_boundaries_ = new size_t[num_segments_];
-    memset(segment_offset_boundaries_, 0, sizeof(size_t) * num_segments_);
-
-    segment_sizes_ = new size_t[num_segments_];
-    memset(segment_sizes_, 0, sizeof(size_t) * num_segments_);
+    allocate_segments(num_segments);
 
+    key_min_ = 0;
+    key_max_ = 0;
   }
 
   virtual ~InterpolationIndex() {
-
-    delete[] segment_key_boundaries_;
-    segment_key_boundaries_ = nullptr;
-
-    delete[] segment_offset_boundaries_;
-    segment_offset_boundaries_ = nullptr;
-
-    delete[] segment_sizes_;
-    segment_sizes_ = nullptr;
-
+    if (!this->is_image()) {
+      release_segments();
+    }
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {
+  virtual void find(const KeyT &key, ResultSink &values) final {
 
-    stats_.increment_find_op_counter();
+    bool is_profiled = stats_.increment_find_op_counter();
 
     if (this->size_ == 0) {
       return;
@@ -87,131 +123,59 @@ public:
     if (key_min_ == key_max_) {
       if (key_min_ == key) {
         for (size_t i = 0; i < this->size_; ++i) {
-          values.push_back(this->container_[i].value_);
+          if (!this->push_values(i, values)) { return; }
         }
       }
       return;
     }
 
-    // find suitable segment
-    size_t segment_id = (key - key_min_) / ((key_max_ - key_min_) / num_segments_);
-    if (segment_id > num_segments_ - 1) {
-      segment_id = num_segments_ - 1;
-    }
-
-    // the key should fall into: 
-    //  [ segment_key_boundaries_[i], segment_key_boundaries_[i + 1] ) -- if 0 <= i < num_segments_ - 1
-    //  [ segment_key_boundaries_[i], segment_key_boundaries_[i + 1] ] -- if i == num_segments_ - 1
-    if (segment_id < num_segments_ - 1) {
-
-      ASSERT(segment_key_boundaries_[segment_id] <= key, 
-        "beyond boundary: " << segment_key_boundaries_[segment_id] << " " << key);
-      ASSERT(key < segment_key_boundaries_[segment_id + 1], 
-        "beyond boundary: " << key << " " << segment_key_boundaries_[segment_id + 1]);
-
-    } else {
+    // guess where the data lives
+    size_t segment_id = find_segment(key);
+    int64_t guess = guess_offset(key, segment_id);
 
-      ASSERT(segment_id == num_segments_ - 1, 
-        "incorrect segment id: " << segment_id << " " << num_segments_ - 1);
+    size_t offset = search_window(key, guess, segment_errors_[segment_id]);
 
-      ASSERT(segment_key_boundaries_[segment_id] <= key, 
-        "beyond boundary: " << segment_key_boundaries_[segment_id] << " " << key);
-      ASSERT(key <= segment_key_boundaries_[segment_id + 1], 
-        "beyond boundary: " << key << " " << segment_key_boundaries_[segment_id + 1]);
+    if (offset == this->size_ || this->key_at(offset) != key) {
+      return;
     }
 
-    KeyT segment_key_range = segment_key_boundaries_[segment_id + 1] - segment_key_boundaries_[segment_id];
-    
-    // guess where the data lives
-    int64_t guess = int64_t((key - segment_key_boundaries_[segment_id]) * 1.0 / segment_key_range * (segment_sizes_[segment_id] - 1) + segment_offset_boundaries_[segment_id]);
-
-    // TODO: workaround!!
-    if (guess >= this->size_) {
-      guess = this->size_ - 1;
+    if (is_profiled) {
+      stats_.measure_find_op_guess_distance(guess, offset);
     }
 
-    int64_t origin_guess = guess;
-    
-    // if the guess is correct
-    if (this->container_[guess].key_ == key) {
-
-      stats_.measure_find_op_guess_distance(origin_guess, guess);
+    // offset is the first match
+    for (; offset < this->size_ && this->key_at(offset) == key; ++offset) {
+      if (!this->push_values(offset, values)) { return; }
+    }
+  }
 
-      values.push_back(this->container_[guess].value_);
-      
-      // move left
-      int64_t guess_lhs = guess - 1;
-      while (guess_lhs >= 0) {
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
 
-        if (this->container_[guess_lhs].key_ == key) {
-          values.push_back(this->container_[guess_lhs].value_);
-          guess_lhs -= 1;
-        } else {
-          break;
-        }
-      }
-      // move right
-      int64_t guess_rhs = guess + 1;
-      while (guess_rhs <= this->size_ - 1) {
-
-        if (this->container_[guess_rhs].key_ == key) {
-          values.push_back(this->container_[guess_rhs].value_);
-          guess_rhs += 1;
-        } else {
-          break;
-        }
-      }
+    if (this->size_ == 0) {
+      return;
     }
-    // if the guess is larger than the key
-    else if (this->container_[guess].key_ > key) {
-      // move left
-      guess -= 1;
-      while (guess >= 0) {
 
-        if (this->container_[guess].key_ < key) {
-          break;
-        }
-        else if (this->container_[guess].key_ > key) {
-          guess -= 1;
-          continue;
-        } 
-        else {
+    for (size_t group_begin = 0; group_begin < count; group_begin += PREFETCH_GROUP_SIZE) {
 
-          stats_.measure_find_op_guess_distance(origin_guess, guess);
+      const KeyT *group_keys = keys + group_begin;
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, count - group_begin);
 
-          values.push_back(this->container_[guess].value_);
-          guess -= 1;
-          continue;
+      // issue the first probe of every lookup in the group before any of them is resolved.
+      if (key_min_ != key_max_) {
+        for (size_t i = 0; i < group_size; ++i) {
+          if (group_keys[i] > key_max_ || group_keys[i] < key_min_) { continue; }
+
+          this->prefetch_key(guess_offset(group_keys[i], find_segment(group_keys[i])));
         }
       }
-    } 
-    // if the guess is smaller than the key
-    else {
-      // move right
-      guess += 1;
-      while (guess < this->size_ - 1) {
-
-        if (this->container_[guess].key_ > key) {
-          break;
-        }
-        else if (this->container_[guess].key_ < key) {
-          guess += 1;
-          continue;
-        }
-        else {
-          
-          stats_.measure_find_op_guess_distance(origin_guess, guess);
 
-          values.push_back(this->container_[guess].value_);
-          guess += 1;
-          continue;
-        }
+      for (size_t i = 0; i < group_size; ++i) {
+        find(group_keys[i], values[group_begin + i]);
       }
     }
-    return;
   }
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
 
     if (lhs_key > rhs_key) { return; }
 
@@ -232,350 +196,377 @@ public:
     if (key_min_ == key_max_) {
       if (key_min_ >= lhs_key && key_min_ <= rhs_key) {
         for (size_t i = 0; i < this->size_; ++i) {
-          values.push_back(this->container_[i].value_);
+          if (!this->push_values(i, values)) { return; }
         }
       }
       return;
     }
 
-    int64_t lower_bound = find_lower_bound(lhs_key);
-    int64_t upper_bound = find_upper_bound(rhs_key);
-
-    for (size_t i = lower_bound; i <= upper_bound; ++i) {
-      values.push_back(this->container_[i].value_);
+    int64_t lower_bound = 0;
+    if (lhs_key > key_min_) {
+      size_t segment_id = find_segment(lhs_key);
+      lower_bound = search_window(lhs_key, guess_offset(lhs_key, segment_id), segment_errors_[segment_id]);
     }
-    return;
-  }
-
 
-  virtual void reorganize() final {
+    this->collect_range(lhs_key, rhs_key, lower_bound, lower_bound - 1, values);
+  }
 
-    this->base_reorganize();
 
-    key_min_ = this->container_[0].key_; // min value
-    key_max_ = this->container_[this->size_ - 1].key_; // max value
+  virtual void reorganize(const size_t thread_count) final {
 
-    segment_key_boundaries_[0] = key_min_;
-    segment_key_boundaries_[num_segments_] = key_max_;
+    this->base_reorganize(thread_count);
 
-    KeyT key_range = key_max_ - key_min_;
-    KeyT segment_key_range = key_range / num_segments_;
-
-    for (size_t i = 1; i < num_segments_; ++i) {
-      segment_key_boundaries_[i] = this->container_[0].key_ + segment_key_range * i;
+    if (this->size_ == 0) {
+      return;
     }
 
-    size_t current_offset = 0;
+    key_min_ = this->key_at(0); // min value
+    key_max_ = this->key_at(this->size_ - 1); // max value
 
-    segment_offset_boundaries_[0] = current_offset;
-
-    for (size_t i = 0; i < num_segments_ - 1; ++i) {
-      // scan the entire table to find offset boundaries
-      while (this->container_[current_offset].key_ < segment_key_boundaries_[i + 1]) {
-        ++segment_sizes_[i];
-        ++current_offset;
+    if (is_adaptive_) {
+      construct_adaptive_segments(thread_count);
+    } else {
+      construct_uniform_segments(thread_count);
+    }
+
+    // measure the error of every segment on the first entry of each of its keys.
+    size_t segment_thread_count = std::min(thread_count, num_segments_);
+    run_parallel(segment_thread_count, [&](const size_t thread_id) {
+      for (size_t i = thread_id; i < num_segments_; i += segment_thread_count) {
+        size_t begin = segment_offset_boundaries_[i];
+        size_t end = begin + segment_sizes_[i];
+        size_t error = 0;
+        for (size_t offset = begin; offset < end; ++offset) {
+          if (offset == begin || this->key_at(offset) != this->key_at(offset - 1)) {
+            int64_t guess = guess_offset(this->key_at(offset), i);
+            error = std::max(error, size_t(std::abs(guess - int64_t(offset))));
+          }
+        }
+        segment_errors_[i] = error;
       }
-      segment_offset_boundaries_[i + 1] = current_offset;
-    }
-
-    segment_sizes_[num_segments_ - 1] = this->size_ - current_offset;
-
+    });
   }
 
   virtual void print() const final {
     // for (size_t i = 0; i < this->size_; ++i) {
-    //   std::cout << this->container_[i].key_ << " " << this->container_[i].value_ << std::endl;
+    //   std::cout << this->key_at(i) << " " << this->value_at(i) << std::endl;
     // }
 
-    std::cout << "aggregated guess distance = " << stats_.find_op_guess_distance_ << std::endl;
+    std::cout << "segmentation: " << (is_adaptive_ ? "adaptive" : "uniform") << std::endl;
+
+    std::cout << "number of segments = " << num_segments_ << std::endl;
+
+    std::cout << "max segment error = " << *std::max_element(segment_errors_, segment_errors_ + num_segments_) << std::endl;
 
-    std::cout << "number of profiled find operations = " << stats_.find_op_profile_count_ << std::endl;
+    std::cout << "aggregated guess distance = " << stats_.find_op_guess_distance_.load() << std::endl;
 
-    std::cout << "average guess distance = " << stats_.find_op_guess_distance_ * 1.0 / stats_.find_op_profile_count_ << std::endl;
+    std::cout << "number of profiled find operations = " << stats_.find_op_profile_count_.load() << std::endl;
+
+    std::cout << "average guess distance = " << stats_.find_op_guess_distance_.load() * 1.0 / stats_.find_op_profile_count_.load() << std::endl;
+
+    std::cout << "p99 guess distance <= " << stats_.guess_distance_percentile(0.99) << std::endl;
+
+    std::cout << "max guess distance = " << stats_.find_op_guess_distance_max_.load() << std::endl;
   }
 
-private:
+protected:
 
-  int64_t find_lower_bound(const KeyT &lower_key) {
+  virtual void serialize_inner(IndexImageWriter &writer) const final {
+    writer.write_value(uint64_t(is_adaptive_));
+    writer.write_value(uint64_t(target_error_));
+    writer.write_array(segment_key_boundaries_, num_segments_ + 1);
+    writer.write_array(segment_offset_boundaries_, num_segments_);
+    writer.write_array(segment_sizes_, num_segments_);
+    writer.write_array(segment_errors_, num_segments_);
+  }
 
-    ASSERT(lower_key <= key_max_, "lower_key must be <= key_max_");
+  virtual bool load_inner(IndexImageReader &reader) final {
 
-    if (lower_key <= key_min_) {
-      return 0;
+    if (reader.read_value<uint64_t>() != is_adaptive_ || reader.read_value<uint64_t>() != target_error_) {
+      return false;
     }
 
-    size_t segment_id = (lower_key - key_min_) / ((key_max_ - key_min_) / num_segments_);
-    if (segment_id > num_segments_ - 1) {
-      segment_id = num_segments_ - 1;
+    // segments are used in place
+    release_segments();
+
+    size_t count = 0;
+    segment_key_boundaries_ = reader.read_array<KeyT>(count);
+    num_segments_ = count - 1;
+
+    segment_offset_boundaries_ = reader.read_array<size_t>(count);
+    if (count != num_segments_) { return false; }
+    segment_sizes_ = reader.read_array<size_t>(count);
+    if (count != num_segments_) { return false; }
+    segment_errors_ = reader.read_array<size_t>(count);
+    if (count != num_segments_) { return false; }
+
+    if (this->size_ != 0) {
+      key_min_ = this->key_at(0);
+      key_max_ = this->key_at(this->size_ - 1);
     }
+    return true;
+  }
 
-    // the lower_key should fall into: 
-    //  [ segment_key_boundaries_[i], segment_key_boundaries_[i + 1] ) -- if 0 <= i < num_segments_ - 1
-    //  [ segment_key_boundaries_[i], segment_key_boundaries_[i + 1] ] -- if i == num_segments_ - 1
-    if (segment_id < num_segments_ - 1) {
+private:
 
-      ASSERT(segment_key_boundaries_[segment_id] <= lower_key, 
-        "beyond boundary: " << segment_key_boundaries_[segment_id] << " " << lower_key);
-      ASSERT(lower_key < segment_key_boundaries_[segment_id + 1], 
-        "beyond boundary: " << lower_key << " " << segment_key_boundaries_[segment_id + 1]);
+  void allocate_segments(const size_t num_segments) {
 
-    } else {
+    num_segments_ = num_segments;
+    segment_key_boundaries_ = new KeyT[num_segments_ + 1];
+    memset(segment_key_boundaries_, 0, sizeof(KeyT) * (num_segments_ + 1));
 
-      ASSERT(segment_id == num_segments_ - 1, 
-        "incorrect segment id: " << segment_id << " " << num_segments_ - 1);
+    segment_offset_boundaries_ = new size_t[num_segments_];
+    memset(segment_offset_boundaries_, 0, sizeof(size_t) * num_segments_);
 
-      ASSERT(segment_key_boundaries_[segment_id] <= lower_key, 
-        "beyond boundary: " << segment_key_boundaries_[segment_id] << " " << lower_key);
-      ASSERT(lower_key <= segment_key_boundaries_[segment_id + 1], 
-        "beyond boundary: " << lower_key << " " << segment_key_boundaries_[segment_id + 1]);
-    }
+    segment_sizes_ = new size_t[num_segments_];
+    memset(segment_sizes_, 0, sizeof(size_t) * num_segments_);
 
-    KeyT segment_key_range = segment_key_boundaries_[segment_id + 1] - segment_key_boundaries_[segment_id];
-    // guess where the data lives
-    int64_t guess = int64_t((lower_key - segment_key_boundaries_[segment_id]) * 1.0 / segment_key_range * (segment_sizes_[segment_id] - 1) + segment_offset_boundaries_[segment_id]);
+    segment_errors_ = new size_t[num_segments_];
+    memset(segment_errors_, 0, sizeof(size_t) * num_segments_);
+  }
 
-    // TODO: workaround!!
-    if (guess >= this->size_) {
-      guess = this->size_ - 1;
-    }
+  void release_segments() {
 
-    if (this->container_[guess].key_ >= lower_key) {
-      // move left
-      while (guess - 1 >= 0) {
-        if (this->container_[guess - 1].key_ >= lower_key) {
-          --guess;
-        } else {
-          return guess;
-        }
-      }
-      return guess;
+    delete[] segment_key_boundaries_;
+    segment_key_boundaries_ = nullptr;
 
-    } else {
-      // move right
-      ++guess;
-      while (guess < this->size_) {
-        if (this->container_[guess].key_ < lower_key) {
-          ++guess;
-        } else {
-          return guess;
-        }
-      }
-      ASSERT(false, "shouldn't touch this line of code");
-      return guess;
-    }
+    delete[] segment_offset_boundaries_;
+    segment_offset_boundaries_ = nullptr;
 
+    delete[] segment_sizes_;
+    segment_sizes_ = nullptr;
+
+    delete[] segment_errors_;
+    segment_errors_ = nullptr;
   }
-  
-  int64_t find_upper_bound(const KeyT &upper_key) {
-    
-    ASSERT(upper_key >= key_min_, "upper_key must be >= key_min_");
 
-    if (upper_key >= key_max_) {
-      return this->size_ - 1;
-    }
+  // split [key_min_, key_max_] into num_segments_ segments of equal key ranges.
+  void construct_uniform_segments(const size_t thread_count) {
 
-    size_t segment_id = (upper_key - key_min_) / ((key_max_ - key_min_) / num_segments_);
-    if (segment_id > num_segments_ - 1) {
-      segment_id = num_segments_ - 1;
-    }
+    segment_key_boundaries_[0] = key_min_;
+    segment_key_boundaries_[num_segments_] = key_max_;
 
-    // the upper_key should fall into: 
-    //  [ segment_key_boundaries_[i], segment_key_boundaries_[i + 1] ) -- if 0 <= i < num_segments_ - 1
-    //  [ segment_key_boundaries_[i], segment_key_boundaries_[i + 1] ] -- if i == num_segments_ - 1
-    if (segment_id < num_segments_ - 1) {
+    KeyT key_range = key_max_ - key_min_;
+    KeyT segment_key_range = key_range / num_segments_;
 
-      ASSERT(segment_key_boundaries_[segment_id] <= upper_key, 
-        "beyond boundary: " << segment_key_boundaries_[segment_id] << " " << upper_key);
-      ASSERT(upper_key < segment_key_boundaries_[segment_id + 1], 
-        "beyond boundary: " << upper_key << " " << segment_key_boundaries_[segment_id + 1]);
+    for (size_t i = 1; i < num_segments_; ++i) {
+      segment_key_boundaries_[i] = this->key_at(0) + segment_key_range * i;
+    }
 
-    } else {
+    segment_offset_boundaries_[0] = 0;
 
-      ASSERT(segment_id == num_segments_ - 1, 
-        "incorrect segment id: " << segment_id << " " << num_segments_ - 1);
+    // the offset boundary of segment i is the first entry whose key is not smaller than
+    // its key boundary. segments are independent, so they are searched in parallel.
+    size_t segment_thread_count = std::min(thread_count, num_segments_);
+    run_parallel(segment_thread_count, [&](const size_t thread_id) {
+      for (size_t i = thread_id + 1; i < num_segments_; i += segment_thread_count) {
+        segment_offset_boundaries_[i] = this->lower_bound_offset(segment_key_boundaries_[i]);
+      }
+    });
 
-      ASSERT(segment_key_boundaries_[segment_id] <= upper_key, 
-        "beyond boundary: " << segment_key_boundaries_[segment_id] << " " << upper_key);
-      ASSERT(upper_key <= segment_key_boundaries_[segment_id + 1], 
-        "beyond boundary: " << upper_key << " " << segment_key_boundaries_[segment_id + 1]);
+    for (size_t i = 0; i < num_segments_ - 1; ++i) {
+      segment_sizes_[i] = segment_offset_boundaries_[i + 1] - segment_offset_boundaries_[i];
     }
 
-    KeyT segment_key_range = segment_key_boundaries_[segment_id + 1] - segment_key_boundaries_[segment_id];
-    // guess where the data lives
-    int64_t guess = int64_t((upper_key - segment_key_boundaries_[segment_id]) * 1.0 / segment_key_range * (segment_sizes_[segment_id] - 1) + segment_offset_boundaries_[segment_id]);
+    segment_sizes_[num_segments_ - 1] = this->size_ - segment_offset_boundaries_[num_segments_ - 1];
+  }
 
-    // TODO: workaround!!
-    if (guess >= this->size_) {
-      guess = this->size_ - 1;
-    }
+  // grow each segment greedily, one key at a time, while interpolating between its boundaries
+  // guesses the first entry of every key in it within target_error_.
+  // the slopes from the first entry of a segment that satisfy all of its keys form a cone,
+  // which shrinks as keys are added. a segment ends once the slope to its next boundary leaves the cone.
+  // each thread splits a range of entries, and the ranges are then concatenated.
+  void construct_adaptive_segments(const size_t thread_count) {
 
-    if (this->container_[guess].key_ <= upper_key) {
-      // move right
-      while (guess +1 <= this->size_ - 1) {
-        if (this->container_[guess + 1].key_ <= upper_key) {
-          ++guess;
-        } else {
-          return guess;
-        }
-      }
-      return guess;
+    // the first offset of every segment
+    std::vector<std::vector<size_t>> thread_boundaries(thread_count);
 
-    } else {
-      // move left
-      --guess;
-      while (guess > 0) {
-        if (this->container_[guess].key_ > upper_key) {
-          --guess;
-        } else {
-          return guess;
-        }
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      size_t begin = first_entry_from(this->size_ * thread_id / thread_count);
+      size_t end = first_entry_from(this->size_ * (thread_id + 1) / thread_count);
+
+      std::vector<size_t> &boundaries = thread_boundaries[thread_id];
+
+      size_t segment_begin = begin;
+      double slope_lo = 0;
+      double slope_hi = std::numeric_limits<double>::max();
+
+      if (begin < end) {
+        boundaries.push_back(begin);
       }
-      ASSERT(false, "shouldn't touch this line of code");
-      return guess;
-    }
 
+      for (size_t offset = next_entry_from(begin); offset < end; offset = next_entry_from(offset)) {
 
-  }
+        // add the key at offset to the segment
+        double dx = double(this->key_at(offset) - this->key_at(segment_begin));
+        double dy = double(offset - segment_begin);
+        double next_slope_lo = std::max(slope_lo, (dy - target_error_) / dx);
+        double next_slope_hi = std::min(slope_hi, (dy + target_error_) / dx);
 
+        // the segment would then end at the entry before the next key, or at the last entry.
+        size_t next_offset = next_entry_from(offset);
+        size_t last_offset = (next_offset < this->size_) ? next_offset - 1 : this->size_ - 1;
+        KeyT last_key = (next_offset < this->size_) ? this->key_at(next_offset) : key_max_;
+        double slope = double(last_offset - segment_begin) / double(last_key - this->key_at(segment_begin));
 
-  void find_range_by_scan(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) {
+        if (next_slope_lo <= next_slope_hi && slope >= next_slope_lo && slope <= next_slope_hi) {
+          slope_lo = next_slope_lo;
+          slope_hi = next_slope_hi;
+          continue;
+        }
 
-    if (lhs_key > rhs_key) { return; }
+        // start a new segment at offset
+        boundaries.push_back(offset);
+        segment_begin = offset;
+        slope_lo = 0;
+        slope_hi = std::numeric_limits<double>::max();
+      }
+    });
 
-    if (lhs_key == rhs_key) {
-      find(lhs_key, values);
-      return;
+    std::vector<size_t> boundaries;
+    for (auto &entry : thread_boundaries) {
+      boundaries.insert(boundaries.end(), entry.begin(), entry.end());
     }
 
-    if (this->size_ == 0) {
-      return;
-    }
+    release_segments();
+    allocate_segments(boundaries.size());
 
-    if (lhs_key > key_max_ || rhs_key < key_min_) {
-      return;
+    for (size_t i = 0; i < num_segments_; ++i) {
+      segment_key_boundaries_[i] = this->key_at(boundaries[i]);
+      segment_offset_boundaries_[i] = boundaries[i];
+      segment_sizes_[i] = ((i + 1 < num_segments_) ? boundaries[i + 1] : this->size_) - boundaries[i];
     }
+    segment_key_boundaries_[num_segments_] = key_max_;
+  }
 
-    // all keys are equal
-    if (key_min_ == key_max_) {
-      if (key_min_ >= lhs_key && key_min_ <= rhs_key) {
-        for (size_t i = 0; i < this->size_; ++i) {
-          values.push_back(this->container_[i].value_);
-        }
-      }
-      return;
+  // the first entry at or after offset whose key differs from its predecessor, or size_ if there is none.
+  size_t first_entry_from(size_t offset) const {
+    while (offset > 0 && offset < this->size_ && this->key_at(offset) == this->key_at(offset - 1)) {
+      ++offset;
     }
+    return offset;
+  }
 
-    int64_t guess = 0;
+  // the first entry after offset whose key differs from the key at offset, or size_ if there is none.
+  size_t next_entry_from(size_t offset) const {
+    KeyT key = this->key_at(offset);
+    do {
+      ++offset;
+    } while (offset < this->size_ && this->key_at(offset) == key);
+    return offset;
+  }
 
-    if (lhs_key > key_min_) {
+  // the segment that key falls into.
+  // key must fall into [key_min_, key_max_].
+  size_t find_segment(const KeyT &key) const {
 
-      // find suitable segment for lhs_key
-      size_t segment_id = (lhs_key - key_min_) / ((key_max_ - key_min_) / num_segments_);
+    size_t segment_id = 0;
+
+    if (is_adaptive_) {
+      // the number of inner key boundaries that are not larger than key
+      segment_id = std::upper_bound(segment_key_boundaries_ + 1, segment_key_boundaries_ + num_segments_, key) - (segment_key_boundaries_ + 1);
+    } else {
+      segment_id = (key - key_min_) / ((key_max_ - key_min_) / num_segments_);
       if (segment_id > num_segments_ - 1) {
         segment_id = num_segments_ - 1;
       }
+    }
 
-      // the lhs_key should fall into: 
-      //  [ segment_key_boundaries_[i], segment_key_boundaries_[i + 1] ) -- if 0 <= i < num_segments_ - 1
-      //  [ segment_key_boundaries_[i], segment_key_boundaries_[i + 1] ] -- if i == num_segments_ - 1
-      if (segment_id < num_segments_ - 1) {
+    // the key should fall into:
+    //  [ segment_key_boundaries_[i], segment_key_boundaries_[i + 1] ) -- if 0 <= i < num_segments_ - 1
+    //  [ segment_key_boundaries_[i], segment_key_boundaries_[i + 1] ] -- if i == num_segments_ - 1
+    if (segment_id < num_segments_ - 1) {
 
-        ASSERT(segment_key_boundaries_[segment_id] <= lhs_key, 
-          "beyond boundary: " << segment_key_boundaries_[segment_id] << " " << lhs_key);
-        ASSERT(lhs_key < segment_key_boundaries_[segment_id + 1], 
-          "beyond boundary: " << lhs_key << " " << segment_key_boundaries_[segment_id + 1]);
+      ASSERT(segment_key_boundaries_[segment_id] <= key,
+        "beyond boundary: " << segment_key_boundaries_[segment_id] << " " << key);
+      ASSERT(key < segment_key_boundaries_[segment_id + 1],
+        "beyond boundary: " << key << " " << segment_key_boundaries_[segment_id + 1]);
 
-      } else {
+    } else {
 
-        ASSERT(segment_id == num_segments_ - 1, 
-          "incorrect segment id: " << segment_id << " " << num_segments_ - 1);
+      ASSERT(segment_id == num_segments_ - 1,
+        "incorrect segment id: " << segment_id << " " << num_segments_ - 1);
 
-        ASSERT(segment_key_boundaries_[segment_id] <= lhs_key, 
-          "beyond boundary: " << segment_key_boundaries_[segment_id] << " " << lhs_key);
-        ASSERT(lhs_key <= segment_key_boundaries_[segment_id + 1], 
-          "beyond boundary: " << lhs_key << " " << segment_key_boundaries_[segment_id + 1]);
-      }
+      ASSERT(segment_key_boundaries_[segment_id] <= key,
+        "beyond boundary: " << segment_key_boundaries_[segment_id] << " " << key);
+      ASSERT(key <= segment_key_boundaries_[segment_id + 1],
+        "beyond boundary: " << key << " " << segment_key_boundaries_[segment_id + 1]);
+    }
 
-      KeyT segment_key_range = segment_key_boundaries_[segment_id + 1] - segment_key_boundaries_[segment_id];
-      // guess where the data lives
-      guess = int64_t((lhs_key - segment_key_boundaries_[segment_id]) * 1.0 / segment_key_range * (segment_sizes_[segment_id] - 1) + segment_offset_boundaries_[segment_id]);
+    return segment_id;
+  }
 
-      // TODO: workaround!!
-      if (guess >= this->size_) {
-        guess = this->size_ - 1;
-      }
-    }
+  // guess the offset of key by interpolating within its segment.
+  // key must fall into the segment.
+  int64_t guess_offset(const KeyT &key, const size_t segment_id) const {
 
-    // if the guess is in [lhs_key, rhs_key]
-    if (this->container_[guess].key_ >= lhs_key && this->container_[guess].key_ <= rhs_key) {
-      values.push_back(this->container_[guess].value_);
-      
-      // move left
-      int64_t guess_lhs = guess - 1;
-      while (guess_lhs >= 0) {
-        if (this->container_[guess_lhs].key_ >= lhs_key) {
-          values.push_back(this->container_[guess_lhs].value_);
-          guess_lhs -= 1;
-        } else {
-          break;
-        }
-      }
-      // move right
-      int64_t guess_rhs = guess + 1;
-      while (guess_rhs <= this->size_ - 1) {
-        if (this->container_[guess_rhs].key_ <= rhs_key) {
-          values.push_back(this->container_[guess_rhs].value_);
-          guess_rhs += 1;
-        } else {
-          break;
-        }
-      }
+    KeyT segment_key_range = segment_key_boundaries_[segment_id + 1] - segment_key_boundaries_[segment_id];
+
+    // an empty segment, or a single key
+    if (segment_sizes_[segment_id] <= 1 || segment_key_range == 0) {
+      return std::min(segment_offset_boundaries_[segment_id], this->size_ - 1);
     }
-    else if (this->container_[guess].key_ > rhs_key) {
-      // move left
-      int64_t guess_lhs = guess - 1;
-      while (guess_lhs >= 0) {
-        if (this->container_[guess_lhs].key_ < lhs_key) {
-          break;
-        } else if (this->container_[guess_lhs].key_ <= rhs_key) {
-          values.push_back(this->container_[guess_lhs].value_);
-          guess_lhs -= 1;
-        } else {
-          guess_lhs -= 1;
-        }
-      }
+
+    int64_t guess = int64_t((key - segment_key_boundaries_[segment_id]) * 1.0 / segment_key_range * (segment_sizes_[segment_id] - 1) + segment_offset_boundaries_[segment_id]);
+
+    // TODO: workaround!!
+    if (guess >= this->size_) {
+      guess = this->size_ - 1;
     }
-    // if the guess is smaller than lhs_key
-    else {
-      // move right
-      guess += 1;
-      while (guess < this->size_ - 1) {
-        if (this->container_[guess].key_ < lhs_key) {
-          guess += 1;
-          continue;
-        }
-        else if (this->container_[guess].key_ > rhs_key) {
-          break;
-        }
-        else {
-          values.push_back(this->container_[guess].value_);
-          guess += 1;
-          continue;
-        }
+
+    return guess;
+  }
+
+  // offset of the first entry whose key is not smaller than key, or size_ if there is none.
+  // the lower bound of an existing key is at most error away from guess, so only that window is
+  // binary searched. missing keys may fall outside of it, and then the window is extended by
+  // exponential search.
+  size_t search_window(const KeyT &key, const int64_t guess, const size_t error) const {
+
+    // the lower bound is in [lhs_offset, rhs_offset]
+    size_t lhs_offset = std::max(guess - int64_t(error), int64_t(0));
+    size_t rhs_offset = std::min(size_t(guess) + error + 1, this->size_);
+
+    size_t step = 1;
+    while (lhs_offset > 0 && !(this->key_at(lhs_offset - 1) < key)) {
+      rhs_offset = lhs_offset - 1;
+      lhs_offset = (lhs_offset > step) ? lhs_offset - step : 0;
+      step *= 2;
+    }
+
+    step = 1;
+    while (rhs_offset < this->size_ && this->key_at(rhs_offset) < key) {
+      lhs_offset = rhs_offset + 1;
+      rhs_offset = std::min(rhs_offset + step, this->size_);
+      step *= 2;
+    }
+
+    size_t base = lhs_offset;
+    size_t length = rhs_offset - lhs_offset;
+    while (length > 0) {
+      size_t half = length / 2;
+      if (this->key_at(base + half) < key) {
+        base += half + 1;
+        length -= half + 1;
+      } else {
+        length = half;
       }
     }
-    return;
+    return base;
   }
 
 private:
 
   size_t num_segments_;
 
+  bool is_adaptive_;
+  size_t target_error_;
+
   KeyT key_min_;
   KeyT key_max_;
 
   // there are num_segments_ + 1 key boundaries in total
-  KeyT *segment_key_boundaries_; 
+  KeyT *segment_key_boundaries_;
 
   // there are num_segments_ offset boundaries in total
   size_t *segment_offset_boundaries_;
@@ -583,6 +574,9 @@ private:
   // there are num_segments_ elements in segment_sizes_
   size_t *segment_sizes_;
 
+  // the maximum distance between the guess of a key and its first entry, in each segment
+  size_t *segment_errors_;
+
   Stats stats_;
 };
 
@@ -1,29 +1,59 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 #include "base_static_index.h"
 
 
 namespace static_index {
 
+// each inner node holds (num_arys_ - 1) sorted separators, padded to a power of 2
+// (or to whole cachelines) so that nodes never straddle a cacheline.
+// a node is searched by comparing the search key against all its separators 
+// with SIMD instructions and counting the separators that are smaller,
+// as in Schlegel et al., "k-ary search on modern processors".
+// the scalar search, which stops at the first separator that is not smaller, can be selected instead.
 template<typename KeyT, typename ValueT>
 class KAryIndex : public BaseStaticIndex<KeyT, ValueT> {
 
+  typedef typename BaseStaticIndex<KeyT, ValueT>::InnerLayerTask InnerLayerTask;
+
+  typedef typename SimdKey<KeyT>::type SignedKeyT;
+
+  const size_t CACHELINE_SIZE = 64; // unit: byte
+
 public:
-  KAryIndex(DataTable<KeyT, ValueT> *table_ptr, const size_t num_layers, const size_t num_arys) : BaseStaticIndex<KeyT, ValueT>(table_ptr), num_layers_(num_layers), num_arys_(num_arys) {
+  KAryIndex(DataTable<KeyT, ValueT> *table_ptr, const size_t num_layers, const size_t num_arys, const LayoutType layout = LayoutType::AoSLayout) : BaseStaticIndex<KeyT, ValueT>(table_ptr, layout), num_layers_(num_layers), num_arys_(num_arys), inner_nodes_(nullptr), simd_search_(true) {
     ASSERT(num_arys_ >= 2, "num_arys must be larger than or equal to 2");
+
+    size_t cacheline_keys = CACHELINE_SIZE / sizeof(SignedKeyT);
+    node_stride_ = 1;
+    while (node_stride_ < num_arys_ - 1) {
+      node_stride_ *= 2;
+    }
+    if (node_stride_ > cacheline_keys) {
+      node_stride_ = (num_arys_ - 1 + cacheline_keys - 1) / cacheline_keys * cacheline_keys;
+    }
+
+    // nodes are compared one register at a time
+    simd_width_ = std::min(simd_max_width(), std::max(SSE2_WIDTH, node_stride_ * sizeof(SignedKeyT)));
+    simd_lanes_ = simd_width_ / sizeof(SignedKeyT);
   }
 
   virtual ~KAryIndex() {
-    if (num_layers_ != 0) {
-      delete[] inner_nodes_;
-      inner_nodes_ = nullptr;
+    if (!this->is_image()) {
+      huge_page_delete_array(inner_nodes_);
     }
+    inner_nodes_ = nullptr;
   }
 
-  virtual void find(const KeyT &key, std::vector<Uint64> &values) final {
+  // search inner nodes with SIMD comparisons, or with the scalar loop.
+  void set_simd_search(const bool simd_search) { simd_search_ = simd_search; }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
 
     if (this->size_ == 0) {
       return;
@@ -35,7 +65,7 @@ public:
     if (key_max_ == key_min_) {
       if (key_max_ == key) {
         for (size_t i = 0; i < this->size_; ++i) {
-          values.push_back(this->container_[i].value_);
+          if (!this->push_values(i, values)) { return; }
         }
       }
       return;
@@ -43,10 +73,11 @@ public:
 
     size_t offset_find = this->size_;
     std::pair<int, int> offset_range = find_inner_layers(key);
-    if (offset_range.first == offset_range.second) {
+    // a range of one entry may also be a leaf range that does not hold key
+    if (offset_range.first == offset_range.second && this->key_at(offset_range.first) == key) {
       offset_find = offset_range.first;
     } else {
-      offset_find = find_internal(key, offset_range.first, offset_range.second);
+      offset_find = this->find_leaf(key, offset_range.first, offset_range.second);
     }
 
     if (offset_find == this->size_) {
@@ -54,35 +85,50 @@ public:
       return;
     }
 
-    values.push_back(this->container_[offset_find].value_);
+    this->collect_values(key, offset_find, values);
+  }
 
-    // move left
-    int offset_find_lhs = offset_find - 1;
-    while (offset_find_lhs >= 0) {
 
-      if (this->container_[offset_find_lhs].key_ == key) {
-        values.push_back(this->container_[offset_find_lhs].value_);
-        offset_find_lhs -= 1;
-      } else {
-        break;
-      }
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
+
+    if (this->size_ == 0) {
+      return;
     }
-    // move right
-    int offset_find_rhs = offset_find + 1;
-    while (offset_find_rhs <= this->size_ - 1) {
 
-      if (this->container_[offset_find_rhs].key_ == key) {
-        values.push_back(this->container_[offset_find_rhs].value_);
-        offset_find_rhs += 1;
-      } else {
-        break;
+    int offset_begins[PREFETCH_GROUP_SIZE];
+    int offset_ends[PREFETCH_GROUP_SIZE];
+    size_t offsets[PREFETCH_GROUP_SIZE];
+
+    for (size_t group_begin = 0; group_begin < count; group_begin += PREFETCH_GROUP_SIZE) {
+
+      const KeyT *group_keys = keys + group_begin;
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, count - group_begin);
+
+      // inner layers are small and likely to be cached
+      for (size_t i = 0; i < group_size; ++i) {
+        if (group_keys[i] > key_max_ || group_keys[i] < key_min_) {
+          offset_begins[i] = 0;
+          offset_ends[i] = -1;
+          continue;
+        }
+        std::pair<int, int> offset_range = find_inner_layers(group_keys[i]);
+        offset_begins[i] = offset_range.first;
+        offset_ends[i] = std::min(offset_range.second, int(this->size_ - 1));
+      }
+
+      this->find_internal_batch(group_keys, group_size, offset_begins, offset_ends, offsets);
+
+      for (size_t i = 0; i < group_size; ++i) {
+        if (offsets[i] != this->size_) {
+          this->collect_values(group_keys[i], offsets[i], values[group_begin + i]);
+        }
       }
     }
   }
 
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
 
-  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, std::vector<Uint64> &values) final {
-    ASSERT(lhs_key < rhs_key, "lhs_key must be smaller than rhs_key: " << lhs_key << " " << rhs_key);
+    if (lhs_key > rhs_key) { return; }
 
     if (this->size_ == 0) {
       return;
@@ -91,108 +137,158 @@ public:
       return;
     }
 
-  }
+    if (lhs_key <= key_min_) {
+      this->collect_range(lhs_key, rhs_key, 0, -1, values);
+      return;
+    }
+
+    // locate the lower bound through the inner layers
+    std::pair<int, int> offset_range = find_inner_layers(lhs_key);
 
-  virtual void reorganize() final {
+    this->collect_range(lhs_key, rhs_key, offset_range.first, offset_range.second, values);
+  }
 
-    this->base_reorganize();
+  virtual void reorganize(const size_t thread_count) final {
 
     inner_node_count_ = std::pow(num_arys_, num_layers_) - 1;
 
+    this->base_reorganize(thread_count, inner_node_count_);
+
     ASSERT(inner_node_count_ < this->size_, "exceed maximum layers");
 
-    key_min_ = this->container_[0].key_;
-    key_max_ = this->container_[this->size_ - 1].key_;
+    key_min_ = this->key_at(0);
+    key_max_ = this->key_at(this->size_ - 1);
 
     if (num_layers_ != 0) {
 
-      inner_nodes_ = new KeyT[inner_node_count_];
-      construct_inner_layers();
+      size_t inner_size = inner_nodes_size();
+      inner_nodes_ = huge_page_new_array<SignedKeyT>(inner_size);
+      std::fill(inner_nodes_, inner_nodes_ + inner_size, std::numeric_limits<SignedKeyT>::max());
 
-    } else {
-      inner_nodes_ = nullptr;
+      construct_inner_layers(thread_count);
     }
   }
 
   virtual void print() const final {
+    std::cout << "node search: " << (simd_search_ ? simd_block_search_name(simd_width_, sizeof(SignedKeyT)) : "scalar") << std::endl;
+
     if (inner_nodes_ != nullptr) {
 
-      for (size_t i = 0; i < inner_node_count_; ++i) {
-        std::cout << inner_nodes_[i] << " ";
+      size_t node_count = inner_node_count_ / (num_arys_ - 1);
+      for (size_t i = 0; i < node_count; ++i) {
+        for (size_t j = 0; j < num_arys_ - 1; ++j) {
+          std::cout << SimdKey<KeyT>::decode(inner_nodes_[i * node_stride_ + j]) << " ";
+        }
       }
       std::cout << std::endl;
     }
   }
 
+protected:
+
+  virtual void serialize_inner(IndexImageWriter &writer) const final {
+    writer.write_value(uint64_t(num_layers_));
+    writer.write_value(uint64_t(num_arys_));
+    writer.write_value(uint64_t(node_stride_));
+    if (num_layers_ != 0) {
+      writer.write_array(inner_nodes_, inner_nodes_size());
+    }
+  }
+
+  virtual bool load_inner(IndexImageReader &reader) final {
+
+    if (reader.read_value<uint64_t>() != num_layers_ || reader.read_value<uint64_t>() != num_arys_) {
+      return false;
+    }
+    if (reader.read_value<uint64_t>() != node_stride_) {
+      return false;
+    }
+
+    inner_node_count_ = std::pow(num_arys_, num_layers_) - 1;
+
+    key_min_ = this->key_at(0);
+    key_max_ = this->key_at(this->size_ - 1);
+
+    if (num_layers_ != 0) {
+      size_t count = 0;
+      inner_nodes_ = reader.read_array<SignedKeyT>(count);
+      return count == inner_nodes_size();
+    }
+    return true;
+  }
+
 private:
 
-  void construct_inner_layers() {
+  // padding separators are never smaller than a search key.
+  // a register beyond the last node may be loaded, hence the extra cacheline. unit: separators
+  size_t inner_nodes_size() const {
+    size_t node_count = inner_node_count_ / (num_arys_ - 1);
+    return node_count * node_stride_ + CACHELINE_SIZE / sizeof(SignedKeyT);
+  }
+
+  void construct_inner_layers(const size_t thread_count) {
     ASSERT (num_layers_ != 0, "number of layers cannot be 0");
 
     size_t begin_offset = 0;
     size_t end_offset = this->size_ - 1;
 
-    size_t step_offset = (end_offset - begin_offset) / num_arys_;
-    
-    // construct the first layer (layer 0)
-    for (size_t i = 0; i < num_arys_ - 1; ++i) {
-      ASSERT(i < inner_node_count_, 
-        "out of array: " << i << " " << inner_node_count_);
-
-      inner_nodes_[i] = this->container_[begin_offset + step_offset * (i + 1)].key_;
+    // subtrees rooted at task_layer do not overlap, so they are built in parallel.
+    size_t task_layer = num_layers_;
+    if (thread_count > 1) {
+      task_layer = 1;
+      while (task_layer + 1 < num_layers_ && std::pow(num_arys_, task_layer) < thread_count * 4) {
+        ++task_layer;
+      }
     }
-    if (num_layers_ == 1) { return; }
 
-    size_t base_pos = num_arys_ - 1;
-    size_t next_layer = 1;
+    std::vector<InnerLayerTask> tasks;
 
-    // construct (num_arys_ + 1) children
-    construct_inner_layers_internal(begin_offset, begin_offset + step_offset - 1, base_pos, 0, next_layer);
-    for (size_t i = 1; i < num_arys_ - 1; ++i) {
-      construct_inner_layers_internal(begin_offset + step_offset * i + 1, begin_offset + step_offset * (i + 1) - 1, base_pos, i * (num_arys_ - 1), next_layer);
-    }
-    construct_inner_layers_internal(begin_offset + step_offset * (num_arys_ - 1) + 1, end_offset, base_pos, (num_arys_ - 1) * (num_arys_ - 1), next_layer);
+    construct_inner_layers_internal(begin_offset, end_offset, 0, 0, 0, task_layer, tasks);
+
+    this->run_inner_layer_tasks(tasks, thread_count, [&](const InnerLayerTask &task) {
+      construct_inner_layers_internal(task.begin_offset_, task.end_offset_, task.base_pos_, task.dst_pos_, task.layer_, num_layers_, tasks);
+    });
   }
 
-  void construct_inner_layers_internal(const int begin_offset, const int end_offset, const size_t base_pos, const size_t dst_pos, const size_t curr_layer) {
+  // build the subtree rooted at inner node (base_pos + dst_pos), where base_pos is 
+  // the first node of curr_layer and dst_pos is the position of the node in curr_layer.
+  // subtrees rooted at task_layer are not built, but appended to tasks.
+  void construct_inner_layers_internal(const int begin_offset, const int end_offset, const size_t base_pos, const size_t dst_pos, const size_t curr_layer, const size_t task_layer, std::vector<InnerLayerTask> &tasks) {
     if (begin_offset > end_offset) { return; }
 
+    if (curr_layer == task_layer) {
+      tasks.emplace_back(begin_offset, end_offset, base_pos, dst_pos, curr_layer);
+      return;
+    }
+
     size_t step_offset = (end_offset - begin_offset) / num_arys_;
+
+    SignedKeyT *node = inner_nodes_ + (base_pos + dst_pos) * node_stride_;
     
     for (size_t i = 0; i < num_arys_ - 1; ++i) {
-      ASSERT(base_pos + dst_pos + i < inner_node_count_, 
-        "out of array: " << (base_pos + dst_pos + i) << " " << inner_node_count_);
+      ASSERT((base_pos + dst_pos) * (num_arys_ - 1) + i < inner_node_count_, 
+        "out of array: " << (base_pos + dst_pos) << " " << inner_node_count_);
 
-      inner_nodes_[base_pos + dst_pos + i] = this->container_[begin_offset + step_offset * (i + 1)].key_;
+      node[i] = SimdKey<KeyT>::encode(this->key_at(begin_offset + step_offset * (i + 1)));
     }
     if (num_layers_ == curr_layer + 1) { return; }
 
-    size_t new_base_pos = (base_pos + 1) * num_arys_ - 1;
+    size_t new_base_pos = base_pos * num_arys_ + 1;
     size_t new_dst_pos = dst_pos * num_arys_;
     size_t next_layer = curr_layer + 1;
-    construct_inner_layers_internal(begin_offset, begin_offset + step_offset - 1, new_base_pos, new_dst_pos, next_layer);
-    for (size_t i = 1; i < num_arys_ - 1; ++i) {
-      construct_inner_layers_internal(begin_offset + step_offset * i + 1, begin_offset + step_offset * (i + 1) - 1, new_base_pos, new_dst_pos + i * (num_arys_ - 1), next_layer);
+
+    for (size_t i = 0; i < num_arys_; ++i) {
+      std::pair<int, int> child = child_range(begin_offset, end_offset, step_offset, i);
+      construct_inner_layers_internal(child.first, child.second, new_base_pos, new_dst_pos + i, next_layer, task_layer, tasks);
     }
-    construct_inner_layers_internal(begin_offset + step_offset * (num_arys_ - 1) + 1, end_offset, new_base_pos, new_dst_pos + (num_arys_ - 1) * (num_arys_ - 1), next_layer);
   }
 
-  // binary search
-  // this function directly find key in leaf nodes
-  size_t find_internal(const KeyT &key, const int offset_begin, const int offset_end) {
-    if (offset_begin > offset_end) {
-      return this->size_;
-    }
-    int offset_lookup = (offset_begin + offset_end) / 2;
-    KeyT key_lookup = this->container_[offset_lookup].key_;
-    if (key == key_lookup) {
-      return offset_lookup;
-    }
-    if (key > key_lookup) {
-      return find_internal(key, offset_lookup + 1, offset_end);
-    } else {
-      return find_internal(key, offset_begin, offset_lookup - 1);
-    }
+  // entries covered by the i-th child of a node covering [begin_offset, end_offset].
+  // the entries of the separators are not covered by any child.
+  std::pair<int, int> child_range(const int begin_offset, const int end_offset, const size_t step_offset, const size_t i) const {
+    int child_begin = (i == 0) ? begin_offset : begin_offset + step_offset * i + 1;
+    int child_end = (i == num_arys_ - 1) ? end_offset : begin_offset + step_offset * (i + 1) - 1;
+    return std::pair<int, int>(child_begin, child_end);
   }
 
   // find key in inner nodes
@@ -200,58 +296,65 @@ private:
 
     if (num_layers_ == 0) { return std::pair<int, int>(0, this->size_); }
 
+    SignedKeyT signed_key = SimdKey<KeyT>::encode(key);
+
     int begin_offset = 0;
     int end_offset = this->size_ - 1;
 
-    size_t step_offset = (end_offset - begin_offset) / num_arys_;
+    // the current node is (base_pos + dst_pos)
+    size_t base_pos = 0;
+    size_t dst_pos = 0;
 
-    for (size_t i = 0; i < num_arys_ - 1; ++i) {
-      if (key == inner_nodes_[i]) { return std::pair<int, int>(begin_offset + step_offset * (i + 1), begin_offset + step_offset * (i + 1)); }
-    }
+    for (size_t layer = 0; layer < num_layers_; ++layer) {
 
-    size_t base_pos = num_arys_ - 1;
-    size_t next_layer = 1;
+      // nodes of empty ranges are not built
+      if (begin_offset > end_offset) { break; }
 
-    if (key < inner_nodes_[0]) {
-      return find_inner_layers_internal(key, begin_offset, begin_offset + step_offset - 1, base_pos, 0, next_layer);
-    }
+      const SignedKeyT *node = inner_nodes_ + (base_pos + dst_pos) * node_stride_;
 
-    for (size_t i = 1; i < num_arys_ - 1; ++i) {
-      if (key < inner_nodes_[i]) {
-        return find_inner_layers_internal(key, begin_offset + step_offset * i + 1, begin_offset + step_offset * (i + 1) - 1, base_pos, i * (num_arys_ - 1), next_layer);
-      }
-    }
-
-    return find_inner_layers_internal(key, begin_offset + step_offset * (num_arys_ - 1) + 1, end_offset, base_pos, (num_arys_ - 1) * (num_arys_ - 1), next_layer);
-  }
+      size_t branch_id = simd_search_ ? lookup_node_simd(signed_key, node) : lookup_node_scalar(signed_key, node);
 
-  // helper function for find_inner_layers()
-  std::pair<int, int> find_inner_layers_internal(const KeyT &key, const int begin_offset, const int end_offset, const size_t base_pos, const size_t dst_pos, const size_t curr_layer) {
+      size_t step_offset = (end_offset - begin_offset) / num_arys_;
 
-    if (num_layers_ == curr_layer) { return std::pair<int, int>(begin_offset, end_offset); }
+      if (branch_id < num_arys_ - 1 && node[branch_id] == signed_key) {
+        int offset = begin_offset + step_offset * (branch_id + 1);
+        return std::pair<int, int>(offset, offset);
+      }
 
-    size_t step_offset = (end_offset - begin_offset) / num_arys_;
+      std::pair<int, int> child = child_range(begin_offset, end_offset, step_offset, branch_id);
+      begin_offset = child.first;
+      end_offset = child.second;
 
-    for (size_t i = 0; i < num_arys_ - 1; ++i) {
-      if (key == inner_nodes_[base_pos + dst_pos + i]) { 
-        return std::pair<int, int>(begin_offset + step_offset * (i + 1), begin_offset + step_offset * (i + 1)); }
+      base_pos = base_pos * num_arys_ + 1;
+      dst_pos = dst_pos * num_arys_ + branch_id;
     }
 
-    size_t new_base_pos = (base_pos + 1) * num_arys_ - 1;
-    size_t new_dst_pos = dst_pos * num_arys_;
-    size_t next_layer = curr_layer + 1;
-
-    if (key < inner_nodes_[base_pos + dst_pos]) {
-      return find_inner_layers_internal(key, begin_offset, begin_offset + step_offset - 1, new_base_pos, new_dst_pos, next_layer);
-    }
+    return std::pair<int, int>(begin_offset, end_offset);
+  }
 
-    for (size_t i = 1; i < num_arys_ - 1; ++i) {
-      if (key < inner_nodes_[base_pos + dst_pos + i]) {
-        return find_inner_layers_internal(key, begin_offset + step_offset * i + 1, begin_offset + step_offset * (i + 1) - 1, new_base_pos, new_dst_pos + i * (num_arys_ - 1), next_layer);
+  // number of separators in node that are smaller than key.
+  size_t lookup_node_simd(const SignedKeyT key, const SignedKeyT *node) const {
+    size_t branch_id = 0;
+    for (size_t i = 0; i < num_arys_ - 1; i += simd_lanes_) {
+      // a register may extend into the next node
+      size_t count = std::min(simd_lanes_, num_arys_ - 1 - i);
+      if (simd_width_ == AVX512_WIDTH) {
+        branch_id += simd_block_count_less_avx512(node + i, key, count);
+      } else if (simd_width_ == AVX2_WIDTH) {
+        branch_id += simd_block_count_less_avx2(node + i, key, count);
+      } else {
+        branch_id += simd_block_count_less_sse2(node + i, key, count);
       }
     }
+    return branch_id;
+  }
 
-    return find_inner_layers_internal(key, begin_offset + step_offset * (num_arys_ - 1) + 1, end_offset, new_base_pos, new_dst_pos + (num_arys_ - 1) * (num_arys_ - 1), next_layer);
+  size_t lookup_node_scalar(const SignedKeyT key, const SignedKeyT *node) const {
+    size_t branch_id = 0;
+    while (branch_id < num_arys_ - 1 && node[branch_id] < key) {
+      ++branch_id;
+    }
+    return branch_id;
   }
 
 
@@ -262,8 +365,15 @@ private:
 
   KeyT key_min_;
   KeyT key_max_;
-  KeyT *inner_nodes_;
-  size_t inner_node_count_;
+
+  // nodes in BFS order, each taking node_stride_ keys. aligned to a cacheline.
+  SignedKeyT *inner_nodes_;
+  size_t inner_node_count_; // unit: separators
+  size_t node_stride_;
+
+  bool simd_search_;
+  size_t simd_width_; // unit: byte
+  size_t simd_lanes_;
 
 };
 
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include "base_static_index.h"
+
+namespace static_index {
+
+// a learned index: a piecewise linear model that maps a key to its offset in the sorted entries,
+// with every prediction off by at most error_bound_ entries.
+// the segments are trained in reorganize(), and indexed recursively by the same kind of model
+// over their first keys, until a single segment is left, as in
+// Ferragina and Vinciguerra, "The PGM-index: a fully-dynamic compressed learned index with provable worst-case bounds".
+// a lookup walks down one segment per level, and finishes with a binary search in the error window.
+template<typename KeyT, typename ValueT>
+class PgmIndex : public BaseStaticIndex<KeyT, ValueT> {
+
+  static const size_t DEFAULT_ERROR_BOUND = 64;
+  static const size_t DEFAULT_INNER_ERROR_BOUND = 4;
+
+  // predictions are truncated, and slopes are rounded, so windows are widened by a little slack.
+  static const size_t PREDICTION_SLACK = 2;
+
+  // predicts intercept_ + slope_ * (key - key_) for keys from key_ up to the key_ of the next segment.
+  struct Segment {
+    KeyT key_;
+    double slope_;
+    size_t intercept_;
+  };
+
+  // greedy shrinking cone: a segment starts at its first point, and keeps the range of slopes
+  // that predict every point added to it within error. a point that empties the range starts a new segment.
+  // points are added in increasing order of both keys and positions.
+  class SegmentBuilder {
+  public:
+    SegmentBuilder(const size_t error, std::vector<Segment> &segments) :
+      error_(error), segments_(segments), is_open_(false), first_key_(0), first_pos_(0), slope_lo_(0), slope_hi_(0) {}
+
+    void add_point(const KeyT key, const size_t pos) {
+      if (is_open_) {
+        double dx = double(key - first_key_);
+        double dy = double(pos) - double(first_pos_);
+        double slope_lo = (dy - error_) / dx;
+        double slope_hi = (dy + error_) / dx;
+
+        if (slope_lo <= slope_hi_ && slope_hi >= slope_lo_) {
+          slope_lo_ = std::max(slope_lo_, slope_lo);
+          slope_hi_ = std::min(slope_hi_, slope_hi);
+          return;
+        }
+        close();
+      }
+      is_open_ = true;
+      first_key_ = key;
+      first_pos_ = pos;
+      slope_lo_ = 0;
+      slope_hi_ = std::numeric_limits<double>::max();
+    }
+
+    void finish() {
+      if (is_open_) {
+        close();
+        is_open_ = false;
+      }
+    }
+
+  private:
+    // the middle of the cone. positions never decrease, so a non-negative slope is always in it.
+    void close() {
+      double slope = (slope_hi_ == std::numeric_limits<double>::max()) ? 0 : (slope_lo_ + slope_hi_) / 2;
+      segments_.push_back(Segment{ first_key_, std::max(slope, 0.0), first_pos_ });
+    }
+
+  private:
+    const size_t error_;
+    std::vector<Segment> &segments_;
+
+    bool is_open_;
+    KeyT first_key_;
+    size_t first_pos_;
+    double slope_lo_;
+    double slope_hi_;
+  };
+
+public:
+  // error bounds below 1 select the defaults.
+  PgmIndex(DataTable<KeyT, ValueT> *table_ptr, const int error_bound = -1, const int inner_error_bound = -1, const LayoutType layout = LayoutType::AoSLayout) :
+    BaseStaticIndex<KeyT, ValueT>(table_ptr, layout), key_min_(0), key_max_(0) {
+
+    error_bound_ = (error_bound >= 1) ? error_bound : DEFAULT_ERROR_BOUND;
+    inner_error_bound_ = (inner_error_bound >= 1) ? inner_error_bound : DEFAULT_INNER_ERROR_BOUND;
+  }
+
+  virtual ~PgmIndex() {}
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    if (key < key_min_ || key > key_max_) {
+      return;
+    }
+
+    // an existing key is always within the error window of its first entry
+    std::pair<size_t, size_t> window = search_window(key);
+    size_t offset = this->find_leaf(key, window.first, int64_t(window.second) - 1);
+
+    if (offset == this->size_) {
+      // find nothing
+      return;
+    }
+
+    this->collect_values(key, offset, values);
+  }
+
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    std::pair<size_t, size_t> windows[PREFETCH_GROUP_SIZE];
+
+    for (size_t group_begin = 0; group_begin < count; group_begin += PREFETCH_GROUP_SIZE) {
+
+      const KeyT *group_keys = keys + group_begin;
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, count - group_begin);
+
+      // the models of all lookups in the group are evaluated before any of their windows is searched.
+      for (size_t i = 0; i < group_size; ++i) {
+        if (group_keys[i] < key_min_ || group_keys[i] > key_max_) {
+          windows[i] = std::make_pair(size_t(0), size_t(0));
+          continue;
+        }
+        windows[i] = search_window(group_keys[i]);
+        this->prefetch_key((windows[i].first + windows[i].second) / 2);
+      }
+
+      for (size_t i = 0; i < group_size; ++i) {
+        size_t offset = this->find_leaf(group_keys[i], windows[i].first, int64_t(windows[i].second) - 1);
+        if (offset != this->size_) {
+          this->collect_values(group_keys[i], offset, values[group_begin + i]);
+        }
+      }
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    if (lhs_key > key_max_) {
+      return;
+    }
+
+    int64_t offset = (lhs_key < key_min_) ? 0 : lower_bound_offset(lhs_key);
+
+    this->collect_range(lhs_key, rhs_key, offset, offset - 1, values);
+  }
+
+  virtual void reorganize(const size_t thread_count) final {
+
+    this->base_reorganize(thread_count);
+
+    segments_.clear();
+    level_offsets_.clear();
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    key_min_ = this->key_at(0);
+    key_max_ = this->key_at(this->size_ - 1);
+
+    // the points are the first entries of distinct keys.
+    // each thread trains the segments of a range of entries, and the ranges are then concatenated.
+    std::vector<std::vector<Segment>> thread_segments(thread_count);
+
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      size_t begin = first_entry_from(this->size_ * thread_id / thread_count);
+      size_t end = first_entry_from(this->size_ * (thread_id + 1) / thread_count);
+
+      SegmentBuilder builder(error_bound_, thread_segments[thread_id]);
+      for (size_t offset = begin; offset < end; ++offset) {
+        if (offset == begin || this->key_at(offset) != this->key_at(offset - 1)) {
+          builder.add_point(this->key_at(offset), offset);
+        }
+      }
+      builder.finish();
+    });
+
+    level_offsets_.push_back(0);
+    for (auto &segments : thread_segments) {
+      segments_.insert(segments_.end(), segments.begin(), segments.end());
+    }
+    level_offsets_.push_back(segments_.size());
+
+    // each upper level maps the first keys of the level below to their segment ids.
+    while (level_offsets_.back() - level_offsets_[level_offsets_.size() - 2] > 1) {
+      size_t level_begin = level_offsets_[level_offsets_.size() - 2];
+      size_t level_end = level_offsets_.back();
+
+      std::vector<Segment> level_segments;
+      SegmentBuilder builder(inner_error_bound_, level_segments);
+      for (size_t i = level_begin; i < level_end; ++i) {
+        builder.add_point(segments_[i].key_, i - level_begin);
+      }
+      builder.finish();
+
+      segments_.insert(segments_.end(), level_segments.begin(), level_segments.end());
+      level_offsets_.push_back(segments_.size());
+    }
+  }
+
+  virtual void print() const final {
+    size_t level_count = this->level_count();
+
+    std::cout << "error bound: " << error_bound_ << ", inner error bound: " << inner_error_bound_ << std::endl;
+    std::cout << "number of levels: " << level_count << std::endl;
+
+    // an empty index has no levels
+    if (level_count == 0) {
+      return;
+    }
+
+    for (size_t level = 0; level < level_count; ++level) {
+      std::cout << "level " << level << ": " << level_offsets_[level + 1] - level_offsets_[level] << " segments" << std::endl;
+    }
+    std::cout << "model size: " << model_size() << " bytes (" << model_size() * 1.0 / this->size_ << " bytes per key)" << std::endl;
+  }
+
+  // number of bytes taken by the segments of all levels.
+  size_t model_size() const {
+    return segments_.size() * sizeof(Segment) + level_offsets_.size() * sizeof(size_t);
+  }
+
+  size_t level_count() const {
+    return level_offsets_.empty() ? 0 : level_offsets_.size() - 1;
+  }
+
+protected:
+
+  virtual void serialize_inner(IndexImageWriter &writer) const final {
+    writer.write_value(uint64_t(error_bound_));
+    writer.write_value(uint64_t(inner_error_bound_));
+    writer.write_array(segments_.data(), segments_.size());
+    writer.write_array(level_offsets_.data(), level_offsets_.size());
+  }
+
+  // the model is small, so it is copied out of the image.
+  virtual bool load_inner(IndexImageReader &reader) final {
+
+    if (reader.read_value<uint64_t>() != error_bound_ || reader.read_value<uint64_t>() != inner_error_bound_) {
+      return false;
+    }
+
+    size_t count = 0;
+    const Segment *segments = reader.read_array<Segment>(count);
+    if (!reader.is_valid()) {
+      return false;
+    }
+    segments_.assign(segments, segments + count);
+
+    const size_t *level_offsets = reader.read_array<size_t>(count);
+    if (!reader.is_valid()) {
+      return false;
+    }
+    level_offsets_.assign(level_offsets, level_offsets + count);
+
+    if (this->size_ != 0) {
+      key_min_ = this->key_at(0);
+      key_max_ = this->key_at(this->size_ - 1);
+    }
+    return true;
+  }
+
+private:
+
+  // the first entry at or after offset whose key differs from its predecessor, or size_ if there is none.
+  size_t first_entry_from(size_t offset) const {
+    while (offset > 0 && offset < this->size_ && this->key_at(offset) == this->key_at(offset - 1)) {
+      ++offset;
+    }
+    return offset;
+  }
+
+  // the prediction of segment for key, clamped to [intercept_, end]
+  // where end is the first position covered by the next segment.
+  // key must not be smaller than the first key of segment.
+  static size_t predict(const Segment &segment, const KeyT &key, const size_t end) {
+    double delta = segment.slope_ * double(key - segment.key_);
+    if (delta >= double(end - segment.intercept_)) {
+      return end;
+    }
+    return segment.intercept_ + size_t(delta);
+  }
+
+  // the error window [first, second) around the prediction, within [intercept_, end).
+  static std::pair<size_t, size_t> predict_window(const Segment &segment, const KeyT &key, const size_t end, const size_t error) {
+    size_t pos = predict(segment, key, end);
+    size_t window_begin = (pos > segment.intercept_ + error + PREDICTION_SLACK) ? pos - error - PREDICTION_SLACK : segment.intercept_;
+    size_t window_end = std::min(end, pos + error + PREDICTION_SLACK + 1);
+    return std::make_pair(window_begin, window_end);
+  }
+
+  // the error window of the entries that holds the first entry of key, if key exists.
+  // key must fall into [key_min_, key_max_].
+  std::pair<size_t, size_t> search_window(const KeyT &key) const {
+
+    size_t level = level_offsets_.size() - 2;
+    size_t segment_id = 0;
+
+    for (; level > 0; --level) {
+      const Segment *segments = segments_.data() + level_offsets_[level];
+      const Segment *lower_segments = segments_.data() + level_offsets_[level - 1];
+      size_t segment_count = level_offsets_[level + 1] - level_offsets_[level];
+      size_t lower_segment_count = level_offsets_[level] - level_offsets_[level - 1];
+
+      size_t end = (segment_id + 1 < segment_count) ? segments[segment_id + 1].intercept_ : lower_segment_count;
+      std::pair<size_t, size_t> window = predict_window(segments[segment_id], key, end, inner_error_bound_);
+
+      // the last segment of the lower level whose first key is not larger than key.
+      // the first segment of the window always qualifies.
+      size_t base = window.first;
+      size_t length = window.second - window.first;
+      while (length > 1) {
+        size_t half = length / 2;
+        base = (lower_segments[base + half].key_ <= key) ? base + half : base;
+        length -= half;
+      }
+      segment_id = base;
+    }
+
+    size_t end = (segment_id + 1 < level_offsets_[1]) ? segments_[segment_id + 1].intercept_ : this->size_;
+    return predict_window(segments_[segment_id], key, end, error_bound_);
+  }
+
+  // offset of the first entry whose key is not smaller than key, or size_ if there is none.
+  // key must fall into [key_min_, key_max_].
+  size_t lower_bound_offset(const KeyT &key) const {
+    std::pair<size_t, size_t> window = search_window(key);
+
+    size_t offset = lower_bound_offset(key, window.first, window.second);
+    if (offset < window.second) {
+      return offset;
+    }
+
+    // the lower bound of a missing key that follows a run of duplicate keys may lie beyond the window.
+    // gallop to the right until an entry is not smaller than key.
+    size_t begin = window.second;
+    size_t end = window.second;
+    size_t step = 1;
+    while (end < this->size_ && this->key_at(end) < key) {
+      begin = end + 1;
+      end += step;
+      step *= 2;
+    }
+    return lower_bound_offset(key, begin, std::min(end, this->size_));
+  }
+
+  // offset of the first entry in [offset_begin, offset_end) whose key is not smaller than key, or offset_end if there is none.
+  size_t lower_bound_offset(const KeyT &key, const size_t offset_begin, const size_t offset_end) const {
+    size_t base = offset_begin;
+    size_t length = offset_end - offset_begin;
+    while (length > 0) {
+      size_t half = length / 2;
+      if (this->key_at(base + half) < key) {
+        base += half + 1;
+        length -= half + 1;
+      } else {
+        length = half;
+      }
+    }
+    return base;
+  }
+
+private:
+
+  size_t error_bound_;
+  size_t inner_error_bound_;
+
+  KeyT key_min_;
+  KeyT key_max_;
+
+  // segments of all levels, from the entries upwards. the last level has a single segment.
+  std::vector<Segment> segments_;
+
+  // segments of level i are segments_[level_offsets_[i], level_offsets_[i + 1]).
+  std::vector<size_t> level_offsets_;
+
+};
+
+}
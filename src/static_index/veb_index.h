@@ -0,0 +1,206 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "base_static_index.h"
+
+namespace static_index {
+
+// a binary search tree over the entire key set, stored in van Emde Boas order:
+// a tree is split at half its height into a top tree and the bottom trees below it,
+// the top tree is stored first, followed by the bottom trees from left to right,
+// and each of them is laid out the same way recursively.
+// any subtree of height h then spans O(1) blocks of 2^h nodes, whatever the block size.
+// the tree is a perfect one, padded with copies of the largest key.
+// positions are computed with per-depth tables as in
+// Brodal, Fagerberg and Jacob, "Cache oblivious search trees via binary trees of small height".
+template<typename KeyT, typename ValueT>
+class VebIndex : public BaseStaticIndex<KeyT, ValueT> {
+
+  static const size_t MAX_LEVELS = 64;
+
+public:
+  VebIndex(DataTable<KeyT, ValueT> *table_ptr, const LayoutType layout = LayoutType::AoSLayout) :
+    BaseStaticIndex<KeyT, ValueT>(table_ptr, layout), tree_(nullptr), tree_size_(0), levels_(0) {}
+
+  virtual ~VebIndex() {
+    if (!this->is_image()) {
+      huge_page_delete_array(tree_);
+    }
+    tree_ = nullptr;
+  }
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    size_t offset = lower_bound_offset(key);
+
+    if (offset == this->size_ || this->key_at(offset) != key) {
+      // find nothing
+      return;
+    }
+
+    this->collect_values(key, offset, values);
+  }
+
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
+    for (size_t i = 0; i < count; ++i) {
+      find(keys[i], values[i]);
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+
+    if (lhs_key > rhs_key) { return; }
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    int64_t offset = lower_bound_offset(lhs_key);
+
+    this->collect_range(lhs_key, rhs_key, offset, offset - 1, values);
+  }
+
+  virtual void reorganize(const size_t thread_count) final {
+
+    this->base_reorganize(thread_count);
+
+    if (this->size_ == 0) {
+      return;
+    }
+
+    construct_levels();
+
+    tree_ = huge_page_new_array<KeyT>(tree_size_);
+
+    KeyT key_max = this->key_at(this->size_ - 1);
+
+    run_parallel(thread_count, [&](const size_t thread_id) {
+      size_t begin = 1 + tree_size_ * thread_id / thread_count;
+      size_t end = 1 + tree_size_ * (thread_id + 1) / thread_count;
+      for (size_t node = begin; node < end; ++node) {
+        size_t rank = node_rank(node);
+        tree_[node_position(node)] = (rank < this->size_) ? this->key_at(rank) : key_max;
+      }
+    });
+  }
+
+  virtual void print() const final {
+    for (size_t i = 0; i < tree_size_; ++i) {
+      std::cout << tree_[i] << " ";
+    }
+    std::cout << std::endl;
+  }
+
+protected:
+
+  virtual void serialize_inner(IndexImageWriter &writer) const final {
+    if (this->size_ != 0) {
+      writer.write_array(tree_, tree_size_);
+    }
+  }
+
+  virtual bool load_inner(IndexImageReader &reader) final {
+    if (this->size_ == 0) {
+      return true;
+    }
+
+    construct_levels();
+
+    size_t count = 0;
+    tree_ = reader.read_array<KeyT>(count);
+    return count == tree_size_;
+  }
+
+private:
+
+  void construct_levels() {
+    levels_ = 64 - __builtin_clzll(this->size_);
+    tree_size_ = (size_t(1) << levels_) - 1;
+
+    ASSERT(levels_ < MAX_LEVELS, "exceed maximum levels");
+
+    construct_tables(0, levels_);
+  }
+
+  // fill the tables for the subtree of the given levels whose root is at depth.
+  // the bottom trees take the largest power of 2 levels that is smaller than levels.
+  void construct_tables(const size_t depth, const size_t levels) {
+    if (levels <= 1) { return; }
+
+    size_t bottom_levels = (size_t(1) << (64 - __builtin_clzll(levels - 1))) / 2;
+    size_t top_levels = levels - bottom_levels;
+    size_t bottom_depth = depth + top_levels;
+
+    top_sizes_[bottom_depth] = (size_t(1) << top_levels) - 1;
+    bottom_sizes_[bottom_depth] = (size_t(1) << bottom_levels) - 1;
+    top_depths_[bottom_depth] = depth;
+
+    construct_tables(depth, top_levels);
+    construct_tables(bottom_depth, bottom_levels);
+  }
+
+  // position of a node in tree_, given the positions of its ancestors.
+  // the low bits of node pick its bottom tree among those below the top tree.
+  size_t child_position(const size_t node, const size_t depth, const size_t *positions) const {
+    return positions[top_depths_[depth]] + top_sizes_[depth] + (node & top_sizes_[depth]) * bottom_sizes_[depth];
+  }
+
+  // position of the node with BFS number node in tree_.
+  size_t node_position(const size_t node) const {
+    size_t positions[MAX_LEVELS];
+    size_t node_depth = 63 - __builtin_clzll(node);
+
+    positions[0] = 0;
+    for (size_t depth = 1; depth <= node_depth; ++depth) {
+      positions[depth] = child_position(node >> (node_depth - depth), depth, positions);
+    }
+    return positions[node_depth];
+  }
+
+  // position of the node with BFS number node in the sorted entries.
+  size_t node_rank(const size_t node) const {
+    size_t depth = 63 - __builtin_clzll(node);
+    return ((2 * (node - (size_t(1) << depth)) + 1) << (levels_ - 1 - depth)) - 1;
+  }
+
+  // offset of the first entry whose key is not smaller than key, or size_ if there is none.
+  size_t lower_bound_offset(const KeyT &key) const {
+    size_t positions[MAX_LEVELS];
+
+    positions[0] = 0;
+    size_t node = 2 + (tree_[0] < key);
+
+    for (size_t depth = 1; depth < levels_; ++depth) {
+      positions[depth] = child_position(node, depth, positions);
+      node = 2 * node + (tree_[positions[depth]] < key);
+    }
+
+    // strip the trailing right turns, and the last left turn.
+    node >>= __builtin_ffsll(~node);
+
+    // padding nodes only hold the largest key, which a real entry precedes.
+    return (node == 0) ? this->size_ : node_rank(node);
+  }
+
+private:
+
+  // perfect tree of levels_ levels, in van Emde Boas order. aligned to a cacheline.
+  KeyT *tree_;
+  size_t tree_size_;
+  size_t levels_;
+
+  // for the root of each bottom tree at a depth: size of the top tree above it,
+  // size of the bottom tree, and depth of the root of the top tree.
+  size_t top_sizes_[MAX_LEVELS];
+  size_t bottom_sizes_[MAX_LEVELS];
+  size_t top_depths_[MAX_LEVELS];
+
+};
+
+}
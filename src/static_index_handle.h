@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "base_static_index.h"
+#include "epoch_manager.h"
+#include "time_measurer.h"
+
+// serves reads from the current version of a static index, while a new version is built in the background
+// from a snapshot of the data table. a new version is published with an atomic swap, and the old one
+// is retired to an epoch manager, which frees it once no reader can still hold it.
+// like the static indexes, the handle ignores inserts. tuples inserted into the table are picked up by the next rebuild.
+// threads must be prepared and registered before they read.
+template<typename KeyT, typename ValueT>
+class StaticIndexHandle : public BaseIndex<KeyT, ValueT> {
+
+public:
+  StaticIndexHandle(DataTable<KeyT, ValueT> *table_ptr, const StaticIndexFactory<KeyT, ValueT> &factory, const size_t build_thread_count = 1) :
+    BaseIndex<KeyT, ValueT>(table_ptr), factory_(factory), build_thread_count_(std::max(build_thread_count, size_t(1))),
+    current_index_(nullptr), is_rebuilding_(false), version_count_(0), rebuild_time_ms_(0) {}
+
+  virtual ~StaticIndexHandle() {
+    wait_rebuild();
+
+    delete current_index_.load();
+    current_index_ = nullptr;
+  }
+
+  virtual void insert(const KeyT &key, const Uint64 &value) final {}
+
+  virtual void find(const KeyT &key, ResultSink &values) final {
+    EpochGuard guard(epoch_manager_, thread_id_);
+    BaseStaticIndex<KeyT, ValueT> *index = current_index_.load();
+    if (index != nullptr) {
+      index->find(key, values);
+    }
+  }
+
+  virtual void find_batch(const KeyT *keys, const size_t count, ResultSink *values) final {
+    EpochGuard guard(epoch_manager_, thread_id_);
+    BaseStaticIndex<KeyT, ValueT> *index = current_index_.load();
+    if (index != nullptr) {
+      index->find_batch(keys, count, values);
+    }
+  }
+
+  virtual void find_range(const KeyT &lhs_key, const KeyT &rhs_key, ResultSink &values) final {
+    EpochGuard guard(epoch_manager_, thread_id_);
+    BaseStaticIndex<KeyT, ValueT> *index = current_index_.load();
+    if (index != nullptr) {
+      index->find_range(lhs_key, rhs_key, values);
+    }
+  }
+
+  virtual void scan(const KeyT &key, ResultSink &values) final {
+    EpochGuard guard(epoch_manager_, thread_id_);
+    BaseStaticIndex<KeyT, ValueT> *index = current_index_.load();
+    if (index != nullptr) {
+      index->scan(key, values);
+    }
+  }
+
+  virtual void scan_reverse(const KeyT &key, ResultSink &values) final {
+    EpochGuard guard(epoch_manager_, thread_id_);
+    BaseStaticIndex<KeyT, ValueT> *index = current_index_.load();
+    if (index != nullptr) {
+      index->scan_reverse(key, values);
+    }
+  }
+
+  virtual void scan_full(ResultSink &values, const size_t count) final {
+    EpochGuard guard(epoch_manager_, thread_id_);
+    BaseStaticIndex<KeyT, ValueT> *index = current_index_.load();
+    if (index != nullptr) {
+      index->scan_full(values, count);
+    }
+  }
+
+  virtual void erase(const KeyT &key) final {}
+
+  // the size of the current version.
+  virtual size_t size() const final {
+    EpochGuard guard(epoch_manager_, thread_id_);
+    BaseStaticIndex<KeyT, ValueT> *index = current_index_.load();
+    return (index != nullptr) ? index->size() : 0;
+  }
+
+  // build a new version on the calling thread, and publish it.
+  virtual void reorganize(const size_t thread_count) final {
+    wait_rebuild();
+    build_version(thread_count);
+  }
+
+  virtual void prepare_threads(const size_t thread_count) final {
+    epoch_manager_.prepare_threads(thread_count);
+  }
+
+  virtual void register_thread(const size_t thread_id) final {
+    thread_id_ = thread_id;
+  }
+
+  virtual void print() const final {
+    BaseStaticIndex<KeyT, ValueT> *index = current_index_.load();
+    if (index != nullptr) {
+      index->print();
+    }
+    std::cout << "versions = " << version_count_.load() << ", rebuild time = " << rebuild_time_ms_.load() << " ms" << std::endl;
+  }
+
+  // start building a new version in the background, unless one is being built already.
+  // return false if it did not start.
+  bool rebuild() {
+    std::lock_guard<std::mutex> guard(rebuild_mutex_);
+    if (is_rebuilding_.load()) {
+      return false;
+    }
+    if (rebuild_thread_.joinable()) {
+      rebuild_thread_.join();
+    }
+    is_rebuilding_ = true;
+    rebuild_thread_ = std::thread([this]() {
+      build_version(build_thread_count_);
+      is_rebuilding_ = false;
+    });
+    return true;
+  }
+
+  // wait until the version being built in the background is published, and the old one is freed.
+  void wait_rebuild() {
+    std::lock_guard<std::mutex> guard(rebuild_mutex_);
+    if (rebuild_thread_.joinable()) {
+      rebuild_thread_.join();
+    }
+  }
+
+  bool is_rebuilding() const { return is_rebuilding_.load(); }
+
+  // number of versions published so far.
+  size_t version_count() const { return version_count_.load(); }
+
+  // total time spent building versions, including the first one. unit: ms
+  size_t rebuild_time_ms() const { return rebuild_time_ms_.load(); }
+
+private:
+  void build_version(const size_t thread_count) {
+
+    TimeMeasurer timer;
+    timer.tic();
+
+    DataTableSnapshot<KeyT, ValueT> snapshot;
+    this->table_ptr_->take_snapshot(snapshot);
+
+    BaseStaticIndex<KeyT, ValueT> *index = factory_();
+    index->reorganize_snapshot(snapshot, thread_count);
+
+    // readers that loaded the old version before the swap may still be using it.
+    BaseStaticIndex<KeyT, ValueT> *old_index = current_index_.exchange(index);
+    if (old_index != nullptr) {
+      epoch_manager_.retire([old_index]() { delete old_index; });
+    }
+
+    timer.toc();
+    rebuild_time_ms_.fetch_add(timer.time_ms());
+    version_count_.fetch_add(1);
+
+    // readers leave their epoch after a single operation, so this does not take long.
+    while (epoch_manager_.reclaim() != 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
+private:
+  StaticIndexHandle(const StaticIndexHandle &);
+  StaticIndexHandle& operator=(const StaticIndexHandle &);
+
+private:
+  // creates an empty static index of the wrapped type, for every version
+  StaticIndexFactory<KeyT, ValueT> factory_;
+  const size_t build_thread_count_;
+
+  std::atomic<BaseStaticIndex<KeyT, ValueT>*> current_index_;
+
+  mutable EpochManager epoch_manager_;
+  static thread_local size_t thread_id_;
+
+  std::mutex rebuild_mutex_;
+  std::thread rebuild_thread_;
+  std::atomic<bool> is_rebuilding_;
+
+  std::atomic<size_t> version_count_;
+  std::atomic<size_t> rebuild_time_ms_;
+};
+
+template<typename KeyT, typename ValueT>
+thread_local size_t StaticIndexHandle<KeyT, ValueT>::thread_id_ = 0;
@@ -1,9 +1,27 @@
 #pragma once
 
 #include <jemalloc/jemalloc.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <cstdint>
+#include <cstdlib>
 #include <csignal>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 typedef uint16_t Uint16;
 typedef uint32_t Uint32;
@@ -12,6 +30,9 @@ typedef uint64_t Uint64;
 #define COMPILER_MEMORY_FENCE asm volatile("" ::: "memory")
 
 
+// bytes that huge_page_new_array() mapped itself, and that the allocator does not see.
+inline size_t huge_page_mapped_bytes();
+
 static double get_memory_mb() {
 #if defined(NDEBUG)
   uint64_t epoch = 1;
@@ -21,7 +42,7 @@ static double get_memory_mb() {
   size_t allocated;
   sz = sizeof(size_t);
   if (mallctl("stats.allocated", &allocated, &sz, NULL, 0) == 0) {
-    return allocated * 1.0 / 1024 / 1024;
+    return (allocated + huge_page_mapped_bytes()) * 1.0 / 1024 / 1024;
   }
   return -1;
 #else
@@ -38,7 +59,7 @@ static double get_memory_gb() {
   size_t allocated;
   sz = sizeof(size_t);
   if (mallctl("stats.allocated", &allocated, &sz, NULL, 0) == 0) {
-    return allocated * 1.0 / 1024 / 1024 / 1024;
+    return (allocated + huge_page_mapped_bytes()) * 1.0 / 1024 / 1024 / 1024;
   }
   return -1;
 #else
@@ -46,16 +67,404 @@ static double get_memory_gb() {
 #endif
 }
 
-static void pin_to_core(const size_t core) {
-  #if 0
+// pin the calling thread to core. return false if the core does not exist or cannot be used.
+static bool pin_to_core(const size_t core) {
+  if (core >= CPU_SETSIZE) {
+    return false;
+  }
   cpu_set_t cpuset;
   CPU_ZERO(&cpuset);
   CPU_SET(core, &cpuset);
-  int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-  if (ret != 0) {
-    assert(false);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == 0;
+}
+
+// cores that the calling thread may run on. threads inherit them from the thread that creates them.
+static cpu_set_t get_thread_affinity() {
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+  return cpuset;
+}
+
+static bool set_thread_affinity(const cpu_set_t &cpuset) {
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == 0;
+}
+
+// parse a cpu list such as "0-3,8,10-11", as used by sysfs and taskset.
+inline std::vector<size_t> parse_core_list(const std::string &list) {
+  std::vector<size_t> cores;
+  std::stringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    if (range.empty() || range.find_first_not_of(" \n") == std::string::npos) {
+      continue;
+    }
+    size_t dash = range.find('-');
+    size_t first = strtoull(range.c_str(), nullptr, 10);
+    size_t last = (dash == std::string::npos) ? first : strtoull(range.c_str() + dash + 1, nullptr, 10);
+    for (size_t core = first; core <= last; ++core) {
+      cores.push_back(core);
+    }
+  }
+  return cores;
+}
+
+// the cores of each numa node, read from sysfs once.
+// without sysfs, all cores are taken to be on node 0.
+struct NumaTopology {
+  NumaTopology() {
+    for (size_t node = 0; ; ++node) {
+      std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+      if (!file.is_open()) {
+        break;
+      }
+      std::string list;
+      std::getline(file, list);
+      node_cores_.push_back(parse_core_list(list));
+    }
+
+    if (node_cores_.empty()) {
+      node_cores_.push_back(std::vector<size_t>());
+      for (size_t core = 0; core < std::max(std::thread::hardware_concurrency(), 1u); ++core) {
+        node_cores_[0].push_back(core);
+      }
+    }
+
+    for (size_t node = 0; node < node_cores_.size(); ++node) {
+      for (auto core : node_cores_[node]) {
+        if (core >= core_nodes_.size()) {
+          core_nodes_.resize(core + 1, 0);
+        }
+        core_nodes_[core] = node;
+      }
+    }
+  }
+
+  size_t node_count() const { return node_cores_.size(); }
+
+  size_t node_of_core(const size_t core) const {
+    return core < core_nodes_.size() ? core_nodes_[core] : 0;
+  }
+
+  std::vector<std::vector<size_t>> node_cores_;
+  std::vector<size_t> core_nodes_;
+};
+
+inline const NumaTopology& numa_topology() {
+  static NumaTopology topology;
+  return topology;
+}
+
+// how worker threads are pinned to cores.
+enum CorePlacement {
+  CorePlacementNone = 0, // threads are not pinned
+  CorePlacementCompact,  // fill the cores of node 0 first, then those of node 1, and so on
+  CorePlacementScatter,  // take cores from each node in turn
+};
+
+// the core for each of thread_count threads, or nothing with CorePlacementNone.
+// with more threads than cores, cores are handed out again from the start.
+inline std::vector<size_t> assign_cores(const size_t thread_count, const CorePlacement placement) {
+  if (placement == CorePlacementNone) {
+    return std::vector<size_t>();
+  }
+
+  const NumaTopology &topology = numa_topology();
+  std::vector<size_t> order;
+  if (placement == CorePlacementCompact) {
+    for (auto &cores : topology.node_cores_) {
+      order.insert(order.end(), cores.begin(), cores.end());
+    }
+  } else {
+    for (size_t i = 0; order.size() < topology.core_nodes_.size(); ++i) {
+      bool has_core = false;
+      for (auto &cores : topology.node_cores_) {
+        if (i < cores.size()) {
+          order.push_back(cores[i]);
+          has_core = true;
+        }
+      }
+      if (!has_core) { break; }
+    }
+  }
+
+  std::vector<size_t> thread_cores;
+  for (size_t thread_id = 0; thread_id < thread_count && !order.empty(); ++thread_id) {
+    thread_cores.push_back(order[thread_id % order.size()]);
+  }
+  return thread_cores;
+}
+
+// the numa node of the core that the calling thread runs on.
+inline size_t current_numa_node() {
+  const NumaTopology &topology = numa_topology();
+  if (topology.node_count() == 1) {
+    return 0;
+  }
+  int core = sched_getcpu();
+  return core < 0 ? 0 : topology.node_of_core(core);
+}
+
+// ask the kernel to place the pages of [ptr, ptr + length) on node, and move the ones it placed already.
+// ptr and length must be page aligned. a preferred policy falls back to other nodes once node is full.
+// libnuma is not required, the system call is made directly.
+inline bool bind_to_numa_node(void *ptr, const size_t length, const size_t node) {
+  const int MPOL_PREFERRED_MODE = 1;
+  const unsigned MPOL_MF_MOVE_FLAG = 1 << 1;
+
+  if (numa_topology().node_count() == 1 || node >= sizeof(unsigned long) * 8) {
+    return true;
+  }
+  unsigned long node_mask = 1ul << node;
+  return syscall(SYS_mbind, ptr, length, MPOL_PREFERRED_MODE, &node_mask, sizeof(node_mask) * 8, MPOL_MF_MOVE_FLAG) == 0;
+}
+
+// resident memory of this process on each numa node, from /proc/self/numa_maps. unit: MB.
+// empty if the kernel does not report it.
+inline std::vector<double> get_numa_node_memory_mb() {
+  std::vector<double> node_memory(numa_topology().node_count(), 0);
+
+  std::ifstream file("/proc/self/numa_maps");
+  if (!file.is_open()) {
+    return std::vector<double>();
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::stringstream stream(line);
+    std::string field;
+    size_t page_kb = 4;
+    std::vector<std::pair<size_t, size_t>> node_pages;
+    while (stream >> field) {
+      if (field.compare(0, 17, "kernelpagesize_kB") == 0) {
+        page_kb = strtoull(field.c_str() + 18, nullptr, 10);
+      } else if (field.size() > 2 && field[0] == 'N' && isdigit(field[1]) && field.find('=') != std::string::npos) {
+        size_t node = strtoull(field.c_str() + 1, nullptr, 10);
+        size_t pages = strtoull(field.c_str() + field.find('=') + 1, nullptr, 10);
+        node_pages.push_back(std::make_pair(node, pages));
+      }
+    }
+    for (auto &entry : node_pages) {
+      if (entry.first >= node_memory.size()) {
+        node_memory.resize(entry.first + 1, 0);
+      }
+      node_memory[entry.first] += entry.second * page_kb / 1024.0;
+    }
+  }
+  return node_memory;
+}
+
+// run func(thread_id) on thread_count threads and wait for all of them.
+// with a single thread, func runs on the calling thread.
+template<typename FuncT>
+static void run_parallel(const size_t thread_count, FuncT func) {
+  if (thread_count <= 1) {
+    func(0);
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (size_t thread_id = 0; thread_id < thread_count; ++thread_id) {
+    threads.push_back(std::thread(func, thread_id));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+// a reader-writer spin lock for short critical sections.
+// a waiting writer keeps new readers out, so that a stream of readers cannot starve it.
+class ReadWriteSpinLock {
+
+public:
+  ReadWriteSpinLock() : reader_count_(0), is_writing_(false) {}
+
+  void lock_shared() {
+    while (true) {
+      while (is_writing_.load()) {
+        std::this_thread::yield();
+      }
+      reader_count_.fetch_add(1);
+      if (!is_writing_.load()) {
+        return;
+      }
+      reader_count_.fetch_sub(1);
+    }
+  }
+
+  void unlock_shared() {
+    reader_count_.fetch_sub(1);
+  }
+
+  void lock() {
+    while (is_writing_.exchange(true)) {
+      std::this_thread::yield();
+    }
+    while (reader_count_.load() != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  void unlock() {
+    is_writing_.store(false);
+  }
+
+private:
+  ReadWriteSpinLock(const ReadWriteSpinLock &);
+  ReadWriteSpinLock& operator=(const ReadWriteSpinLock &);
+
+private:
+  std::atomic<size_t> reader_count_;
+  std::atomic<bool> is_writing_;
+};
+
+// allocate an array of count elements that starts at an alignment-byte boundary.
+// elements are not initialized. release it with aligned_delete_array().
+template<typename T>
+static T* aligned_new_array(const size_t count, const size_t alignment = 64) {
+  void *ptr = nullptr;
+  if (posix_memalign(&ptr, alignment, std::max(count, size_t(1)) * sizeof(T)) != 0) {
+    throw std::bad_alloc();
+  }
+  return static_cast<T*>(ptr);
+}
+
+template<typename T>
+static void aligned_delete_array(T *ptr) {
+  free(ptr);
+}
+
+
+// how huge_page_new_array() backs large arrays.
+enum HugePageMode {
+  HugePageNone = 0,    // regular allocation
+  HugePageTransparent, // anonymous mapping with madvise(MADV_HUGEPAGE)
+  HugePageExplicit,    // MAP_HUGETLB from the reserved pool, falling back to HugePageTransparent
+};
+
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024; // unit: byte
+
+// large arrays that huge_page_new_array() mapped itself, and the totals it reports.
+// the functions are inline, so that all translation units share a single registry.
+struct HugePageRegistry {
+  HugePageRegistry() : mode_(HugePageNone), explicit_bytes_(0), transparent_bytes_(0) {}
+
+  std::mutex mutex_;
+  HugePageMode mode_;
+  std::unordered_map<void*, std::pair<size_t, bool>> mappings_; // address -> (length, is explicit)
+  size_t explicit_bytes_;
+  size_t transparent_bytes_;
+};
+
+inline HugePageRegistry& huge_page_registry() {
+  static HugePageRegistry registry;
+  return registry;
+}
+
+// arrays allocated afterwards use mode. arrays allocated before keep their backing.
+inline void set_huge_page_mode(const HugePageMode mode) {
+  HugePageRegistry &registry = huge_page_registry();
+  std::lock_guard<std::mutex> guard(registry.mutex_);
+  registry.mode_ = mode;
+}
+
+inline HugePageMode get_huge_page_mode() {
+  HugePageRegistry &registry = huge_page_registry();
+  std::lock_guard<std::mutex> guard(registry.mutex_);
+  return registry.mode_;
+}
+
+// bytes currently mapped with MAP_HUGETLB, and with transparent huge pages.
+inline size_t huge_page_explicit_bytes() {
+  HugePageRegistry &registry = huge_page_registry();
+  std::lock_guard<std::mutex> guard(registry.mutex_);
+  return registry.explicit_bytes_;
+}
+
+inline size_t huge_page_transparent_bytes() {
+  HugePageRegistry &registry = huge_page_registry();
+  std::lock_guard<std::mutex> guard(registry.mutex_);
+  return registry.transparent_bytes_;
+}
+
+inline size_t huge_page_mapped_bytes() {
+  HugePageRegistry &registry = huge_page_registry();
+  std::lock_guard<std::mutex> guard(registry.mutex_);
+  return registry.explicit_bytes_ + registry.transparent_bytes_;
+}
+
+// a huge page aligned anonymous mapping of length bytes, or nullptr.
+// transparent huge pages only back aligned 2MB ranges, so the mapping is over-allocated and trimmed.
+inline void* map_huge_pages(const size_t length, const bool is_explicit) {
+  if (is_explicit) {
+    void *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+  }
+
+  void *ptr = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    return nullptr;
+  }
+  char *begin = static_cast<char*>(ptr);
+  char *aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(begin) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+  if (aligned != begin) {
+    munmap(begin, aligned - begin);
+  }
+  if (aligned + length != begin + length + HUGE_PAGE_SIZE) {
+    munmap(aligned + length, begin + HUGE_PAGE_SIZE - aligned);
+  }
+  madvise(aligned, length, MADV_HUGEPAGE);
+  return aligned;
+}
+
+// allocate an array of count elements, backed by huge pages as set by set_huge_page_mode().
+// arrays smaller than half a huge page, or allocated with HugePageNone, come from aligned_new_array().
+// elements are not initialized. release it with huge_page_delete_array().
+template<typename T>
+static T* huge_page_new_array(const size_t count, const size_t alignment = 64) {
+  const size_t size = count * sizeof(T);
+  const HugePageMode mode = get_huge_page_mode();
+
+  if (mode == HugePageNone || size < HUGE_PAGE_SIZE / 2) {
+    return aligned_new_array<T>(count, alignment);
+  }
+
+  const size_t length = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+  bool is_explicit = (mode == HugePageExplicit);
+  void *ptr = map_huge_pages(length, is_explicit);
+  if (ptr == nullptr && is_explicit) {
+    is_explicit = false;
+    ptr = map_huge_pages(length, is_explicit);
+  }
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  HugePageRegistry &registry = huge_page_registry();
+  std::lock_guard<std::mutex> guard(registry.mutex_);
+  registry.mappings_[ptr] = std::make_pair(length, is_explicit);
+  (is_explicit ? registry.explicit_bytes_ : registry.transparent_bytes_) += length;
+
+  return static_cast<T*>(ptr);
+}
+
+template<typename T>
+static void huge_page_delete_array(T *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  {
+    HugePageRegistry &registry = huge_page_registry();
+    std::lock_guard<std::mutex> guard(registry.mutex_);
+    auto entry = registry.mappings_.find(ptr);
+    if (entry != registry.mappings_.end()) {
+      (entry->second.second ? registry.explicit_bytes_ : registry.transparent_bytes_) -= entry->second.first;
+      munmap(ptr, entry->second.first);
+      registry.mappings_.erase(entry);
+      return;
+    }
   }
-  #endif
+  aligned_delete_array(ptr);
 }
 
 template<typename KeyT>
@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <atomic>
 #include <map>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -14,9 +17,7 @@ class DataTableTest : public IndexZooTest {};
 
 
 template<typename KeyT>
-void data_table_numeric_test() {
-  // size_t n = 54321;
-  size_t n = 1000;
+void data_table_numeric_test(const size_t n = 1000) {
 
   std::vector<std::pair<KeyT, uint64_t>> validation_vector;
   std::vector<std::pair<KeyT, uint64_t>> test_vector;
@@ -56,6 +57,191 @@ TEST_F(DataTableTest, NumericTest) {
   data_table_numeric_test<uint64_t>();
 }
 
+// tuples inserted by several threads are all found by the iterator and by a snapshot,
+// whichever blocks the threads filled.
+template<typename KeyT>
+void data_table_numeric_concurrent_test(const BlockPlacement block_placement, const size_t thread_count = 4, const size_t n = 20000, const uint64_t max_block_capacity = MaxBlockCapacity) {
+
+  std::unique_ptr<DataTable<KeyT, uint64_t>> data_table(
+    new DataTable<KeyT, uint64_t>(max_block_capacity, block_placement));
+
+  std::vector<std::vector<std::pair<KeyT, uint64_t>>> thread_vectors(thread_count);
+
+  std::vector<std::thread> threads;
+  for (size_t thread_id = 0; thread_id < thread_count; ++thread_id) {
+    threads.push_back(std::thread([&, thread_id]() {
+      for (size_t i = thread_id; i < n; i += thread_count) {
+        OffsetT offset = data_table->insert_tuple(KeyT(i), i);
+        thread_vectors[thread_id].emplace_back(KeyT(i), offset.raw_data());
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::map<uint64_t, KeyT> validation_map;
+  for (auto &thread_vector : thread_vectors) {
+    for (auto &entry : thread_vector) {
+      validation_map[entry.second] = entry.first;
+    }
+  }
+  EXPECT_EQ(validation_map.size(), n);
+  EXPECT_EQ(data_table->size(), n);
+
+  std::map<uint64_t, KeyT> test_map;
+  DataTableIterator<KeyT, uint64_t> iterator(data_table.get());
+  while (iterator.has_next()) {
+    auto entry = iterator.next();
+    test_map[entry.offset_] = *(entry.key_);
+  }
+  EXPECT_EQ(test_map, validation_map);
+
+  DataTableSnapshot<KeyT, uint64_t> snapshot;
+  data_table->take_snapshot(snapshot);
+  EXPECT_EQ(snapshot.size(), n);
+
+  size_t tuple_count = 0;
+  for (size_t block_id = 0; block_id < snapshot.block_count(); ++block_id) {
+    EXPECT_EQ(snapshot.block_offset(block_id), tuple_count);
+    for (size_t rel_offset = 0; rel_offset < snapshot.block_size(block_id); ++rel_offset) {
+      EXPECT_EQ(*(snapshot.get_tuple_key(block_id, rel_offset)), validation_map[OffsetT::construct_raw_data(block_id, rel_offset)]);
+    }
+    tuple_count += snapshot.block_size(block_id);
+  }
+  EXPECT_EQ(tuple_count, n);
+}
+
+TEST_F(DataTableTest, ConcurrentTest) {
+  data_table_numeric_concurrent_test<uint32_t>(BlockPlacement::SharedBlock);
+  data_table_numeric_concurrent_test<uint64_t>(BlockPlacement::SharedBlock);
+}
+
+TEST_F(DataTableTest, NumaLocalTest) {
+  data_table_numeric_concurrent_test<uint32_t>(BlockPlacement::NumaLocalBlock, 1, 54321);
+  data_table_numeric_concurrent_test<uint32_t>(BlockPlacement::NumaLocalBlock);
+  data_table_numeric_concurrent_test<uint64_t>(BlockPlacement::NumaLocalBlock);
+}
+
+TEST_F(DataTableTest, CoreLocalTest) {
+  data_table_numeric_concurrent_test<uint32_t>(BlockPlacement::CoreLocalBlock, 1, 54321);
+  data_table_numeric_concurrent_test<uint32_t>(BlockPlacement::CoreLocalBlock);
+  data_table_numeric_concurrent_test<uint64_t>(BlockPlacement::CoreLocalBlock);
+}
+
+// enough small blocks to fill more than one segment of the block directory.
+TEST_F(DataTableTest, BlockDirectoryTest) {
+  data_table_numeric_concurrent_test<uint64_t>(BlockPlacement::SharedBlock, 4, 100000, 4);
+  data_table_numeric_concurrent_test<uint64_t>(BlockPlacement::CoreLocalBlock, 4, 100000, 4);
+}
+
+// snapshots taken while threads keep inserting hold written tuples only, though tuples
+// are written out of order. keys start at 1, so a tuple that is not written yet has key 0.
+template<typename KeyT>
+void data_table_numeric_concurrent_snapshot_test(const BlockPlacement block_placement, const size_t thread_count = 4, const size_t n = 200000, const uint64_t max_block_capacity = MaxBlockCapacity) {
+
+  std::unique_ptr<DataTable<KeyT, uint64_t>> data_table(
+    new DataTable<KeyT, uint64_t>(max_block_capacity, block_placement));
+
+  std::atomic<size_t> finished_count(0);
+
+  std::vector<std::thread> threads;
+  for (size_t thread_id = 0; thread_id < thread_count; ++thread_id) {
+    threads.push_back(std::thread([&, thread_id]() {
+      for (size_t i = thread_id; i < n; i += thread_count) {
+        data_table->insert_tuple(KeyT(i + 1), i);
+      }
+      finished_count.fetch_add(1);
+    }));
+  }
+
+  size_t snapshot_count = 0;
+  size_t last_size = 0;
+  while (finished_count.load() < thread_count || snapshot_count == 0) {
+    DataTableSnapshot<KeyT, uint64_t> snapshot;
+    data_table->take_snapshot(snapshot);
+    EXPECT_GE(snapshot.size(), last_size);
+    last_size = snapshot.size();
+
+    size_t mismatch_count = 0;
+    for (size_t block_id = 0; block_id < snapshot.block_count(); ++block_id) {
+      for (size_t rel_offset = 0; rel_offset < snapshot.block_size(block_id); ++rel_offset) {
+        KeyT key = *(snapshot.get_tuple_key(block_id, rel_offset));
+        uint64_t value = *(data_table->get_tuple_value(block_id, rel_offset));
+        if (key == 0 || key != KeyT(value + 1)) {
+          ++mismatch_count;
+        }
+      }
+    }
+    EXPECT_EQ(mismatch_count, 0);
+    ++snapshot_count;
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  DataTableSnapshot<KeyT, uint64_t> snapshot;
+  data_table->take_snapshot(snapshot);
+  EXPECT_EQ(snapshot.size(), n);
+}
+
+TEST_F(DataTableTest, ConcurrentSnapshotTest) {
+  data_table_numeric_concurrent_snapshot_test<uint32_t>(BlockPlacement::SharedBlock, 8);
+  data_table_numeric_concurrent_snapshot_test<uint64_t>(BlockPlacement::SharedBlock, 4, 200000, 4);
+  data_table_numeric_concurrent_snapshot_test<uint64_t>(BlockPlacement::NumaLocalBlock);
+  data_table_numeric_concurrent_snapshot_test<uint64_t>(BlockPlacement::CoreLocalBlock, 4, 200000, 4);
+}
+
+// core lists are parsed as sysfs writes them, and threads are placed on cores that exist.
+TEST_F(DataTableTest, NumaTopologyTest) {
+  EXPECT_EQ(parse_core_list("0-3,8,10-11\n"), std::vector<size_t>({ 0, 1, 2, 3, 8, 10, 11 }));
+  EXPECT_EQ(parse_core_list(""), std::vector<size_t>());
+
+  const NumaTopology &topology = numa_topology();
+  EXPECT_GE(topology.node_count(), 1);
+
+  EXPECT_TRUE(assign_cores(4, CorePlacementNone).empty());
+
+  for (auto placement : { CorePlacementCompact, CorePlacementScatter }) {
+    std::vector<size_t> cores = assign_cores(5, placement);
+    EXPECT_EQ(cores.size(), 5);
+    for (auto core : cores) {
+      size_t node = topology.node_of_core(core);
+      auto &node_cores = topology.node_cores_[node];
+      EXPECT_NE(std::find(node_cores.begin(), node_cores.end(), core), node_cores.end());
+    }
+  }
+
+  // the first core of the first node is always there to run on
+  // and the cores a thread ran on before are restored after pinning
+  std::thread thread([&]() {
+    cpu_set_t affinity = get_thread_affinity();
+    EXPECT_TRUE(pin_to_core(topology.node_cores_[0][0]));
+    EXPECT_EQ(current_numa_node(), 0);
+    cpu_set_t pinned_affinity = get_thread_affinity();
+    EXPECT_EQ(CPU_COUNT(&pinned_affinity), 1);
+    EXPECT_TRUE(set_thread_affinity(affinity));
+    cpu_set_t restored_affinity = get_thread_affinity();
+    EXPECT_TRUE(CPU_EQUAL(&restored_affinity, &affinity));
+  });
+  thread.join();
+
+  std::vector<double> node_memory = get_numa_node_memory_mb();
+  if (!node_memory.empty()) {
+    EXPECT_GT(node_memory[0], 0);
+  }
+}
+
+TEST_F(DataTableTest, HugePageTest) {
+  // blocks are packed into huge page chunks, and the last chunk is not full
+  set_huge_page_mode(HugePageTransparent);
+  data_table_numeric_test<uint16_t>(54321);
+  data_table_numeric_test<uint64_t>(154321);
+  set_huge_page_mode(HugePageNone);
+  EXPECT_EQ(huge_page_mapped_bytes(), 0);
+}
+
 
 void data_table_generic_test(const uint64_t max_key_size) {
   // size_t n = 54321;
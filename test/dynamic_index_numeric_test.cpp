@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <atomic>
 #include <map>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -74,6 +77,8 @@ TEST_F(DynamicIndexNumericTest, UniqueKeyFindTest) {
 
     // dynamic indexes - singlethread
     IndexType::D_ST_StxBtree,
+    IndexType::D_ST_Skiplist,
+    IndexType::D_ST_CSBtree,
     IndexType::D_ST_ArtTree,
     
     // dynamic indexes - multithread
@@ -81,6 +86,8 @@ TEST_F(DynamicIndexNumericTest, UniqueKeyFindTest) {
     IndexType::D_MT_ArtTree,
     IndexType::D_MT_BwTree,
     IndexType::D_MT_Masstree,
+    IndexType::D_MT_Skiplist,
+    IndexType::D_MT_BTreeOLC,
   };
 
   for (auto index_type : index_types) {
@@ -145,6 +152,15 @@ void test_dynamic_index_numeric_non_unique_key_find(const IndexType index_type)
 
       EXPECT_EQ(*value, entry.second.at(offset));
     }
+
+    // first match only
+    ResultSink first_offset(1);
+
+    data_index->find(key, first_offset);
+
+    EXPECT_EQ(first_offset.size(), 1);
+
+    EXPECT_NE(entry.second.end(), entry.second.find(first_offset[0]));
   }
 }
 
@@ -155,6 +171,8 @@ TEST_F(DynamicIndexNumericTest, NonUniqueKeyFindTest) {
 
     // dynamic indexes - singlethread
     IndexType::D_ST_StxBtree,
+    IndexType::D_ST_Skiplist,
+    IndexType::D_ST_CSBtree,
     IndexType::D_ST_ArtTree,
     
     // dynamic indexes - multithread
@@ -162,6 +180,8 @@ TEST_F(DynamicIndexNumericTest, NonUniqueKeyFindTest) {
     IndexType::D_MT_ArtTree,
     IndexType::D_MT_BwTree,
     // IndexType::D_MT_Masstree, // do not support non-unique keys
+    IndexType::D_MT_Skiplist,
+    IndexType::D_MT_BTreeOLC,
   };
 
   for (auto index_type : index_types) {
@@ -178,6 +198,94 @@ TEST_F(DynamicIndexNumericTest, NonUniqueKeyFindTest) {
 }
 
 
+template<typename KeyT, typename ValueT>
+void test_dynamic_index_numeric_find_batch(const IndexType index_type) {
+
+  size_t n = 10000;
+  size_t m = 1000;
+  
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get()));
+
+  data_index->prepare_threads(1);
+  data_index->register_thread(0);
+
+  std::unordered_map<KeyT, std::unordered_map<Uint64, ValueT>> validation_set;
+  
+  // insert
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>() % m;
+    ValueT value = i + 2048;
+    
+    OffsetT offset = data_table->insert_tuple(key, value);
+    
+    validation_set[key][offset.raw_data()] = value;
+
+    data_index->insert(key, offset.raw_data());
+  }
+
+  // half of the lookups hit nothing
+  std::vector<KeyT> keys;
+  for (size_t i = 0; i < 2 * m; ++i) {
+    keys.push_back(rand_gen.next<KeyT>() % (2 * m));
+  }
+
+  // find
+  std::vector<ResultSink> offsets(keys.size());
+  data_index->find_batch(keys.data(), keys.size(), offsets.data());
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto entry = validation_set.find(keys.at(i));
+
+    if (entry == validation_set.end()) {
+      EXPECT_EQ(offsets.at(i).size(), 0);
+      continue;
+    }
+
+    EXPECT_EQ(offsets.at(i).size(), entry->second.size());
+
+    for (size_t j = 0; j < offsets.at(i).size(); ++j) {
+      EXPECT_NE(entry->second.end(), entry->second.find(offsets.at(i)[j]));
+    }
+  }
+}
+
+TEST_F(DynamicIndexNumericTest, FindBatchTest) {
+
+  std::vector<IndexType> index_types {
+
+    // dynamic indexes - singlethread
+    IndexType::D_ST_StxBtree,
+    IndexType::D_ST_Skiplist,
+    IndexType::D_ST_CSBtree,
+    IndexType::D_ST_ArtTree,
+    
+    // dynamic indexes - multithread
+    IndexType::D_MT_Libcuckoo,
+    IndexType::D_MT_ArtTree,
+    IndexType::D_MT_BwTree,
+    // IndexType::D_MT_Masstree, // do not support non-unique keys
+    IndexType::D_MT_Skiplist,
+    IndexType::D_MT_BTreeOLC,
+  };
+
+  for (auto index_type : index_types) {
+    // key type is set to uint16_t
+    test_dynamic_index_numeric_find_batch<uint16_t, uint64_t>(index_type);
+    
+    // key type is set to uint32_t
+    test_dynamic_index_numeric_find_batch<uint32_t, uint64_t>(index_type);
+    
+    // key type is set to uint64_t
+    test_dynamic_index_numeric_find_batch<uint64_t, uint64_t>(index_type);
+  }
+}
+
 template<typename KeyT, typename ValueT>
 void test_dynamic_index_numeric_unique_key_find_range(const IndexType index_type) {
 
@@ -249,6 +357,8 @@ TEST_F(DynamicIndexNumericTest, UniqueKeyFindRangeTest) {
 
     // dynamic indexes - singlethread
     IndexType::D_ST_StxBtree,
+    IndexType::D_ST_Skiplist,
+    IndexType::D_ST_CSBtree,
     // IndexType::D_ST_ArtTree, // do not fully support range queries
     
     // dynamic indexes - multithread
@@ -256,6 +366,8 @@ TEST_F(DynamicIndexNumericTest, UniqueKeyFindRangeTest) {
     // IndexType::D_MT_ArtTree, // do not fully support range queries
     IndexType::D_MT_BwTree,
     // IndexType::D_MT_Masstree, // do not support range queries
+    IndexType::D_MT_Skiplist,
+    IndexType::D_MT_BTreeOLC,
   };
 
   for (auto index_type : index_types) {
@@ -343,6 +455,8 @@ TEST_F(DynamicIndexNumericTest, NonUniqueKeyFindRangeTest) {
 
     // dynamic indexes - singlethread
     IndexType::D_ST_StxBtree,
+    IndexType::D_ST_Skiplist,
+    IndexType::D_ST_CSBtree,
     // IndexType::D_ST_ArtTree, // do not support non-unique keys
     
     // dynamic indexes - multithread
@@ -350,6 +464,8 @@ TEST_F(DynamicIndexNumericTest, NonUniqueKeyFindRangeTest) {
     IndexType::D_MT_ArtTree,
     IndexType::D_MT_BwTree,
     // IndexType::D_MT_Masstree, // do not support non-unique keys
+    IndexType::D_MT_Skiplist,
+    IndexType::D_MT_BTreeOLC,
   };
 
   for (auto index_type : index_types) {
@@ -422,7 +538,11 @@ TEST_F(DynamicIndexNumericTest, ScanTest) {
 
   std::vector<IndexType> index_types {
     IndexType::D_ST_StxBtree,
+    IndexType::D_ST_Skiplist,
+    IndexType::D_ST_CSBtree,
     IndexType::D_ST_ArtTree,
+    IndexType::D_MT_Skiplist,
+    IndexType::D_MT_BTreeOLC,
   };
 
   for (auto index_type : index_types) {
@@ -430,3 +550,186 @@ TEST_F(DynamicIndexNumericTest, ScanTest) {
   }
 }
 
+
+
+template<typename KeyT, typename ValueT>
+void test_dynamic_index_numeric_erase_scan_reverse(const IndexType index_type) {
+
+  size_t n = 10000;
+  size_t m = 1000;
+
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get()));
+
+  data_index->prepare_threads(1);
+  data_index->register_thread(0);
+
+  std::map<KeyT, std::vector<Uint64>> validation_set;
+
+  // insert
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>() % m;
+    ValueT value = i + 2048;
+
+    OffsetT offset = data_table->insert_tuple(key, value);
+
+    validation_set[key].push_back(offset.raw_data());
+
+    data_index->insert(key, offset.raw_data());
+  }
+
+  // erase every other key
+  size_t erased_count = 0;
+  for (KeyT key = 0; key < m; key += 2) {
+    data_index->erase(key);
+    auto entry = validation_set.find(key);
+    if (entry != validation_set.end()) {
+      erased_count += entry->second.size();
+      validation_set.erase(entry);
+    }
+  }
+
+  EXPECT_EQ(data_index->size(), n - erased_count);
+
+  // find, and the reverse scan returns the same values in reverse
+  for (KeyT key = 0; key < m; ++key) {
+
+    std::vector<Uint64> offsets;
+    data_index->find(key, offsets);
+
+    std::vector<Uint64> reverse_offsets;
+    data_index->scan_reverse(key, reverse_offsets);
+
+    std::reverse(reverse_offsets.begin(), reverse_offsets.end());
+    EXPECT_EQ(offsets, reverse_offsets);
+
+    auto entry = validation_set.find(key);
+    if (entry == validation_set.end()) {
+      EXPECT_EQ(offsets.size(), 0);
+      continue;
+    }
+
+    std::sort(offsets.begin(), offsets.end());
+    EXPECT_EQ(offsets, entry->second);
+  }
+
+  std::vector<Uint64> offsets;
+  data_index->scan_full(offsets);
+
+  EXPECT_EQ(offsets.size(), n - erased_count);
+}
+
+TEST_F(DynamicIndexNumericTest, EraseScanReverseTest) {
+
+  std::vector<IndexType> index_types {
+    IndexType::D_ST_Skiplist,
+    IndexType::D_ST_CSBtree,
+    IndexType::D_MT_Skiplist,
+    IndexType::D_MT_BTreeOLC,
+  };
+
+  for (auto index_type : index_types) {
+    test_dynamic_index_numeric_erase_scan_reverse<uint16_t, uint64_t>(index_type);
+    test_dynamic_index_numeric_erase_scan_reverse<uint64_t, uint64_t>(index_type);
+  }
+}
+
+
+// writers insert disjoint keys and erase some of them, while readers keep finding keys that stay.
+template<typename KeyT, typename ValueT>
+void test_dynamic_index_numeric_concurrent_insert_erase(const IndexType index_type) {
+
+  size_t n = 10000;
+  size_t writer_count = 4;
+  size_t reader_count = 2;
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get()));
+
+  data_index->prepare_threads(writer_count + reader_count + 1);
+  data_index->register_thread(writer_count + reader_count);
+
+  // keys below n stay, with two values each
+  for (size_t i = 0; i < n; ++i) {
+    data_index->insert(KeyT(i), i);
+    data_index->insert(KeyT(i), i + n);
+  }
+
+  std::atomic<bool> is_writing(true);
+  std::atomic<size_t> mismatch_count(0);
+
+  std::vector<std::thread> readers;
+  for (size_t thread_id = 0; thread_id < reader_count; ++thread_id) {
+    readers.push_back(std::thread([&, thread_id]() {
+      data_index->register_thread(writer_count + thread_id);
+      FastRandom rand_gen(thread_id);
+      while (is_writing.load()) {
+        size_t i = rand_gen.next<uint64_t>() % n;
+        std::vector<Uint64> offsets;
+        data_index->find(KeyT(i), offsets);
+        if (offsets.size() != 2 || offsets[0] != i || offsets[1] != i + n) {
+          mismatch_count.fetch_add(1);
+        }
+        offsets.clear();
+        data_index->find_range(KeyT(i), KeyT(i + 1), offsets);
+        if (offsets.size() < 2 || offsets.size() > 4) {
+          mismatch_count.fetch_add(1);
+        }
+      }
+    }));
+  }
+
+  // writer i inserts keys n + j * writer_count + i, and erases the odd ones again
+  std::vector<std::thread> writers;
+  for (size_t thread_id = 0; thread_id < writer_count; ++thread_id) {
+    writers.push_back(std::thread([&, thread_id]() {
+      data_index->register_thread(thread_id);
+      for (size_t j = 0; j < n; ++j) {
+        KeyT key = KeyT(n + j * writer_count + thread_id);
+        data_index->insert(key, key);
+        data_index->insert(key, key + 1);
+        if (j % 2 == 1) {
+          data_index->erase(key);
+        }
+      }
+    }));
+  }
+
+  for (auto &writer : writers) {
+    writer.join();
+  }
+
+  is_writing = false;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(mismatch_count.load(), 0);
+  EXPECT_EQ(data_index->size(), 2 * n + n * writer_count);
+
+  for (size_t thread_id = 0; thread_id < writer_count; ++thread_id) {
+    for (size_t j = 0; j < n; ++j) {
+      KeyT key = KeyT(n + j * writer_count + thread_id);
+      std::vector<Uint64> offsets;
+      data_index->find(key, offsets);
+      EXPECT_EQ(offsets.size(), (j % 2 == 1) ? 0 : 2);
+    }
+  }
+
+  // the full scan returns all entries in key order
+  std::vector<Uint64> offsets;
+  data_index->scan_full(offsets);
+  EXPECT_EQ(offsets.size(), 2 * n + n * writer_count);
+}
+
+TEST_F(DynamicIndexNumericTest, ConcurrentInsertEraseTest) {
+  test_dynamic_index_numeric_concurrent_insert_erase<uint64_t, uint64_t>(IndexType::D_MT_Skiplist);
+  test_dynamic_index_numeric_concurrent_insert_erase<uint32_t, uint64_t>(IndexType::D_MT_BTreeOLC);
+}
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "harness.h"
+#include "fast_random.h"
+#include "time_measurer.h"
+
+#include "data_table.h"
+
+#include "index_all.h"
+
+
+class HybridIndexNumericTest : public IndexZooTest {};
+
+template<typename KeyT, typename ValueT>
+void check_hybrid_index_numeric_find(BaseIndex<KeyT, ValueT> *data_index, const std::multimap<KeyT, Uint64> &validation_set) {
+
+  for (auto iter = validation_set.begin(); iter != validation_set.end(); iter = validation_set.upper_bound(iter->first)) {
+    KeyT key = iter->first;
+
+    std::vector<Uint64> offsets;
+    data_index->find(key, offsets);
+
+    std::vector<Uint64> expected;
+    auto range = validation_set.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+      expected.push_back(it->second);
+    }
+
+    std::sort(offsets.begin(), offsets.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(offsets, expected);
+  }
+}
+
+// inserts after the first reorganize are found in the buffer, and after a merge in the static part.
+template<typename KeyT, typename ValueT>
+void test_hybrid_index_numeric_merge(const IndexType index_type, const int index_param_1, const int index_param_2, const LayoutType layout = LayoutType::AoSLayout) {
+
+  size_t n = 10000;
+  size_t m = 3000;
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+
+  // a threshold that is never reached, so that merges only happen when asked for
+  std::unique_ptr<HybridIndex<KeyT, ValueT>> data_index(
+    create_hybrid_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout, n * 10));
+
+  // the vector wrappers are declared on the base class
+  BaseIndex<KeyT, ValueT> *base_index = data_index.get();
+
+  std::multimap<KeyT, Uint64> validation_set;
+
+  // every key is inserted twice before the first reorganize
+  for (size_t i = 0; i < n; ++i) {
+    KeyT key = (i / 2) * 3;
+    OffsetT offset = data_table->insert_tuple(key, i);
+    data_index->insert(key, offset.raw_data());
+    validation_set.insert(std::pair<KeyT, Uint64>(key, offset.raw_data()));
+  }
+
+  data_index->reorganize(2);
+
+  EXPECT_EQ(data_index->size(), n);
+
+  check_hybrid_index_numeric_find(data_index.get(), validation_set);
+
+  FastRandom rand_gen;
+
+  for (size_t round = 0; round < 2; ++round) {
+
+    // new keys in between the old ones, and more values for old keys
+    for (size_t i = 0; i < m; ++i) {
+      KeyT key = (i % 2 == 0) ? KeyT(rand_gen.next<uint64_t>() % (n * 3 / 2)) : KeyT((i / 2) * 3);
+      OffsetT offset = data_table->insert_tuple(key, i);
+      data_index->insert(key, offset.raw_data());
+      validation_set.insert(std::pair<KeyT, Uint64>(key, offset.raw_data()));
+    }
+
+    EXPECT_EQ(data_index->size(), validation_set.size());
+
+    check_hybrid_index_numeric_find(data_index.get(), validation_set);
+
+    data_index->merge();
+
+    EXPECT_EQ(data_index->merge_count(), round + 1);
+    EXPECT_EQ(data_index->size(), validation_set.size());
+
+    check_hybrid_index_numeric_find(data_index.get(), validation_set);
+  }
+
+  // a range with both merged and buffered entries
+  for (size_t i = 0; i < m; ++i) {
+    KeyT key = KeyT(rand_gen.next<uint64_t>() % (n * 3 / 2));
+    OffsetT offset = data_table->insert_tuple(key, i);
+    data_index->insert(key, offset.raw_data());
+    validation_set.insert(std::pair<KeyT, Uint64>(key, offset.raw_data()));
+  }
+
+  KeyT lhs_key = n / 2;
+  KeyT rhs_key = n;
+
+  std::vector<Uint64> offsets;
+  base_index->find_range(lhs_key, rhs_key, offsets);
+
+  std::vector<Uint64> expected;
+  for (auto it = validation_set.lower_bound(lhs_key); it != validation_set.upper_bound(rhs_key); ++it) {
+    expected.push_back(it->second);
+  }
+
+  std::sort(offsets.begin(), offsets.end());
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(offsets, expected);
+
+  // the reverse scan returns the values of find in reverse
+  std::vector<Uint64> find_offsets;
+  std::vector<Uint64> reverse_offsets;
+  base_index->find(KeyT(0), find_offsets);
+  base_index->scan_reverse(KeyT(0), reverse_offsets);
+  std::reverse(reverse_offsets.begin(), reverse_offsets.end());
+  EXPECT_EQ(find_offsets, reverse_offsets);
+
+  std::vector<Uint64> full_offsets;
+  base_index->scan_full(full_offsets);
+  EXPECT_EQ(full_offsets.size(), validation_set.size());
+
+  full_offsets.clear();
+  base_index->scan_full(full_offsets, validation_set.size() - 10);
+  EXPECT_EQ(full_offsets.size(), validation_set.size() - 10);
+
+  // a limited sink stops at its limit across the static part and the buffers
+  ResultSink limited_sink(1);
+  data_index->find(KeyT(0), limited_sink);
+  EXPECT_EQ(limited_sink.size(), 1);
+}
+
+// readers always find the keys of the first reorganize while a writer keeps inserting,
+// and background merges replace the static part.
+template<typename KeyT, typename ValueT>
+void test_hybrid_index_numeric_concurrent_merge(const IndexType index_type, const int index_param_1, const int index_param_2) {
+
+  size_t n = 10000;
+  size_t m = 20000;
+  size_t reader_count = 3;
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<HybridIndex<KeyT, ValueT>> data_index(
+    create_hybrid_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, LayoutType::AoSLayout, 1000));
+  BaseIndex<KeyT, ValueT> *base_index = data_index.get();
+
+  std::vector<Uint64> initial_offsets(n);
+
+  for (size_t i = 0; i < n; ++i) {
+    OffsetT offset = data_table->insert_tuple(KeyT(i * 2), i);
+    initial_offsets[i] = offset.raw_data();
+  }
+
+  data_index->reorganize(1);
+
+  std::atomic<bool> is_writing(true);
+  std::atomic<size_t> mismatch_count(0);
+
+  std::vector<std::thread> readers;
+  for (size_t thread_id = 0; thread_id < reader_count; ++thread_id) {
+    readers.push_back(std::thread([&, thread_id]() {
+      FastRandom rand_gen(thread_id);
+      while (is_writing.load()) {
+        size_t i = rand_gen.next<uint64_t>() % n;
+        std::vector<Uint64> offsets;
+        base_index->find(KeyT(i * 2), offsets);
+        if (offsets.size() != 1 || offsets[0] != initial_offsets[i]) {
+          mismatch_count.fetch_add(1);
+        }
+      }
+    }));
+  }
+
+  // odd keys, so that the initial keys keep a single value
+  std::vector<std::pair<KeyT, Uint64>> inserted;
+  for (size_t i = 0; i < m; ++i) {
+    KeyT key = KeyT(i % n * 2 + 1);
+    OffsetT offset = data_table->insert_tuple(key, i);
+    data_index->insert(key, offset.raw_data());
+    inserted.push_back(std::pair<KeyT, Uint64>(key, offset.raw_data()));
+  }
+
+  // the buffer has crossed the threshold, so a background merge finishes eventually
+  while (data_index->merge_count() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  is_writing = false;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(mismatch_count.load(), 0);
+
+  data_index->merge();
+
+  EXPECT_EQ(data_index->size(), n + m);
+
+  std::multimap<KeyT, Uint64> validation_set(inserted.begin(), inserted.end());
+  check_hybrid_index_numeric_find(data_index.get(), validation_set);
+}
+
+TEST_F(HybridIndexNumericTest, MergeTest) {
+  test_hybrid_index_numeric_merge<uint32_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM);
+  test_hybrid_index_numeric_merge<uint64_t, uint64_t>(IndexType::S_Interpolation, INVALID_INDEX_PARAM, 8, LayoutType::SoALayout);
+  test_hybrid_index_numeric_merge<uint32_t, uint64_t>(IndexType::S_Binary, 7, INVALID_INDEX_PARAM);
+  test_hybrid_index_numeric_merge<uint64_t, uint64_t>(IndexType::S_KAry, 3, 4, LayoutType::SoALayout);
+  test_hybrid_index_numeric_merge<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM);
+  test_hybrid_index_numeric_merge<uint64_t, uint64_t>(IndexType::S_Eytzinger, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+  test_hybrid_index_numeric_merge<uint32_t, uint64_t>(IndexType::S_Veb, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+  test_hybrid_index_numeric_merge<uint64_t, uint64_t>(IndexType::S_Pgm, 8, INVALID_INDEX_PARAM);
+  test_hybrid_index_numeric_merge<uint32_t, uint64_t>(IndexType::S_Compressed, 32, INVALID_INDEX_PARAM);
+}
+
+TEST_F(HybridIndexNumericTest, ConcurrentMergeTest) {
+  test_hybrid_index_numeric_concurrent_merge<uint64_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM);
+  test_hybrid_index_numeric_concurrent_merge<uint32_t, uint64_t>(IndexType::S_Pgm, 8, INVALID_INDEX_PARAM);
+  test_hybrid_index_numeric_concurrent_merge<uint64_t, uint64_t>(IndexType::S_Compressed, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+}
@@ -0,0 +1,103 @@
+#include <vector>
+
+#include "result_sink.h"
+
+#include "harness.h"
+
+
+class ResultSinkTest : public IndexZooTest {};
+
+
+TEST_F(ResultSinkTest, InlineTest) {
+  size_t n = ResultSink::INLINE_CAPACITY * 4;
+
+  ResultSink sink;
+
+  // values beyond the inline buffer spill over
+  for (size_t i = 0; i < n; ++i) {
+    EXPECT_TRUE(sink.push_back(i + 2048));
+  }
+
+  EXPECT_EQ(sink.size(), n);
+  EXPECT_FALSE(sink.full());
+
+  for (size_t i = 0; i < n; ++i) {
+    EXPECT_EQ(sink[i], i + 2048);
+  }
+
+  sink.clear();
+
+  EXPECT_EQ(sink.size(), 0);
+
+  sink.push_back(1024);
+
+  EXPECT_EQ(sink.size(), 1);
+  EXPECT_EQ(sink[0], 1024);
+}
+
+TEST_F(ResultSinkTest, LimitTest) {
+  size_t limit = 3;
+
+  ResultSink sink(limit);
+
+  EXPECT_TRUE(sink.push_back(0));
+  EXPECT_TRUE(sink.push_back(1));
+  // the sink is full after accepting the last value
+  EXPECT_FALSE(sink.push_back(2));
+  EXPECT_FALSE(sink.push_back(3));
+
+  EXPECT_TRUE(sink.full());
+  EXPECT_EQ(sink.size(), limit);
+
+  for (size_t i = 0; i < limit; ++i) {
+    EXPECT_EQ(sink[i], i);
+  }
+
+  std::vector<Uint64> values { 4, 5, 6 };
+
+  sink.clear();
+
+  EXPECT_FALSE(sink.append(values));
+  EXPECT_EQ(sink.size(), limit);
+  EXPECT_EQ(sink[0], 4);
+}
+
+TEST_F(ResultSinkTest, VectorTest) {
+  size_t n = 100;
+
+  std::vector<Uint64> values { 1024 };
+
+  ResultSink sink(values);
+
+  for (size_t i = 0; i < n; ++i) {
+    sink.push_back(i + 2048);
+  }
+
+  // existing values are kept
+  EXPECT_EQ(sink.size(), n);
+  EXPECT_EQ(values.size(), n + 1);
+  EXPECT_EQ(values.at(0), 1024);
+
+  for (size_t i = 0; i < n; ++i) {
+    EXPECT_EQ(values.at(i + 1), i + 2048);
+  }
+}
+
+static void sum_visitor(void *context, const Uint64 value) {
+  *reinterpret_cast<Uint64*>(context) += value;
+}
+
+TEST_F(ResultSinkTest, VisitorTest) {
+  size_t n = 100;
+
+  Uint64 sum = 0;
+
+  ResultSink sink(sum_visitor, &sum, n / 2);
+
+  for (size_t i = 0; i < n; ++i) {
+    sink.push_back(i);
+  }
+
+  EXPECT_EQ(sink.size(), n / 2);
+  EXPECT_EQ(sum, (n / 2) * (n / 2 - 1) / 2);
+}
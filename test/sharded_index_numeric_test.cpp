@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "harness.h"
+#include "fast_random.h"
+
+#include "data_table.h"
+
+#include "index_all.h"
+
+
+class ShardedIndexNumericTest : public IndexZooTest {};
+
+template<typename KeyT, typename ValueT>
+ShardedIndex<KeyT, ValueT>* create_test_sharded_index(const IndexType index_type, DataTable<KeyT, ValueT> *data_table, const size_t shard_count, const ShardingType sharding_type, const std::vector<KeyT> &keys) {
+  std::vector<KeyT> split_keys;
+  if (sharding_type == ShardingType::RangeSharding) {
+    split_keys = choose_split_keys(keys.data(), keys.size(), shard_count);
+  }
+  return create_sharded_index<KeyT, ValueT>(index_type, data_table, shard_count, sharding_type, split_keys);
+}
+
+// lookups and range lookups over shards return the same values as a single index.
+// with range sharding, range lookups and full scans return values in key order.
+template<typename KeyT, typename ValueT>
+void test_sharded_index_numeric_find(const IndexType index_type, const ShardingType sharding_type) {
+
+  size_t n = 10000;
+  size_t shard_count = 5;
+
+  std::vector<KeyT> keys;
+  for (size_t i = 0; i < n; ++i) {
+    keys.push_back(KeyT((i / 2) * 3));
+  }
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<ShardedIndex<KeyT, ValueT>> data_index(
+    create_test_sharded_index<KeyT, ValueT>(index_type, data_table.get(), shard_count, sharding_type, keys));
+
+  data_index->prepare_threads(1);
+  data_index->register_thread(0);
+
+  std::multimap<KeyT, Uint64> validation_set;
+  std::map<Uint64, KeyT> offset_keys;
+
+  FastRandom rand_gen;
+  for (size_t i = n - 1; i > 0; --i) {
+    std::swap(keys[i], keys[rand_gen.next<uint64_t>() % (i + 1)]);
+  }
+
+  for (auto key : keys) {
+    OffsetT offset = data_table->insert_tuple(key, validation_set.size());
+    data_index->insert(key, offset.raw_data());
+    validation_set.insert(std::pair<KeyT, Uint64>(key, offset.raw_data()));
+    offset_keys[offset.raw_data()] = key;
+  }
+
+  data_index->reorganize(1);
+
+  EXPECT_EQ(data_index->size(), n);
+
+  BaseIndex<KeyT, ValueT> *base_index = data_index.get();
+
+  // every shard takes part
+  for (size_t shard_id = 0; shard_id < shard_count; ++shard_id) {
+    size_t shard_size = std::count_if(keys.begin(), keys.end(), [&](const KeyT &key) { return data_index->route(key) == shard_id; });
+    EXPECT_GT(shard_size, n / shard_count / 2);
+  }
+
+  for (auto iter = validation_set.begin(); iter != validation_set.end(); iter = validation_set.upper_bound(iter->first)) {
+    KeyT key = iter->first;
+
+    std::vector<Uint64> offsets;
+    base_index->find(key, offsets);
+
+    std::vector<Uint64> expected;
+    auto range = validation_set.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+      expected.push_back(it->second);
+    }
+
+    std::sort(offsets.begin(), offsets.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(offsets, expected);
+  }
+
+  for (size_t i = 0; i < 100; ++i) {
+    KeyT lhs_key = KeyT(rand_gen.next<uint64_t>() % (n * 3 / 2));
+    KeyT rhs_key = KeyT(lhs_key + rand_gen.next<uint64_t>() % (n / 2));
+
+    std::vector<Uint64> offsets;
+    base_index->find_range(lhs_key, rhs_key, offsets);
+
+    std::vector<Uint64> expected;
+    for (auto it = validation_set.lower_bound(lhs_key); it != validation_set.upper_bound(rhs_key); ++it) {
+      expected.push_back(it->second);
+    }
+
+    EXPECT_EQ(offsets.size(), expected.size());
+
+    if (sharding_type == ShardingType::RangeSharding) {
+      for (size_t j = 1; j < offsets.size(); ++j) {
+        EXPECT_LE(offset_keys[offsets[j - 1]], offset_keys[offsets[j]]);
+      }
+    }
+
+    std::sort(offsets.begin(), offsets.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(offsets, expected);
+  }
+
+  std::vector<Uint64> offsets;
+  base_index->scan_full(offsets, n / 3);
+  EXPECT_EQ(offsets.size(), n / 3);
+
+  if (sharding_type == ShardingType::RangeSharding) {
+    auto it = validation_set.begin();
+    for (size_t j = 0; j < offsets.size(); ++j, ++it) {
+      EXPECT_EQ(offset_keys[offsets[j]], it->first);
+    }
+  }
+}
+
+// threads insert disjoint keys through the shard locks, while others look up the initial keys.
+template<typename KeyT, typename ValueT>
+void test_sharded_index_numeric_concurrent_insert(const IndexType index_type, const ShardingType sharding_type) {
+
+  size_t n = 20000;
+  size_t m = 20000;
+  size_t shard_count = 4;
+  size_t writer_count = 3;
+  size_t reader_count = 2;
+
+  // initial keys are even, keys inserted later are odd
+  std::vector<KeyT> keys;
+  for (size_t i = 0; i < n; ++i) {
+    keys.push_back(KeyT(i * 2));
+  }
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<ShardedIndex<KeyT, ValueT>> data_index(
+    create_test_sharded_index<KeyT, ValueT>(index_type, data_table.get(), shard_count, sharding_type, keys));
+
+  data_index->prepare_threads(writer_count + reader_count + 1);
+  data_index->register_thread(writer_count + reader_count);
+
+  std::vector<Uint64> initial_offsets;
+  for (auto key : keys) {
+    OffsetT offset = data_table->insert_tuple(key, key);
+    data_index->insert(key, offset.raw_data());
+    initial_offsets.push_back(offset.raw_data());
+  }
+
+  data_index->reorganize(1);
+
+  BaseIndex<KeyT, ValueT> *base_index = data_index.get();
+
+  std::atomic<bool> is_writing(true);
+  std::atomic<size_t> mismatch_count(0);
+
+  std::vector<std::thread> readers;
+  for (size_t thread_id = 0; thread_id < reader_count; ++thread_id) {
+    readers.push_back(std::thread([&, thread_id]() {
+      data_index->register_thread(writer_count + thread_id);
+      FastRandom rand_gen(thread_id);
+      while (is_writing.load()) {
+        size_t i = rand_gen.next<uint64_t>() % n;
+        std::vector<Uint64> offsets;
+        base_index->find(KeyT(i * 2), offsets);
+        if (offsets.size() != 1 || offsets[0] != initial_offsets[i]) {
+          mismatch_count.fetch_add(1);
+        }
+      }
+    }));
+  }
+
+  std::vector<std::thread> writers;
+  for (size_t thread_id = 0; thread_id < writer_count; ++thread_id) {
+    writers.push_back(std::thread([&, thread_id]() {
+      data_index->register_thread(thread_id);
+      for (size_t i = thread_id; i < m; i += writer_count) {
+        data_index->insert(KeyT(i * 2 + 1), i);
+      }
+    }));
+  }
+
+  for (auto &writer : writers) {
+    writer.join();
+  }
+
+  is_writing = false;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(mismatch_count.load(), 0);
+  EXPECT_EQ(data_index->size(), n + m);
+
+  for (size_t i = 0; i < m; ++i) {
+    std::vector<Uint64> offsets;
+    base_index->find(KeyT(i * 2 + 1), offsets);
+    EXPECT_EQ(offsets.size(), 1);
+    EXPECT_EQ(offsets[0], i);
+  }
+}
+
+TEST_F(ShardedIndexNumericTest, FindTest) {
+
+  std::vector<IndexType> index_types {
+    IndexType::D_ST_StxBtree,
+    IndexType::D_ST_Skiplist,
+    IndexType::D_ST_CSBtree,
+    IndexType::D_MT_BTreeOLC,
+  };
+
+  for (auto index_type : index_types) {
+    test_sharded_index_numeric_find<uint32_t, uint64_t>(index_type, ShardingType::HashSharding);
+    test_sharded_index_numeric_find<uint64_t, uint64_t>(index_type, ShardingType::RangeSharding);
+  }
+}
+
+TEST_F(ShardedIndexNumericTest, ConcurrentInsertTest) {
+
+  std::vector<IndexType> index_types {
+    IndexType::D_ST_StxBtree,
+    IndexType::D_ST_ArtTree,
+    IndexType::D_ST_CSBtree,
+    IndexType::D_MT_Skiplist,
+  };
+
+  for (auto index_type : index_types) {
+    test_sharded_index_numeric_concurrent_insert<uint64_t, uint64_t>(index_type, ShardingType::HashSharding);
+    test_sharded_index_numeric_concurrent_insert<uint64_t, uint64_t>(index_type, ShardingType::RangeSharding);
+  }
+}
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <vector>
+
+#include "fast_random.h"
+#include "radix_sort.h"
+#include "parallel_sort.h"
+
+#include "harness.h"
+
+
+class SortTest : public IndexZooTest {};
+
+template<typename KeyT>
+struct SortEntry {
+  KeyT key_;
+  Uint64 value_;
+};
+
+template<typename KeyT>
+void generate_sort_entries(const size_t n, const KeyT key_mask, std::vector<SortEntry<KeyT>> &entries) {
+
+  FastRandom rand_gen(0);
+
+  entries.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    // keys share their high bits, so that some radix passes are skipped
+    entries[i].key_ = (rand_gen.next<KeyT>() & key_mask) | (~key_mask & KeyT(0xA5A5A5A5A5A5A5A5ull));
+    entries[i].value_ = i;
+  }
+}
+
+template<typename KeyT>
+void test_radix_sort(const size_t n, const KeyT key_mask) {
+
+  std::vector<SortEntry<KeyT>> entries;
+  generate_sort_entries<KeyT>(n, key_mask, entries);
+
+  std::vector<SortEntry<KeyT>> expected(entries);
+  std::stable_sort(expected.begin(), expected.end(),
+    [](const SortEntry<KeyT> &lhs, const SortEntry<KeyT> &rhs) { return lhs.key_ < rhs.key_; });
+
+  radix_sort(entries.data(), n);
+
+  // radix sort is stable
+  for (size_t i = 0; i < n; ++i) {
+    EXPECT_EQ(entries[i].key_, expected[i].key_);
+    EXPECT_EQ(entries[i].value_, expected[i].value_);
+  }
+}
+
+TEST_F(SortTest, RadixSortTest) {
+  for (size_t n : { 0, 1, 7, 1000, 100000 }) {
+    test_radix_sort<uint16_t>(n, 0xFFFF);
+    test_radix_sort<uint32_t>(n, 0xFFFFFFFF);
+    test_radix_sort<uint32_t>(n, 0xFFF);
+    test_radix_sort<uint64_t>(n, 0xFFFFFFFFFFFFFFFF);
+    test_radix_sort<uint64_t>(n, 0xFF00FF);
+  }
+}
+
+template<typename KeyT>
+void test_parallel_sort(const size_t n, const KeyT key_mask, const size_t thread_count) {
+
+  std::vector<SortEntry<KeyT>> entries;
+  generate_sort_entries<KeyT>(n, key_mask, entries);
+
+  parallel_sort(entries.data(), n, thread_count);
+
+  std::vector<bool> visited(n, false);
+  for (size_t i = 0; i < n; ++i) {
+    if (i > 0) {
+      EXPECT_LE(entries[i - 1].key_, entries[i].key_);
+    }
+    EXPECT_FALSE(visited[entries[i].value_]);
+    visited[entries[i].value_] = true;
+  }
+}
+
+TEST_F(SortTest, ParallelSortTest) {
+  for (size_t thread_count = 1; thread_count <= 8; thread_count *= 2) {
+    test_parallel_sort<uint16_t>(100000, 0xFFFF, thread_count);
+    test_parallel_sort<uint32_t>(100000, 0xFFFFFFFF, thread_count);
+    test_parallel_sort<uint64_t>(100000, 0xFFFFFFFFFFFFFFFF, thread_count);
+    test_parallel_sort<uint64_t>(100000, 0xFF, thread_count);
+  }
+}
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "harness.h"
+#include "fast_random.h"
+
+#include "data_table.h"
+#include "epoch_manager.h"
+
+#include "index_all.h"
+
+
+class StaticIndexHandleNumericTest : public IndexZooTest {};
+
+template<typename KeyT, typename ValueT>
+void check_static_index_handle_numeric_find(BaseIndex<KeyT, ValueT> *data_index, const std::multimap<KeyT, Uint64> &validation_set) {
+
+  for (auto iter = validation_set.begin(); iter != validation_set.end(); iter = validation_set.upper_bound(iter->first)) {
+    KeyT key = iter->first;
+
+    std::vector<Uint64> offsets;
+    data_index->find(key, offsets);
+
+    std::vector<Uint64> expected;
+    auto range = validation_set.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+      expected.push_back(it->second);
+    }
+
+    std::sort(offsets.begin(), offsets.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(offsets, expected);
+  }
+}
+
+// tuples inserted into the table after a version is built are found once the next version is published.
+template<typename KeyT, typename ValueT>
+void test_static_index_handle_numeric_rebuild(const IndexType index_type, const int index_param_1, const int index_param_2, const LayoutType layout = LayoutType::AoSLayout) {
+
+  size_t n = 10000;
+  size_t m = 3000;
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<StaticIndexHandle<KeyT, ValueT>> data_index(
+    create_static_index_handle<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout, 2));
+
+  data_index->prepare_threads(1);
+  data_index->register_thread(0);
+
+  std::multimap<KeyT, Uint64> validation_set;
+
+  for (size_t i = 0; i < n; ++i) {
+    KeyT key = (i / 2) * 3;
+    OffsetT offset = data_table->insert_tuple(key, i);
+    validation_set.insert(std::pair<KeyT, Uint64>(key, offset.raw_data()));
+  }
+
+  data_index->reorganize(2);
+
+  EXPECT_EQ(data_index->version_count(), 1);
+  EXPECT_EQ(data_index->size(), n);
+
+  check_static_index_handle_numeric_find(data_index.get(), validation_set);
+
+  FastRandom rand_gen;
+
+  for (size_t round = 0; round < 2; ++round) {
+
+    std::multimap<KeyT, Uint64> published_set = validation_set;
+
+    for (size_t i = 0; i < m; ++i) {
+      KeyT key = (i % 2 == 0) ? KeyT(rand_gen.next<uint64_t>() % (n * 3 / 2)) : KeyT((i / 2) * 3);
+      OffsetT offset = data_table->insert_tuple(key, i);
+      validation_set.insert(std::pair<KeyT, Uint64>(key, offset.raw_data()));
+    }
+
+    // the published version does not see the new tuples
+    EXPECT_EQ(data_index->size(), published_set.size());
+    check_static_index_handle_numeric_find(data_index.get(), published_set);
+
+    EXPECT_TRUE(data_index->rebuild());
+    data_index->wait_rebuild();
+
+    EXPECT_FALSE(data_index->is_rebuilding());
+    EXPECT_EQ(data_index->version_count(), round + 2);
+    EXPECT_EQ(data_index->size(), validation_set.size());
+
+    check_static_index_handle_numeric_find(data_index.get(), validation_set);
+  }
+}
+
+// readers always find the keys of the first version while a writer keeps inserting into the table,
+// and rebuilds keep replacing the version they read.
+template<typename KeyT, typename ValueT>
+void test_static_index_handle_numeric_concurrent_rebuild(const IndexType index_type, const int index_param_1, const int index_param_2) {
+
+  size_t n = 10000;
+  size_t m = 20000;
+  size_t reader_count = 3;
+  size_t rebuild_count = 5;
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<StaticIndexHandle<KeyT, ValueT>> data_index(
+    create_static_index_handle<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+
+  // the main thread reads too
+  data_index->prepare_threads(reader_count + 1);
+  data_index->register_thread(reader_count);
+
+  std::vector<Uint64> initial_offsets(n);
+
+  for (size_t i = 0; i < n; ++i) {
+    OffsetT offset = data_table->insert_tuple(KeyT(i * 2), i);
+    initial_offsets[i] = offset.raw_data();
+  }
+
+  data_index->reorganize(1);
+
+  std::atomic<bool> is_writing(true);
+  std::atomic<size_t> mismatch_count(0);
+
+  std::vector<std::thread> readers;
+  for (size_t thread_id = 0; thread_id < reader_count; ++thread_id) {
+    readers.push_back(std::thread([&, thread_id]() {
+      data_index->register_thread(thread_id);
+      BaseIndex<KeyT, ValueT> *base_index = data_index.get();
+      FastRandom rand_gen(thread_id);
+      while (is_writing.load()) {
+        size_t i = rand_gen.next<uint64_t>() % n;
+        std::vector<Uint64> offsets;
+        base_index->find(KeyT(i * 2), offsets);
+        if (offsets.size() != 1 || offsets[0] != initial_offsets[i]) {
+          mismatch_count.fetch_add(1);
+        }
+      }
+    }));
+  }
+
+  // odd keys, so that the initial keys keep a single value
+  std::multimap<KeyT, Uint64> validation_set;
+  for (size_t i = 0; i < m; ++i) {
+    KeyT key = KeyT(i % n * 2 + 1);
+    OffsetT offset = data_table->insert_tuple(key, i);
+    validation_set.insert(std::pair<KeyT, Uint64>(key, offset.raw_data()));
+
+    if (i % (m / rebuild_count) == 0) {
+      data_index->rebuild();
+    }
+  }
+
+  data_index->wait_rebuild();
+
+  is_writing = false;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(mismatch_count.load(), 0);
+  EXPECT_GT(data_index->version_count(), 1);
+
+  data_index->reorganize(1);
+
+  EXPECT_EQ(data_index->size(), n + m);
+
+  check_static_index_handle_numeric_find(data_index.get(), validation_set);
+}
+
+TEST_F(StaticIndexHandleNumericTest, RebuildTest) {
+  test_static_index_handle_numeric_rebuild<uint32_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM);
+  test_static_index_handle_numeric_rebuild<uint64_t, uint64_t>(IndexType::S_Binary, 7, INVALID_INDEX_PARAM, LayoutType::SoALayout);
+  test_static_index_handle_numeric_rebuild<uint32_t, uint64_t>(IndexType::S_KAry, 3, 4);
+  test_static_index_handle_numeric_rebuild<uint64_t, uint64_t>(IndexType::S_Fast, 9, INVALID_INDEX_PARAM);
+  test_static_index_handle_numeric_rebuild<uint32_t, uint64_t>(IndexType::S_Eytzinger, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+  test_static_index_handle_numeric_rebuild<uint64_t, uint64_t>(IndexType::S_Veb, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+  test_static_index_handle_numeric_rebuild<uint32_t, uint64_t>(IndexType::S_Pgm, 8, INVALID_INDEX_PARAM);
+  test_static_index_handle_numeric_rebuild<uint64_t, uint64_t>(IndexType::S_Compressed, 32, INVALID_INDEX_PARAM);
+}
+
+TEST_F(StaticIndexHandleNumericTest, ConcurrentRebuildTest) {
+  test_static_index_handle_numeric_concurrent_rebuild<uint64_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM);
+  test_static_index_handle_numeric_concurrent_rebuild<uint32_t, uint64_t>(IndexType::S_Pgm, 8, INVALID_INDEX_PARAM);
+  test_static_index_handle_numeric_concurrent_rebuild<uint64_t, uint64_t>(IndexType::S_Compressed, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+}
+
+// an object retired while a reader is inside its epoch is only freed once the reader leaves.
+TEST_F(StaticIndexHandleNumericTest, EpochTest) {
+
+  EpochManager epoch_manager;
+  epoch_manager.prepare_threads(2);
+
+  size_t freed_count = 0;
+
+  epoch_manager.enter(0);
+
+  epoch_manager.retire([&freed_count]() { ++freed_count; });
+  EXPECT_EQ(epoch_manager.reclaim(), 1);
+  EXPECT_EQ(freed_count, 0);
+
+  // a reader entering after the retire cannot hold the object
+  epoch_manager.enter(1);
+
+  epoch_manager.exit(0);
+  EXPECT_EQ(epoch_manager.reclaim(), 0);
+  EXPECT_EQ(freed_count, 1);
+
+  epoch_manager.retire([&freed_count]() { ++freed_count; });
+  EXPECT_EQ(epoch_manager.reclaim(), 1);
+
+  epoch_manager.exit(1);
+  EXPECT_EQ(epoch_manager.reclaim(), 0);
+  EXPECT_EQ(freed_count, 2);
+}
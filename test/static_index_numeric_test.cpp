@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <map>
+#include <thread>
+#include <typeinfo>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -15,14 +20,18 @@
 class StaticIndexNumericTest : public IndexZooTest {};
 
 template<typename KeyT, typename ValueT>
-void test_static_index_numeric_unique_key_find(const IndexType index_type, const size_t index_param_1, const size_t index_param_2) {
+void test_static_index_numeric_unique_key_find(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const LayoutType layout = LayoutType::AoSLayout, const size_t leaf_scan_cachelines = 0) {
 
   size_t n = 10000;
 
   std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
     new DataTable<KeyT, ValueT>());
   std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
-    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
+
+  if (leaf_scan_cachelines != 0) {
+    dynamic_cast<BaseStaticIndex<KeyT, ValueT>*>(data_index.get())->set_leaf_scan_cachelines(leaf_scan_cachelines);
+  }
 
   std::unordered_map<KeyT, std::pair<Uint64, ValueT>> validation_set;
   
@@ -69,6 +78,11 @@ TEST_F(StaticIndexNumericTest, UniqueKeyFindTest) {
     test_static_index_numeric_unique_key_find<uint32_t, uint64_t>(index_type, segments, INVALID_INDEX_PARAM);
     test_static_index_numeric_unique_key_find<uint64_t, uint64_t>(index_type, segments, INVALID_INDEX_PARAM);
   }
+  for (size_t target_error : { 1, 8, 64 }) {
+    test_static_index_numeric_unique_key_find<uint16_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+    test_static_index_numeric_unique_key_find<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+    test_static_index_numeric_unique_key_find<uint64_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+  }
 
   index_type = IndexType::S_Binary;
   for (size_t layers = 0; layers < 8; ++layers) {
@@ -86,16 +100,24 @@ TEST_F(StaticIndexNumericTest, UniqueKeyFindTest) {
     }
   }
 
+  // nodes are 4 layers deep with 4-byte keys, and 3 with 8-byte keys
   index_type = IndexType::S_Fast;
-  for (size_t layers = 0; layers <= 12; layers += 4) {
-    test_static_index_numeric_unique_key_find<uint32_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+  for (size_t nodes = 0; nodes <= 3; ++nodes) {
+    test_static_index_numeric_unique_key_find<uint32_t, uint64_t>(index_type, nodes * 4, INVALID_INDEX_PARAM);
+    test_static_index_numeric_unique_key_find<uint64_t, uint64_t>(index_type, nodes * 3, INVALID_INDEX_PARAM);
+  }
+
+  for (auto index_type : { IndexType::S_Eytzinger, IndexType::S_Veb, IndexType::S_Pgm, IndexType::S_Compressed }) {
+    test_static_index_numeric_unique_key_find<uint16_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+    test_static_index_numeric_unique_key_find<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+    test_static_index_numeric_unique_key_find<uint64_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
   }
 
 }
 
 
 template<typename KeyT, typename ValueT>
-void test_static_index_numeric_non_unique_key_find(const IndexType index_type, const size_t index_param_1, const size_t index_param_2) {
+void test_static_index_numeric_non_unique_key_find(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const LayoutType layout = LayoutType::AoSLayout, const size_t leaf_scan_cachelines = 0) {
 
   size_t n = 10000;
   size_t m = 1000;
@@ -105,7 +127,11 @@ void test_static_index_numeric_non_unique_key_find(const IndexType index_type, c
   std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
     new DataTable<KeyT, ValueT>());
   std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
-    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
+
+  if (leaf_scan_cachelines != 0) {
+    dynamic_cast<BaseStaticIndex<KeyT, ValueT>*>(data_index.get())->set_leaf_scan_cachelines(leaf_scan_cachelines);
+  }
 
   std::unordered_map<KeyT, std::unordered_map<Uint64, ValueT>> validation_set;
 
@@ -140,6 +166,15 @@ void test_static_index_numeric_non_unique_key_find(const IndexType index_type, c
 
       EXPECT_EQ(*value, entry.second.at(offset));
     }
+
+    // first match only
+    ResultSink first_offset(1);
+
+    data_index->find(key, first_offset);
+
+    EXPECT_EQ(first_offset.size(), 1);
+
+    EXPECT_NE(entry.second.end(), entry.second.find(first_offset[0]));
   }
 
 }
@@ -152,6 +187,11 @@ TEST_F(StaticIndexNumericTest, NonUniqueKeyFindTest) {
     test_static_index_numeric_non_unique_key_find<uint32_t, uint64_t>(index_type, segments, INVALID_INDEX_PARAM);
     test_static_index_numeric_non_unique_key_find<uint64_t, uint64_t>(index_type, segments, INVALID_INDEX_PARAM);
   }
+  for (size_t target_error : { 1, 8, 64 }) {
+    test_static_index_numeric_non_unique_key_find<uint16_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+    test_static_index_numeric_non_unique_key_find<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+    test_static_index_numeric_non_unique_key_find<uint64_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+  }
 
   index_type = IndexType::S_Binary;
   for (size_t layers = 0; layers < 8; ++layers) {
@@ -169,23 +209,132 @@ TEST_F(StaticIndexNumericTest, NonUniqueKeyFindTest) {
     }
   }
 
+  // nodes are 4 layers deep with 4-byte keys, and 3 with 8-byte keys
   index_type = IndexType::S_Fast;
-  for (size_t layers = 0; layers <= 12; layers += 4) {
-    test_static_index_numeric_non_unique_key_find<uint32_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+  for (size_t nodes = 0; nodes <= 3; ++nodes) {
+    test_static_index_numeric_non_unique_key_find<uint32_t, uint64_t>(index_type, nodes * 4, INVALID_INDEX_PARAM);
+    test_static_index_numeric_non_unique_key_find<uint64_t, uint64_t>(index_type, nodes * 3, INVALID_INDEX_PARAM);
+  }
+
+  for (auto index_type : { IndexType::S_Eytzinger, IndexType::S_Veb, IndexType::S_Pgm, IndexType::S_Compressed }) {
+    test_static_index_numeric_non_unique_key_find<uint16_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+    test_static_index_numeric_non_unique_key_find<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+    test_static_index_numeric_non_unique_key_find<uint64_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
   }
 
 }
 
 
 template<typename KeyT, typename ValueT>
-void test_static_index_numeric_unique_key_find_range(const IndexType index_type, const size_t index_param_1, const size_t index_param_2) {
+void test_static_index_numeric_find_batch(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const LayoutType layout = LayoutType::AoSLayout) {
 
   size_t n = 10000;
+  size_t m = 1000;
+  
+  FastRandom rand_gen(0);
 
   std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
     new DataTable<KeyT, ValueT>());
   std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
-    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
+
+  std::unordered_map<KeyT, std::unordered_map<Uint64, ValueT>> validation_set;
+
+  // insert
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>() % m;
+    ValueT value = i + 2048;
+    
+    OffsetT offset = data_table->insert_tuple(key, value);
+    
+    validation_set[key][offset.raw_data()] = value;
+  }
+
+  // reorganize data
+  data_index->reorganize();
+
+  // half of the lookups hit nothing
+  std::vector<KeyT> keys;
+  for (size_t i = 0; i < 2 * m; ++i) {
+    keys.push_back(rand_gen.next<KeyT>() % (2 * m));
+  }
+
+  // find
+  std::vector<ResultSink> offsets(keys.size());
+  data_index->find_batch(keys.data(), keys.size(), offsets.data());
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto entry = validation_set.find(keys.at(i));
+
+    if (entry == validation_set.end()) {
+      EXPECT_EQ(offsets.at(i).size(), 0);
+      continue;
+    }
+
+    EXPECT_EQ(offsets.at(i).size(), entry->second.size());
+
+    for (size_t j = 0; j < offsets.at(i).size(); ++j) {
+      EXPECT_NE(entry->second.end(), entry->second.find(offsets.at(i)[j]));
+    }
+  }
+
+}
+
+TEST_F(StaticIndexNumericTest, FindBatchTest) {
+
+  IndexType index_type = IndexType::S_Interpolation;
+  for (size_t segments = 1; segments <= 10; ++segments) {
+    test_static_index_numeric_find_batch<uint16_t, uint64_t>(index_type, segments, INVALID_INDEX_PARAM);
+    test_static_index_numeric_find_batch<uint32_t, uint64_t>(index_type, segments, INVALID_INDEX_PARAM);
+    test_static_index_numeric_find_batch<uint64_t, uint64_t>(index_type, segments, INVALID_INDEX_PARAM);
+  }
+  for (size_t target_error : { 1, 8, 64 }) {
+    test_static_index_numeric_find_batch<uint16_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+    test_static_index_numeric_find_batch<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+    test_static_index_numeric_find_batch<uint64_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+  }
+
+  index_type = IndexType::S_Binary;
+  for (size_t layers = 0; layers < 8; ++layers) {
+    test_static_index_numeric_find_batch<uint16_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+    test_static_index_numeric_find_batch<uint32_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+    test_static_index_numeric_find_batch<uint64_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+  }
+
+  index_type = IndexType::S_KAry;
+  for (size_t layers = 0; layers < 4; ++layers) {
+    for (size_t k = 2; k < 5; ++k) {
+      test_static_index_numeric_find_batch<uint16_t, uint64_t>(index_type, layers, k);
+      test_static_index_numeric_find_batch<uint32_t, uint64_t>(index_type, layers, k);
+      test_static_index_numeric_find_batch<uint64_t, uint64_t>(index_type, layers, k);
+    }
+  }
+
+  // nodes are 4 layers deep with 4-byte keys, and 3 with 8-byte keys
+  index_type = IndexType::S_Fast;
+  for (size_t nodes = 0; nodes <= 3; ++nodes) {
+    test_static_index_numeric_find_batch<uint32_t, uint64_t>(index_type, nodes * 4, INVALID_INDEX_PARAM);
+    test_static_index_numeric_find_batch<uint64_t, uint64_t>(index_type, nodes * 3, INVALID_INDEX_PARAM);
+  }
+
+  for (auto index_type : { IndexType::S_Eytzinger, IndexType::S_Veb, IndexType::S_Pgm, IndexType::S_Compressed }) {
+    test_static_index_numeric_find_batch<uint16_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+    test_static_index_numeric_find_batch<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+    test_static_index_numeric_find_batch<uint64_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+  }
+
+}
+
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_unique_key_find_range(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const LayoutType layout = LayoutType::AoSLayout) {
+
+  size_t n = 10000;
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
 
   std::map<KeyT, std::pair<Uint64, ValueT>> validation_set;
   std::vector<KeyT> keys_vector;
@@ -231,7 +380,7 @@ void test_static_index_numeric_unique_key_find_range(const IndexType index_type,
 
     EXPECT_EQ(real_offsets.size(), offsets.size());
 
-    for (auto entry : real_offsets) {
+    for (auto entry : offsets) {
 
       EXPECT_NE(real_offsets.end(), real_offsets.find(entry));
     }
@@ -246,32 +395,45 @@ TEST_F(StaticIndexNumericTest, UniqueKeyFindRangeTest) {
     test_static_index_numeric_unique_key_find_range<uint32_t, uint64_t>(index_type, segments, INVALID_INDEX_PARAM);
     test_static_index_numeric_unique_key_find_range<uint64_t, uint64_t>(index_type, segments, INVALID_INDEX_PARAM);
   }
+  for (size_t target_error : { 1, 8, 64 }) {
+    test_static_index_numeric_unique_key_find_range<uint16_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+    test_static_index_numeric_unique_key_find_range<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+    test_static_index_numeric_unique_key_find_range<uint64_t, uint64_t>(index_type, INVALID_INDEX_PARAM, target_error);
+  }
+
+  index_type = IndexType::S_Binary;
+  for (size_t layers = 0; layers < 8; ++layers) {
+    test_static_index_numeric_unique_key_find_range<uint16_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+    test_static_index_numeric_unique_key_find_range<uint32_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+    test_static_index_numeric_unique_key_find_range<uint64_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+  }
 
-  // index_type = IndexType::S_Binary;
-  // for (size_t layers = 0; layers < 8; ++layers) {
-  //   test_static_index_numeric_unique_key_find_range<uint16_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
-  //   test_static_index_numeric_unique_key_find_range<uint32_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
-  //   test_static_index_numeric_unique_key_find_range<uint64_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
-  // }
+  index_type = IndexType::S_KAry;
+  for (size_t layers = 0; layers < 4; ++layers) {
+    for (size_t k = 2; k < 5; ++k) {
+      test_static_index_numeric_unique_key_find_range<uint16_t, uint64_t>(index_type, layers, k);
+      test_static_index_numeric_unique_key_find_range<uint32_t, uint64_t>(index_type, layers, k);
+      test_static_index_numeric_unique_key_find_range<uint64_t, uint64_t>(index_type, layers, k);
+    }
+  }
 
-  // index_type = IndexType::S_KAry;
-  // for (size_t layers = 0; layers < 4; ++layers) {
-  //   for (size_t k = 2; k < 5; ++k) {
-  //     test_static_index_numeric_unique_key_find_range<uint16_t, uint64_t>(index_type, layers, k);
-  //     test_static_index_numeric_unique_key_find_range<uint32_t, uint64_t>(index_type, layers, k);
-  //     test_static_index_numeric_unique_key_find_range<uint64_t, uint64_t>(index_type, layers, k);
-  //   }
-  // }
+  // nodes are 4 layers deep with 4-byte keys, and 3 with 8-byte keys
+  index_type = IndexType::S_Fast;
+  for (size_t nodes = 0; nodes <= 3; ++nodes) {
+    test_static_index_numeric_unique_key_find_range<uint32_t, uint64_t>(index_type, nodes * 4, INVALID_INDEX_PARAM);
+    test_static_index_numeric_unique_key_find_range<uint64_t, uint64_t>(index_type, nodes * 3, INVALID_INDEX_PARAM);
+  }
 
-  // index_type = IndexType::S_Fast;
-  // for (size_t layers = 0; layers <= 12; layers += 4) {
-  //   test_static_index_numeric_unique_key_find_range<uint32_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
-  // }
+  for (auto index_type : { IndexType::S_Eytzinger, IndexType::S_Veb, IndexType::S_Pgm, IndexType::S_Compressed }) {
+    test_static_index_numeric_unique_key_find_range<uint16_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+    test_static_index_numeric_unique_key_find_range<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+    test_static_index_numeric_unique_key_find_range<uint64_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+  }
 
 }
 
 template<typename KeyT, typename ValueT>
-void test_static_index_numeric_non_unique_key_find_range(const IndexType index_type, const size_t index_param_1, const size_t index_param_2) {
+void test_static_index_numeric_non_unique_key_find_range(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const LayoutType layout = LayoutType::AoSLayout) {
 
   size_t n = 10000;
   size_t m = 1000;
@@ -281,7 +443,7 @@ void test_static_index_numeric_non_unique_key_find_range(const IndexType index_t
   std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
     new DataTable<KeyT, ValueT>());
   std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
-    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
 
   std::map<KeyT, std::unordered_map<Uint64, ValueT>> validation_set;
   std::vector<KeyT> keys_vector;
@@ -326,7 +488,7 @@ void test_static_index_numeric_non_unique_key_find_range(const IndexType index_t
     
     EXPECT_EQ(real_offsets.size(), offsets.size());
 
-    for (auto entry : real_offsets) {
+    for (auto entry : offsets) {
 
       EXPECT_NE(real_offsets.end(), real_offsets.find(entry));      
     }
@@ -344,38 +506,46 @@ TEST_F(StaticIndexNumericTest, NonUniqueKeyFindRangeTest) {
     test_static_index_numeric_non_unique_key_find_range<uint64_t, uint64_t>(index_type, segments, INVALID_INDEX_PARAM);
   }
 
-  // index_type = IndexType::S_Binary;
-  // for (size_t layers = 0; layers < 8; ++layers) {
-  //   test_static_index_numeric_non_unique_key_find_range<uint16_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
-  //   test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
-  //   test_static_index_numeric_non_unique_key_find_range<uint64_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
-  // }
+  index_type = IndexType::S_Binary;
+  for (size_t layers = 0; layers < 8; ++layers) {
+    test_static_index_numeric_non_unique_key_find_range<uint16_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+    test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+    test_static_index_numeric_non_unique_key_find_range<uint64_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
+  }
+
+  index_type = IndexType::S_KAry;
+  for (size_t layers = 0; layers < 4; ++layers) {
+    for (size_t k = 2; k < 5; ++k) {
+      test_static_index_numeric_non_unique_key_find_range<uint16_t, uint64_t>(index_type, layers, k);
+      test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(index_type, layers, k);
+      test_static_index_numeric_non_unique_key_find_range<uint64_t, uint64_t>(index_type, layers, k);
+    }
+  }
 
-  // index_type = IndexType::S_KAry;
-  // for (size_t layers = 0; layers < 4; ++layers) {
-  //   for (size_t k = 2; k < 5; ++k) {
-  //     test_static_index_numeric_non_unique_key_find_range<uint16_t, uint64_t>(index_type, layers, k);
-  //     test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(index_type, layers, k);
-  //     test_static_index_numeric_non_unique_key_find_range<uint64_t, uint64_t>(index_type, layers, k);
-  //   }
-  // }
+  // nodes are 4 layers deep with 4-byte keys, and 3 with 8-byte keys
+  index_type = IndexType::S_Fast;
+  for (size_t nodes = 0; nodes <= 3; ++nodes) {
+    test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(index_type, nodes * 4, INVALID_INDEX_PARAM);
+    test_static_index_numeric_non_unique_key_find_range<uint64_t, uint64_t>(index_type, nodes * 3, INVALID_INDEX_PARAM);
+  }
 
-  // index_type = IndexType::S_Fast;
-  // for (size_t layers = 0; layers <= 12; layers += 4) {
-  //   test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(index_type, layers, INVALID_INDEX_PARAM);
-  // }
+  for (auto index_type : { IndexType::S_Eytzinger, IndexType::S_Veb, IndexType::S_Pgm, IndexType::S_Compressed }) {
+    test_static_index_numeric_non_unique_key_find_range<uint16_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+    test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+    test_static_index_numeric_non_unique_key_find_range<uint64_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+  }
 }
 
 
 template<typename KeyT, typename ValueT>
-void test_static_index_numeric_scan(const IndexType index_type, const size_t index_param_1, const size_t index_param_2) {
+void test_static_index_numeric_scan(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const LayoutType layout = LayoutType::AoSLayout) {
 
   size_t n = 10000;
 
   std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
     new DataTable<KeyT, ValueT>());
   std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
-    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
 
   std::map<KeyT, std::pair<Uint64, ValueT>> validation_set;
 
@@ -425,6 +595,917 @@ TEST_F(StaticIndexNumericTest, ScanTest) {
 }
 
 
+// looks up keys through the concrete index type.
+template<typename KeyT>
+struct DispatchFindFunctor {
+  DispatchFindFunctor(const KeyT key, std::vector<Uint64> &values) : key_(key), values_(values) {}
+
+  template<typename IndexT>
+  void operator()(IndexT *data_index) {
+    EXPECT_TRUE(typeid(*data_index) == typeid(IndexT));
+
+    ResultSink sink(values_);
+    data_index->find(key_, sink);
+  }
+
+  KeyT key_;
+  std::vector<Uint64> &values_;
+};
+
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_dispatch(const IndexType index_type, const size_t index_param_1, const size_t index_param_2) {
+
+  size_t n = 10000;
+  size_t m = 1000;
+  
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+
+  // insert
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>() % m;
+    ValueT value = i + 2048;
+    
+    data_table->insert_tuple(key, value);
+  }
+
+  // reorganize data
+  data_index->reorganize();
+
+  // find
+  for (KeyT key = 0; key < 2 * m; ++key) {
+
+    std::vector<Uint64> offsets;
+    data_index->find(key, offsets);
+
+    std::vector<Uint64> dispatch_offsets;
+    DispatchFindFunctor<KeyT> func(key, dispatch_offsets);
+    dispatch_numeric_index<KeyT, ValueT>(index_type, data_index.get(), func);
+
+    EXPECT_EQ(offsets, dispatch_offsets);
+  }
+}
+
+TEST_F(StaticIndexNumericTest, DispatchTest) {
+
+  test_static_index_numeric_dispatch<uint64_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM);
+  test_static_index_numeric_dispatch<uint64_t, uint64_t>(IndexType::S_Binary, 4, INVALID_INDEX_PARAM);
+  test_static_index_numeric_dispatch<uint64_t, uint64_t>(IndexType::S_KAry, 2, 4);
+  test_static_index_numeric_dispatch<uint32_t, uint64_t>(IndexType::S_Fast, 4, INVALID_INDEX_PARAM);
+  test_static_index_numeric_dispatch<uint64_t, uint64_t>(IndexType::S_Eytzinger, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+  test_static_index_numeric_dispatch<uint64_t, uint64_t>(IndexType::S_Veb, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM);
+  test_static_index_numeric_dispatch<uint64_t, uint64_t>(IndexType::S_Pgm, 16, INVALID_INDEX_PARAM);
+  test_static_index_numeric_dispatch<uint64_t, uint64_t>(IndexType::S_Compressed, 16, INVALID_INDEX_PARAM);
+}
+
+
+
+
+
+
+
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_parallel_reorganize(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const size_t thread_count) {
+
+  // spans multiple data blocks, and the last block is not full
+  size_t n = 25500;
+  size_t m = 5000;
+
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> serial_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> parallel_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+
+  std::unordered_set<KeyT> keys;
+
+  // insert
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>() % m;
+    ValueT value = i + 2048;
+    
+    data_table->insert_tuple(key, value);
+
+    keys.insert(key);
+  }
+
+  // reorganize data
+  serial_index->reorganize(1);
+  parallel_index->reorganize(thread_count);
+
+  EXPECT_EQ(serial_index->size(), n);
+  EXPECT_EQ(parallel_index->size(), n);
+
+  // find
+  for (KeyT key = 0; key < m; ++key) {
+
+    std::vector<Uint64> serial_offsets;
+    std::vector<Uint64> parallel_offsets;
+
+    serial_index->find(key, serial_offsets);
+    parallel_index->find(key, parallel_offsets);
+
+    EXPECT_EQ(serial_offsets.empty(), keys.find(key) == keys.end());
+
+    // equal keys may be ordered differently
+    std::sort(serial_offsets.begin(), serial_offsets.end());
+    std::sort(parallel_offsets.begin(), parallel_offsets.end());
+
+    EXPECT_EQ(serial_offsets, parallel_offsets);
+  }
+}
+
+TEST_F(StaticIndexNumericTest, ParallelReorganizeTest) {
+
+  for (size_t thread_count = 2; thread_count <= 8; thread_count *= 2) {
+    test_static_index_numeric_parallel_reorganize<uint16_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, thread_count);
+    test_static_index_numeric_parallel_reorganize<uint64_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, thread_count);
+    test_static_index_numeric_parallel_reorganize<uint32_t, uint64_t>(IndexType::S_Interpolation, INVALID_INDEX_PARAM, 8, thread_count);
+    test_static_index_numeric_parallel_reorganize<uint32_t, uint64_t>(IndexType::S_Binary, 7, INVALID_INDEX_PARAM, thread_count);
+    test_static_index_numeric_parallel_reorganize<uint64_t, uint64_t>(IndexType::S_KAry, 3, 4, thread_count);
+    test_static_index_numeric_parallel_reorganize<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM, thread_count);
+    test_static_index_numeric_parallel_reorganize<uint32_t, uint64_t>(IndexType::S_Eytzinger, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, thread_count);
+    test_static_index_numeric_parallel_reorganize<uint64_t, uint64_t>(IndexType::S_Veb, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, thread_count);
+    test_static_index_numeric_parallel_reorganize<uint32_t, uint64_t>(IndexType::S_Pgm, 8, INVALID_INDEX_PARAM, thread_count);
+    test_static_index_numeric_parallel_reorganize<uint16_t, uint64_t>(IndexType::S_Compressed, 32, INVALID_INDEX_PARAM, thread_count);
+  }
+}
+
+TEST_F(StaticIndexNumericTest, SoALayoutTest) {
+
+  LayoutType layout = LayoutType::SoALayout;
+
+  test_static_index_numeric_unique_key_find<uint16_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_non_unique_key_find<uint64_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_find_batch<uint32_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_unique_key_find_range<uint64_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_scan<uint64_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, layout);
+
+  test_static_index_numeric_unique_key_find<uint16_t, uint64_t>(IndexType::S_Binary, 4, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_non_unique_key_find<uint64_t, uint64_t>(IndexType::S_Binary, 4, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_find_batch<uint32_t, uint64_t>(IndexType::S_Binary, 4, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(IndexType::S_Binary, 4, INVALID_INDEX_PARAM, layout);
+
+  test_static_index_numeric_unique_key_find<uint16_t, uint64_t>(IndexType::S_KAry, 3, 4, layout);
+  test_static_index_numeric_non_unique_key_find<uint64_t, uint64_t>(IndexType::S_KAry, 3, 4, layout);
+  test_static_index_numeric_find_batch<uint32_t, uint64_t>(IndexType::S_KAry, 3, 4, layout);
+  test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(IndexType::S_KAry, 3, 4, layout);
+
+  test_static_index_numeric_unique_key_find<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_non_unique_key_find<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_find_batch<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM, layout);
+  test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM, layout);
+
+  for (auto index_type : { IndexType::S_Eytzinger, IndexType::S_Veb, IndexType::S_Pgm, IndexType::S_Compressed }) {
+    test_static_index_numeric_unique_key_find<uint16_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_non_unique_key_find<uint64_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_find_batch<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_non_unique_key_find_range<uint32_t, uint64_t>(index_type, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, layout);
+  }
+}
+
+TEST_F(StaticIndexNumericTest, LeafScanTest) {
+
+  for (auto layout : { LayoutType::AoSLayout, LayoutType::SoALayout }) {
+    for (size_t cachelines = 1; cachelines <= 4; cachelines *= 2) {
+      test_static_index_numeric_unique_key_find<uint16_t, uint64_t>(IndexType::S_Binary, 4, INVALID_INDEX_PARAM, layout, cachelines);
+      test_static_index_numeric_unique_key_find<uint32_t, uint64_t>(IndexType::S_Binary, 4, INVALID_INDEX_PARAM, layout, cachelines);
+      test_static_index_numeric_non_unique_key_find<uint64_t, uint64_t>(IndexType::S_Binary, 4, INVALID_INDEX_PARAM, layout, cachelines);
+      test_static_index_numeric_non_unique_key_find<uint32_t, uint64_t>(IndexType::S_KAry, 3, 4, layout, cachelines);
+      test_static_index_numeric_unique_key_find<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM, layout, cachelines);
+      test_static_index_numeric_non_unique_key_find<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM, layout, cachelines);
+    }
+  }
+}
+
+
+// trees over the entire key set have an incomplete last level for most sizes.
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_tree_sizes(const IndexType index_type, const size_t n) {
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get()));
+
+  std::unordered_map<KeyT, Uint64> validation_set;
+
+  // insert odd keys only
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = 2 * (n - i) - 1;
+    ValueT value = i + 2048;
+
+    OffsetT offset = data_table->insert_tuple(key, value);
+
+    validation_set[key] = offset.raw_data();
+  }
+
+  // reorganize data
+  data_index->reorganize();
+
+  for (KeyT key = 0; key <= 2 * n + 1; ++key) {
+
+    std::vector<Uint64> offsets;
+    data_index->find(key, offsets);
+
+    if (key % 2 == 0 || key > 2 * n) {
+      EXPECT_EQ(offsets.size(), 0);
+      continue;
+    }
+    EXPECT_EQ(offsets.size(), 1);
+    EXPECT_EQ(offsets.at(0), validation_set[key]);
+
+    // the range starts at the lower bound of key - 1, which is missing
+    std::vector<Uint64> range_offsets;
+    data_index->find_range(key - 1, key + 2, range_offsets);
+
+    EXPECT_EQ(range_offsets.size(), (key + 2 <= 2 * n) ? 2 : 1);
+    EXPECT_EQ(range_offsets.at(0), validation_set[key]);
+  }
+}
+
+TEST_F(StaticIndexNumericTest, TreeSizesTest) {
+
+  for (auto index_type : { IndexType::S_Eytzinger, IndexType::S_Veb, IndexType::S_Pgm, IndexType::S_Compressed }) {
+    for (size_t n = 1; n <= 130; ++n) {
+      test_static_index_numeric_tree_sizes<uint32_t, uint64_t>(index_type, n);
+    }
+  }
+}
+
+
+// keys cover the whole key domain, including keys whose highest bit is set.
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_full_range_keys(const IndexType index_type, const size_t index_param_1, const size_t index_param_2) {
+
+  size_t n = 10000;
+
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+
+  std::unordered_map<KeyT, std::unordered_set<Uint64>> validation_set;
+
+  // insert
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>();
+    ValueT value = i + 2048;
+
+    OffsetT offset = data_table->insert_tuple(key, value);
+
+    validation_set[key].insert(offset.raw_data());
+  }
 
+  // reorganize data
+  data_index->reorganize();
 
+  for (auto &entry : validation_set) {
 
+    std::vector<Uint64> offsets;
+    data_index->find(entry.first, offsets);
+
+    EXPECT_EQ(offsets.size(), entry.second.size());
+    for (auto offset : offsets) {
+      EXPECT_NE(entry.second.end(), entry.second.find(offset));
+    }
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>();
+
+    std::vector<Uint64> offsets;
+    data_index->find(key, offsets);
+
+    auto entry = validation_set.find(key);
+    EXPECT_EQ(offsets.size(), (entry == validation_set.end()) ? 0 : entry->second.size());
+  }
+}
+
+TEST_F(StaticIndexNumericTest, FastSimdWidthTest) {
+
+  IndexType index_type = IndexType::S_Fast;
+
+  // widths that the CPU does not support fall back to narrower ones.
+  for (size_t simd_width = 128; simd_width <= 512; simd_width *= 2) {
+    for (size_t nodes = 0; nodes <= 3; ++nodes) {
+      test_static_index_numeric_unique_key_find<uint32_t, uint64_t>(index_type, nodes * 4, simd_width);
+      test_static_index_numeric_unique_key_find<uint64_t, uint64_t>(index_type, nodes * 3, simd_width);
+      test_static_index_numeric_non_unique_key_find<uint32_t, uint64_t>(index_type, nodes * 4, simd_width);
+      test_static_index_numeric_non_unique_key_find<uint64_t, uint64_t>(index_type, nodes * 3, simd_width);
+      test_static_index_numeric_find_batch<uint64_t, uint64_t>(index_type, nodes * 3, simd_width);
+      test_static_index_numeric_non_unique_key_find_range<uint64_t, uint64_t>(index_type, nodes * 3, simd_width);
+      test_static_index_numeric_full_range_keys<uint32_t, uint64_t>(index_type, nodes * 4, simd_width);
+      test_static_index_numeric_full_range_keys<uint64_t, uint64_t>(index_type, nodes * 3, simd_width);
+    }
+  }
+}
+
+
+// node searches with SIMD comparisons and with the scalar loop must agree.
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_kary_node_search(const size_t num_layers, const size_t num_arys) {
+
+  size_t n = 10000;
+
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<static_index::KAryIndex<KeyT, ValueT>> data_index(
+    new static_index::KAryIndex<KeyT, ValueT>(data_table.get(), num_layers, num_arys));
+
+  std::unordered_map<KeyT, size_t> validation_set;
+  std::vector<KeyT> keys;
+
+  // insert
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>();
+    ValueT value = i + 2048;
+
+    data_table->insert_tuple(key, value);
+
+    validation_set[key] += 1;
+    keys.push_back(key);
+    keys.push_back(rand_gen.next<KeyT>());
+  }
+
+  // reorganize data
+  data_index->reorganize(1);
+
+  for (auto key : keys) {
+
+    std::vector<Uint64> simd_offsets;
+    ResultSink simd_sink(simd_offsets);
+    data_index->set_simd_search(true);
+    data_index->find(key, simd_sink);
+
+    std::vector<Uint64> scalar_offsets;
+    ResultSink scalar_sink(scalar_offsets);
+    data_index->set_simd_search(false);
+    data_index->find(key, scalar_sink);
+
+    auto entry = validation_set.find(key);
+    EXPECT_EQ(simd_offsets.size(), (entry == validation_set.end()) ? 0 : entry->second);
+
+    std::sort(simd_offsets.begin(), simd_offsets.end());
+    std::sort(scalar_offsets.begin(), scalar_offsets.end());
+    EXPECT_EQ(simd_offsets, scalar_offsets);
+  }
+}
+
+TEST_F(StaticIndexNumericTest, KAryNodeSearchTest) {
+
+  // 64-bit blocks of 128-bit registers, with keys of both signs
+  const int64_t block_keys[2] = { -5, 7 };
+  for (int64_t key : { int64_t(-6), int64_t(-5), int64_t(0), int64_t(7), int64_t(8) }) {
+    for (size_t count = 0; count <= 2; ++count) {
+      size_t expected = 0;
+      for (size_t i = 0; i < count; ++i) {
+        expected += (block_keys[i] < key);
+      }
+      EXPECT_EQ(simd_block_count_less_sse2(block_keys, key, count), expected);
+    }
+  }
+
+  for (size_t k : { 3, 5, 9, 17 }) {
+    for (size_t layers = 1; layers <= 3; ++layers) {
+      test_static_index_numeric_kary_node_search<uint16_t, uint64_t>(layers, k);
+      test_static_index_numeric_kary_node_search<uint32_t, uint64_t>(layers, k);
+      test_static_index_numeric_kary_node_search<uint64_t, uint64_t>(layers, k);
+    }
+  }
+}
+
+
+// skewed keys with long runs of duplicates, so that models have many segments 
+// and the lower bounds of missing keys may lie beyond the error window.
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_skewed_keys(const IndexType index_type, const size_t index_param_1, const size_t index_param_2) {
+
+  size_t n = 10000;
+
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+
+  std::map<KeyT, std::unordered_set<Uint64>> validation_set;
+
+  for (size_t i = 0; i < n; ++i) {
+
+    // cubes of small numbers, and runs of up to 500 copies of every 100th of them
+    KeyT base = rand_gen.next<KeyT>() % 1600;
+    KeyT key = base * base * base;
+    size_t copies = (base % 100 == 0) ? rand_gen.next<uint32_t>() % 500 + 1 : 1;
+
+    for (size_t j = 0; j < copies; ++j) {
+      OffsetT offset = data_table->insert_tuple(key, i + 2048);
+      validation_set[key].insert(offset.raw_data());
+    }
+  }
+
+  data_index->reorganize();
+
+  for (auto &entry : validation_set) {
+
+    for (KeyT key : { KeyT(entry.first - 1), entry.first, KeyT(entry.first + 1) }) {
+
+      std::vector<Uint64> offsets;
+      ResultSink sink(offsets);
+      data_index->find(key, sink);
+
+      auto match = validation_set.find(key);
+      if (match == validation_set.end()) {
+        EXPECT_EQ(offsets.size(), 0);
+      } else {
+        EXPECT_EQ(offsets.size(), match->second.size());
+      }
+    }
+
+    // the range starts at a missing key, right after the entries of entry.first
+    KeyT lhs_key = entry.first + 1;
+    KeyT rhs_key = entry.first + 100000;
+
+    std::vector<Uint64> range_offsets;
+    ResultSink range_sink(range_offsets);
+    data_index->find_range(lhs_key, rhs_key, range_sink);
+
+    size_t expected_count = 0;
+    for (auto it = validation_set.lower_bound(lhs_key); it != validation_set.end() && it->first <= rhs_key; ++it) {
+      expected_count += it->second.size();
+    }
+    EXPECT_EQ(range_offsets.size(), expected_count);
+    for (auto offset : range_offsets) {
+      KeyT key = *data_table->get_tuple_key(OffsetT(offset));
+      EXPECT_TRUE(key >= lhs_key && key <= rhs_key);
+    }
+  }
+}
+
+// an index over an empty table has no levels, and finds nothing.
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_pgm_empty_table(const size_t error_bound) {
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(IndexType::S_Pgm, data_table.get(), error_bound, INVALID_INDEX_PARAM));
+
+  data_index->reorganize();
+
+  EXPECT_EQ(data_index->size(), 0);
+  typedef static_index::PgmIndex<KeyT, ValueT> PgmIndexT;
+  EXPECT_EQ(dynamic_cast<PgmIndexT*>(data_index.get())->level_count(), 0);
+
+  std::vector<Uint64> offsets;
+  ResultSink sink(offsets);
+  data_index->find(KeyT(0), sink);
+  data_index->find_range(KeyT(0), KeyT(100), sink);
+  EXPECT_EQ(offsets.size(), 0);
+
+  data_index->print();
+}
+
+TEST_F(StaticIndexNumericTest, PgmErrorBoundTest) {
+
+  test_static_index_numeric_pgm_empty_table<uint32_t, uint64_t>(16);
+  test_static_index_numeric_pgm_empty_table<uint64_t, uint64_t>(16);
+
+  for (size_t error_bound : { 1, 4, 64 }) {
+    for (size_t inner_error_bound : { 1, 4 }) {
+      test_static_index_numeric_skewed_keys<uint32_t, uint64_t>(IndexType::S_Pgm, error_bound, inner_error_bound);
+      test_static_index_numeric_skewed_keys<uint64_t, uint64_t>(IndexType::S_Pgm, error_bound, inner_error_bound);
+    }
+  }
+}
+
+TEST_F(StaticIndexNumericTest, InterpolationSegmentationTest) {
+
+  for (size_t segments : { 1, 10, 100 }) {
+    test_static_index_numeric_skewed_keys<uint32_t, uint64_t>(IndexType::S_Interpolation, segments, INVALID_INDEX_PARAM);
+    test_static_index_numeric_skewed_keys<uint64_t, uint64_t>(IndexType::S_Interpolation, segments, INVALID_INDEX_PARAM);
+  }
+
+  for (size_t target_error : { 1, 4, 64 }) {
+    test_static_index_numeric_skewed_keys<uint32_t, uint64_t>(IndexType::S_Interpolation, INVALID_INDEX_PARAM, target_error);
+    test_static_index_numeric_skewed_keys<uint64_t, uint64_t>(IndexType::S_Interpolation, INVALID_INDEX_PARAM, target_error);
+  }
+}
+
+
+// readers share one index, and each of them looks up every key many times,
+// so that the find operations sampled for the stats come from all threads.
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_concurrent_find(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const size_t thread_count) {
+
+  size_t n = 20000;
+  size_t m = 5000;
+  size_t rounds = 20;
+
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2));
+
+  std::vector<size_t> key_counts(m, 0);
+
+  for (size_t i = 0; i < n; ++i) {
+    KeyT key = rand_gen.next<KeyT>() % m;
+    data_table->insert_tuple(key, i + 2048);
+    key_counts[key] += 1;
+  }
+
+  data_index->reorganize();
+
+  std::atomic<size_t> mismatch_count(0);
+
+  std::vector<std::thread> readers;
+  for (size_t thread_id = 0; thread_id < thread_count; ++thread_id) {
+    readers.push_back(std::thread([&, thread_id]() {
+      for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < m; ++i) {
+          KeyT key = KeyT((i + thread_id * m / thread_count) % m);
+          std::vector<Uint64> offsets;
+          ResultSink sink(offsets);
+          data_index->find(key, sink);
+          if (offsets.size() != key_counts[key]) {
+            mismatch_count.fetch_add(1);
+          }
+        }
+      }
+    }));
+  }
+
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(mismatch_count.load(), 0);
+}
+
+TEST_F(StaticIndexNumericTest, ConcurrentFindTest) {
+
+  for (size_t thread_count : { 2, 4, 8 }) {
+    test_static_index_numeric_concurrent_find<uint32_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, thread_count);
+    test_static_index_numeric_concurrent_find<uint64_t, uint64_t>(IndexType::S_Interpolation, INVALID_INDEX_PARAM, 8, thread_count);
+  }
+}
+
+
+// an index loaded from an image answers like the index that wrote it.
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_image(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const LayoutType layout = LayoutType::AoSLayout) {
+
+  size_t n = 10000;
+  size_t m = 3000;
+
+  std::string path = "static_index_numeric_test.img";
+
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> image_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
+
+  for (size_t i = 0; i < n; ++i) {
+    data_table->insert_tuple(rand_gen.next<KeyT>() % m, i + 2048);
+  }
+
+  data_index->reorganize();
+
+  typedef BaseStaticIndex<KeyT, ValueT> StaticIndexT;
+
+  EXPECT_TRUE(dynamic_cast<StaticIndexT*>(data_index.get())->serialize(path));
+  EXPECT_TRUE(dynamic_cast<StaticIndexT*>(image_index.get())->load(path));
+
+  EXPECT_EQ(image_index->size(), n);
+
+  for (KeyT key = 0; key <= m; ++key) {
+
+    std::vector<Uint64> offsets;
+    ResultSink sink(offsets);
+    data_index->find(key, sink);
+
+    std::vector<Uint64> image_offsets;
+    ResultSink image_sink(image_offsets);
+    image_index->find(key, image_sink);
+
+    std::sort(offsets.begin(), offsets.end());
+    std::sort(image_offsets.begin(), image_offsets.end());
+    EXPECT_EQ(offsets, image_offsets);
+
+    std::vector<Uint64> range_offsets;
+    ResultSink range_sink(range_offsets);
+    data_index->find_range(key, key + 10, range_sink);
+
+    std::vector<Uint64> image_range_offsets;
+    ResultSink image_range_sink(image_range_offsets);
+    image_index->find_range(key, key + 10, image_range_sink);
+
+    EXPECT_EQ(range_offsets, image_range_offsets);
+  }
+
+  // the image of one index type does not load into another
+  IndexType other_type = (index_type == IndexType::S_Eytzinger) ? IndexType::S_Veb : IndexType::S_Eytzinger;
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> other_index(
+    create_numeric_index<KeyT, ValueT>(other_type, data_table.get(), INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, layout));
+  EXPECT_FALSE(dynamic_cast<StaticIndexT*>(other_index.get())->load(path));
+
+  // nor into an index over a table of other blocks, or with more tuples
+  std::unique_ptr<DataTable<KeyT, ValueT>> other_table(
+    new DataTable<KeyT, ValueT>(MaxBlockCapacity / 2));
+  for (size_t i = 0; i < n; ++i) {
+    other_table->insert_tuple(KeyT(i % m), i + 2048);
+  }
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> other_table_index(
+    create_numeric_index<KeyT, ValueT>(index_type, other_table.get(), index_param_1, index_param_2, layout));
+  EXPECT_FALSE(dynamic_cast<StaticIndexT*>(other_table_index.get())->load(path));
+
+  data_table->insert_tuple(KeyT(0), n + 2048);
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> grown_table_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
+  EXPECT_FALSE(dynamic_cast<StaticIndexT*>(grown_table_index.get())->load(path));
+
+  std::remove(path.c_str());
+}
+
+TEST_F(StaticIndexNumericTest, ImageTest) {
+
+  for (auto layout : { LayoutType::AoSLayout, LayoutType::SoALayout }) {
+    test_static_index_numeric_image<uint32_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_image<uint64_t, uint64_t>(IndexType::S_Interpolation, INVALID_INDEX_PARAM, 8, layout);
+    test_static_index_numeric_image<uint32_t, uint64_t>(IndexType::S_Binary, 4, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_image<uint64_t, uint64_t>(IndexType::S_KAry, 3, 5, layout);
+    test_static_index_numeric_image<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_image<uint64_t, uint64_t>(IndexType::S_Fast, 6, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_image<uint16_t, uint64_t>(IndexType::S_Eytzinger, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_image<uint32_t, uint64_t>(IndexType::S_Veb, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_image<uint64_t, uint64_t>(IndexType::S_Pgm, 16, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_image<uint32_t, uint64_t>(IndexType::S_Compressed, 64, INVALID_INDEX_PARAM, layout);
+  }
+}
+
+
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_huge_pages(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const HugePageMode mode, const LayoutType layout = LayoutType::AoSLayout) {
+
+  // large enough for the container and the table chunks to be mapped with huge pages
+  size_t n = 100000;
+
+  FastRandom rand_gen(0);
+
+  set_huge_page_mode(mode);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> data_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
+
+  std::unordered_map<KeyT, Uint64> validation_set;
+
+  // insert
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>();
+    ValueT value = i + 2048;
+
+    if (validation_set.find(key) != validation_set.end()) { continue; }
+
+    OffsetT offset = data_table->insert_tuple(key, value);
+
+    validation_set[key] = offset.raw_data();
+  }
+
+  // reorganize data
+  data_index->reorganize();
+
+  set_huge_page_mode(HugePageNone);
+
+  EXPECT_GT(huge_page_mapped_bytes(), 0);
+
+  // find
+  for (auto &entry : validation_set) {
+
+    std::vector<Uint64> offsets;
+
+    data_index->find(entry.first, offsets);
+
+    EXPECT_EQ(offsets.size(), 1);
+    EXPECT_EQ(offsets.at(0), entry.second);
+  }
+
+  data_index.reset();
+  data_table.reset();
+
+  EXPECT_EQ(huge_page_mapped_bytes(), 0);
+}
+
+TEST_F(StaticIndexNumericTest, HugePageTest) {
+
+  for (auto mode : { HugePageTransparent, HugePageExplicit }) {
+    for (auto layout : { LayoutType::AoSLayout, LayoutType::SoALayout }) {
+      test_static_index_numeric_huge_pages<uint32_t, uint64_t>(IndexType::S_Interpolation, 10, INVALID_INDEX_PARAM, mode, layout);
+      test_static_index_numeric_huge_pages<uint64_t, uint64_t>(IndexType::S_Binary, 7, INVALID_INDEX_PARAM, mode, layout);
+      test_static_index_numeric_huge_pages<uint64_t, uint64_t>(IndexType::S_KAry, 3, 5, mode, layout);
+      test_static_index_numeric_huge_pages<uint32_t, uint64_t>(IndexType::S_Fast, 8, INVALID_INDEX_PARAM, mode, layout);
+      test_static_index_numeric_huge_pages<uint64_t, uint64_t>(IndexType::S_Eytzinger, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, mode, layout);
+      test_static_index_numeric_huge_pages<uint64_t, uint64_t>(IndexType::S_Veb, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, mode, layout);
+      test_static_index_numeric_huge_pages<uint64_t, uint64_t>(IndexType::S_Pgm, 16, INVALID_INDEX_PARAM, mode, layout);
+      test_static_index_numeric_huge_pages<uint64_t, uint64_t>(IndexType::S_Compressed, 128, INVALID_INDEX_PARAM, mode, layout);
+    }
+  }
+}
+
+
+// blocks unpacked with SIMD gathers and with scalar unpacking must agree, for all key widths.
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_compressed_unpack(const size_t block_size, const KeyT key_mask) {
+
+  size_t n = 10000;
+
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<static_index::CompressedIndex<KeyT, ValueT>> data_index(
+    new static_index::CompressedIndex<KeyT, ValueT>(data_table.get(), block_size));
+
+  std::unordered_map<KeyT, std::unordered_set<Uint64>> validation_set;
+  std::vector<KeyT> keys;
+
+  // insert
+  for (size_t i = 0; i < n; ++i) {
+
+    KeyT key = rand_gen.next<KeyT>() & key_mask;
+    ValueT value = i + 2048;
+
+    OffsetT offset = data_table->insert_tuple(key, value);
+
+    validation_set[key].insert(offset.raw_data());
+    keys.push_back(key);
+    keys.push_back(rand_gen.next<KeyT>() & key_mask);
+  }
+
+  // reorganize data
+  data_index->reorganize(1);
+
+  // single entry blocks only add overhead
+  if (block_size >= 8) {
+    EXPECT_LT(data_index->compressed_size(), n * (sizeof(KeyT) + sizeof(Uint64)));
+  }
+
+  for (auto key : keys) {
+
+    std::vector<Uint64> simd_offsets;
+    ResultSink simd_sink(simd_offsets);
+    data_index->set_simd_unpack(true);
+    data_index->find(key, simd_sink);
+
+    std::vector<Uint64> scalar_offsets;
+    ResultSink scalar_sink(scalar_offsets);
+    data_index->set_simd_unpack(false);
+    data_index->find(key, scalar_sink);
+
+    auto entry = validation_set.find(key);
+    EXPECT_EQ(simd_offsets.size(), (entry == validation_set.end()) ? 0 : entry->second.size());
+    for (auto offset : simd_offsets) {
+      EXPECT_NE(entry->second.end(), entry->second.find(offset));
+    }
+
+    EXPECT_EQ(simd_offsets, scalar_offsets);
+  }
+}
+
+TEST_F(StaticIndexNumericTest, CompressedUnpackTest) {
+
+  for (size_t block_size : { 1, 8, 64, 256 }) {
+    // keys of a few bits, of 32-bit and 64-bit gathers, and of full width
+    test_static_index_numeric_compressed_unpack<uint16_t, uint64_t>(block_size, 0xfff);
+    test_static_index_numeric_compressed_unpack<uint32_t, uint64_t>(block_size, 0xffffffff);
+    test_static_index_numeric_compressed_unpack<uint64_t, uint64_t>(block_size, (uint64_t(1) << 40) - 1);
+    test_static_index_numeric_compressed_unpack<uint64_t, uint64_t>(block_size, ~uint64_t(0));
+  }
+
+  for (size_t block_size : { 16, 128 }) {
+    test_static_index_numeric_skewed_keys<uint32_t, uint64_t>(IndexType::S_Compressed, block_size, INVALID_INDEX_PARAM);
+    test_static_index_numeric_full_range_keys<uint64_t, uint64_t>(IndexType::S_Compressed, block_size, INVALID_INDEX_PARAM);
+  }
+}
+
+
+// indexes with equal keys collapsed into value runs must return the same values as without.
+template<typename KeyT, typename ValueT>
+void test_static_index_numeric_value_runs(const IndexType index_type, const size_t index_param_1, const size_t index_param_2, const LayoutType layout = LayoutType::AoSLayout) {
+
+  size_t n = 20000;
+  size_t m = 100;
+
+  FastRandom rand_gen(0);
+
+  std::unique_ptr<DataTable<KeyT, ValueT>> data_table(
+    new DataTable<KeyT, ValueT>());
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> run_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
+  std::unique_ptr<BaseIndex<KeyT, ValueT>> plain_index(
+    create_numeric_index<KeyT, ValueT>(index_type, data_table.get(), index_param_1, index_param_2, layout));
+
+  typedef BaseStaticIndex<KeyT, ValueT> StaticIndexT;
+  dynamic_cast<StaticIndexT*>(plain_index.get())->set_value_runs(false);
+
+  std::unordered_map<KeyT, size_t> validation_set;
+
+  // keys are multiples of 3, so that the keys in between are missing
+  for (size_t i = 0; i < n; ++i) {
+    KeyT key = rand_gen.next<KeyT>() % m * 3;
+    data_table->insert_tuple(key, i + 2048);
+    validation_set[key] += 1;
+  }
+
+  run_index->reorganize(4);
+  plain_index->reorganize(4);
+
+  EXPECT_TRUE(dynamic_cast<StaticIndexT*>(run_index.get())->has_value_runs());
+  EXPECT_FALSE(dynamic_cast<StaticIndexT*>(plain_index.get())->has_value_runs());
+  EXPECT_EQ(run_index->size(), n);
+
+  for (KeyT key = 0; key <= 3 * m; ++key) {
+
+    std::vector<Uint64> run_offsets;
+    std::vector<Uint64> plain_offsets;
+
+    // runs are returned in key order, and values of a key in table order
+    run_index->find(key, run_offsets);
+    plain_index->find(key, plain_offsets);
+    EXPECT_EQ(run_offsets.size(), validation_set.count(key) ? validation_set[key] : 0);
+    std::sort(run_offsets.begin(), run_offsets.end());
+    std::sort(plain_offsets.begin(), plain_offsets.end());
+    EXPECT_EQ(run_offsets, plain_offsets);
+
+    run_offsets.clear();
+    plain_offsets.clear();
+    run_index->find_range(key, key + 7, run_offsets);
+    plain_index->find_range(key, key + 7, plain_offsets);
+    std::sort(run_offsets.begin(), run_offsets.end());
+    std::sort(plain_offsets.begin(), plain_offsets.end());
+    EXPECT_EQ(run_offsets, plain_offsets);
+
+    run_offsets.clear();
+    plain_offsets.clear();
+    run_index->scan_reverse(key, run_offsets);
+    plain_index->scan_reverse(key, plain_offsets);
+    EXPECT_EQ(run_offsets.size(), plain_offsets.size());
+
+    // a run is cut off at the limit of the sink
+    run_offsets.clear();
+    ResultSink limited_sink(run_offsets, 3);
+    run_index->find(key, limited_sink);
+    EXPECT_EQ(run_offsets.size(), validation_set.count(key) ? std::min(validation_set[key], size_t(3)) : 0);
+  }
+
+  std::vector<Uint64> run_offsets;
+  std::vector<Uint64> plain_offsets;
+  run_index->scan_full(run_offsets, n / 2);
+  plain_index->scan_full(plain_offsets, n / 2);
+  EXPECT_EQ(run_offsets.size(), n / 2);
+  std::sort(run_offsets.begin(), run_offsets.end());
+  std::sort(plain_offsets.begin(), plain_offsets.end());
+  EXPECT_EQ(run_offsets, plain_offsets);
+}
+
+TEST_F(StaticIndexNumericTest, ValueRunsTest) {
+
+  for (auto layout : { LayoutType::AoSLayout, LayoutType::SoALayout }) {
+    test_static_index_numeric_value_runs<uint32_t, uint64_t>(IndexType::S_Interpolation, 4, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_value_runs<uint64_t, uint64_t>(IndexType::S_Interpolation, INVALID_INDEX_PARAM, 8, layout);
+    test_static_index_numeric_value_runs<uint32_t, uint64_t>(IndexType::S_Binary, 3, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_value_runs<uint64_t, uint64_t>(IndexType::S_KAry, 2, 3, layout);
+    test_static_index_numeric_value_runs<uint32_t, uint64_t>(IndexType::S_Fast, 4, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_value_runs<uint16_t, uint64_t>(IndexType::S_Eytzinger, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_value_runs<uint64_t, uint64_t>(IndexType::S_Veb, INVALID_INDEX_PARAM, INVALID_INDEX_PARAM, layout);
+    test_static_index_numeric_value_runs<uint32_t, uint64_t>(IndexType::S_Pgm, 4, INVALID_INDEX_PARAM, layout);
+  }
+}